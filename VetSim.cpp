@@ -22,6 +22,7 @@
 */
 
 #include "vetsim.h"
+#include "scenario.h"
 using namespace std;
 
 // FOR WIN32 SIGNAL HANDLING
@@ -219,6 +220,8 @@ int vetsim()
 	(void)start_task("pluseTask", pulseTask);
 	(void)start_task("simstatusMain", simstatusMain);
 	(void)start_task("bcastReply", bcastReply);
+	(void)start_task("scenarioPreload", scenarioPreloadMain);
+	(void)start_task("scenarioPrefetch", scenarioPrefetchMain);
 	printf("Hostname: %s\n", simmgr_shm->server.name);
 	sprintf_s(msg_buf, BUF_SIZE, "simmgrInitialization %s", "Done");
 	log_message("", msg_buf);
@@ -362,8 +365,12 @@ simmgrInitialize(void)
 
 	clearAllTrends();
 
-	timer_start(hrcheck_handler, 5 );
-	timer_start(awrr_check, 10);
+	// The headless runner calls these itself, on the virtual clock
+	if (!simClockIsVirtual())
+	{
+		timer_start(hrcheck_handler, 5);
+		timer_start(awrr_check, 10);
+	}
 }
 
 void
@@ -471,6 +478,7 @@ resetAllParameters(void)
 	simmgr_shm->status.telesim.vid[1].command = 0;
 	simmgr_shm->status.telesim.vid[1].param = 0;
 	simmgr_shm->status.telesim.vid[1].next = 0;
+	statusMarkDirty(STATUS_SEC_ALL);
 
 	// instructor/cardiac
 	sprintf_s(simmgr_shm->instructor.cardiac.rhythm, STR_SIZE, "%s", "");
@@ -764,6 +772,10 @@ awrr_check(void)
 			}
 		}
 	}
+	if (simmgr_shm->status.respiration.awRR != oldRate)
+	{
+		statusMarkDirty(STATUS_SEC_RESPIRATION);
+	}
 }
 
 ULONGLONG cprLast = 0;
@@ -775,6 +787,7 @@ cpr_check(void)
 {
 	ULONGLONG now = simmgr_shm->server.msec_time;
 	ULONGLONG cprCurrent = simmgr_shm->status.cpr.last;
+	int running = simmgr_shm->status.cpr.running;
 
 	if (cprCurrent != cprLast)
 	{
@@ -801,6 +814,10 @@ cpr_check(void)
 			simmgr_shm->status.cpr.running = 0;
 		}
 	}
+	if (simmgr_shm->status.cpr.running != running)
+	{
+		statusMarkDirty(STATUS_SEC_CPR);
+	}
 }
 ULONGLONG shockLast = 0;
 ULONGLONG shockStartTime = 0;
@@ -811,6 +828,7 @@ shock_check(void)
 {
 	ULONGLONG now = simmgr_shm->server.msec_time;
 	ULONGLONG shockCurrent = simmgr_shm->status.defibrillation.last;
+	int shock = simmgr_shm->status.defibrillation.shock;
 
 	if (shockCurrent != shockLast)
 	{
@@ -841,6 +859,10 @@ shock_check(void)
 			shockStartTime = 0;
 		}
 	}
+	if (simmgr_shm->status.defibrillation.shock != shock)
+	{
+		statusMarkDirty(STATUS_SEC_DEFIBRILLATION);
+	}
 }
 /*
  * hrcheck_handler
@@ -888,7 +910,7 @@ void hrcheck_handler(void )     // current system time  )    // additional infor
 	float minutes;
 	int i;
 	int intervals = -1;
-	// int oldRate;
+	int oldRate = simmgr_shm->status.cardiac.avg_rate;
 	int newRate;
 	int setRate = simmgr_shm->status.cardiac.rate;
 	int newBeat = 0;
@@ -908,6 +930,10 @@ void hrcheck_handler(void )     // current system time  )    // additional infor
 		{
 			hrLog[i] = firstTime;
 		}
+		if (oldRate != 0)
+		{
+			statusMarkDirty(STATUS_SEC_CARDIAC);
+		}
 		return;
 	}
 	else if (hrLogLastNatural != simmgr_shm->status.cardiac.pulseCount)
@@ -1043,6 +1069,10 @@ void hrcheck_handler(void )     // current system time  )    // additional infor
 		}
 #endif
 	}
+	if (simmgr_shm->status.cardiac.avg_rate != oldRate)
+	{
+		statusMarkDirty(STATUS_SEC_CARDIAC);
+	}
 }
 
 /*
@@ -1053,7 +1083,7 @@ msec_time_update(void)
 {
 	ULONGLONG msec;
 
-	msec = GetTickCount64();
+	msec = simClockMsec();
 
 	simmgr_shm->server.msec_time = msec;
 	// printf("Tick %ull\n", simmgr_shm->server.msec_time);
@@ -1079,17 +1109,17 @@ time_update(void)
 
 #ifdef WIN32
 	time_t now;
-	SYSTEMTIME st;
+	struct tm st;
 
-	GetLocalTime(&st);
+	now = simClockTime();
+	localtime_s(&st, &now);
 	sprintf_s(simmgr_shm->server.server_time, STR_SIZE, "%04d/%02d/%02d %02d:%02d:%02d",
-		st.wYear,
-		st.wMonth,
-		st.wDay,
-		st.wHour,
-		st.wMinute,
-		st.wSecond);
-	now = time(nullptr);
+		st.tm_year + 1900,
+		st.tm_mon + 1,
+		st.tm_mday,
+		st.tm_hour,
+		st.tm_min,
+		st.tm_sec);
 	elapsedTimeSeconds = (int)difftime(now, scenario_start_time);
 #else
 	struct tm tm;
@@ -1117,6 +1147,7 @@ time_update(void)
 		min = (sec / 60);
 		hour = min / 60;
 		sprintf_s(simmgr_shm->status.scenario.clockDisplay, STR_SIZE, "%02d:%02d:%02d", hour, min % 60, sec % 60);
+		statusMarkDirty(STATUS_SEC_SCENARIO);
 	}
 	if ((elapsedTimeSeconds > MAX_SCENARIO_RUNTIME) &&
 		((scenario_state == ScenarioState::ScenarioRunning) ||
@@ -1145,6 +1176,7 @@ time_update(void)
 		min = (sec / 60);
 		hour = min / 60;
 		sprintf_s(simmgr_shm->status.scenario.runtimeScene, STR_SIZE, "%02d:%02d:%02d", hour, min % 60, sec % 60);
+		statusMarkDirty(STATUS_SEC_SCENARIO);
 
 		seconds = elapsedTimeSeconds % 60;
 		if ((seconds == 0) && (last_time_sec != 0))
@@ -1240,7 +1272,7 @@ setTrend(struct trend* trend, int end, int current, int duration)
 	{
 		trend->current = (double)current;
 		trend->changePerSecond = diff / duration;
-		trend->nextTime = time(0) + 1;
+		trend->nextTime = simClockTime() + 1;
 	}
 	else
 	{
@@ -1251,6 +1283,12 @@ setTrend(struct trend* trend, int end, int current, int duration)
 	return ((int)trend->current);
 }
 
+static bool
+trendDue(struct trend* trend)
+{
+	return (trend->nextTime && (trend->nextTime <= simClockTime()));
+}
+
 int
 trendProcess(struct trend* trend)
 {
@@ -1258,7 +1296,7 @@ trendProcess(struct trend* trend)
 	double newval;
 	int rval;
 
-	now = time(0);
+	now = simClockTime();
 
 	if (trend->nextTime && (trend->nextTime <= now))
 	{
@@ -1359,6 +1397,7 @@ scan_commands(void)
 	bool newIsPulsed;
 	int v;
 	char buf[BUF_SIZE];
+	int statusChanged = 0;	// STATUS_SEC_* sections changed by the commands below
 
 	// Lock the command interface before processing commands
 	trycount = 0;
@@ -1374,12 +1413,14 @@ scan_commands(void)
 	{
 		simmgr_shm->status.scenario.record = simmgr_shm->instructor.scenario.record;
 		simmgr_shm->instructor.scenario.record = -1;
+		statusChanged |= STATUS_SEC_SCENARIO;
 	}
 	if (simmgr_shm->instructor.scenario.error_flag >= 0)
 	{
 		simmgr_shm->status.scenario.error_flag = simmgr_shm->instructor.scenario.error_flag;
 		sprintf_s(simmgr_shm->status.scenario.error_message, "%s", simmgr_shm->instructor.scenario.error_message);
 		simmgr_shm->instructor.scenario.error_flag = -1;
+		statusChanged |= STATUS_SEC_SCENARIO;
 	}
 	if (strlen(simmgr_shm->instructor.scenario.state) > 0)
 	{
@@ -1454,6 +1495,7 @@ scan_commands(void)
 			break;
 		case ScenarioState::ScenarioStopped:
 			sprintf_s(simmgr_shm->status.scenario.active, STR_SIZE, "%s", simmgr_shm->instructor.scenario.active);
+			statusChanged |= STATUS_SEC_SCENARIO;
 			break;
 		}
 		sprintf_s(simmgr_shm->instructor.scenario.active, STR_SIZE, "%s", "");
@@ -1490,6 +1532,7 @@ scan_commands(void)
 			simlog_entry(buf);
 		}
 		sprintf_s(simmgr_shm->instructor.cardiac.rhythm, STR_SIZE, "%s", "");
+		statusChanged |= STATUS_SEC_CARDIAC;
 
 	}
 	if (simmgr_shm->instructor.cardiac.rate >= 0)
@@ -1530,6 +1573,7 @@ scan_commands(void)
 			}
 		}
 		simmgr_shm->instructor.cardiac.rate = -1;
+		statusChanged |= STATUS_SEC_CARDIAC;
 	}
 	if (simmgr_shm->instructor.cardiac.nibp_rate >= 0)
 	{
@@ -1540,6 +1584,7 @@ scan_commands(void)
 			simlog_entry(buf);
 		}
 		simmgr_shm->instructor.cardiac.nibp_rate = -1;
+		statusChanged |= STATUS_SEC_CARDIAC;
 	}
 	if (simmgr_shm->instructor.cardiac.nibp_read >= 0)
 	{
@@ -1548,6 +1593,7 @@ scan_commands(void)
 			simmgr_shm->status.cardiac.nibp_read = simmgr_shm->instructor.cardiac.nibp_read;
 		}
 		simmgr_shm->instructor.cardiac.nibp_read = -1;
+		statusChanged |= STATUS_SEC_CARDIAC;
 	}
 	if (simmgr_shm->instructor.cardiac.nibp_linked_hr >= 0)
 	{
@@ -1556,6 +1602,7 @@ scan_commands(void)
 			simmgr_shm->status.cardiac.nibp_linked_hr = simmgr_shm->instructor.cardiac.nibp_linked_hr;
 		}
 		simmgr_shm->instructor.cardiac.nibp_linked_hr = -1;
+		statusChanged |= STATUS_SEC_CARDIAC;
 	}
 	if (simmgr_shm->instructor.cardiac.nibp_freq >= 0)
 	{
@@ -1568,26 +1615,31 @@ scan_commands(void)
 			}
 		}
 		simmgr_shm->instructor.cardiac.nibp_freq = -1;
+		statusChanged |= STATUS_SEC_CARDIAC;
 	}
 	if (strlen(simmgr_shm->instructor.cardiac.pwave) > 0)
 	{
 		sprintf_s(simmgr_shm->status.cardiac.pwave, STR_SIZE, "%s", simmgr_shm->instructor.cardiac.pwave);
 		sprintf_s(simmgr_shm->instructor.cardiac.pwave, STR_SIZE, "%s", "");
+		statusChanged |= STATUS_SEC_CARDIAC;
 	}
 	if (simmgr_shm->instructor.cardiac.pr_interval >= 0)
 	{
 		simmgr_shm->status.cardiac.pr_interval = simmgr_shm->instructor.cardiac.pr_interval;
 		simmgr_shm->instructor.cardiac.pr_interval = -1;
+		statusChanged |= STATUS_SEC_CARDIAC;
 	}
 	if (simmgr_shm->instructor.cardiac.qrs_interval >= 0)
 	{
 		simmgr_shm->status.cardiac.qrs_interval = simmgr_shm->instructor.cardiac.qrs_interval;
 		simmgr_shm->instructor.cardiac.qrs_interval = -1;
+		statusChanged |= STATUS_SEC_CARDIAC;
 	}
 	if (simmgr_shm->instructor.cardiac.qrs_interval >= 0)
 	{
 		simmgr_shm->status.cardiac.qrs_interval = simmgr_shm->instructor.cardiac.qrs_interval;
 		simmgr_shm->instructor.cardiac.qrs_interval = -1;
+		statusChanged |= STATUS_SEC_CARDIAC;
 	}
 	if (simmgr_shm->instructor.cardiac.bps_sys >= 0)
 	{
@@ -1596,6 +1648,7 @@ scan_commands(void)
 			simmgr_shm->status.cardiac.bps_sys,
 			simmgr_shm->instructor.cardiac.transfer_time);
 		simmgr_shm->instructor.cardiac.bps_sys = -1;
+		statusChanged |= STATUS_SEC_CARDIAC;
 	}
 	if (simmgr_shm->instructor.cardiac.bps_dia >= 0)
 	{
@@ -1604,48 +1657,57 @@ scan_commands(void)
 			simmgr_shm->status.cardiac.bps_dia,
 			simmgr_shm->instructor.cardiac.transfer_time);
 		simmgr_shm->instructor.cardiac.bps_dia = -1;
+		statusChanged |= STATUS_SEC_CARDIAC;
 	}
 	if (simmgr_shm->instructor.cardiac.pea >= 0)
 	{
 		simmgr_shm->status.cardiac.pea = simmgr_shm->instructor.cardiac.pea;
 		simmgr_shm->instructor.cardiac.pea = -1;
+		statusChanged |= STATUS_SEC_CARDIAC;
 	}
 	if (simmgr_shm->instructor.cardiac.right_dorsal_pulse_strength >= 0)
 	{
 		simmgr_shm->status.cardiac.right_dorsal_pulse_strength = simmgr_shm->instructor.cardiac.right_dorsal_pulse_strength;
 		simmgr_shm->instructor.cardiac.right_dorsal_pulse_strength = -1;
+		statusChanged |= STATUS_SEC_CARDIAC;
 	}
 	if (simmgr_shm->instructor.cardiac.right_femoral_pulse_strength >= 0)
 	{
 		simmgr_shm->status.cardiac.right_femoral_pulse_strength = simmgr_shm->instructor.cardiac.right_femoral_pulse_strength;
 		simmgr_shm->instructor.cardiac.right_femoral_pulse_strength = -1;
+		statusChanged |= STATUS_SEC_CARDIAC;
 	}
 	if (simmgr_shm->instructor.cardiac.left_dorsal_pulse_strength >= 0)
 	{
 		simmgr_shm->status.cardiac.left_dorsal_pulse_strength = simmgr_shm->instructor.cardiac.left_dorsal_pulse_strength;
 		simmgr_shm->instructor.cardiac.left_dorsal_pulse_strength = -1;
+		statusChanged |= STATUS_SEC_CARDIAC;
 	}
 	if (simmgr_shm->instructor.cardiac.left_femoral_pulse_strength >= 0)
 	{
 		simmgr_shm->status.cardiac.left_femoral_pulse_strength = simmgr_shm->instructor.cardiac.left_femoral_pulse_strength;
 		simmgr_shm->instructor.cardiac.left_femoral_pulse_strength = -1;
+		statusChanged |= STATUS_SEC_CARDIAC;
 	}
 	if (simmgr_shm->instructor.cardiac.vpc_freq >= 0)
 	{
 		simmgr_shm->status.cardiac.vpc_freq = simmgr_shm->instructor.cardiac.vpc_freq;
 		simmgr_shm->instructor.cardiac.vpc_freq = -1;
+		statusChanged |= STATUS_SEC_CARDIAC;
 	}
 	/*
 	if ( simmgr_shm->instructor.cardiac.vpc_delay >= 0 )
 	{
 		simmgr_shm->status.cardiac.vpc_delay = simmgr_shm->instructor.cardiac.vpc_delay;
 		simmgr_shm->instructor.cardiac.vpc_delay = -1;
+		statusChanged |= STATUS_SEC_CARDIAC;
 	}
 	*/
 	if (strlen(simmgr_shm->instructor.cardiac.vpc) > 0)
 	{
 		sprintf_s(simmgr_shm->status.cardiac.vpc, STR_SIZE, "%s", simmgr_shm->instructor.cardiac.vpc);
 		sprintf_s(simmgr_shm->instructor.cardiac.vpc, STR_SIZE, "%s", "");
+		statusChanged |= STATUS_SEC_CARDIAC;
 		switch (simmgr_shm->status.cardiac.vpc[0])
 		{
 		case '1':
@@ -1681,21 +1743,25 @@ scan_commands(void)
 	{
 		sprintf_s(simmgr_shm->status.cardiac.vfib_amplitude, STR_SIZE, "%s", simmgr_shm->instructor.cardiac.vfib_amplitude);
 		sprintf_s(simmgr_shm->instructor.cardiac.vfib_amplitude, STR_SIZE, "%s", "");
+		statusChanged |= STATUS_SEC_CARDIAC;
 	}
 	if (strlen(simmgr_shm->instructor.cardiac.heart_sound) > 0)
 	{
 		sprintf_s(simmgr_shm->status.cardiac.heart_sound, STR_SIZE, "%s", simmgr_shm->instructor.cardiac.heart_sound);
 		sprintf_s(simmgr_shm->instructor.cardiac.heart_sound, STR_SIZE, "%s", "");
+		statusChanged |= STATUS_SEC_CARDIAC;
 	}
 	if (simmgr_shm->instructor.cardiac.heart_sound_volume >= 0)
 	{
 		simmgr_shm->status.cardiac.heart_sound_volume = simmgr_shm->instructor.cardiac.heart_sound_volume;
 		simmgr_shm->instructor.cardiac.heart_sound_volume = -1;
+		statusChanged |= STATUS_SEC_CARDIAC;
 	}
 	if (simmgr_shm->instructor.cardiac.heart_sound_mute >= 0)
 	{
 		simmgr_shm->status.cardiac.heart_sound_mute = simmgr_shm->instructor.cardiac.heart_sound_mute;
 		simmgr_shm->instructor.cardiac.heart_sound_mute = -1;
+		statusChanged |= STATUS_SEC_CARDIAC;
 	}
 
 	if (simmgr_shm->instructor.cardiac.ecg_indicator >= 0)
@@ -1707,6 +1773,7 @@ scan_commands(void)
 			simlog_entry(buf);
 		}
 		simmgr_shm->instructor.cardiac.ecg_indicator = -1;
+		statusChanged |= STATUS_SEC_CARDIAC;
 	}
 	if (simmgr_shm->instructor.cardiac.bp_cuff >= 0)
 	{
@@ -1717,6 +1784,7 @@ scan_commands(void)
 			simlog_entry(buf);
 		}
 		simmgr_shm->instructor.cardiac.bp_cuff = -1;
+		statusChanged |= STATUS_SEC_CARDIAC;
 	}
 	if (simmgr_shm->instructor.cardiac.arrest >= 0)
 	{
@@ -1727,6 +1795,7 @@ scan_commands(void)
 			simlog_entry(buf);
 		}
 		simmgr_shm->instructor.cardiac.arrest = -1;
+		statusChanged |= STATUS_SEC_CARDIAC;
 	}
 	simmgr_shm->instructor.cardiac.transfer_time = -1;
 
@@ -1735,43 +1804,51 @@ scan_commands(void)
 	{
 		sprintf_s(simmgr_shm->status.respiration.left_lung_sound, STR_SIZE, "%s", simmgr_shm->instructor.respiration.left_lung_sound);
 		sprintf_s(simmgr_shm->instructor.respiration.left_lung_sound, STR_SIZE, "%s", "");
+		statusChanged |= STATUS_SEC_RESPIRATION;
 	}
 	if (strlen(simmgr_shm->instructor.respiration.right_lung_sound) > 0)
 	{
 		sprintf_s(simmgr_shm->status.respiration.right_lung_sound, STR_SIZE, "%s", simmgr_shm->instructor.respiration.right_lung_sound);
 		sprintf_s(simmgr_shm->instructor.respiration.right_lung_sound, STR_SIZE, "%s", "");
+		statusChanged |= STATUS_SEC_RESPIRATION;
 	}
 	/*
 	if ( simmgr_shm->instructor.respiration.inhalation_duration >= 0 )
 	{
 		simmgr_shm->status.respiration.inhalation_duration = simmgr_shm->instructor.respiration.inhalation_duration;
 		simmgr_shm->instructor.respiration.inhalation_duration = -1;
+		statusChanged |= STATUS_SEC_RESPIRATION;
 	}
 	if ( simmgr_shm->instructor.respiration.exhalation_duration >= 0 )
 	{
 		simmgr_shm->status.respiration.exhalation_duration = simmgr_shm->instructor.respiration.exhalation_duration;
 		simmgr_shm->instructor.respiration.exhalation_duration = -1;
+		statusChanged |= STATUS_SEC_RESPIRATION;
 	}
 	*/
 	if (simmgr_shm->instructor.respiration.left_lung_sound_volume >= 0)
 	{
 		simmgr_shm->status.respiration.left_lung_sound_volume = simmgr_shm->instructor.respiration.left_lung_sound_volume;
 		simmgr_shm->instructor.respiration.left_lung_sound_volume = -1;
+		statusChanged |= STATUS_SEC_RESPIRATION;
 	}
 	if (simmgr_shm->instructor.respiration.left_lung_sound_mute >= 0)
 	{
 		simmgr_shm->status.respiration.left_lung_sound_mute = simmgr_shm->instructor.respiration.left_lung_sound_mute;
 		simmgr_shm->instructor.respiration.left_lung_sound_mute = -1;
+		statusChanged |= STATUS_SEC_RESPIRATION;
 	}
 	if (simmgr_shm->instructor.respiration.right_lung_sound_volume >= 0)
 	{
 		simmgr_shm->status.respiration.right_lung_sound_volume = simmgr_shm->instructor.respiration.right_lung_sound_volume;
 		simmgr_shm->instructor.respiration.right_lung_sound_volume = -1;
+		statusChanged |= STATUS_SEC_RESPIRATION;
 	}
 	if (simmgr_shm->instructor.respiration.right_lung_sound_mute >= 0)
 	{
 		simmgr_shm->status.respiration.right_lung_sound_mute = simmgr_shm->instructor.respiration.right_lung_sound_mute;
 		simmgr_shm->instructor.respiration.right_lung_sound_mute = -1;
+		statusChanged |= STATUS_SEC_RESPIRATION;
 	}
 	if (simmgr_shm->instructor.respiration.rate >= 0)
 	{
@@ -1786,6 +1863,7 @@ scan_commands(void)
 			setRespirationPeriods(simmgr_shm->status.respiration.rate, simmgr_shm->instructor.respiration.rate);
 		}
 		simmgr_shm->instructor.respiration.rate = -1;
+		statusChanged |= STATUS_SEC_RESPIRATION;
 	}
 	if (simmgr_shm->instructor.respiration.spo2 >= 0)
 	{
@@ -1794,6 +1872,7 @@ scan_commands(void)
 			simmgr_shm->status.respiration.spo2,
 			simmgr_shm->instructor.respiration.transfer_time);
 		simmgr_shm->instructor.respiration.spo2 = -1;
+		statusChanged |= STATUS_SEC_RESPIRATION;
 	}
 
 	if (simmgr_shm->instructor.respiration.etco2 >= 0)
@@ -1803,6 +1882,7 @@ scan_commands(void)
 			simmgr_shm->status.respiration.etco2,
 			simmgr_shm->instructor.respiration.transfer_time);
 		simmgr_shm->instructor.respiration.etco2 = -1;
+		statusChanged |= STATUS_SEC_RESPIRATION;
 	}
 	if (simmgr_shm->instructor.respiration.etco2_indicator >= 0)
 	{
@@ -1814,6 +1894,7 @@ scan_commands(void)
 		}
 
 		simmgr_shm->instructor.respiration.etco2_indicator = -1;
+		statusChanged |= STATUS_SEC_RESPIRATION;
 	}
 	if (simmgr_shm->instructor.respiration.spo2_indicator >= 0)
 	{
@@ -1824,6 +1905,7 @@ scan_commands(void)
 			simlog_entry(buf);
 		}
 		simmgr_shm->instructor.respiration.spo2_indicator = -1;
+		statusChanged |= STATUS_SEC_RESPIRATION;
 	}
 	if (simmgr_shm->instructor.respiration.chest_movement >= 0)
 	{
@@ -1832,11 +1914,13 @@ scan_commands(void)
 			simmgr_shm->status.respiration.chest_movement = simmgr_shm->instructor.respiration.chest_movement;
 		}
 		simmgr_shm->instructor.respiration.chest_movement = -1;
+		statusChanged |= STATUS_SEC_RESPIRATION;
 	}
 	if (simmgr_shm->instructor.respiration.manual_breath >= 0)
 	{
 		simmgr_shm->status.respiration.manual_count++;
 		simmgr_shm->instructor.respiration.manual_breath = -1;
+		statusChanged |= STATUS_SEC_RESPIRATION;
 	}
 	simmgr_shm->instructor.respiration.transfer_time = -1;
 
@@ -1848,6 +1932,7 @@ scan_commands(void)
 			simmgr_shm->status.general.temperature,
 			simmgr_shm->instructor.general.transfer_time);
 		simmgr_shm->instructor.general.temperature = -1;
+		statusChanged |= STATUS_SEC_GENERAL;
 	}
 	if (strlen(simmgr_shm->instructor.general.temperature_units) > 0)
 	{
@@ -1860,6 +1945,7 @@ scan_commands(void)
 					simmgr_shm->instructor.general.temperature_units);
 			}
 			sprintf_s(simmgr_shm->instructor.general.temperature_units, STR_SIZE, "%s", "");
+			statusChanged |= STATUS_SEC_GENERAL;
 		}
 	}
 	if (simmgr_shm->instructor.general.temperature_enable >= 0)
@@ -1871,17 +1957,19 @@ scan_commands(void)
 			simlog_entry(buf);
 		}
 		simmgr_shm->instructor.general.temperature_enable = -1;
+		statusChanged |= STATUS_SEC_GENERAL;
 	}
 	simmgr_shm->instructor.general.transfer_time = -1;
 	if (strlen(simmgr_shm->instructor.general.clockStart) > 0)
 	{
 		struct tm tm;
 		time_t now;
-		now = std::time(nullptr);
+		now = simClockTime();
 		localtime_s(&tm, &now);
 
 		sprintf_s(simmgr_shm->status.general.clockStart, STR_SIZE, "%s", simmgr_shm->instructor.general.clockStart);
 		sprintf_s(simmgr_shm->instructor.general.clockStart, STR_SIZE, "%s", "");
+		statusChanged |= STATUS_SEC_GENERAL;
 		sprintf_s(simmgr_shm->status.general.clockStart, STR_SIZE, "%02d:%02d:%02d", tm.tm_hour, tm.tm_min, tm.tm_sec);
 		sprintf_s(buf, BUF_SIZE, "%s %02d %02d %02d", "time returned", tm.tm_hour, tm.tm_min, tm.tm_sec);
 		log_message("", buf);
@@ -1893,26 +1981,31 @@ scan_commands(void)
 	{
 		sprintf_s(simmgr_shm->status.vocals.filename, STR_SIZE, "%s", simmgr_shm->instructor.vocals.filename);
 		sprintf_s(simmgr_shm->instructor.vocals.filename, STR_SIZE, "%s", "");
+		statusChanged |= STATUS_SEC_VOCALS;
 	}
 	if (simmgr_shm->instructor.vocals.repeat >= 0)
 	{
 		simmgr_shm->status.vocals.repeat = simmgr_shm->instructor.vocals.repeat;
 		simmgr_shm->instructor.vocals.repeat = -1;
+		statusChanged |= STATUS_SEC_VOCALS;
 	}
 	if (simmgr_shm->instructor.vocals.volume >= 0)
 	{
 		simmgr_shm->status.vocals.volume = simmgr_shm->instructor.vocals.volume;
 		simmgr_shm->instructor.vocals.volume = -1;
+		statusChanged |= STATUS_SEC_VOCALS;
 	}
 	if (simmgr_shm->instructor.vocals.play >= 0)
 	{
 		simmgr_shm->status.vocals.play = simmgr_shm->instructor.vocals.play;
 		simmgr_shm->instructor.vocals.play = -1;
+		statusChanged |= STATUS_SEC_VOCALS;
 	}
 	if (simmgr_shm->instructor.vocals.mute >= 0)
 	{
 		simmgr_shm->status.vocals.mute = simmgr_shm->instructor.vocals.mute;
 		simmgr_shm->instructor.vocals.mute = -1;
+		statusChanged |= STATUS_SEC_VOCALS;
 	}
 
 	// media
@@ -1920,11 +2013,13 @@ scan_commands(void)
 	{
 		sprintf_s(simmgr_shm->status.media.filename, STR_SIZE, "%s", simmgr_shm->instructor.media.filename);
 		sprintf_s(simmgr_shm->instructor.media.filename, STR_SIZE, "%s", "");
+		statusChanged |= STATUS_SEC_MEDIA;
 	}
 	if (simmgr_shm->instructor.media.play != -1)
 	{
 		simmgr_shm->status.media.play = simmgr_shm->instructor.media.play;
 		simmgr_shm->instructor.media.play = -1;
+		statusChanged |= STATUS_SEC_MEDIA;
 	}
 	// telesim
 	if (simmgr_shm->instructor.telesim.enable >= 0)
@@ -1936,6 +2031,7 @@ scan_commands(void)
 			simlog_entry(buf);
 		}
 		simmgr_shm->instructor.telesim.enable = -1;
+		statusChanged |= STATUS_SEC_TELESIM;
 	}
 	for (v = 0; v < TSIM_WINDOWS; v++)
 	{
@@ -1943,6 +2039,7 @@ scan_commands(void)
 		{
 			sprintf_s(simmgr_shm->status.telesim.vid[v].name, STR_SIZE, "%s", simmgr_shm->instructor.telesim.vid[v].name);
 			sprintf_s(simmgr_shm->instructor.telesim.vid[v].name, STR_SIZE, "%s", "");
+			statusChanged |= STATUS_SEC_TELESIM;
 		}
 		if (simmgr_shm->instructor.telesim.vid[v].next > 0 &&
 			simmgr_shm->instructor.telesim.vid[v].next != simmgr_shm->status.telesim.vid[v].next)
@@ -1952,6 +2049,7 @@ scan_commands(void)
 			simmgr_shm->status.telesim.vid[v].command = simmgr_shm->instructor.telesim.vid[v].command;
 			simmgr_shm->status.telesim.vid[v].param = simmgr_shm->instructor.telesim.vid[v].param;
 			simmgr_shm->status.telesim.vid[v].next = simmgr_shm->instructor.telesim.vid[v].next;
+			statusChanged |= STATUS_SEC_TELESIM;
 		}
 	}
 	// CPR
@@ -1964,6 +2062,7 @@ scan_commands(void)
 			simmgr_shm->status.cpr.running = 1;
 		}
 		simmgr_shm->instructor.cpr.compression = -1;
+		statusChanged |= STATUS_SEC_CPR;
 	}
 	// Defibbrilation
 	if (simmgr_shm->instructor.defibrillation.shock >= 0)
@@ -1973,18 +2072,27 @@ scan_commands(void)
 			simmgr_shm->status.defibrillation.last += 1;
 		}
 		simmgr_shm->instructor.defibrillation.shock = -1;
+		statusChanged |= STATUS_SEC_DEFIBRILLATION;
 	}
 	if (simmgr_shm->instructor.defibrillation.energy >= 0)
 	{
 		simmgr_shm->status.defibrillation.energy = simmgr_shm->instructor.defibrillation.energy;
 		simmgr_shm->instructor.defibrillation.energy = -1;
+		statusChanged |= STATUS_SEC_DEFIBRILLATION;
 	}
+	initApplied();
+
 	// Release the MUTEX
 	releaseInstructorLock();
 	vs_iiLockTaken = 0;
 
 	// Process the trends
 	// We do this even if no scenario is running, to allow an instructor simple, manual control
+	if (trendDue(&cardiacTrend) || trendDue(&sysTrend) || trendDue(&diaTrend) || trendDue(&respirationTrend) ||
+		trendDue(&spo2Trend) || trendDue(&etco2Trend) || trendDue(&tempTrend))
+	{
+		statusChanged |= STATUS_SEC_CARDIAC | STATUS_SEC_RESPIRATION | STATUS_SEC_GENERAL;
+	}
 	simmgr_shm->status.cardiac.rate = trendProcess(&cardiacTrend);
 	simmgr_shm->status.cardiac.bps_sys = trendProcess(&sysTrend);
 	simmgr_shm->status.cardiac.bps_dia = trendProcess(&diaTrend);
@@ -1998,7 +2106,7 @@ scan_commands(void)
 	simmgr_shm->status.general.temperature = trendProcess(&tempTrend);
 
 	// NIBP processing
-	now = std::time(nullptr);
+	now = simClockTime();
 	switch (nibp_state)
 	{
 	case NibpState::NibpIdle:	// Not started or BP Cuff detached
@@ -2040,6 +2148,7 @@ scan_commands(void)
 				snprintf(msg_buf, BUF_SIZE, "NIBP Read Periodic");
 				lockAndComment(msg_buf);
 				simmgr_shm->status.cardiac.nibp_read = 1;
+				statusChanged |= STATUS_SEC_CARDIAC;
 			}
 		}
 		break;
@@ -2058,6 +2167,7 @@ scan_commands(void)
 				int meanValue;
 
 				simmgr_shm->status.cardiac.nibp_read = 0;
+				statusChanged |= STATUS_SEC_CARDIAC;
 
 				meanValue = ((simmgr_shm->status.cardiac.bps_sys - simmgr_shm->status.cardiac.bps_dia) / 3) + simmgr_shm->status.cardiac.bps_dia;
 				snprintf(msg_buf, BUF_SIZE, "NIBP %d/%d (%d)mmHg %d bpm",
@@ -2103,6 +2213,13 @@ scan_commands(void)
 			updateScenarioState(ScenarioState::ScenarioStopped);
 		}
 	}
+	if (statusChanged)
+	{
+		statusMarkDirty(statusChanged);
+
+		// Let the scenario check its triggers against the new values now
+		scenarioNotify();
+	}
 
 	return (0);
 }
@@ -2187,6 +2304,7 @@ start_scenario(void)
 	start_scenario_log();
 	if (simmgr_shm->status.scenario.error_flag != 0)
 	{
+		statusMarkDirty(STATUS_SEC_SCENARIO);
 		simlog_entry(simmgr_shm->status.scenario.error_message);
 		printf("%s\n", simmgr_shm->status.scenario.error_message);
 		updateScenarioState(ScenarioState::ScenarioTerminate);
@@ -2195,7 +2313,7 @@ start_scenario(void)
 	{
 		// start the new scenario
 		printf("Video started after wait of %0.2f seconds.\n", (OBS_START_SLEEP_TIME * (double)tryCount) / 1000);
-		scenario_start_time = time(nullptr);
+		scenario_start_time = simClockTime();
 		sprintf_s(msg_buf, BUF_SIZE, "Start Scenario: %s", simmgr_shm->status.scenario.active);
 		simlog_entry(msg_buf);
 
@@ -2207,6 +2325,7 @@ start_scenario(void)
 		sprintf_s(simmgr_shm->status.scenario.runtimeScenario, STR_SIZE, "%s", "00:00:00");
 		sprintf_s(simmgr_shm->status.scenario.runtimeScene, STR_SIZE, "%s", "00:00:00");
 		simmgr_shm->status.scenario.error_flag = 0;
+		statusMarkDirty(STATUS_SEC_SCENARIO);
 		thread::id tid;
 		tid = start_task("scenario_main", scenario_main);
 
@@ -2373,6 +2492,8 @@ updateScenarioState(ScenarioState new_state)
 			}
 			sprintf_s(c_msgbuf, STR_SIZE, "State: %s ", simmgr_shm->status.scenario.state);
 			log_message("", c_msgbuf);
+			statusMarkDirty(STATUS_SEC_SCENARIO);
+			scenarioNotify();
 		}
 	}
 	return (rval);
@@ -26,332 +26,620 @@
 #include <strsafe.h>
 #include <fileapi.h>
 #include <iostream>
+#include <new>
 #include "XMLRead.h"
+#include "XMLScan.h"
 
 void DisplayError(LPTSTR lpszFunction);
 
-int
-XMLRead::open(const char* path)
+/*
+ * findText
+ *
+ * Bounded strstr. The document is not terminated when it is a mapped file.
+ */
+static char*
+findText(char* from, char* end, const char* text)
 {
-    LARGE_INTEGER filelen;
-    size_t len;
-    DWORD ol;
-    BOOL sts;
-    HANDLE hFile; 
-    char* cptr;
-    char* cptr1;
-    char* cptr2;
-    int length;
+    size_t len = strlen(text);
 
+    while ((size_t)(end - from) >= len)
+    {
+        from = (char*)memchr(from, text[0], (size_t)(end - from) - len + 1);
+        if (!from)
+        {
+            break;
+        }
+        if (memcmp(from, text, len) == 0)
+        {
+            return (from);
+        }
+        from++;
+    }
+    return (NULL);
+}
+
+/*
+ * begin
+ *
+ * Release the last document and start the next from its first byte.
+ */
+void
+XMLRead::begin(void)
+{
+    close();
+    type = XML_TYPE_NONE;
     depth = -1;
     fileLength = 0;
-    name[0] = 0;
-    value[0] = 0;
     idx = 0;
-    TCHAR* tchar = new TCHAR[strlen(path) + 4];
-    size_t i;
-    for (i = 0; i <= strlen(path); i++)
-    {
-        tchar[i] = path[i];
-    }
+    inTag = 0;
+    closePending = 0;
+    newlines = 0;
+    error = NULL;
+    name = std::string_view();
+    value = std::string_view();
+    attributes = std::string_view();
+}
+
+/*
+ * open
+ * @path: file to read
+ *
+ * A disk file is mapped copy-on-write: pages are read as the tokenizer reaches them, and
+ * the terminators it writes go to private pages, never to the file. Pipes and devices
+ * have no size to map, so they are read in chunks into reserved address space as the
+ * tokenizer asks for more, and the document does not move as it grows.
+ */
+int
+XMLRead::open(const char* path)
+{
+    LARGE_INTEGER filelen;
+    HANDLE hFile;
+    HANDLE hMap;
+
+    // The reader is reused for each scenario read on a thread
+    begin();
 
-    printf("XMLRead open %s\n", path);
+    printf("XMLRead open %s (%s scan)\n", path, xmlScanKernel());
 
-    hFile = CreateFile((LPCWSTR)tchar,               // file to open
-        GENERIC_READ,          // open for reading
-        FILE_SHARE_READ,       // share for reading
-        NULL,                  // default security
-        OPEN_EXISTING,         // existing file only
-        FILE_ATTRIBUTE_NORMAL, // normal file
-        NULL);                 // no attr. template
+    hFile = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+        FILE_FLAG_SEQUENTIAL_SCAN, NULL);
     if (hFile == INVALID_HANDLE_VALUE)
     {
         DisplayError((LPTSTR)(TEXT("CreateFile")));
-        _tprintf(TEXT("Terminal failure: unable to open file \"%s\" for read.\n"), tchar);
+        printf("Terminal failure: unable to open file \"%s\" for read.\n", path);
         return (-1);
     }
-	sts = GetFileSizeEx(hFile, &filelen);
-    if ( !sts )
+    if (GetFileType(hFile) != FILE_TYPE_DISK)
+    {
+        XMLRead::xml = (char*)VirtualAlloc(NULL, XML_MAX_DOCUMENT, MEM_RESERVE, PAGE_NOACCESS);
+        if (!XMLRead::xml)
+        {
+            DisplayError((LPTSTR)(TEXT("VirtualAlloc")));
+            CloseHandle(hFile);
+            return (-1);
+        }
+        XMLRead::stream = hFile;
+        printf("XMLRead::open complete\n");
+        return (0);
+    }
+    if (!GetFileSizeEx(hFile, &filelen))
     {
         DisplayError((LPTSTR)(TEXT("GetFileSizeEx")));
-        _tprintf(TEXT("Terminal failure: unable to get file length\"%s\" for read.\n"), tchar);
+        printf("Terminal failure: unable to get file length \"%s\" for read.\n", path);
+        CloseHandle(hFile);
         return (-1);
     }
-    
-    len = (size_t)filelen.LowPart;
-    XMLRead::xml = (char *)calloc(len+32, 1);
-    XMLRead::idx = 0;
-    _tprintf(TEXT("ReadFile Request %d bytes.\n"), (int)len);
-
-    sts = ReadFile(hFile, (LPVOID)&XMLRead::xml[0], (DWORD)len, &ol, NULL);
-    if ( !sts || ol != len)
+    if ((unsigned long long)filelen.QuadPart > (unsigned long long)XML_MAX_DOCUMENT)
     {
-        DisplayError((LPTSTR)(TEXT("ReadFile")));
-        _tprintf(TEXT("Terminal failure: ReadFile for \"%s\" returned %d bytes with %d epected.\n"), tchar, ol, (int)len);
-        printf(" %.40s...\n", XMLRead::xml);
+        printf("Terminal failure: \"%s\" is %lld bytes\n", path, (long long)filelen.QuadPart);
+        CloseHandle(hFile);
         return (-1);
     }
-    printf("Read is good\n");
-    
+    // An empty file cannot be mapped, and is an empty document
+    if (filelen.QuadPart > 0)
+    {
+        hMap = CreateFileMappingA(hFile, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+        if (hMap)
+        {
+            XMLRead::xml = (char*)MapViewOfFile(hMap, FILE_MAP_COPY, 0, 0, 0);
+            CloseHandle(hMap);
+        }
+        if (!XMLRead::xml)
+        {
+            DisplayError((LPTSTR)(TEXT("MapViewOfFile")));
+            printf("Terminal failure: unable to map \"%s\"\n", path);
+            CloseHandle(hFile);
+            return (-1);
+        }
+        XMLRead::mapped = 1;
+        XMLRead::length = (size_t)filelen.QuadPart;
+    }
     CloseHandle(hFile);
+    XMLRead::fileLength = XMLRead::length;
+
+    printf("XMLRead::open complete\n");
+    return ( 0 );
+}
 
-    cptr = XMLRead::xml;
-    // printf("%s\n", cptr);
-    // Strip out prolog, if present  ( replace with spaces )
-    cptr1 = strstr(cptr, "<?xml");
-    if (!cptr1)
+/*
+ * openMemory
+ * @data: the document
+ * @size: its length in bytes
+ *
+ * Read a document that is already in memory, as the fuzzer and the benchmark do. The
+ * tokenizer writes terminators into the document, so it reads a copy. The copy is on
+ * the heap and exactly the size of the document, so that the address sanitizer sees
+ * a read past its end.
+ */
+int
+XMLRead::openMemory(const char* data, size_t size)
+{
+    begin();
+    if (size > XML_MAX_DOCUMENT)
     {
-        cptr1 = strstr(cptr, "<?XML");
+        printf("Terminal failure: document is %zu bytes\n", size);
+        return (-1);
     }
-    if (cptr1)
+    // An empty document needs no copy
+    if (size > 0)
     {
-        cptr2 = strstr(cptr1, "?>");
-        if (cptr2)
+        XMLRead::xml = new (std::nothrow) char[size];
+        if (!XMLRead::xml)
         {
-            cptr2 += 2;
-            length = (int)(cptr2 - cptr1);
-            memset(cptr1, ' ', length);
+            printf("Terminal failure: no memory for a document of %zu bytes\n", size);
+            return (-1);
         }
+        memcpy(XMLRead::xml, data, size);
+        XMLRead::copied = 1;
+        XMLRead::length = size;
     }
+    XMLRead::fileLength = XMLRead::length;
+    return (0);
+}
 
-    // Strip out all comments ( replace with spaces )
-    cptr1 = cptr;
-    while (1)
+/*
+ * fill
+ *
+ * Read the next chunk of a stream. Returns 1, or 0 at its end, after which the
+ * document is complete.
+ */
+int
+XMLRead::fill(void)
+{
+    DWORD got;
+
+    if (!XMLRead::stream)
+    {
+        return (0);
+    }
+    if (XMLRead::length + XML_STREAM_CHUNK > XMLRead::committed)
     {
-        cptr1 = strstr(cptr1, "<!--");
-        if (cptr1)
+        if (XMLRead::committed + XML_STREAM_CHUNK > XML_MAX_DOCUMENT ||
+            !VirtualAlloc(XMLRead::xml + XMLRead::committed, XML_STREAM_CHUNK, MEM_COMMIT, PAGE_READWRITE))
         {
-            cptr2 = strstr(cptr1, "-->");
-            if (cptr2)
-            {
-                cptr2 += 3;
-                length = (int)(cptr2 - cptr1);
-                memset(cptr1, ' ', length);
-            }
-            else
-            {
-                break;
-            }
+            printf("XMLRead: input is more than %d bytes\n", (int)XMLRead::committed);
+            CloseHandle(XMLRead::stream);
+            XMLRead::stream = NULL;
+            return (0);
+        }
+        XMLRead::committed += XML_STREAM_CHUNK;
+    }
+    // A pipe reports its end as ERROR_BROKEN_PIPE
+    if (!ReadFile(XMLRead::stream, XMLRead::xml + XMLRead::length,
+        (DWORD)(XMLRead::committed - XMLRead::length), &got, NULL) || got == 0)
+    {
+        CloseHandle(XMLRead::stream);
+        XMLRead::stream = NULL;
+        return (0);
+    }
+    XMLRead::length += got;
+    XMLRead::fileLength = XMLRead::length;
+    return (1);
+}
+
+/*
+ * close
+ *
+ * Release the document. Names and text returned from it are no longer valid.
+ */
+void
+XMLRead::close(void)
+{
+    if (XMLRead::stream)
+    {
+        CloseHandle(XMLRead::stream);
+        XMLRead::stream = NULL;
+    }
+    if (XMLRead::xml)
+    {
+        if (XMLRead::mapped)
+        {
+            UnmapViewOfFile(XMLRead::xml);
+        }
+        else if (XMLRead::copied)
+        {
+            delete[] XMLRead::xml;
         }
         else
         {
-            break;
+            VirtualFree(XMLRead::xml, 0, MEM_RELEASE);
         }
     }
-       
-    XMLRead::fileLength = ol;
+    XMLRead::xml = NULL;
+    XMLRead::mapped = 0;
+    XMLRead::copied = 0;
+    XMLRead::length = 0;
+    XMLRead::committed = 0;
+}
 
-    printf("XMLRead::open complete\n");
-    return ( 0 );
+#define XML_MORE	2	// scan reached the end of the input read so far
+
+// The XML white space characters. isspace also takes \v and \f, and costs a call per byte.
+static inline int
+xmlSpace(char c)
+{
+    return (c == ' ' || c == '\n' || c == '\t' || c == '\r');
+}
+
+/*
+ * terminate
+ *
+ * Write the terminator for a name or text over the character that follows it.
+ */
+void
+XMLRead::terminate(char* cptr)
+{
+    if (*cptr == '\n')
+    {
+        newlines++;
+    }
+    *cptr = 0;
 }
 
+int
+XMLRead::fail(const char* msg, const char* cptr)
+{
+    XMLRead::error = msg;
+    XMLRead::type = XML_TYPE_NONE;
+    XMLRead::idx = (size_t)(cptr - XMLRead::xml);
+    return (-1);
+}
+
+/*
+ * errorLine
+ *
+ * Line of the document at which getEntry failed.
+ */
+int
+XMLRead::errorLine(void)
+{
+    size_t i;
+    int line = 1 + newlines;
+
+    for (i = 0; i < XMLRead::idx && i < XMLRead::length; i++)
+    {
+        if (XMLRead::xml[i] == '\n')
+        {
+            line++;
+        }
+    }
+    return (line);
+}
+
+/*
+ * getEntry
+ *
+ * Advance to the next token. Returns 0 with type, name, value and depth set, 1 at the
+ * end of the document, or -1 with error set if the document is malformed. White space
+ * between tags is not returned. An empty element tag returns its start and then its end.
+ */
 int
 XMLRead::getEntry(void)
 {
-    int i;
-    size_t maxLen;
+    int sts;
+
+    XMLRead::name = std::string_view();
+    XMLRead::value = std::string_view();
+    XMLRead::attributes = std::string_view();
+    XMLRead::type = XML_TYPE_FILE_END;
+    if (!XMLRead::xml || XMLRead::error)
+    {
+        return (XMLRead::error ? -1 : 1);
+    }
+    if (XMLRead::closePending)
+    {
+        XMLRead::closePending = 0;
+        XMLRead::name = XMLRead::levels[XMLRead::depth];
+        XMLRead::type = XML_TYPE_END_ELEMENT;
+        XMLRead::depth--;
+        return (0);
+    }
+    while ((sts = scan()) == XML_MORE)
+    {
+        (void)fill();
+    }
+    return (sts);
+}
+
+/*
+ * more
+ *
+ * The token at cptr runs past the input read so far. Ask for more, or fail if that was
+ * all of it.
+ */
+int
+XMLRead::more(const char* msg, const char* cptr)
+{
+    return (XMLRead::stream ? XML_MORE : fail(msg, cptr));
+}
+
+/*
+ * scan
+ *
+ * One pass over the document from idx, to the end of the next token. Comments, the
+ * prolog and other processing instructions, and declarations are passed over where
+ * they stand, so nothing is read twice. idx and inTag move only when a token or a
+ * skipped construct is complete, and nothing is written until then, so a token cut off
+ * by the end of the input read so far is scanned again after fill.
+ */
+int
+XMLRead::scan(void)
+{
     char* cptr = XMLRead::xml + XMLRead::idx;
-    char* cptr2;
-    XMLRead::type = XML_TYPE_FILE_END;  // Default return if nothing is found
-
-    //printf("Get Entry: ");
-    // If not inElement, then skip everything up to the next 
-    if (XMLRead::state == xmlParseState::initial || XMLRead::state == xmlParseState::closedElement)
-    {    
-        for (i = 0; cptr[i]; i++)
+    char* end = XMLRead::xml + XMLRead::length;
+    char* start;
+    char* last;
+    int empty;
+
+    while (1)
+    {
+        if (!XMLRead::inTag)
         {
-            if (strncmp(&cptr[i], "</", 2) == 0 )
+            // Text up to the next tag. Most of it is the indent before a tag.
+            start = (char*)xmlSkip(XML_CLASS_SPACE, cptr, end);
+            if (start < end && *start == '<')
+            {
+                cptr = start;
+            }
+            else
+            {
+                cptr = (char*)memchr(start, '<', (size_t)(end - start));
+            }
+            if (!cptr)
             {
-                // Next is an end of element
-                cptr2 = &cptr[i+2];
-                for (i = 0; cptr2[i]; i++)
+                if (XMLRead::stream)
                 {
-                    if (cptr2[i] == '>' || isspace(cptr2[i]))
-                    {
-                        break;
-                    }
+                    return (XML_MORE);
                 }
-                strncpy_s(XMLRead::name, cptr2, size_t(i)-1);
-                XMLRead::name[i] = 0;
-                XMLRead::value[0] = 0;
-                XMLRead::type = XML_TYPE_END_ELEMENT;
-                if (XMLRead::depth > 0)
+                XMLRead::idx = XMLRead::length;
+                if (XMLRead::depth >= 0)
                 {
-                    XMLRead::depth--;
+                    return (fail("Unexpected end of document", end));
                 }
-                XMLRead::idx = (int)(&cptr2[i] - XMLRead::xml + 1);
-                XMLRead::state = xmlParseState::closedElement;
-                break;
+                return (1);
             }
-            else if (cptr[i] == '<')
+            last = cptr;
+            while (last > start && xmlSpace(last[-1]))
             {
-                cptr = &cptr[i+1];
-                for (i = 0; cptr[i]; i++)
-                {
-                    if (cptr[i] == '>' || isspace(cptr[i]))
-                    {
-                        if (i > 0)
-                        {
-                            maxLen = (size_t)(i);
-                            strncpy_s(XMLRead::name, cptr, maxLen);
-                            XMLRead::name[i] = 0;
-                        }
-                        else
-                        {
-                            XMLRead::name[0] = 0;
-                        }
-                        XMLRead::value[0] = 0;
-                        XMLRead::type = XML_TYPE_ELEMENT;
-                        XMLRead::idx = (int)(&cptr[i] - XMLRead::xml + 1);
-                        XMLRead::depth++;
-                        XMLRead::state = xmlParseState::foundElement;
-                        break;
-                    }
-                }
-                break;
+                last--;
             }
-        }
-    }
-    else if (XMLRead::state == xmlParseState::foundElement)
-    {
-        // Skip white space up to next text
-        for (i = 0; cptr[i]; i++)
-        {
-            if (!isspace(cptr[i]))
+            cptr++;
+            XMLRead::inTag = 1;
+            XMLRead::idx = (size_t)(cptr - XMLRead::xml);
+            if (last > start && XMLRead::depth >= 0)
             {
-                cptr = &cptr[i];
-                break;
+                XMLRead::value = std::string_view(start, (size_t)(last - start));
+                XMLRead::name = XMLRead::levels[XMLRead::depth];
+                XMLRead::type = XML_TYPE_TEXT;
+                terminate(last);
+                return (0);
             }
         }
-        if (strncmp(cptr, "</", 2) == 0)
+
+        // cptr follows a '<'
+        if (cptr == end)
+        {
+            return (more("Unexpected end of document", cptr));
+        }
+        if (*cptr == '/')
         {
-            // Next is an end of element
-            cptr2 = &cptr[2];
-            for (i = 0; cptr2[i]; i++)
+            start = ++cptr;
+            cptr = (char*)xmlFind(XML_CLASS_NAME_END, cptr, end);
+            last = cptr;
+            cptr = (char*)xmlSkip(XML_CLASS_SPACE, cptr, end);
+            if (cptr == end)
             {
-                if (cptr2[i] == '>' || isspace(cptr2[i]) )
-                {
-                    break;
-                }
+                return (more("Unterminated end tag", start));
             }
-            strncpy_s(XMLRead::name, cptr2, size_t(i));
-            XMLRead::name[i] = 0;
-            XMLRead::value[0] = 0;
-            XMLRead::type = XML_TYPE_END_ELEMENT;
-            if (XMLRead::depth > 0)
+            if (*cptr != '>' || last == start)
             {
-                XMLRead::depth--;
+                return (fail("Malformed end tag", start));
             }
-            XMLRead::idx = (int)(&cptr2[i] - XMLRead::xml + 1);
-            XMLRead::state = xmlParseState::closedElement;
-        }
-        else if (cptr[0] == '<')
-        {
-            // Next is an start of element
-            cptr++;
-            for (i = 0; cptr[i]; i++)
+            XMLRead::name = std::string_view(start, (size_t)(last - start));
+            if (XMLRead::depth < 0 || XMLRead::name != XMLRead::levels[XMLRead::depth])
             {
-                if (cptr[i] == '>' || isspace(cptr[i]))
-                {
-                    strncpy_s(XMLRead::name, cptr, size_t(i));
-                    XMLRead::name[i] = 0;
-                    XMLRead::value[0] = 0;
-                    XMLRead::type = XML_TYPE_ELEMENT;
-                    XMLRead::depth++;
-                    XMLRead::idx = (int)(&cptr[i] - XMLRead::xml + 1);
-                    XMLRead::state = xmlParseState::foundElement;
-                    break;
-                }
+                return (fail("End tag does not match the open element", start));
             }
+            terminate(last);
+            XMLRead::inTag = 0;
+            XMLRead::idx = (size_t)(cptr + 1 - XMLRead::xml);
+            XMLRead::type = XML_TYPE_END_ELEMENT;
+            XMLRead::depth--;
+            return (0);
         }
-        else
+        if (*cptr == '!' || *cptr == '?')
         {
-            // Not a tag open or close, so return any content up to the next tag
-            for ( i = 0 ; cptr[i]; i++)
+            // Enough to tell a comment from CDATA or a declaration
+            if (end - cptr < 8 && XMLRead::stream)
+            {
+                return (XML_MORE);
+            }
+            if (end - cptr >= 8 && memcmp(cptr, "![CDATA[", 8) == 0)
             {
-                if (cptr[i] == '<')
+                start = cptr + 8;
+                last = findText(start, end, "]]>");
+                if (!last)
                 {
-                    XMLRead::value[i] = 0;
-                    XMLRead::state = xmlParseState::returnedText;
-                    XMLRead::type = XML_TYPE_TEXT;
-                    XMLRead::idx = (int)(&cptr[i] - XMLRead::xml);
-                    break;
+                    return (more("Unterminated CDATA section", cptr));
                 }
-                else
+                if (XMLRead::depth < 0)
                 {
-                    XMLRead::value[i] = cptr[i];
+                    return (fail("CDATA outside of the root element", cptr));
                 }
+                XMLRead::value = std::string_view(start, (size_t)(last - start));
+                XMLRead::name = XMLRead::levels[XMLRead::depth];
+                XMLRead::type = XML_TYPE_TEXT;
+                XMLRead::inTag = 0;
+                XMLRead::idx = (size_t)(last + 3 - XMLRead::xml);
+                terminate(last);
+                return (0);
             }
-        }
-    }
-    else if (XMLRead::state == xmlParseState::returnedText)
-    { 
-        // Skip white space up to next text
-        for (i = 0; cptr[i]; i++)
-        {
-            if (!isspace(cptr[i]))
+            if (*cptr == '?')
             {
-                cptr = &cptr[i];
-                break;
+                last = findText(cptr, end, "?>");
+                start = (last ? last + 2 : NULL);
             }
-        }
-        if (strncmp(cptr, "</", 2) == 0)
-        {
-            // Next is an end of element
-            cptr2 = &cptr[2];
-            for (i = 0; cptr2[i]; i++)
+            else if (end - cptr >= 3 && memcmp(cptr, "!--", 3) == 0)
+            {
+                last = findText(cptr + 3, end, "-->");
+                start = (last ? last + 3 : NULL);
+            }
+            else
             {
-                if (cptr2[i] == '>')
+                // A DOCTYPE may carry an internal subset in [ ], with its own '>'s
+                for (last = cptr; last < end && *last != '>'; last++)
                 {
-                    cptr2 = &cptr2[i];
-                    break;
+                    if (*last == '[')
+                    {
+                        last = (char*)memchr(last, ']', (size_t)(end - last));
+                        if (!last)
+                        {
+                            break;
+                        }
+                    }
                 }
+                start = (last && last < end ? last + 1 : NULL);
             }
-            strncpy_s(XMLRead::name, &cptr[2], size_t(i));
-            XMLRead::name[i + 1] = 0;
-            XMLRead::value[0] = 0;
-            XMLRead::type = XML_TYPE_END_ELEMENT;
-            if (XMLRead::depth > 0)
+            if (!start)
             {
-                XMLRead::depth--;
+                return (more("Unterminated comment or declaration", cptr - 1));
             }
-            XMLRead::idx = XMLRead::idx + i;
-            XMLRead::state = xmlParseState::closedElement;
+            cptr = start;
+            XMLRead::inTag = 0;
+            XMLRead::idx = (size_t)(cptr - XMLRead::xml);
+            continue;
         }
-        else if (cptr[0] == '<')
+
+        // Start tag
+        start = cptr;
+        cptr = (char*)xmlFind(XML_CLASS_NAME_END, cptr, end);
+        if (cptr == start)
         {
-            // Next is an start of element
-            cptr++;
-            for (i = 0; cptr[i]; i++)
+            return (fail("Missing element name", start));
+        }
+        XMLRead::name = std::string_view(start, (size_t)(cptr - start));
+        last = cptr;
+        cptr = (char*)xmlSkip(XML_CLASS_SPACE, cptr, end);
+        start = cptr;
+        while ((cptr = (char*)xmlFind(XML_CLASS_TAG_END, cptr, end)) < end && *cptr != '>')
+        {
+            if (*cptr == '/')
             {
-                if (cptr[i] == '>' || isspace(cptr[i]))
+                if (cptr + 1 < end && cptr[1] == '>')
                 {
-                    strncpy_s(XMLRead::name, cptr, size_t(i));
-
-                    XMLRead::name[i] = 0;
-                    XMLRead::value[0] = 0;
-                    XMLRead::type = XML_TYPE_ELEMENT;
-                    XMLRead::depth++;
-                    XMLRead::idx = (int)(&cptr[i] - XMLRead::xml + 1);
-                    XMLRead::state = xmlParseState::foundElement;
                     break;
                 }
             }
+            else
+            {
+                cptr = (char*)memchr(cptr + 1, *cptr, (size_t)(end - cptr - 1));
+                if (!cptr)
+                {
+                    return (more("Unterminated attribute value", start));
+                }
+            }
+            cptr++;
         }
-        else
+        if (cptr == end)
         {
-            XMLRead::name[0] = 0;
-            XMLRead::value[0] = 0;
-            XMLRead::type = XML_TYPE_NONE;
-            XMLRead::idx = (int)(&cptr[i] - XMLRead::xml + 1);
-            XMLRead::state = xmlParseState::initial;
+            return (more("Unterminated start tag", start));
         }
-    }
-    if (XMLRead::type == XML_TYPE_FILE_END)
-        return (1);
-    else
+        empty = (*cptr == '/');
+        if (XMLRead::depth + 1 >= XML_MAX_DEPTH)
+        {
+            return (fail("Elements are nested too deeply", start));
+        }
+        XMLRead::inTag = 0;
+        XMLRead::idx = (size_t)(cptr + (empty ? 2 : 1) - XMLRead::xml);
+        if (cptr > start)
+        {
+            XMLRead::attributes = std::string_view(start, (size_t)(cptr - start));
+            while (XMLRead::attributes.size() && xmlSpace(XMLRead::attributes.back()))
+            {
+                XMLRead::attributes.remove_suffix(1);
+            }
+            terminate(start + XMLRead::attributes.size());
+        }
+        terminate(last);
+        XMLRead::depth++;
+        XMLRead::levels[XMLRead::depth] = XMLRead::name;
+        XMLRead::closePending = empty;
+        XMLRead::type = XML_TYPE_ELEMENT;
         return (0);
+    }
+}
+
+/*
+ * getAttribute
+ * @key: attribute name
+ * @val: receives the value, without its quotes
+ *
+ * Look up an attribute of the current start tag. Returns 0, or -1 if it is not present.
+ * Entities in the value are not expanded.
+ */
+int
+XMLRead::getAttribute(std::string_view key, std::string_view& val)
+{
+    std::string_view attrs = XMLRead::attributes;
+    std::string_view attrName;
+    size_t i;
+    size_t close;
+
+    while (1)
+    {
+        for (i = 0; i < attrs.size() && xmlSpace(attrs[i]); i++)
+        {
+        }
+        attrs.remove_prefix(i);
+        for (i = 0; i < attrs.size() && attrs[i] != '=' && !xmlSpace(attrs[i]); i++)
+        {
+        }
+        if (i == 0)
+        {
+            return (-1);
+        }
+        attrName = attrs.substr(0, i);
+        for (; i < attrs.size() && (attrs[i] == '=' || xmlSpace(attrs[i])); i++)
+        {
+        }
+        if (i == attrs.size() || (attrs[i] != '"' && attrs[i] != '\''))
+        {
+            return (-1);
+        }
+        close = attrs.find(attrs[i], i + 1);
+        if (close == std::string_view::npos)
+        {
+            return (-1);
+        }
+        if (attrName == key)
+        {
+            val = attrs.substr(i + 1, close - i - 1);
+            return (0);
+        }
+        attrs.remove_prefix(close + 1);
+    }
 }
+
 void DisplayError(LPTSTR lpszFunction)
 // Routine Description:
 // Retrieve and output the system error message for the last-error code
@@ -1,13 +1,15 @@
 #pragma once
 #include <string>
+#include <string_view>
 #include <sstream>
 #include <iostream>
 #include <iterator>
 
 using namespace std;
 
-#define XML_MAX_NAME	512
-#define XML_MAX_VALUE	16536
+#define XML_MAX_DEPTH		32
+#define XML_MAX_DOCUMENT	(256 * 1024 * 1024)
+#define XML_STREAM_CHUNK	(64 * 1024)	// Read size for input that cannot be mapped
 
 constexpr auto  XML_TYPE_NONE = 0;
 constexpr auto  XML_TYPE_ELEMENT = 1;
@@ -15,47 +17,58 @@ constexpr auto  XML_TYPE_TEXT = 2;
 constexpr auto  XML_TYPE_END_ELEMENT = 3;
 constexpr auto  XML_TYPE_FILE_END = 4;
 
-enum class xmlParseState
-{
-	initial = 0,
-	foundElement = 1,
-	returnedText = 2,
-	closedElement = 3
-};
-
+/*
+ * XMLRead
+ *
+ * Pull tokenizer over a document held in memory. Each getEntry returns the next start
+ * tag, text or end tag as slices of the document. Nothing is copied: the reader writes
+ * a terminator after each name and text in place, so name.data() and value.data() are
+ * also C strings. They stay valid until the next open or close.
+ */
 class XMLRead
 {
 private:
-	int idx = 0;
 	char* xml = (char *)NULL;
-	enum class xmlParseState state = xmlParseState::initial;;
+	int mapped = 0;			// xml is a copy-on-write view of the file, else reserved memory
+	int copied = 0;			// xml is a heap copy made by openMemory
+	HANDLE stream = NULL;	// Input still to be read into xml by fill
+	size_t committed = 0;
+	size_t length = 0;
+	size_t idx = 0;
+	int inTag = 0;			// idx follows a '<', which a text terminator may have overwritten
+	int closePending = 0;	// Empty element tag. Its end is returned next.
+	int newlines = 0;		// Newlines overwritten by terminators, for errorLine
+	std::string_view levels[XML_MAX_DEPTH];
+
+	int scan(void);
+	int fill(void);
+	int more(const char* msg, const char* cptr);
+	void terminate(char* cptr);
+	int fail(const char* msg, const char* cptr);
+	void begin(void);
 
 public:
 	int type = XML_TYPE_NONE;
 	int depth = -1;
-	DWORD fileLength = 0;
-	char name[XML_MAX_NAME] = { 0, };
-	char value[XML_MAX_VALUE] = { 0, };
+	size_t fileLength = 0;
+	std::string_view name;			// Element, or for text the enclosing element
+	std::string_view value;			// Text with the outer white space trimmed, or CDATA as is
+	std::string_view attributes;	// Attribute list of a start tag, unparsed
+	const char* error = NULL;		// Reason getEntry returned -1
 
 	XMLRead(void)
 	{
-		idx = 0;
-		xml = (char*)NULL;
-		state = xmlParseState::initial;
-		type = XML_TYPE_NONE;
-		name[0] = 0;
-		value[0] = 0;
 	};
 	~XMLRead(void)
 	{
-		if (XMLRead::xml)
-		{
-			free(XMLRead::xml);
-			XMLRead::xml = NULL;
-		}
+		close();
 	};
 	int getEntry(void);
+	int getAttribute(std::string_view key, std::string_view& val);
+	int errorLine(void);
 	int open(const char* path);
+	int openMemory(const char* data, size_t size);
+	void close(void);
 
 };
 
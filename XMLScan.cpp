@@ -0,0 +1,290 @@
+/*
+ * XMLScan.cpp
+ *
+ * Vectorised delimiter scans for the XML reader
+ *
+ * This file is part of the sim-mgr distribution (https://github.com/OpenVetSim/sim-mgr).
+ *
+ * Copyright (c) 2019-2025 ITown Design
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <string.h>
+#if defined(_M_X64) || defined(_M_IX86)
+#include <intrin.h>
+#include <immintrin.h>
+#define XML_SCAN_X86
+#endif
+#include "XMLScan.h"
+
+#define XML_CLASSES		4
+#define XML_CLASS_MAX	6
+#define XML_SCAN_SHORT	16	// Bytes checked one at a time before a kernel is called
+
+struct scan_class
+{
+	int count;
+	char chars[XML_CLASS_MAX];
+};
+
+static constexpr struct scan_class scanClasses[XML_CLASSES] =
+{
+	{ 4, { ' ', '\t', '\n', '\r' } },
+	{ 6, { ' ', '\t', '\n', '\r', '>', '/' } },
+	{ 4, { '>', '/', '"', '\'' } },
+	{ 6, { ' ', '\t', '\n', '\v', '\f', '\r' } },
+};
+
+typedef const char* (*scan_fn)(int cls, const char* p, const char* end, int match);
+
+static unsigned char classBits[256];	// Bit cls is set for each member of class cls
+static scan_fn scanFn[XML_CLASSES];
+static int scanLevel;
+static int scanLevelMax;
+
+/*
+ * scalarScan
+ * @match: 1 to stop at the first member of the class, 0 at the first non member
+ */
+static const char*
+scalarScan(int cls, const char* p, const char* end, int match)
+{
+	for (; p < end; p++)
+	{
+		if (((classBits[(unsigned char)*p] >> cls) & 1) == match)
+		{
+			break;
+		}
+	}
+	return (p);
+}
+
+#ifdef XML_SCAN_X86
+static int
+lowestBit(unsigned int bits)
+{
+	unsigned long index;
+
+	_BitScanForward(&index, bits);
+	return ((int)index);
+}
+
+// The class is a template argument, so its compares are unrolled and its constants hoisted
+template <int cls> static const char*
+sse2Scan(int unused, const char* p, const char* end, int match)
+{
+	constexpr const struct scan_class* sc = &scanClasses[cls];
+	__m128i set[XML_CLASS_MAX];
+	__m128i v;
+	__m128i hit;
+	unsigned int bits;
+	int k;
+
+	for (k = 0; k < sc->count; k++)
+	{
+		set[k] = _mm_set1_epi8(sc->chars[k]);
+	}
+	while (end - p >= 16)
+	{
+		v = _mm_loadu_si128((const __m128i*)p);
+		hit = _mm_cmpeq_epi8(v, set[0]);
+		for (k = 1; k < sc->count; k++)
+		{
+			hit = _mm_or_si128(hit, _mm_cmpeq_epi8(v, set[k]));
+		}
+		bits = (unsigned int)_mm_movemask_epi8(hit);
+		if (!match)
+		{
+			bits = ~bits & 0xffff;
+		}
+		if (bits)
+		{
+			return (p + lowestBit(bits));
+		}
+		p += 16;
+	}
+	return (scalarScan(cls, p, end, match));
+}
+
+template <int cls> static const char*
+avx2Scan(int unused, const char* p, const char* end, int match)
+{
+	constexpr const struct scan_class* sc = &scanClasses[cls];
+	__m256i set[XML_CLASS_MAX];
+	__m256i v;
+	__m256i hit;
+	unsigned int bits;
+	int k;
+
+	for (k = 0; k < sc->count; k++)
+	{
+		set[k] = _mm256_set1_epi8(sc->chars[k]);
+	}
+	while (end - p >= 32)
+	{
+		v = _mm256_loadu_si256((const __m256i*)p);
+		hit = _mm256_cmpeq_epi8(v, set[0]);
+		for (k = 1; k < sc->count; k++)
+		{
+			hit = _mm256_or_si256(hit, _mm256_cmpeq_epi8(v, set[k]));
+		}
+		bits = (unsigned int)_mm256_movemask_epi8(hit);
+		if (!match)
+		{
+			bits = ~bits;
+		}
+		if (bits)
+		{
+			return (p + lowestBit(bits));
+		}
+		p += 32;
+	}
+	return (sse2Scan<cls>(cls, p, end, match));
+}
+
+// AVX2 needs the CPU to have it and the OS to save the YMM registers
+static int
+haveAVX2(void)
+{
+	int regs[4];
+
+	__cpuid(regs, 0);
+	if (regs[0] < 7)
+	{
+		return (0);
+	}
+	__cpuid(regs, 1);
+	if (!(regs[2] & (1 << 27)) || !(regs[2] & (1 << 28)))	// OSXSAVE, AVX
+	{
+		return (0);
+	}
+	if ((_xgetbv(0) & 6) != 6)
+	{
+		return (0);
+	}
+	__cpuidex(regs, 7, 0);
+	return ((regs[1] & (1 << 5)) != 0);
+}
+#endif
+
+static int
+scanInit(void)
+{
+	int cls;
+	int k;
+
+	for (cls = 0; cls < XML_CLASSES; cls++)
+	{
+		for (k = 0; k < scanClasses[cls].count; k++)
+		{
+			classBits[(unsigned char)scanClasses[cls].chars[k]] |= (unsigned char)(1 << cls);
+		}
+	}
+#ifdef XML_SCAN_X86
+	scanLevelMax = (haveAVX2() ? XML_SCAN_AVX2 : XML_SCAN_SSE2);
+#else
+	scanLevelMax = XML_SCAN_SCALAR;
+#endif
+	return (xmlScanSelect(scanLevelMax));
+}
+static int scanReady = scanInit();
+
+/*
+ * xmlScanSelect
+ * @level: XML_SCAN_*
+ *
+ * Use the given kernel, or the best this CPU has if it lacks that one. Returns the level
+ * in use. Meant for startup and for comparing the kernels.
+ */
+int
+xmlScanSelect(int level)
+{
+	if (level > scanLevelMax)
+	{
+		level = scanLevelMax;
+	}
+	switch (level)
+	{
+#ifdef XML_SCAN_X86
+	case XML_SCAN_AVX2:
+		scanFn[XML_CLASS_SPACE] = avx2Scan<XML_CLASS_SPACE>;
+		scanFn[XML_CLASS_NAME_END] = avx2Scan<XML_CLASS_NAME_END>;
+		scanFn[XML_CLASS_TAG_END] = avx2Scan<XML_CLASS_TAG_END>;
+		scanFn[XML_CLASS_C_SPACE] = avx2Scan<XML_CLASS_C_SPACE>;
+		break;
+	case XML_SCAN_SSE2:
+		scanFn[XML_CLASS_SPACE] = sse2Scan<XML_CLASS_SPACE>;
+		scanFn[XML_CLASS_NAME_END] = sse2Scan<XML_CLASS_NAME_END>;
+		scanFn[XML_CLASS_TAG_END] = sse2Scan<XML_CLASS_TAG_END>;
+		scanFn[XML_CLASS_C_SPACE] = sse2Scan<XML_CLASS_C_SPACE>;
+		break;
+#endif
+	default:
+		level = XML_SCAN_SCALAR;
+		scanFn[XML_CLASS_SPACE] = scalarScan;
+		scanFn[XML_CLASS_NAME_END] = scalarScan;
+		scanFn[XML_CLASS_TAG_END] = scalarScan;
+		scanFn[XML_CLASS_C_SPACE] = scalarScan;
+		break;
+	}
+	scanLevel = level;
+	return (level);
+}
+
+const char*
+xmlScanKernel(void)
+{
+	return (scanLevel == XML_SCAN_AVX2 ? "avx2" : scanLevel == XML_SCAN_SSE2 ? "sse2" : "scalar");
+}
+
+/*
+ * xmlFind
+ *
+ * First byte in [p, end) that is in the class, or end.
+ */
+const char*
+xmlFind(int cls, const char* p, const char* end)
+{
+	const char* shortEnd = (end - p > XML_SCAN_SHORT ? p + XML_SCAN_SHORT : end);
+
+	// Most runs between delimiters are short, and cost less to settle a byte at a time
+	// than to load a vector for
+	for (; p < shortEnd; p++)
+	{
+		if ((classBits[(unsigned char)*p] >> cls) & 1)
+		{
+			return (p);
+		}
+	}
+	return (p == end ? p : scanFn[cls](cls, p, end, 1));
+}
+
+/*
+ * xmlSkip
+ *
+ * First byte in [p, end) that is not in the class, or end.
+ */
+const char*
+xmlSkip(int cls, const char* p, const char* end)
+{
+	const char* shortEnd = (end - p > XML_SCAN_SHORT ? p + XML_SCAN_SHORT : end);
+
+	for (; p < shortEnd; p++)
+	{
+		if (!((classBits[(unsigned char)*p] >> cls) & 1))
+		{
+			return (p);
+		}
+	}
+	return (p == end ? p : scanFn[cls](cls, p, end, 0));
+}
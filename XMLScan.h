@@ -0,0 +1,20 @@
+#pragma once
+
+/*
+ * Delimiter scans for the XML reader. A kernel is chosen once at startup by CPUID: AVX2
+ * (32 bytes a step) or SSE2 (16 bytes), with a table driven scalar scan for the tail of
+ * the input and for other targets.
+ */
+#define XML_CLASS_SPACE		0	// XML white space
+#define XML_CLASS_NAME_END	1	// White space, '>' or '/'
+#define XML_CLASS_TAG_END	2	// '>', '/' or a quote
+#define XML_CLASS_C_SPACE	3	// isspace() in the C locale
+
+#define XML_SCAN_SCALAR		0
+#define XML_SCAN_SSE2		1
+#define XML_SCAN_AVX2		2
+
+const char* xmlFind(int cls, const char* p, const char* end);
+const char* xmlSkip(int cls, const char* p, const char* end);
+int xmlScanSelect(int level);
+const char* xmlScanKernel(void);
@@ -0,0 +1,109 @@
+/*
+ * arena.cpp
+ *
+ * Bump allocator for the parsed scenario
+ *
+ * This file is part of the sim-mgr distribution (https://github.com/OpenVetSim/sim-mgr).
+ *
+ * Copyright (c) 2019-2025 ITown Design
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+ * The scenario graph (scenes, triggers, groups and events) is built once by the XML
+ * parser and released all at once when the scenario ends. Allocating it from an arena
+ * makes each node a pointer bump and the release one pass over a few large blocks.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include "arena.h"
+
+#define ARENA_ALIGN	16
+
+struct arena_block
+{
+	struct arena_block* next;
+	size_t size;				// Usable bytes after the header
+	size_t used;
+};
+
+#define ARENA_HEADER	((sizeof(struct arena_block) + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1))
+
+/*
+ * arena_alloc
+ *
+ * Returns zeroed memory aligned to ARENA_ALIGN, or NULL if the heap is exhausted.
+ */
+void*
+arena_alloc(struct arena* arena, size_t size)
+{
+	struct arena_block* block = arena->head;
+	size_t want;
+	char* ptr;
+
+	size = (size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+	if (!block || block->size - block->used < size)
+	{
+		// Oversize requests get a block of their own
+		want = (size > ARENA_BLOCK_SIZE - ARENA_HEADER ? size : ARENA_BLOCK_SIZE - ARENA_HEADER);
+		block = (struct arena_block*)malloc(ARENA_HEADER + want);
+		if (!block)
+		{
+			return (NULL);
+		}
+		block->size = want;
+		block->used = 0;
+		if (arena->head && want > ARENA_BLOCK_SIZE - ARENA_HEADER)
+		{
+			// Keep filling the current block after an oversize request
+			block->next = arena->head->next;
+			arena->head->next = block;
+		}
+		else
+		{
+			block->next = arena->head;
+			arena->head = block;
+		}
+		arena->reserved += ARENA_HEADER + want;
+		arena->blocks++;
+	}
+	ptr = (char*)block + ARENA_HEADER + block->used;
+	block->used += size;
+	arena->allocated += size;
+	memset(ptr, 0, size);
+	return (ptr);
+}
+
+/*
+ * arena_free
+ *
+ * Release every block and leave the arena empty, ready for reuse.
+ */
+void
+arena_free(struct arena* arena)
+{
+	struct arena_block* block = arena->head;
+	struct arena_block* next;
+
+	while (block)
+	{
+		next = block->next;
+		free(block);
+		block = next;
+	}
+	arena->head = NULL;
+	arena->allocated = 0;
+	arena->reserved = 0;
+	arena->blocks = 0;
+}
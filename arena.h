@@ -0,0 +1,43 @@
+#pragma once
+/*
+ * arena.h
+ *
+ * Bump allocator for the parsed scenario
+ *
+ * This file is part of the sim-mgr distribution (https://github.com/OpenVetSim/sim-mgr).
+ *
+ * Copyright (c) 2019-2025 ITown Design
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stddef.h>
+
+#define ARENA_BLOCK_SIZE	(64 * 1024)
+
+struct arena_block;
+
+/*
+ * Everything allocated from an arena is released together by arena_free.
+ * A zero-initialized struct arena is an empty arena.
+ */
+struct arena
+{
+	struct arena_block* head;	// Current block. Older blocks are chained behind it.
+	size_t allocated;			// Bytes handed out
+	size_t reserved;			// Bytes obtained from the heap
+	int blocks;
+};
+
+void* arena_alloc(struct arena* arena, size_t size);
+void arena_free(struct arena* arena);
@@ -0,0 +1,65 @@
+@echo off
+rem check.cmd [WinVetSim.exe] [scenario]
+rem
+rem The headless checks, run from the top of the tree. Results go to check\.
+rem
+rem   --xmlbench over the seed corpus in fuzz\corpus, one pass each
+rem   --xmlbench -g over the synthetic corpus, three passes
+rem   --validate over every scenario in html\scenarios
+rem   --run of the scenario, if one is named, twice with the same script and seed.
+rem     The two reports must be the same.
+rem
+rem The program defaults to the Release x64 build. It is started with start /wait
+rem because the Release build is a Windows program, which cmd does not wait for.
+rem The exit status is 0 if every check passed.
+
+setlocal EnableDelayedExpansion
+set EXE=%~1
+if "%EXE%"=="" set EXE=x64\Release\WinVetSim.exe
+set SCENARIO=%~2
+set OUT=check
+set STS=0
+
+if not exist "%EXE%" (
+	echo %EXE% not found
+	exit /b 1
+)
+if not exist %OUT% mkdir %OUT%
+
+set FILES=
+for %%f in (fuzz\corpus\*.xml) do set FILES=!FILES! %%f
+start /wait "" "%EXE%" --xmlbench -n 1 -o %OUT%\corpus.json!FILES!
+if errorlevel 1 (
+	echo --xmlbench failed on fuzz\corpus
+	set STS=1
+)
+
+start /wait "" "%EXE%" --xmlbench -n 3 -g %OUT%\synthetic -o %OUT%\synthetic.json
+if errorlevel 1 (
+	echo --xmlbench failed on the synthetic corpus
+	set STS=1
+)
+
+start /wait "" "%EXE%" --validate -o %OUT%\validate.json
+if errorlevel 1 (
+	echo --validate found errors, see %OUT%\validate.json
+	set STS=1
+)
+
+if not "%SCENARIO%"=="" (
+	> %OUT%\script.txt (
+		echo 0:30 cardiac:rate=40
+		echo 1:00 event:event_id=epinephrine
+		echo 2:00 respiration:spo2=85
+		echo 10:00 end
+	)
+	start /wait "" "%EXE%" --run "%SCENARIO%" %OUT%\script.txt -s 1 -o %OUT%\run1.txt
+	start /wait "" "%EXE%" --run "%SCENARIO%" %OUT%\script.txt -s 1 -o %OUT%\run2.txt
+	fc /b %OUT%\run1.txt %OUT%\run2.txt > nul
+	if errorlevel 1 (
+		echo The two --run reports for %SCENARIO% differ
+		set STS=1
+	)
+)
+
+exit /b %STS%
@@ -0,0 +1,493 @@
+/*
+ * headless.cpp
+ *
+ * Headless scenario runner
+ *
+ * This file is part of the sim-mgr distribution (https://github.com/OpenVetSim/sim-mgr).
+ *
+ * Copyright (c) 2019-2025 ITown Design
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+ * Usage: WinVetSim --run scenario script [-s seed] [-t seconds] [-o report]
+ *
+ * Runs a scenario without the web server, the pulse port or an instructor, on the
+ * virtual simulation clock (see simClockMsec), as fast as the machine allows. The
+ * script is a list of timed inputs, one per line:
+ *
+ *		# Comment
+ *		0:30		cardiac:rate=40
+ *		1:05.5		event:event_id=epinephrine
+ *		90			cpr:compression=1
+ *		2:00		pulse:left_femoral=1
+ *		10:00		end
+ *
+ * The time is from the start of the scenario, as seconds, m:ss or h:mm:ss, with an
+ * optional fraction. An input is any set: command the Instructor Interface sends,
+ * except the scenario class, which the runner drives itself. "end" terminates the
+ * scenario, as does the time limit (-t, MAX_SCENARIO_RUNTIME by default).
+ *
+ * The report lists the inputs, the scenario's comments (scene starts, triggers, CPR
+ * and palpation) and the scene sequence, stamped with scenario time. The threads of
+ * a live system are replaced by one loop that moves the clock 1 msec at a time and
+ * calls each periodic task when it is due, so for a given scenario, script and seed
+ * the report is the same on every run.
+ */
+#include "vetsim.h"
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+
+#define RUN_CLOCK_START		(60 * 60 * 1000)	// Tick count at the start. The rate calculations look back up to 47 sec.
+#define RUN_CLOCK_EPOCH		1735732800			// Wall clock at the start, 2025-01-01 12:00:00 UTC
+#define RUN_HRCHECK_PERIOD	5		// msec, as the hrcheck_handler timer
+#define RUN_LOOP_PERIOD		10		// msec, as the vetsim loop, the awrr_check timer and pulseBroadcastLoop
+#define RUN_RATE_PERIOD		50		// msec, as pulseProcessChild
+#define RUN_SCENE_PERIOD	10		// msec between scenario passes
+#define RUN_STOP_GRACE		5000	// msec allowed to stop after terminate
+
+void simmgrInitialize(void);
+int updateScenarioState(ScenarioState new_state);
+
+struct runInput
+{
+	ULONGLONG msec;
+	int line;
+	int end;
+	std::string key;
+	std::string value;
+};
+
+struct runScene
+{
+	int id;
+	std::string name;
+	ULONGLONG enter;
+};
+
+static FILE* report;
+static int reportComment;
+static std::vector<struct runScene> runScenes;
+
+/*
+ * parseRunTime
+ * @str: seconds, m:ss or h:mm:ss, with an optional fraction
+ * @msec: receives the time
+ *
+ * Returns 0, or -1 if the time is not valid.
+ */
+static int
+parseRunTime(const char* str, ULONGLONG* msec)
+{
+	ULONGLONG secs = 0;
+	ULONGLONG val;
+	ULONGLONG frac = 0;
+	int fields = 0;
+	int digits;
+
+	while (1)
+	{
+		if (!isdigit((unsigned char)*str))
+		{
+			return (-1);
+		}
+		for (val = 0; isdigit((unsigned char)*str); str++)
+		{
+			val = val * 10 + (*str - '0');
+		}
+		secs = secs * 60 + val;
+		fields++;
+		if (*str != ':')
+		{
+			break;
+		}
+		if (fields == 3)
+		{
+			return (-1);
+		}
+		str++;
+	}
+	if (*str == '.')
+	{
+		str++;
+		for (digits = 0; isdigit((unsigned char)*str); digits++, str++)
+		{
+			if (digits < 3)
+			{
+				frac = frac * 10 + (*str - '0');
+			}
+		}
+		if (digits == 0)
+		{
+			return (-1);
+		}
+		for (; digits < 3; digits++)
+		{
+			frac *= 10;
+		}
+	}
+	if (*str)
+	{
+		return (-1);
+	}
+	*msec = secs * 1000 + frac;
+	return (0);
+}
+
+static const char*
+formatRunTime(ULONGLONG msec, char* buf, size_t len)
+{
+	sprintf_s(buf, len, "%02llu:%02llu:%02llu.%03llu",
+		msec / 3600000, (msec / 60000) % 60, (msec / 1000) % 60, msec % 1000);
+	return (buf);
+}
+
+/*
+ * readRunScript
+ * @path: script file
+ * @inputs: receives the inputs, in time order
+ *
+ * Every input is validated before the run starts. Returns the number of errors.
+ */
+static int
+readRunScript(const char* path, std::vector<struct runInput>& inputs)
+{
+	FILE* fp;
+	char line[1024];
+	char* ptr;
+	char* cmd;
+	char* eq;
+	struct runInput input;
+	int lineno = 0;
+	int errors = 0;
+	int sts;
+
+	if (fopen_s(&fp, path, "r") != 0 || fp == NULL)
+	{
+		printf("Cannot read %s\n", path);
+		return (1);
+	}
+	while (fgets(line, sizeof(line), fp))
+	{
+		lineno++;
+		line[strcspn(line, "\r\n")] = 0;
+		for (ptr = line; *ptr == ' ' || *ptr == '\t'; ptr++)
+		{
+		}
+		if (*ptr == 0 || *ptr == '#')
+		{
+			continue;
+		}
+		for (cmd = ptr; *cmd && *cmd != ' ' && *cmd != '\t'; cmd++)
+		{
+		}
+		if (*cmd)
+		{
+			*cmd++ = 0;
+		}
+		for (; *cmd == ' ' || *cmd == '\t'; cmd++)
+		{
+		}
+		for (eq = cmd + strlen(cmd); eq > cmd && (eq[-1] == ' ' || eq[-1] == '\t'); eq--)
+		{
+			eq[-1] = 0;
+		}
+
+		input.line = lineno;
+		input.end = 0;
+		input.key.clear();
+		input.value.clear();
+		if (parseRunTime(ptr, &input.msec) != 0)
+		{
+			printf("%s:%d: Bad time \"%s\"\n", path, lineno, ptr);
+			errors++;
+			continue;
+		}
+		if (strcmp(cmd, "end") == 0)
+		{
+			input.end = 1;
+			inputs.push_back(input);
+			continue;
+		}
+		eq = strchr(cmd, '=');
+		if (!eq || !strchr(cmd, ':') || strchr(cmd, ':') > eq)
+		{
+			printf("%s:%d: Expected class:param=value or end, not \"%s\"\n", path, lineno, cmd);
+			errors++;
+			continue;
+		}
+		*eq = 0;
+		if (strncmp(cmd, "scenario:", 9) == 0)
+		{
+			printf("%s:%d: The scenario class is driven by the runner\n", path, lineno);
+			errors++;
+			continue;
+		}
+		sts = applySetCommand(cmd, eq + 1, 0);
+		if (sts != 0 && sts != 5)
+		{
+			printf("%s:%d: \"%s=%s\" is not valid (%d)\n", path, lineno, cmd, eq + 1, sts);
+			errors++;
+			continue;
+		}
+		input.key = cmd;
+		input.value = eq + 1;
+		inputs.push_back(input);
+	}
+	fclose(fp);
+
+	std::stable_sort(inputs.begin(), inputs.end(),
+		[](const struct runInput& a, const struct runInput& b) { return (a.msec < b.msec); });
+	return (errors);
+}
+
+static void
+reportLine(ULONGLONG msec, const char* kind, const char* text)
+{
+	char buf[32];
+
+	fprintf(report, "%s  %-8s %s\n", formatRunTime(msec, buf, sizeof(buf)), kind, text);
+}
+
+/*
+ * reportStatus
+ * @msec: scenario time
+ *
+ * Report new comments and a change of scene since the last step
+ */
+static void
+reportStatus(ULONGLONG msec)
+{
+	struct runScene scene;
+
+	while (reportComment != simmgr_shm->commentListNext)
+	{
+		reportLine(msec, "comment", simmgr_shm->commentList[reportComment].comment);
+		reportComment++;
+		if (reportComment >= COMMENT_LIST_SIZE)
+		{
+			reportComment = 0;
+		}
+	}
+	if (strcmp(simmgr_shm->status.scenario.state, "Stopped") == 0)
+	{
+		return;
+	}
+	if (runScenes.empty() || runScenes.back().id != simmgr_shm->status.scenario.scene_id ||
+		runScenes.back().name != simmgr_shm->status.scenario.scene_name)
+	{
+		scene.id = simmgr_shm->status.scenario.scene_id;
+		scene.name = simmgr_shm->status.scenario.scene_name;
+		scene.enter = msec;
+		runScenes.push_back(scene);
+	}
+}
+
+static void
+runTerminate(void)
+{
+	takeInstructorLock();
+	sprintf_s(simmgr_shm->instructor.scenario.state, STR_SIZE, "%s", "terminate");
+	releaseInstructorLock();
+}
+
+static void
+usage(void)
+{
+	printf("Usage: WinVetSim --run scenario script [-s seed] [-t seconds] [-o report]\n");
+}
+
+/*
+ * headlessMain
+ * @argc, @argv: the arguments after --run
+ *
+ * Returns 0 if the scenario reached an ending scene, 2 if it was terminated or hit
+ * the time limit, or 1 on an error.
+ */
+int
+headlessMain(int argc, char* argv[])
+{
+	std::vector<struct runInput> inputs;
+	const char* scenarioName;
+	const char* scriptPath;
+	char reportPath[256] = "headlessRun.txt";
+	unsigned int seed = 1;
+	ULONGLONG limit = (ULONGLONG)MAX_SCENARIO_RUNTIME * 1000;
+	ULONGLONG msec = 0;
+	ULONGLONG stopping = 0;
+	ULONGLONG end;
+	size_t next = 0;
+	int stopped = 0;
+	int ended;
+	int sts;
+	int i;
+	char buf[COMMENT_SIZE + 64];
+	char tbuf[32];
+	std::chrono::steady_clock::time_point start;
+	long long realMsec;
+
+	if (argc < 2)
+	{
+		usage();
+		return (1);
+	}
+	scenarioName = argv[0];
+	scriptPath = argv[1];
+	for (i = 2; i < argc; i++)
+	{
+		if (i + 1 >= argc || argv[i][0] != '-')
+		{
+			usage();
+			return (1);
+		}
+		switch (argv[i][1])
+		{
+		case 's':
+			seed = (unsigned int)strtoul(argv[++i], NULL, 10);
+			break;
+		case 't':
+			limit = (ULONGLONG)strtoul(argv[++i], NULL, 10) * 1000;
+			break;
+		case 'o':
+			sprintf_s(reportPath, sizeof(reportPath), "%s", argv[++i]);
+			break;
+		default:
+			usage();
+			return (1);
+		}
+	}
+
+	// Everything below runs on this thread, on the virtual clock
+	simClockSetVirtual(RUN_CLOCK_EPOCH - RUN_CLOCK_START / 1000, RUN_CLOCK_START);
+	simSrand(seed);
+	initSHM();
+	simmgrInitialize();
+	log_message_init();
+	(void)msec_time_update();
+	pulseTimerInit();
+
+	if (readRunScript(scriptPath, inputs) != 0)
+	{
+		return (1);
+	}
+	if (fopen_s(&report, reportPath, "w") != 0 || report == NULL)
+	{
+		printf("Cannot write %s\n", reportPath);
+		return (1);
+	}
+	fprintf(report, "Scenario: %s\nScript: %s\nSeed: %u\n\n", scenarioName, scriptPath, seed);
+
+	start = std::chrono::steady_clock::now();
+	sprintf_s(simmgr_shm->status.scenario.active, STR_SIZE, "%s", scenarioName);
+	reportComment = simmgr_shm->commentListNext;
+	resetAllParameters();
+	updateScenarioState(ScenarioState::ScenarioRunning);
+	if (scenarioStart() != 0)
+	{
+		reportLine(0, "error", "The scenario could not be read");
+		fclose(report);
+		printf("%s could not be read\n", scenarioName);
+		return (1);
+	}
+	reportStatus(0);
+
+	while (!stopped)
+	{
+		simClockAdvance(1);
+		msec++;
+		(void)msec_time_update();
+
+		while (next < inputs.size() && inputs[next].msec <= msec)
+		{
+			if (inputs[next].end)
+			{
+				reportLine(msec, "input", "end");
+				if (!stopping)
+				{
+					runTerminate();
+					stopping = msec;
+				}
+			}
+			else
+			{
+				sprintf_s(buf, sizeof(buf), "%s=%s", inputs[next].key.c_str(), inputs[next].value.c_str());
+				sts = applySetCommand(inputs[next].key.c_str(), inputs[next].value.c_str(), 1);
+				if (sts != 0)
+				{
+					sprintf_s(buf, sizeof(buf), "%s=%s (line %d, status %d)",
+						inputs[next].key.c_str(), inputs[next].value.c_str(), inputs[next].line, sts);
+				}
+				reportLine(msec, "input", buf);
+			}
+			next++;
+		}
+
+		pulseTimerCheck();
+		if (msec % RUN_HRCHECK_PERIOD == 0)
+		{
+			hrcheck_handler();
+		}
+		if (msec % RUN_LOOP_PERIOD == 0)
+		{
+			awrr_check();
+			pulseBroadcastCheck();
+			simmgrRun();
+		}
+		if (msec % RUN_RATE_PERIOD == 0)
+		{
+			pulseRateCheck();
+		}
+		if (msec % RUN_SCENE_PERIOD == 0)
+		{
+			stopped = scenarioStep();
+		}
+		reportStatus(msec);
+
+		if (!stopping && msec >= limit)
+		{
+			reportLine(msec, "limit", "Time limit reached");
+			runTerminate();
+			stopping = msec;
+		}
+		else if (stopping && msec - stopping > RUN_STOP_GRACE)
+		{
+			reportLine(msec, "error", "The scenario did not stop");
+			break;
+		}
+	}
+	end = msec;
+	realMsec = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+
+	fprintf(report, "\nScenes:\n");
+	for (size_t s = 0; s < runScenes.size(); s++)
+	{
+		fprintf(report, "  %s  %6llu sec  %d %s\n", formatRunTime(runScenes[s].enter, tbuf, sizeof(tbuf)),
+			((s + 1 < runScenes.size() ? runScenes[s + 1].enter : end) - runScenes[s].enter) / 1000,
+			runScenes[s].id, runScenes[s].name.c_str());
+	}
+	ended = (stopped && !runScenes.empty() && runScenes.back().id <= 0);
+	fprintf(report, "\nResult: %s at %s\n", ended ? "Ending scene" : (stopped ? "Terminated" : "Did not stop"),
+		formatRunTime(end, tbuf, sizeof(tbuf)));
+	fclose(report);
+
+	printf("Ran %s of scenario time in %lld msec (%.0fx). Report written to %s\n",
+		formatRunTime(end, tbuf, sizeof(tbuf)), realMsec, (double)end / (realMsec ? realMsec : 1), reportPath);
+	if (ended)
+	{
+		return (0);
+	}
+	return (stopped ? 2 : 1);
+}
@@ -0,0 +1,279 @@
+/*
+ * httpRequest.cpp
+ *
+ * Incremental HTTP request parser for the simstatus port
+ *
+ * This file is part of the sim-mgr distribution (https://github.com/OpenVetSim/sim-mgr).
+ *
+ * Copyright (c) 2019-2025 ITown Design
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+ * The parser is handed everything received so far on a connection. It returns
+ * HTTP_PARSE_INCOMPLETE until the header and any Content-Length body are present, so
+ * a request split across TCP segments is handled by receiving more and calling again.
+ * Nothing in the buffer is modified until the request is complete. Once it is, the
+ * path and arguments are percent-decoded in place and returned as views into the
+ * buffer. "length" tells the caller where the next pipelined request starts.
+ */
+#include <string.h>
+#include "httpRequest.h"
+
+static int
+hexValue(char c)
+{
+	if (c >= '0' && c <= '9')
+	{
+		return (c - '0');
+	}
+	if (c >= 'a' && c <= 'f')
+	{
+		return (c - 'a' + 10);
+	}
+	if (c >= 'A' && c <= 'F')
+	{
+		return (c - 'A' + 10);
+	}
+	return (-1);
+}
+
+/*
+ * percentDecode
+ *
+ * Decode %XX escapes and '+' (form encoding for space) in place, in one pass.
+ * A '%' that is not followed by two hex digits is kept as is.
+ * Returns the decoded length, which is never more than len.
+ */
+size_t
+percentDecode(char* str, size_t len)
+{
+	size_t in;
+	size_t out = 0;
+	int hi;
+	int lo;
+
+	for (in = 0; in < len; in++)
+	{
+		char c = str[in];
+
+		if (c == '+')
+		{
+			c = ' ';
+		}
+		else if (c == '%' && in + 2 < len)
+		{
+			hi = hexValue(str[in + 1]);
+			lo = hexValue(str[in + 2]);
+			if (hi >= 0 && lo >= 0)
+			{
+				c = (char)((hi << 4) | lo);
+				in += 2;
+			}
+		}
+		str[out++] = c;
+	}
+	return (out);
+}
+
+/*
+ * splitArgs
+ *
+ * Split an application/x-www-form-urlencoded string at '&' and '=' and decode each
+ * key and value separately, so an escaped '&' or '=' stays inside its value.
+ * Entries without an '=' are skipped, as before.
+ */
+void
+splitArgs(char* str, size_t len, std::vector<struct httpArg>& args)
+{
+	size_t start = 0;
+	size_t end;
+	size_t eq;
+	struct httpArg arg;
+
+	while (start < len)
+	{
+		end = start;
+		eq = len;
+		while (end < len && str[end] != '&')
+		{
+			if (str[end] == '=' && eq == len)
+			{
+				eq = end;
+			}
+			end++;
+		}
+		if (eq < end)
+		{
+			arg.key = std::string_view(str + start, percentDecode(str + start, eq - start));
+			arg.value = std::string_view(str + eq + 1, percentDecode(str + eq + 1, end - eq - 1));
+			args.push_back(arg);
+		}
+		start = end + 1;
+	}
+}
+
+static int
+headerIs(const char* name, size_t len, const char* match)
+{
+	size_t i;
+
+	for (i = 0; i < len; i++)
+	{
+		char c = name[i];
+
+		if (c >= 'A' && c <= 'Z')
+		{
+			c = c - 'A' + 'a';
+		}
+		if (match[i] == 0 || c != match[i])
+		{
+			return (0);
+		}
+	}
+	return (match[len] == 0);
+}
+
+/*
+ * httpRequest::parse
+ *
+ * Parse one request from the start of buf.
+ * Returns HTTP_PARSE_OK, HTTP_PARSE_INCOMPLETE or HTTP_PARSE_ERROR.
+ */
+int
+httpRequest::parse(char* buf, size_t len)
+{
+	size_t headerEnd = 0;
+	size_t lineStart;
+	size_t lineEnd;
+	size_t i;
+	size_t targetStart;
+	size_t targetEnd;
+	size_t queryStart;
+	size_t value;
+	int haveLength = 0;
+
+	method = HTTP_METHOD_NONE;
+	path = std::string_view();
+	args.clear();
+	contentLength = 0;
+	length = 0;
+
+	// Find the blank line that ends the header. Accept bare LF line endings too.
+	for (i = 0; i < len; i++)
+	{
+		if (buf[i] == '\n')
+		{
+			if (i + 1 < len && buf[i + 1] == '\n')
+			{
+				headerEnd = i + 2;
+				break;
+			}
+			if (i + 2 < len && buf[i + 1] == '\r' && buf[i + 2] == '\n')
+			{
+				headerEnd = i + 3;
+				break;
+			}
+		}
+	}
+	if (headerEnd == 0)
+	{
+		return (len >= HTTP_MAX_REQUEST ? HTTP_PARSE_ERROR : HTTP_PARSE_INCOMPLETE);
+	}
+
+	// Request line
+	for (lineEnd = 0; buf[lineEnd] != '\n'; lineEnd++)
+		;
+	if (strncmp(buf, "GET ", 4) == 0)
+	{
+		method = HTTP_METHOD_GET;
+		targetStart = 4;
+	}
+	else if (strncmp(buf, "POST ", 5) == 0)
+	{
+		method = HTTP_METHOD_POST;
+		targetStart = 5;
+	}
+	else
+	{
+		return (HTTP_PARSE_ERROR);
+	}
+	for (targetEnd = targetStart; targetEnd < lineEnd && buf[targetEnd] != ' ' && buf[targetEnd] != '\r'; targetEnd++)
+		;
+	if (targetEnd == targetStart || buf[targetStart] != '/')
+	{
+		return (HTTP_PARSE_ERROR);
+	}
+
+	// Header lines. Only Content-Length matters here.
+	for (lineStart = lineEnd + 1; lineStart < headerEnd; lineStart = lineEnd + 1)
+	{
+		size_t colon = 0;
+
+		for (lineEnd = lineStart; buf[lineEnd] != '\n'; lineEnd++)
+		{
+			if (buf[lineEnd] == ':' && colon == 0)
+			{
+				colon = lineEnd;
+			}
+		}
+		if (colon == 0 || !headerIs(buf + lineStart, colon - lineStart, "content-length"))
+		{
+			continue;
+		}
+		for (i = colon + 1; i < lineEnd && (buf[i] == ' ' || buf[i] == '\t'); i++)
+			;
+		if (i == lineEnd || buf[i] < '0' || buf[i] > '9')
+		{
+			return (HTTP_PARSE_ERROR);
+		}
+		for (value = 0; i < lineEnd && buf[i] >= '0' && buf[i] <= '9'; i++)
+		{
+			value = value * 10 + (buf[i] - '0');
+			if (value > HTTP_MAX_REQUEST)
+			{
+				return (HTTP_PARSE_ERROR);
+			}
+		}
+		if (haveLength && value != contentLength)
+		{
+			return (HTTP_PARSE_ERROR);
+		}
+		contentLength = value;
+		haveLength = 1;
+	}
+	if (headerEnd + contentLength > HTTP_MAX_REQUEST)
+	{
+		return (HTTP_PARSE_ERROR);
+	}
+	if (len < headerEnd + contentLength)
+	{
+		return (HTTP_PARSE_INCOMPLETE);
+	}
+	length = headerEnd + contentLength;
+
+	// Complete. Decode in place.
+	for (queryStart = targetStart; queryStart < targetEnd && buf[queryStart] != '?'; queryStart++)
+		;
+	path = std::string_view(buf + targetStart + 1, percentDecode(buf + targetStart + 1, queryStart - targetStart - 1));
+	if (queryStart < targetEnd)
+	{
+		splitArgs(buf + queryStart + 1, targetEnd - queryStart - 1, args);
+	}
+	if (method == HTTP_METHOD_POST && contentLength > 0)
+	{
+		splitArgs(buf + headerEnd, contentLength, args);
+	}
+	return (HTTP_PARSE_OK);
+}
@@ -0,0 +1,60 @@
+#pragma once
+/*
+ * httpRequest.h
+ *
+ * Incremental HTTP request parser for the simstatus port
+ *
+ * This file is part of the sim-mgr distribution (https://github.com/OpenVetSim/sim-mgr).
+ *
+ * Copyright (c) 2019-2025 ITown Design
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <string_view>
+#include <vector>
+
+#define HTTP_MAX_REQUEST	(64 * 1024)	// Limit for request header plus body
+
+constexpr auto HTTP_PARSE_INCOMPLETE = 0;	// Need more bytes
+constexpr auto HTTP_PARSE_OK = 1;
+constexpr auto HTTP_PARSE_ERROR = -1;		// Malformed or too large
+
+constexpr auto HTTP_METHOD_NONE = 0;
+constexpr auto HTTP_METHOD_GET = 1;
+constexpr auto HTTP_METHOD_POST = 2;
+
+struct httpArg
+{
+	std::string_view key;
+	std::string_view value;
+};
+
+/*
+ * One request parsed in place from a receive buffer. The views point into that buffer,
+ * so they are only valid until the buffer is reused.
+ */
+class httpRequest
+{
+public:
+	int method = HTTP_METHOD_NONE;
+	std::string_view path;				// Decoded, without the leading '/'
+	std::vector<struct httpArg> args;	// Query string, then form body for POST
+	size_t contentLength = 0;
+	size_t length = 0;					// Bytes of the buffer used by this request
+
+	int parse(char* buf, size_t len);
+};
+
+size_t percentDecode(char* str, size_t len);
+void splitArgs(char* str, size_t len, std::vector<struct httpArg>& args);
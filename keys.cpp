@@ -418,6 +418,9 @@ int getKeys()
 			fileWriteStream << "[Listeners]" << std::endl;
 			fileWriteStream << "pulsePort = " << PORT_PULSE << std::endl;
 			fileWriteStream << "statusPort = " << PORT_STATUS << std::endl;
+			fileWriteStream << "" << std::endl;
+			fileWriteStream << "[Scenario]" << std::endl;
+			fileWriteStream << "prefetchMB = " << localConfig.prefetch_mb << std::endl;
 			ret = file.read(ini);
 			if (ret != true)
 			{
@@ -451,6 +454,10 @@ int getKeys()
 		{
 			localConfig.port_status = atoi((const char*)ini["Listeners"]["statusPort"].c_str());
 		}
+		if (ini["Scenario"]["prefetchMB"].length() > 0)
+		{
+			localConfig.prefetch_mb = atoi((const char*)ini["Scenario"]["prefetchMB"].c_str());
+		}
 		printf("Data from INI: Server %s:%d, Pulse %d, Status %d\n",
 			localConfig.php_server_addr, 
 			localConfig.php_server_port, 
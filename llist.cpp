@@ -27,21 +27,32 @@
 void
 insert_llist(struct snode* entry, struct snode* list)
 {
-	int limit = 100;
-
 	// Scan to the first NULL entry (end of list)
 	while (list->next)
 	{
 		list = list->next;
-		if (limit-- == 0)
-		{
-			fprintf(stderr, "insert_llist: Limit exceeded\n");
-			exit(-1);
-		}
 	}
 	list->next = entry;
 }
 
+/*
+ * append_llist
+ *
+ * Add entry at the end of list without scanning it. tail is kept by the caller
+ * and must start as NULL for an empty list.
+ */
+void
+append_llist(struct snode* entry, struct snode* list, struct snode** tail)
+{
+	if (!*tail)
+	{
+		*tail = list;
+	}
+	entry->next = NULL;
+	(*tail)->next = entry;
+	*tail = entry;
+}
+
 struct snode*
 	get_next_llist(struct snode* entry)
 {
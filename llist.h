@@ -30,6 +30,7 @@ struct snode
 };
 
 void insert_llist(struct snode* entry, struct snode* list);
+void append_llist(struct snode* entry, struct snode* list, struct snode** tail);
 struct snode* get_next_llist(struct snode* entry);
 
 #endif // _LLIST_H
\ No newline at end of file
@@ -173,6 +173,46 @@ int APIENTRY wWinMain(_In_ HINSTANCE hInstance,
 	BOOL bRet;
 	WNDCLASS wc;
 
+	// Run a scenario headless, without the window or the servers, and exit
+	if ((__argc > 2 && wcscmp(__wargv[1], L"--run") == 0) ||
+		(__argc > 1 && (wcscmp(__wargv[1], L"--validate") == 0 || wcscmp(__wargv[1], L"--xmlbench") == 0 ||
+			wcscmp(__wargv[1], L"--httpbench") == 0)))
+	{
+		std::vector<std::string> args;
+		std::vector<char*> argp;
+		char arg[1024];
+		FILE* fp;
+
+		if (AttachConsole(ATTACH_PARENT_PROCESS))
+		{
+			freopen_s(&fp, "CONOUT$", "w", stdout);
+		}
+		for (int i = 2; i < __argc; i++)
+		{
+			WideCharToMultiByte(CP_ACP, 0, __wargv[i], -1, arg, sizeof(arg), NULL, NULL);
+			args.push_back(arg);
+		}
+		for (auto& a : args)
+		{
+			argp.push_back(&a[0]);
+		}
+		setWVSVersion();
+		initializeConfiguration();
+		if (wcscmp(__wargv[1], L"--validate") == 0)
+		{
+			return (validateMain((int)argp.size(), argp.data()));
+		}
+		if (wcscmp(__wargv[1], L"--xmlbench") == 0)
+		{
+			return (benchMain((int)argp.size(), argp.data()));
+		}
+		if (wcscmp(__wargv[1], L"--httpbench") == 0)
+		{
+			return (httpBenchMain((int)argp.size(), argp.data()));
+		}
+		return (headlessMain((int)argp.size(), argp.data()));
+	}
+
 	sts = checkProcessRunning();
 	if (sts == 0)
 	{
@@ -516,6 +556,32 @@ int main(int argc, char *argv[] )
 	char *ptr;
 	int sts;
 
+	// Run a scenario headless, without the servers, and exit
+	if (argc > 2 && strcmp(argv[1], "--run") == 0)
+	{
+		setWVSVersion();
+		initializeConfiguration();
+		return (headlessMain(argc - 2, argv + 2));
+	}
+	if (argc > 1 && strcmp(argv[1], "--validate") == 0)
+	{
+		setWVSVersion();
+		initializeConfiguration();
+		return (validateMain(argc - 2, argv + 2));
+	}
+	if (argc > 1 && strcmp(argv[1], "--xmlbench") == 0)
+	{
+		setWVSVersion();
+		initializeConfiguration();
+		return (benchMain(argc - 2, argv + 2));
+	}
+	if (argc > 1 && strcmp(argv[1], "--httpbench") == 0)
+	{
+		setWVSVersion();
+		initializeConfiguration();
+		return (httpBenchMain(argc - 2, argv + 2));
+	}
+
 	sts = checkProcessRunning();
 	if (sts == 0)
 	{
@@ -605,6 +671,7 @@ initializeConfiguration(void)
 	localConfig.php_server_port = DEFAULT_PHP_SERVER_PORT;
 	sprintf_s(localConfig.php_server_addr, "%s", DEFAULT_PHP_SERVER_ADDRESS);
 	sprintf_s(localConfig.log_name, "%s", DEFAULT_LOG_NAME);
+	localConfig.prefetch_mb = DEFAULT_PREFETCH_MB;
 
 	//char publicPath[64];
 	const char htmlPath[32] = DEFAULT_HTML_PATH;
@@ -175,6 +175,7 @@ pulse_beat_handler(void)
 				{
 					// VPC Injection
 					simmgr_shm->status.cardiac.pulseCountVpc++;
+					statusMarkDirty(STATUS_SEC_CARDIAC);
 					hrLogBeat();
 					vpcState--;
 					switch (vpcState)
@@ -204,12 +205,13 @@ pulse_beat_handler(void)
 				{
 					// Normal Cycle
 					simmgr_shm->status.cardiac.pulseCount++;
+					statusMarkDirty(STATUS_SEC_CARDIAC);
 					hrLogBeat();
 					if (afibActive)
 					{
 						// Next beat phase is between 50% and 200% of standard. 
 						// Calculate a random from 0 to 14 and add to 5
-						beatPhase = 5 + (rand() % 14);
+						beatPhase = 5 + (simRand() % 14);
 					}
 					else if ((vpcType > 0) && (currentVpcFreq > 0))
 					{
@@ -237,6 +239,7 @@ pulse_beat_handler(void)
 		else
 		{
 			simmgr_shm->status.cardiac.pulseCount++;
+			statusMarkDirty(STATUS_SEC_CARDIAC);
 			hrLogBeat();
 			setPulseState(2);
 		}
@@ -250,6 +253,7 @@ breath_beat_handler(void)
 	if (simmgr_shm->status.respiration.rate > 0)
 	{
 		simmgr_shm->status.respiration.breathCount++;
+		statusMarkDirty(STATUS_SEC_RESPIRATION);
 	}
 	breathSema.unlock();
 }
@@ -270,7 +274,7 @@ calculateVPCFreq(void)
 		// get 100 samples for 100 cycles of sinus rhythm between 10 and 90
 		for (i = 0; i < VPC_ARRAY_LEN; i++)
 		{
-			val = rand() % 100;
+			val = simRand() % 100;
 			if (val > currentVpcFreq)
 			{
 				vpcFrequencyArray[i] = 0;
@@ -474,21 +478,7 @@ pulseTask(void )
 	_tprintf(TEXT("pulseTask: Current thread priority is 0x%x\n"), dwThreadPri);
 
 
-	// Seed rand, needed for vpc array generation
-	srand(NULL);
-
-	currentPulseRate = simmgr_shm->status.cardiac.rate;
-	pulseSema.lock();
-	set_pulse_rate(currentPulseRate);
-	pulseSema.unlock();
-	simmgr_shm->status.cardiac.pulseCount = 0;
-	simmgr_shm->status.cardiac.pulseCountVpc = 0;
-
-	currentBreathRate = simmgr_shm->status.respiration.rate;
-	breathSema.lock();
-	set_breath_rate(currentBreathRate);
-	breathSema.unlock();
-	simmgr_shm->status.respiration.breathCount = 0;
+	pulseTimerInit();
 
 	//printf("Pulse Interval %llu Next %llu now %llu\n", pulseInterval, nextPulseTime, simmgr_shm->server.msec_time );
 	//printf("Calling start_task for pulseProcessChild\n");
@@ -501,6 +491,7 @@ pulseTask(void )
 		listeners[i].allocated = 0;
 		simmgr_shm->simControllers[i].allocated = 0;
 	}
+	statusMarkDirty(STATUS_SEC_CONTROLLERS);
 
 	error = WSAStartup(0x0202, &w);  // Fill in WSA info
 	if (error)
@@ -576,6 +567,7 @@ pulseTask(void )
 				client_addr.sa_data[4] & 0xff,
 				client_addr.sa_data[5] & 0xff
 			);
+			statusMarkDirty(STATUS_SEC_CONTROLLERS);
 			printf("Connecting Controller %d.%d.%d.%d\n",
 				client_addr.sa_data[2] & 0xff,
 				client_addr.sa_data[3] & 0xff,
@@ -619,6 +611,7 @@ pulseTask(void )
 							client_addr.sa_data[4] & 0xff,
 							client_addr.sa_data[5] & 0xff
 						);
+						statusMarkDirty(STATUS_SEC_CONTROLLERS);
 						printf("%d.%d.%d.%d\n",
 							client_addr.sa_data[2] & 0xff,
 							client_addr.sa_data[3] & 0xff,
@@ -736,52 +729,66 @@ broadcast_word(char* word)
  *		a message is sent to the listeners.
  *		It also monitors the rates and adjusts the timeout for the beat_handler when a rate is changed.
 */
+/*
+ * pulseTimerInit
+ *
+ * Start the timers at the current rates
+ */
 void
-pulseTimer(void)
+pulseTimerInit(void)
 {
-	if (!SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL))
-	{
-		DWORD dwError;
-		dwError = GetLastError();
-		_tprintf(TEXT("Failed to elevate priority (%d)\n"), dwError);
-	}
-	DWORD dwThreadPri;
-	dwThreadPri = GetThreadPriority(GetCurrentThread());
-	_tprintf(TEXT("pulseTimer: Current thread priority is 0x%x\n"), dwThreadPri);
+	currentPulseRate = simmgr_shm->status.cardiac.rate;
+	pulseSema.lock();
+	set_pulse_rate(currentPulseRate);
+	pulseSema.unlock();
+	simmgr_shm->status.cardiac.pulseCount = 0;
+	simmgr_shm->status.cardiac.pulseCountVpc = 0;
+
+	currentBreathRate = simmgr_shm->status.respiration.rate;
+	breathSema.lock();
+	set_breath_rate(currentBreathRate);
+	breathSema.unlock();
+	simmgr_shm->status.respiration.breathCount = 0;
+	statusMarkDirty(STATUS_SEC_CARDIAC | STATUS_SEC_RESPIRATION);
+}
 
+/*
+ * pulseTimerCheck
+ *
+ * Fire the pulse and breath handlers when they are due. Called every msec.
+ */
+void
+pulseTimerCheck(void)
+{
 	ULONGLONG now;
 	ULONGLONG now2;
-	while (1)
+
+	now = simmgr_shm->server.msec_time;
+	if (nextPulseTime <= now)
 	{
-		Sleep(1);
-		now = simmgr_shm->server.msec_time;
-		if (nextPulseTime <= now)
+		pulse_beat_handler();
+		nextPulseTime += pulseInterval;
+		now2 = simmgr_shm->server.msec_time;
+		if (nextPulseTime <= (now2+1))
 		{
-			pulse_beat_handler();
-			nextPulseTime += pulseInterval;
-			now2 = simmgr_shm->server.msec_time;
-			if (nextPulseTime <= (now2+1))
-			{
-				nextPulseTime = now2;
-			}
+			nextPulseTime = now2;
 		}
-		now = simmgr_shm->server.msec_time;
-		if (nextBreathTime <= now)
+	}
+	now = simmgr_shm->server.msec_time;
+	if (nextBreathTime <= now)
+	{
+		breath_beat_handler();
+		nextBreathTime += breathInterval;
+		now2 = simmgr_shm->server.msec_time;
+		if (nextBreathTime <= (now2+1))
 		{
-			breath_beat_handler();
-			nextBreathTime += breathInterval;
-			now2 = simmgr_shm->server.msec_time;
-			if (nextBreathTime <= (now2+1))
-			{
-				nextBreathTime = now2 + breathInterval;
-			}
+			nextBreathTime = now2 + breathInterval;
 		}
 	}
-	printf("pulseTimer Exit\n");
-	exit(205);
 }
+
 void
-pulseBroadcastLoop(void)
+pulseTimer(void)
 {
 	if (!SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL))
 	{
@@ -790,151 +797,198 @@ pulseBroadcastLoop(void)
 		_tprintf(TEXT("Failed to elevate priority (%d)\n"), dwError);
 	}
 	DWORD dwThreadPri;
-	dwThreadPri = GetThreadPriority(GetCurrentThread()); 
-	_tprintf(TEXT("pulseBroadcastLoop: Current thread priority is 0x%x\n"), dwThreadPri);
+	dwThreadPri = GetThreadPriority(GetCurrentThread());
+	_tprintf(TEXT("pulseTimer: Current thread priority is 0x%x\n"), dwThreadPri);
+
+	while (1)
+	{
+		Sleep(1);
+		pulseTimerCheck();
+	}
+	printf("pulseTimer Exit\n");
+	exit(205);
+}
+static int portUpdateLoops = 0;
+static unsigned int last_pulse;
+static unsigned int last_pulseVpc;
+static unsigned int last_breath;
+static unsigned int last_manual_breath;
 
+/*
+ * pulseBroadcastCheck
+ *
+ * Send the pulse and breath words for any new beats and breaths. Called every 10 msec.
+ */
+void
+pulseBroadcastCheck(void)
+{
 	int count;
-	int portUpdateLoops = 0;
 	char pbuf[64];
-	unsigned int last_pulse = simmgr_shm->status.cardiac.pulseCount;
-	unsigned int last_pulseVpc = simmgr_shm->status.cardiac.pulseCountVpc;
-	unsigned int last_breath = simmgr_shm->status.respiration.breathCount;
-	unsigned int last_manual_breath = simmgr_shm->status.respiration.manual_count;
 
-	while (1)
+	if (portUpdateLoops++ > 500)
 	{
-		Sleep(10);
-		
-		if (portUpdateLoops++ > 500)
-		{
-			sprintf_s(pbuf, "statusPort:%d", PORT_STATUS);
-			broadcast_word(pbuf);
-			portUpdateLoops = 0;
-		}
-		
-		if (last_pulse != simmgr_shm->status.cardiac.pulseCount)
+		sprintf_s(pbuf, "statusPort:%d", PORT_STATUS);
+		broadcast_word(pbuf);
+		portUpdateLoops = 0;
+	}
+	
+	if (last_pulse != simmgr_shm->status.cardiac.pulseCount)
+	{
+		last_pulse = simmgr_shm->status.cardiac.pulseCount;
+		count = broadcast_word(pulseWord);
+		if (count)
 		{
-			last_pulse = simmgr_shm->status.cardiac.pulseCount;
-			count = broadcast_word(pulseWord);
-			if (count)
-			{
 #ifdef DEBUG
-				//printf("Pulse sent to %d listeners\n", count);
+			//printf("Pulse sent to %d listeners\n", count);
 #endif
-			}
 		}
-		if (last_pulseVpc != simmgr_shm->status.cardiac.pulseCountVpc)
+	}
+	if (last_pulseVpc != simmgr_shm->status.cardiac.pulseCountVpc)
+	{
+		last_pulseVpc = simmgr_shm->status.cardiac.pulseCountVpc;
+		count = broadcast_word(pulseWordVPC);
+		if (count)
 		{
-			last_pulseVpc = simmgr_shm->status.cardiac.pulseCountVpc;
-			count = broadcast_word(pulseWordVPC);
-			if (count)
-			{
 #ifdef DEBUG
-				//printf("PulseVPC sent to %d listeners\n", count);
+			//printf("PulseVPC sent to %d listeners\n", count);
 #endif
-			}
 		}
+	}
+	if (last_manual_breath != simmgr_shm->status.respiration.manual_count)
+	{
+		last_manual_breath = simmgr_shm->status.respiration.manual_count;
+		simmgr_shm->status.respiration.breathCount++;
+		statusMarkDirty(STATUS_SEC_RESPIRATION);
+	}
+	if (last_breath != simmgr_shm->status.respiration.breathCount)
+	{
+		last_breath = simmgr_shm->status.respiration.breathCount;
+		count = 0;
 		if (last_manual_breath != simmgr_shm->status.respiration.manual_count)
 		{
 			last_manual_breath = simmgr_shm->status.respiration.manual_count;
-			simmgr_shm->status.respiration.breathCount++;
 		}
-		if (last_breath != simmgr_shm->status.respiration.breathCount)
-		{
-			last_breath = simmgr_shm->status.respiration.breathCount;
-			count = 0;
-			if (last_manual_breath != simmgr_shm->status.respiration.manual_count)
-			{
-				last_manual_breath = simmgr_shm->status.respiration.manual_count;
-			}
-			count = broadcast_word(breathWord);
+		count = broadcast_word(breathWord);
 #ifdef DEBUG
-			if (count)
-			{
-				//printf("Breath sent to %d listeners\n", count);
-			}
-#endif
+		if (count)
+		{
+			//printf("Breath sent to %d listeners\n", count);
 		}
+#endif
 	}
-	printf("pulseBroadcastLoop exit\n");
-	exit(206);
 }
+
 void
-pulseProcessChild(void)
+pulseBroadcastLoop(void)
 {
-	int checkCount = 0;
+	if (!SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL))
+	{
+		DWORD dwError;
+		dwError = GetLastError();
+		_tprintf(TEXT("Failed to elevate priority (%d)\n"), dwError);
+	}
+	DWORD dwThreadPri;
+	dwThreadPri = GetThreadPriority(GetCurrentThread()); 
+	_tprintf(TEXT("pulseBroadcastLoop: Current thread priority is 0x%x\n"), dwThreadPri);
+
+	last_pulse = simmgr_shm->status.cardiac.pulseCount;
+	last_pulseVpc = simmgr_shm->status.cardiac.pulseCountVpc;
+	last_breath = simmgr_shm->status.respiration.breathCount;
+	last_manual_breath = simmgr_shm->status.respiration.manual_count;
 
 	while (1)
 	{
-		Sleep(50);		// 50 msec wait
+		Sleep(10);
+		pulseBroadcastCheck();
+	}
+	printf("pulseBroadcastLoop exit\n");
+	exit(206);
+}
 
-		if (strcmp(simmgr_shm->status.scenario.state, "Running") == 0)
-		{
-			// A place for code to run only when a scenario is active
-		}
-		else
-		{
-			
-		}
+/*
+ * pulseRateCheck
+ *
+ * Reset the timers when the rates, rhythm or VPC settings change. Called every 50 msec.
+ */
+void
+pulseRateCheck(void)
+{
+	if (strcmp(simmgr_shm->status.scenario.state, "Running") == 0)
+	{
+		// A place for code to run only when a scenario is active
+	}
+	else
+	{
 		
-		if (currentPulseRate != simmgr_shm->status.cardiac.rate)
-		{
-			pulseSema.lock();
-			set_pulse_rate(simmgr_shm->status.cardiac.rate);
-			currentPulseRate = simmgr_shm->status.cardiac.rate;
-			pulseSema.unlock();
+	}
+	
+	if (currentPulseRate != simmgr_shm->status.cardiac.rate)
+	{
+		pulseSema.lock();
+		set_pulse_rate(simmgr_shm->status.cardiac.rate);
+		currentPulseRate = simmgr_shm->status.cardiac.rate;
+		pulseSema.unlock();
 #ifdef DEBUG
-			sprintf_s(p_msg, "Set Pulse to %d", currentPulseRate);
-			log_message("", p_msg);
+		sprintf_s(p_msg, "Set Pulse to %d", currentPulseRate);
+		log_message("", p_msg);
 #endif
-		}
-		if (currentVpcFreq != simmgr_shm->status.cardiac.vpc_freq ||
-				vpcType != simmgr_shm->status.cardiac.vpc_type)
-		{
-			currentVpcFreq = simmgr_shm->status.cardiac.vpc_freq;
-			vpcType = simmgr_shm->status.cardiac.vpc_type;
-			calculateVPCFreq();
-			set_pulse_rate(simmgr_shm->status.cardiac.rate);
+	}
+	if (currentVpcFreq != simmgr_shm->status.cardiac.vpc_freq ||
+			vpcType != simmgr_shm->status.cardiac.vpc_type)
+	{
+		currentVpcFreq = simmgr_shm->status.cardiac.vpc_freq;
+		vpcType = simmgr_shm->status.cardiac.vpc_type;
+		calculateVPCFreq();
+		set_pulse_rate(simmgr_shm->status.cardiac.rate);
 
-		}
+	}
 
-		if (strncmp(simmgr_shm->status.cardiac.rhythm, "afib", 4) == 0 &&
-			! afibActive )
-		{
-			afibActive = 1;
-			set_pulse_rate(simmgr_shm->status.cardiac.rate);
-		}
-		else if (afibActive )
-		{
-			afibActive = 0;
-			set_pulse_rate(simmgr_shm->status.cardiac.rate);
+	if (strncmp(simmgr_shm->status.cardiac.rhythm, "afib", 4) == 0 &&
+		! afibActive )
+	{
+		afibActive = 1;
+		set_pulse_rate(simmgr_shm->status.cardiac.rate);
+	}
+	else if (afibActive )
+	{
+		afibActive = 0;
+		set_pulse_rate(simmgr_shm->status.cardiac.rate);
 
-		}
-		
-		if (lastManualBreath != simmgr_shm->status.respiration.manual_count)
-		{
-			// Manual Breath has started. Reset timer to run based on this breath
-			lastManualBreath = simmgr_shm->status.respiration.manual_count;
-			breathSema.lock();
-			restart_breath_timer();
-			breathSema.unlock();
-		}
-		
-		// If the breath rate has changed, then reset the timer
-		if (currentBreathRate != simmgr_shm->status.respiration.rate)
-		{
-			breathSema.lock();
-			set_breath_rate(simmgr_shm->status.respiration.rate);
-			currentBreathRate = simmgr_shm->status.respiration.rate;
-			breathSema.unlock();
+	}
+	
+	if (lastManualBreath != simmgr_shm->status.respiration.manual_count)
+	{
+		// Manual Breath has started. Reset timer to run based on this breath
+		lastManualBreath = simmgr_shm->status.respiration.manual_count;
+		breathSema.lock();
+		restart_breath_timer();
+		breathSema.unlock();
+	}
+	
+	// If the breath rate has changed, then reset the timer
+	if (currentBreathRate != simmgr_shm->status.respiration.rate)
+	{
+		breathSema.lock();
+		set_breath_rate(simmgr_shm->status.respiration.rate);
+		currentBreathRate = simmgr_shm->status.respiration.rate;
+		breathSema.unlock();
 
-			// awRR Calculation - TBD - Need real calculations
-			//simmgr_shm->status.respiration.awRR = simmgr_shm->status.respiration.rate;
+		// awRR Calculation - TBD - Need real calculations
+		//simmgr_shm->status.respiration.awRR = simmgr_shm->status.respiration.rate;
 #ifdef DEBUG
-			sprintf_s(p_msg, "Set Breath to %d", currentBreathRate);
-			log_message("", p_msg);
+		sprintf_s(p_msg, "Set Breath to %d", currentBreathRate);
+		log_message("", p_msg);
 #endif
-		}
+	}
+}
+
+void
+pulseProcessChild(void)
+{
+	while (1)
+	{
+		Sleep(50);		// 50 msec wait
+		pulseRateCheck();
 	}
 	printf("pulseProcessChild Exit");
 	exit(204);
@@ -970,6 +1024,7 @@ void getControllerVersion(int index) {
 				sprintf_s(listeners[index].version, "%s", buffer);
 				printf("Controller Version: %s  %s\n", buffer, listeners[index].version);
 				sprintf_s(simmgr_shm->simControllers[index].version, "%s", buffer);
+				statusMarkDirty(STATUS_SEC_CONTROLLERS);
 			}
 			else if (result == 0) {
 				std::cout << "Connection closed by server." << std::endl;
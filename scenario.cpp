@@ -67,15 +67,18 @@
 #include "vetsim.h"
 #include "scenario.h"
 #include "llist.h"
+#include <algorithm>
+#include <unordered_map>
 // #include "XMLRead.h"
 
-int current_scene_id = -1;
+// The parse state is per thread, so the library can be preloaded while a scenario runs
+thread_local int current_scene_id = -1;
 using namespace std;
-const char* xml_filename;
-int line_number = 0;
+thread_local const char* xml_filename;
+thread_local int line_number = 0;
 int verbose = 0;
 int checkOnly = 0;
-int errCount = 0;
+thread_local int errCount = 0;
 
 extern int closeFlag;
 
@@ -84,16 +87,33 @@ extern int closeFlag;
 //static void saveData(const xmlChar* xmlName, const xmlChar* xmlValue);
 //static int readScenario(const char* filename);
 static void scene_check(void);
+static DWORD sceneWaitTime(void);
 static struct scenario_scene* findScene(int scene_id);
+static int reloadScenario(void);
 
 int validateScenes(void );
-static void startScene(int sceneId);
+static void startScene(struct scenario_scene* new_scene, int sceneId);
 
-// loopStart and loopStop are used to measure the actual sleep time of the scenario loop,
+// loopStart and loopStop are used to measure the time since the last scene_check,
 // to calculate the time in a scene and in the scenario
 struct timeval loopStart;
 struct timeval loopStop;
 
+// Index from each status value the current scene tests to the triggers that test it.
+// A trigger's result only depends on its value, so scene_check re-tests a trigger
+// only when that value has changed since the last pass.
+struct trigger_dep
+{
+	size_t offset;
+	int width;
+	int last;		// Value at the last pass
+	std::vector<struct scenario_trigger*> triggers;
+};
+static std::vector<struct trigger_dep> sceneDeps;
+static std::vector<std::vector<struct scenario_trigger*>> sceneEvents;	// By interned event ID
+static std::vector<struct scenario_trigger*> sceneDirty;
+static int sceneDepsPrimed = 0;	// Clear to test every trigger on the next pass
+
 // palpateStart and palpateStop are used to measure the duration of palpation,
 struct timeval palpateStart;
 struct timeval palpateNow;
@@ -106,6 +126,8 @@ int cprCumulative = 0;		// Cumulative time for CPR active in this scene
 int shockActive = 0;	// Flag to indicate Defibrillation is active
 struct pulse pulseStatus = { 0, 0, 0, 0, 0, 0 };
 
+thread_local struct arena scenarioArena;
+
 // Internal state is tracked to compare to the overall state, for detecting changes
 ScenarioState proc_scenario_state;
 
@@ -240,21 +262,25 @@ void displayParseLog(void)
 #define MAX_MSG_SIZE 1024
 char s_msg[MAX_MSG_SIZE];
 
-int xml_current_level = 0;
-std::wstring parseLog;
-int parse_state = PARSE_STATE_NONE;
-int parse_init_state = PARSE_INIT_STATE_NONE;
-int parse_scene_state = PARSE_SCENE_STATE_NONE;
-int parse_header_state = PARSE_HEADER_STATE_NONE;
+thread_local int xml_current_level = 0;
+thread_local std::wstring parseLog;
+thread_local int parse_state = PARSE_STATE_NONE;
+thread_local int parse_init_state = PARSE_INIT_STATE_NONE;
+thread_local int parse_scene_state = PARSE_SCENE_STATE_NONE;
+thread_local int parse_header_state = PARSE_HEADER_STATE_NONE;
 
-struct scenario_data* scenario;
+thread_local struct scenario_data* scenario;
 struct scenario_scene* current_scene;
 
+/*
+ * scenarioStart
+ *
+ * Read the active scenario, apply its init and enter the starting scene.
+ * Returns 0, or -1 if the scenario could not be read.
+ */
 int
-scenario_main(void)
+scenarioStart(void)
 {
-	int sts;
-	char* sesid = NULL;
 	struct tm tmDest;
 	time_t start_time;
 	errno_t err = 0;
@@ -269,14 +295,7 @@ scenario_main(void)
 		fprintf(stderr, "%s\n", s_msg);
 	}
 
-	xml_current_level = 0;
-	current_scene_id = -1;
-	line_number = 0;
-
-	parse_state = PARSE_STATE_NONE;
-	parse_init_state = PARSE_INIT_STATE_NONE;
-	parse_scene_state = PARSE_SCENE_STATE_NONE;
-	parse_header_state = PARSE_HEADER_STATE_NONE;
+	resetParseState();
 
 	cprActive = 0;				// Flag to indicate CPR is active
 	cprCumulative = 0;		// Cumulative time for CPR active in this scene
@@ -291,15 +310,21 @@ scenario_main(void)
 	simmgr_shm->status.scenario.elapsed_msec_scenario = 0;
 	simmgr_shm->status.scenario.elapsed_msec_scene = 0;
 
-	// Allocate and clear the base scenario structure
-	scenario = (struct scenario_data*)calloc(1, sizeof(struct scenario_data));
-	initializeParameterStruct(&scenario->initParams);
+	// Allocate and clear the base scenario structure. The scenes, triggers and events
+	// are added to the same arena as they are parsed.
+	arena_free(&scenarioArena);
+	scenario = (struct scenario_data*)arena_alloc(&scenarioArena, sizeof(struct scenario_data));
+	if (!scenario)
+	{
+		printf("Failed to allocate the scenario\n");
+		return (-1);
+	}
 
 	simmgr_shm->eventListNextWrite = 0;	// Start processing event at the next posted event
 	simmgr_shm->eventListNextRead = 0;
 
 	// For display Time
-	start_time = std::time(nullptr);
+	start_time = simClockTime();
 	err = localtime_s(&tmDest, &start_time);
 	simmgr_shm->status.general.clockStartSec = (tmDest.tm_hour * 60 * 60) + (tmDest.tm_min * 60) + tmDest.tm_sec;
 
@@ -321,13 +346,23 @@ scenario_main(void)
 		sprintf_s(simmgr_shm->instructor.scenario.state, STR_SIZE, "%s", "stopped");
 		simmgr_shm->instructor.scenario.error_flag = 1;
 		releaseInstructorLock();
+		arena_free(&scenarioArena);
+		scenario = NULL;
 		return (-1);
 	}
+	if (verbose)
+	{
+		printf("Scenario memory: %zu bytes in %d blocks\n", scenarioArena.allocated, scenarioArena.blocks);
+	}
 	if (errCount)
 	{
 
 	}
 	printf("readScenario Success\n");
+	if (!checkOnly)
+	{
+		watchScenarioReload(simmgr_shm->status.scenario.active);
+	}
 	if (verbose || checkOnly)
 	{
 		printf("Showing scenes\n");
@@ -425,6 +460,8 @@ scenario_main(void)
 	simmgr_shm->status.respiration.manual_breath = 0;
 	simmgr_shm->status.respiration.manual_count = 0;
 	simmgr_shm->status.general.temperature_enable = 0;
+	statusMarkDirty(STATUS_SEC_SCENARIO | STATUS_SEC_CARDIAC | STATUS_SEC_RESPIRATION | STATUS_SEC_GENERAL |
+		STATUS_SEC_CPR | STATUS_SEC_DEFIBRILLATION);
 
 
 	// Log the Scenario Name
@@ -448,7 +485,7 @@ scenario_main(void)
 		{
 			printf("Calling processInit for Scene %d, %s \n", current_scene->id, current_scene->name);
 		}
-		startScene(current_scene_id);
+		startScene(current_scene, current_scene_id);
 	}
 
 	// Set our internal state to running
@@ -463,7 +500,7 @@ scenario_main(void)
 	simmgr_shm->status.scenario.elapsed_msec_scene = 0;
 
 	extern std::time_t scenario_start_time;
-	scenario_start_time = time(nullptr);
+	scenario_start_time = simClockTime();
 
 	cprActive = 0;
 	cprCumulative = 0;
@@ -473,64 +510,113 @@ scenario_main(void)
 	//{
 		//errno = -1;
 	//}
-	// Continue scenario execution
-	while (1)
+
+	clock_gettime(CLOCK_REALTIME, &loopStart);
+	return (0);
+}
+
+/*
+ * scenarioStep
+ *
+ * One pass of the scenario loop: follow the scenario state and, while running, check
+ * the scene. Returns 1 once the scenario has stopped and been freed, otherwise 0.
+ */
+int
+scenarioStep(void)
+{
+	int sts;
+
+	if (simmgr_shm->status.defibrillation.shock == 1)
 	{
 		clock_gettime(CLOCK_REALTIME, &loopStart);
-
-		// Sleep
-		Sleep(SCENARIO_LOOP_DELAY);
-		if (simmgr_shm->status.defibrillation.shock == 1)
-		{
-			continue;
-		}
-		if (strcmp(simmgr_shm->status.scenario.state, "Terminate") == 0)	// Check for termination
+		return (0);
+	}
+	if (strcmp(simmgr_shm->status.scenario.state, "Terminate") == 0)	// Check for termination
+	{
+		if (proc_scenario_state != ScenarioState::ScenarioTerminate)
 		{
-			if (proc_scenario_state != ScenarioState::ScenarioTerminate)
-			{
-				// If the scenario needs to do any cleanup, this is the place.
-				printf("Scenario is Terminating\n");
-				snprintf(s_msg, MAX_MSG_SIZE, "Scenario: Terminate");
-				//log_message("", s_msg );
+			// If the scenario needs to do any cleanup, this is the place.
+			printf("Scenario is Terminating\n");
+			snprintf(s_msg, MAX_MSG_SIZE, "Scenario: Terminate");
+			//log_message("", s_msg );
 
-				sts = takeInstructorLock();
-				if (!sts)
-				{
-					addComment(s_msg);
-					proc_scenario_state = ScenarioState::ScenarioTerminate;
-					sprintf_s(simmgr_shm->instructor.scenario.state, STR_SIZE, "Stopped");
-					releaseInstructorLock();
-					printf("Scenario is Stopping\n");
-				}
-				else
-				{
-					printf("Failed to get the Instructor Lock\n");
-				}
+			sts = takeInstructorLock();
+			if (!sts)
+			{
+				addComment(s_msg);
+				proc_scenario_state = ScenarioState::ScenarioTerminate;
+				sprintf_s(simmgr_shm->instructor.scenario.state, STR_SIZE, "Stopped");
+				releaseInstructorLock();
+				printf("Scenario is Stopping\n");
 			}
-		}
-		else if (strcmp(simmgr_shm->status.scenario.state, "Stopped") == 0)
-		{
-			if (proc_scenario_state != ScenarioState::ScenarioStopped)
+			else
 			{
-				snprintf(s_msg, MAX_MSG_SIZE, "Scenario: Stopped");
-				//log_message("", s_msg );
-				lockAndComment(s_msg);
-				proc_scenario_state = ScenarioState::ScenarioStopped;
-				printf("Scenario process is exiting\n");
-				free(scenario);
-				return(0);
+				printf("Failed to get the Instructor Lock\n");
 			}
 		}
-		else if (strcmp(simmgr_shm->status.scenario.state, "Running") == 0)
+	}
+	else if (strcmp(simmgr_shm->status.scenario.state, "Stopped") == 0)
+	{
+		if (proc_scenario_state != ScenarioState::ScenarioStopped)
+		{
+			snprintf(s_msg, MAX_MSG_SIZE, "Scenario: Stopped");
+			//log_message("", s_msg );
+			lockAndComment(s_msg);
+			proc_scenario_state = ScenarioState::ScenarioStopped;
+			printf("Scenario process is exiting\n");
+			watchScenarioReload(NULL);
+			prefetchRelease();
+			sceneDeps.clear();
+			sceneEvents.clear();
+			current_scene = NULL;
+			arena_free(&scenarioArena);
+			scenario = NULL;
+			return (1);
+		}
+	}
+	else if (strcmp(simmgr_shm->status.scenario.state, "Running") == 0)
+	{
+		if (proc_scenario_state == ScenarioState::ScenarioPaused)
 		{
-			// Do periodic scenario check
-			scene_check();
-			proc_scenario_state = ScenarioState::ScenarioRunning;
+			// Resumed. The thread slept through the pause, which is not counted.
+			clock_gettime(CLOCK_REALTIME, &loopStart);
 		}
-		else if (strcmp(simmgr_shm->status.scenario.state, "Paused") == 0)
+		// Do periodic scenario check
+		scene_check();
+		proc_scenario_state = ScenarioState::ScenarioRunning;
+	}
+	else if (strcmp(simmgr_shm->status.scenario.state, "Paused") == 0)
+	{
+		// Nothing, and the paused time is not counted
+		proc_scenario_state = ScenarioState::ScenarioPaused;
+		clock_gettime(CLOCK_REALTIME, &loopStart);
+	}
+	return (0);
+}
+
+int
+scenario_main(void)
+{
+	if (scenarioStart() != 0)
+	{
+		return (-1);
+	}
+
+	// start_scenario sets the state to Running after starting this thread
+	while (strcmp(simmgr_shm->status.scenario.state, "Stopped") == 0 && !closeFlag)
+	{
+		scenarioWait(SCENARIO_LOOP_DELAY);
+	}
+
+	// Continue scenario execution
+	clock_gettime(CLOCK_REALTIME, &loopStart);
+	while (1)
+	{
+		// Wait for an event, a status change or the next deadline
+		scenarioWait(sceneWaitTime());
+		if (scenarioStep())
 		{
-			// Nothing
-			proc_scenario_state = ScenarioState::ScenarioPaused;
+			return (0);
 		}
 		if (closeFlag)
 		{
@@ -543,39 +629,58 @@ scenario_main(void)
 }
 
 /**
- * findScene
- * @scene_id
- *
+* sceneWaitTime
+*
+* How long the scenario thread can sleep before scene_check has work of its own.
+* Events, instructor commands and state changes wake it early through scenarioNotify.
+* Value triggers, CPR and palpation timing and a shock in progress still need the
+* periodic check, as the values they read are also updated outside scan_commands.
+* While running, it wakes at least every SCENARIO_CLOCK_DELAY so the elapsed times
+* shown as runtimeScene and runtimeScenario keep moving.
 */
-static struct scenario_scene*
-findScene(int scene_id)
+static DWORD
+sceneWaitTime(void)
 {
-	struct snode* snode;
-	struct scenario_scene* scene;
-	//int limit = 50;
-
-	snode = scenario->scene_list.next;
+	DWORD wait = SCENARIO_CLOCK_DELAY;
+	ULONGLONG limit;
 
-	while (snode)
+	if (closeFlag)
 	{
-		scene = (struct scenario_scene*)snode;
-		if (scene->id == scene_id)
+		return (0);
+	}
+	if (strcmp(simmgr_shm->status.scenario.state, "Running") != 0 || !current_scene)
+	{
+		return (simmgr_shm->status.defibrillation.shock == 1 ? SCENARIO_LOOP_DELAY : INFINITE);
+	}
+	if (current_scene->timeout)
+	{
+		limit = (ULONGLONG)current_scene->timeout * 1000;
+		if (simmgr_shm->status.scenario.elapsed_msec_scene >= limit)
 		{
-			return (scene);
+			return (0);
 		}
-		/*
-		if ( limit-- == 0 )
+		if (limit - simmgr_shm->status.scenario.elapsed_msec_scene < wait)
 		{
-			printf("findScene Limit reached\n" );
-			sprintf(s_msg, "Scenario: findScene Limit reached" );
-			log_message("", s_msg );
-			lockAndComment(s_msg );
-			exit ( -2 );
+			wait = (DWORD)(limit - simmgr_shm->status.scenario.elapsed_msec_scene);
 		}
-		*/
-		snode = get_next_llist(snode);
 	}
-	return (NULL);
+	if (simmgr_shm->status.defibrillation.shock == 1 || cprActive || simmgr_shm->status.cpr.compression ||
+		pulseStatus.active || simmgr_shm->status.pulse.active || !sceneDeps.empty())
+	{
+		return (min(wait, (DWORD)SCENARIO_LOOP_DELAY));
+	}
+	return (wait);
+}
+
+/**
+ * findScene
+ * @scene_id
+ *
+*/
+static struct scenario_scene*
+findScene(int scene_id)
+{
+	return (findSceneIn(scenario, scene_id));
 }
 
 
@@ -703,6 +808,10 @@ static void pulse_check(void)
 		snprintf(s_msg, MAX_MSG_SIZE, "Action: End Pulse Palpation Left Femoral ");
 		lockAndComment(s_msg);
 	}
+	if (simmgr_shm->status.pulse.active != pulseStatus.active)
+	{
+		statusMarkDirty(STATUS_SEC_PULSE);
+	}
 	simmgr_shm->status.pulse.active = pulseStatus.active;
 	if (pulseStatus.active)
 	{
@@ -713,6 +822,7 @@ static void pulse_check(void)
 		msec_diff = (((sec_diff * 1000000) + palpateNow.tv_usec) - palpateStart.tv_usec) / 1000;
 
 		simmgr_shm->status.pulse.duration = msec_diff;
+		statusMarkDirty(STATUS_SEC_PULSE);
 	}
 }
 
@@ -725,77 +835,21 @@ int trigger_check(struct scenario_trigger* trig )
 {
 	int met = 0;
 
+	// Event triggers are dispatched by ID in scene_check
 	if (trig->test == TRIGGER_TEST_EVENT)
 	{
-		if (strcmp(trig->param_element, simmgr_shm->eventList[simmgr_shm->eventListNextRead].eventName) == 0)
-		{
-			met = 1;
-			printf("Event %s MET!\n", trig->param_element);
-		}
-		//printf("Event %s %s %d %d %d %d Met %d\n",
-		//	trig->param_class,
-		//	trig->param_element,
-		//	trig->test,
-		//	trig->value,
-		//	trig->value2,
-		//	trig->scene, met );
+		return (0);
 	}
-	else
+	if (trig->width)
 	{
 		int val;
 
-		val = getValueFromName(trig->param_class, trig->param_element);
-		switch (trig->test)
+		// The test was compiled to a range when the scenario was read
+		val = getStatusValue(trig->offset, trig->width);
+		if (((val >= trig->low) && (val <= trig->high)) != (trig->outside != 0))
 		{
-		case TRIGGER_TEST_EQ:
-			if (val == trig->value)
-			{
-				printf("Event %s MET!\n", trig->param_element);
-				met = 1;
-			}
-			break;
-		case TRIGGER_TEST_LTE:
-			if (val <= trig->value)
-			{
-				printf("Event %s MET!\n", trig->param_element);
-				met = 1;
-			}
-			break;
-		case TRIGGER_TEST_LT:
-			if (val < trig->value)
-			{
-				printf("Event %s MET!\n", trig->param_element);
-				met = 1;
-			}
-			break;
-		case TRIGGER_TEST_GTE:
-			if (val >= trig->value)
-			{
-				printf("Event %s MET!\n", trig->param_element);
-				met = 1;
-			}
-			break;
-		case TRIGGER_TEST_GT:
-			if (val > trig->value)
-			{
-				printf("Event %s MET!\n", trig->param_element);
-				met = 1;
-			}
-			break;
-		case TRIGGER_TEST_INSIDE:
-			if ((val > trig->value) && (val < trig->value2))
-			{
-				printf("Event %s MET!\n", trig->param_element);
-				met = 1;
-			}
-			break;
-		case TRIGGER_TEST_OUTSIDE:
-			if ((val < trig->value) || (val > trig->value2))
-			{
-				printf("Event %s MET!\n", trig->param_element);
-				met = 1;
-			}
-			break;
+			printf("Event %s MET!\n", trig->param_element);
+			met = 1;
 		}
 		//printf("Trig %s %s %d %d %d %d %d Met %d\n",
 		//	trig->param_class, trig->param_element,
@@ -808,6 +862,33 @@ int trigger_check(struct scenario_trigger* trig )
 	}
 	return (met);
 }
+/**
+* isMet
+*
+* Check whether a group trigger has been met since the scene started
+*/
+static inline int
+isMet(struct scenario_scene* scene, struct scenario_trigger* trig)
+{
+	return ((scene->metBits[trig->bit / 32] >> (trig->bit % 32)) & 1);
+}
+
+/**
+* setMet
+*
+* Record a group trigger as met. Returns 1 if this completes its group.
+*/
+static int
+setMet(struct scenario_scene* scene, struct scenario_trigger* trig)
+{
+	if (isMet(scene, trig))
+	{
+		return (0);
+	}
+	scene->metBits[trig->bit / 32] |= 1u << (trig->bit % 32);
+	return (++scene->groupMet[trig->trig_group->index] >= trig->trig_group->group_triggers_needed);
+}
+
 /**
 * scene_check
 *
@@ -819,67 +900,53 @@ scene_check(void)
 {
 	struct scenario_trigger* trig;
 	struct trigger_group* trig_group;
-	struct snode* snode;
-	struct snode* tsnode;
 	int met = 0;
-	int msec_diff;
-	int sec_diff;
+	long long msec_diff;
+	long long sec_diff;
+	int event;
+
+	// Time since the last check. loopStart is moved on by whole msec only, so
+	// frequent wakeups don't lose the fractions.
+	clock_gettime(CLOCK_REALTIME, &loopStop);
+	sec_diff = (loopStop.tv_sec - loopStart.tv_sec);
+	msec_diff = (((sec_diff * 1000000) + loopStop.tv_usec) - loopStart.tv_usec) / 1000;
+	simmgr_shm->status.scenario.elapsed_msec_scenario += msec_diff;
+	simmgr_shm->status.scenario.elapsed_msec_scene += msec_diff;
+	loopStart.tv_usec += (long)(msec_diff % 1000) * 1000;
+	loopStart.tv_sec += (long)(msec_diff / 1000) + (loopStart.tv_usec / 1000000);
+	loopStart.tv_usec %= 1000000;
+
+	// Take up a new definition if main.xml has been edited
+	if (reloadScenario())
+	{
+		return;
+	}
 
-	// Event checks 
+	// Event checks. Each posted event goes straight to the triggers waiting for it.
 	while (simmgr_shm->eventListNextWrite != simmgr_shm->eventListNextRead )
 	{
-		snode = current_scene->trigger_list.next;
-		
-		// Event Checks - Single Triggers
-		while (snode)
+		event = findEventId(simmgr_shm->eventList[simmgr_shm->eventListNextRead].eventName);
+		if (event >= 0 && event < (int)sceneEvents.size())
 		{
-			trig = (struct scenario_trigger*)snode;
-			if (trig->test == TRIGGER_TEST_EVENT)
+			// In scene order: single triggers, then each group in turn
+			for (auto waiting : sceneEvents[event])
 			{
-				if ( trigger_check(trig ) )
+				trig = waiting;
+				trig_group = trig->trig_group;
+				if (!trig_group)
 				{
 					logTrigger(trig, 0);
-					startScene(trig->scene);
+					startScene(trig->next, trig->scene);
 					return;
 				}
-			}
-			snode = get_next_llist(snode);
-		}
-		// Event Checks - Group Triggers
-		tsnode = current_scene->group_list.next;
-		while (tsnode)
-		{
-			trig_group = (struct trigger_group*)tsnode;
-			printf("Checking Group %d Event Trigs\n", trig_group->group_id );
-			snode = trig_group->group_trigger_list.next;
-			while (snode)
-			{
-				trig = (struct scenario_trigger*)snode;
-				printf("\t\tTrigger %s %d %d\n", trig->param_element, trig->test, trig->met );
-				if (!trig->met)
+				if (setMet(current_scene, trig))
 				{
-					if (trig->test == TRIGGER_TEST_EVENT)
-					{
-						printf("Checking Group %d Trig Event %s\n", trig_group->group_id, trig->param_element);
-						if (trigger_check(trig))
-						{
-							trig->met = 1;
-							trig_group->group_triggers_met++;
-							printf("Group %d Trig Event %s MET! Group Met is %d\n", trig_group->group_id, trig->param_element, trig_group->group_triggers_needed);
-							if (trig_group->group_triggers_met >= trig_group->group_triggers_needed)
-							{
-								logTriggerGroup(trig_group, 0);
-								startScene(trig_group->scene);
-								return;
-							}
-						}
-					}
+					logTriggerGroup(trig_group, 0);
+					startScene(trig_group->next, trig_group->scene);
+					return;
 				}
-				snode = get_next_llist(snode);
 			}
-			tsnode = get_next_llist(tsnode);
 		}
-		printf("Processed Event %s\n", simmgr_shm->eventList[simmgr_shm->eventListNextRead].eventName);
 		simmgr_shm->eventListNextRead++;
 		if (simmgr_shm->eventListNextRead >= EVENT_LIST_SIZE)
 		{
@@ -922,16 +989,36 @@ scene_check(void)
 	// Pulse Palpation Checks
 	pulse_check();
 
-	// Trigger Checks - Single Triggers
-	snode = current_scene->trigger_list.next;
-	while (snode)
+	// Trigger Checks - collect the triggers whose value changed
+	sceneDirty.clear();
+	for (auto& dep : sceneDeps)
+	{
+		int val = getStatusValue(dep.offset, dep.width);
+
+		if (sceneDepsPrimed && val == dep.last)
+		{
+			continue;
+		}
+		dep.last = val;
+		sceneDirty.insert(sceneDirty.end(), dep.triggers.begin(), dep.triggers.end());
+	}
+	sceneDepsPrimed = 1;
+
+	// Test them in scene order: single triggers, then each group in turn
+	if (sceneDirty.size() > 1)
+	{
+		sort(sceneDirty.begin(), sceneDirty.end(),
+			[](struct scenario_trigger* a, struct scenario_trigger* b) { return (a->seq < b->seq); });
+	}
+	for (auto dirty : sceneDirty)
 	{
 		if (closeFlag)
 		{
 			break;
 		}
-		trig = (struct scenario_trigger*)snode;
-		if (trig->test != TRIGGER_TEST_EVENT)
+		trig = dirty;
+		trig_group = trig->trig_group;
+		if (!trig_group)
 		{
 			met = trigger_check(trig);
 
@@ -939,67 +1026,36 @@ scene_check(void)
 			{
 				printf("Single Trigger Met\n");
 				logTrigger(trig, 0);
-				startScene(trig->scene);
+				startScene(trig->next, trig->scene);
 				return;
 			}
 		}
-		snode = get_next_llist(snode);
-	}
-
-	// Trigger Checks - Group Triggers
-	snode = current_scene->group_list.next;
-	while (snode)
-	{
-		if (closeFlag)
-		{
-			break;
-		}
-		trig_group = (struct trigger_group*)snode;
-		tsnode = trig_group->group_trigger_list.next;
-		while (tsnode)
+		else if (!isMet(current_scene, trig))
 		{
-			if (closeFlag)
-			{
-				break;
-			}
-			trig = (struct scenario_trigger*)tsnode;
-			if (!trig->met && trig->test != TRIGGER_TEST_EVENT)
-			{
-				met = trigger_check(trig);
+			met = trigger_check(trig);
 
+			if (met)
+			{
+				met = setMet(current_scene, trig);
+				printf("Group %d Trigger %s Gropup Met %d\n", trig_group->group_id, trig->param_element, current_scene->groupMet[trig_group->index] );
+				logTrigger(trig, 0);
 				if (met)
 				{
-					trig->met = 1;
-					trig_group->group_triggers_met++;
-					printf("Group %d Trigger %s Gropup Met %d\n", trig_group->group_id, trig->param_element, trig_group->group_triggers_met );
-					logTrigger(trig, 0);
-					if (trig_group->group_triggers_met >= trig_group->group_triggers_needed)
-					{
-						logTriggerGroup(trig_group, 0);
-						startScene(trig_group->scene);
-						return;
-					}
+					logTriggerGroup(trig_group, 0);
+					startScene(trig_group->next, trig_group->scene);
+					return;
 				}
 			}
-			tsnode = get_next_llist(tsnode);
 		}
-		snode = get_next_llist(snode);
 	}
 
 	// Check timeout
-	clock_gettime(CLOCK_REALTIME, &loopStop);
-	sec_diff = (loopStop.tv_sec - loopStart.tv_sec);
-	//msec_diff = (((sec_diff * 1000000000) + loopStop.tv_nsec) - loopStart.tv_nsec) / 1000000;
-	msec_diff = (((sec_diff * 1000000) + loopStop.tv_usec) - loopStart.tv_usec) / 1000;
-	simmgr_shm->status.scenario.elapsed_msec_scenario += msec_diff;
-	simmgr_shm->status.scenario.elapsed_msec_scene += msec_diff;
-
 	if (current_scene->timeout)
 	{
 		if (simmgr_shm->status.scenario.elapsed_msec_scene >= ((ULONGLONG)current_scene->timeout * 1000))
 		{
 			logTrigger((struct scenario_trigger*)0, current_scene->timeout);
-			startScene(current_scene->timeout_scene);
+			startScene(current_scene->timeout_next, current_scene->timeout_scene);
 		}
 	}
 }
@@ -1048,16 +1104,139 @@ showScene(struct scenario_scene* scene)
 	}
 	
 }
+/** indexTrigger
+ * @trig: value trigger in the current scene
+ *
+*/
+static void
+indexTrigger(struct scenario_trigger* trig)
+{
+	struct trigger_dep dep;
+
+	if (trig->test == TRIGGER_TEST_EVENT)
+	{
+		if (trig->event >= 0 && trig->event < (int)sceneEvents.size())
+		{
+			sceneEvents[trig->event].push_back(trig);
+		}
+		return;
+	}
+	if (trig->width == 0)
+	{
+		return;
+	}
+	for (auto& d : sceneDeps)
+	{
+		if (d.offset == trig->offset)
+		{
+			d.triggers.push_back(trig);
+			return;
+		}
+	}
+	dep.offset = trig->offset;
+	dep.width = trig->width;
+	dep.last = 0;
+	dep.triggers.push_back(trig);
+	sceneDeps.push_back(dep);
+}
+
+/** indexScene
+ * @scene: the new current scene
+ *
+ * Build the value and event to trigger indexes for the scene. Every value trigger is
+ * tested on the next pass.
+*/
+static void
+indexScene(struct scenario_scene* scene)
+{
+	struct snode* snode;
+	struct snode* tsnode;
+
+	sceneDeps.clear();
+	sceneDepsPrimed = 0;
+	sceneEvents.clear();
+	sceneEvents.resize(eventIdCount());
+	for (snode = scene->trigger_list.next; snode; snode = get_next_llist(snode))
+	{
+		indexTrigger((struct scenario_trigger*)snode);
+	}
+	for (snode = scene->group_list.next; snode; snode = get_next_llist(snode))
+	{
+		for (tsnode = ((struct trigger_group*)snode)->group_trigger_list.next; tsnode; tsnode = get_next_llist(tsnode))
+		{
+			indexTrigger((struct scenario_trigger*)tsnode);
+		}
+	}
+}
+
+/** sceneAssets
+ * @scene
+ * @assets: receives the vocal and media files the scene's init plays
+ *
+*/
+static void
+sceneAssets(struct scenario_scene* scene, std::vector<std::string>& assets)
+{
+	const char* name;
+
+	name = paramDeltaString(&scene->initParams, offsetof(struct instructor, vocals.filename));
+	if (name && name[0])
+	{
+		assets.push_back(std::string("vocals\\") + name);
+	}
+	name = paramDeltaString(&scene->initParams, offsetof(struct instructor, media.filename));
+	if (name && name[0])
+	{
+		assets.push_back(std::string("media\\") + name);
+	}
+}
+
+/** prefetchNext
+ *
+ * Count the current scene's files as hits or misses, and have the files of each
+ * scene it can go to next read ahead.
+*/
+static void
+prefetchNext(void)
+{
+	std::vector<std::string> used;
+	std::vector<std::string> next;
+	struct snode* snode;
+
+	sceneAssets(current_scene, used);
+	if (current_scene->timeout && current_scene->timeout_next)
+	{
+		sceneAssets(current_scene->timeout_next, next);
+	}
+	for (snode = current_scene->trigger_list.next; snode; snode = get_next_llist(snode))
+	{
+		if (((struct scenario_trigger*)snode)->next)
+		{
+			sceneAssets(((struct scenario_trigger*)snode)->next, next);
+		}
+	}
+	for (snode = current_scene->group_list.next; snode; snode = get_next_llist(snode))
+	{
+		if (((struct trigger_group*)snode)->next)
+		{
+			sceneAssets(((struct trigger_group*)snode)->next, next);
+		}
+	}
+	if (!used.empty() || !next.empty())
+	{
+		prefetchAssets(simmgr_shm->status.scenario.active, used, next);
+	}
+}
+
 /** startScene
+ * @new_scene: the new scene, as bound when the scenario was read
  * @sceneId: id of new scene
  *
+ * A NULL scene is a target that did not exist when the scenario was read.
 */
 static void
-startScene(int sceneId)
+startScene(struct scenario_scene* new_scene, int sceneId)
 {
-	struct scenario_scene* new_scene;
-
-	new_scene = findScene(sceneId);
 	if (!new_scene)
 	{
 		fprintf(stderr, "Scene %d not found", sceneId);
@@ -1069,10 +1248,12 @@ startScene(int sceneId)
 		sprintf_s(simmgr_shm->instructor.scenario.state, NORMAL_STRING_SIZE, "%s", "Terminate");
 		sprintf_s(simmgr_shm->status.scenario.scene_name, LONG_STRING_SIZE, "%s", "");
 		releaseInstructorLock();
+		statusMarkDirty(STATUS_SEC_SCENARIO);
 		return;
 	}
 	showScene(new_scene);
 	current_scene = new_scene;
+	indexScene(current_scene);
 	simmgr_shm->status.scenario.elapsed_msec_scene = 0;
 	cprCumulative = 0;
 	cprActive = 0;
@@ -1082,6 +1263,7 @@ startScene(int sceneId)
 
 	simmgr_shm->status.scenario.scene_id = sceneId;
 	simmgr_shm->status.respiration.manual_count = 0;
+	statusMarkDirty(STATUS_SEC_SCENARIO | STATUS_SEC_RESPIRATION);
 
 	if (current_scene->id <= 0)
 	{
@@ -1110,21 +1292,252 @@ startScene(int sceneId)
 		memset(simmgr_shm->eventList, 0, sizeof(simmgr_shm->eventList));
 
 		processInit(&current_scene->initParams);
+		prefetchNext();
+
 		// Clear completion counts in any trigger groups
-		struct trigger_group * trigger_group;
-		struct scenario_trigger* trigger;
+		if (current_scene->groupCount)
+		{
+			memset(current_scene->groupMet, 0, current_scene->groupCount * sizeof(int));
+			memset(current_scene->metBits, 0, SCENE_MET_WORDS(current_scene) * sizeof(unsigned int));
+		}
+	}
+}
 
-		trigger_group = (struct trigger_group* )current_scene->group_list.next;
-		while (trigger_group)
+/** sameDelta
+ *
+ * Compare two init parameter lists.
+*/
+static int
+sameDelta(const struct param_delta* a, const struct param_delta* b)
+{
+	int i;
+
+	if (a->count != b->count)
+	{
+		return (0);
+	}
+	for (i = 0; i < a->count; i++)
+	{
+		if (a->entries[i].field != b->entries[i].field || a->entries[i].length != b->entries[i].length ||
+			memcmp(a->values + a->entries[i].value, b->values + b->entries[i].value, a->entries[i].length) != 0)
 		{
-			trigger_group->group_triggers_met = 0;
-			trigger = (struct scenario_trigger*)trigger_group->group_list.next;
-			while (trigger)
+			return (0);
+		}
+	}
+	return (1);
+}
+
+/** sameTrigger
+ *
+ * Compare two triggers as written in main.xml.
+*/
+static int
+sameTrigger(const struct scenario_trigger* a, const struct scenario_trigger* b)
+{
+	return (strcmp(a->param_class, b->param_class) == 0 && strcmp(a->param_element, b->param_element) == 0 &&
+		a->test == b->test && a->value == b->value && a->value2 == b->value2 &&
+		a->scene == b->scene && a->group == b->group);
+}
+
+static int
+sameTriggers(struct snode* a, struct snode* b)
+{
+	while (a && b)
+	{
+		if (!sameTrigger((struct scenario_trigger*)a, (struct scenario_trigger*)b))
+		{
+			return (0);
+		}
+		a = get_next_llist(a);
+		b = get_next_llist(b);
+	}
+	return (a == b);
+}
+
+/** sameScene
+ *
+ * Compare two definitions of a scene.
+*/
+static int
+sameScene(struct scenario_scene* a, struct scenario_scene* b)
+{
+	struct snode* ga;
+	struct snode* gb;
+	struct trigger_group* group_a;
+	struct trigger_group* group_b;
+
+	if (strcmp(a->name, b->name) != 0 || a->timeout != b->timeout || a->timeout_scene != b->timeout_scene ||
+		!sameDelta(&a->initParams, &b->initParams) || !sameTriggers(a->trigger_list.next, b->trigger_list.next))
+	{
+		return (0);
+	}
+	for (ga = a->group_list.next, gb = b->group_list.next; ga && gb; ga = get_next_llist(ga), gb = get_next_llist(gb))
+	{
+		group_a = (struct trigger_group*)ga;
+		group_b = (struct trigger_group*)gb;
+		if (group_a->group_id != group_b->group_id || group_a->scene != group_b->scene ||
+			group_a->group_triggers_needed != group_b->group_triggers_needed ||
+			!sameTriggers(group_a->group_trigger_list.next, group_b->group_trigger_list.next))
+		{
+			return (0);
+		}
+	}
+	return (ga == gb);
+}
+
+/** carryGroups
+ * @from: the current scene as it was
+ * @to: the current scene as reloaded
+ *
+ * Keep the met state of the group triggers that are unchanged. Groups are matched by
+ * position and ID, triggers by position within the group.
+*/
+static void
+carryGroups(struct scenario_scene* from, struct scenario_scene* to)
+{
+	struct snode* ga;
+	struct snode* gb;
+	struct snode* ta;
+	struct snode* tb;
+	struct trigger_group* group_a;
+	struct trigger_group* group_b;
+
+	for (ga = from->group_list.next, gb = to->group_list.next; ga && gb; ga = get_next_llist(ga), gb = get_next_llist(gb))
+	{
+		group_a = (struct trigger_group*)ga;
+		group_b = (struct trigger_group*)gb;
+		if (group_a->group_id != group_b->group_id)
+		{
+			break;
+		}
+		for (ta = group_a->group_trigger_list.next, tb = group_b->group_trigger_list.next; ta && tb;
+			ta = get_next_llist(ta), tb = get_next_llist(tb))
+		{
+			if (isMet(from, (struct scenario_trigger*)ta) && sameTrigger((struct scenario_trigger*)ta, (struct scenario_trigger*)tb))
 			{
-				trigger->met = 0;
-				trigger = (struct scenario_trigger*)trigger->trigger_list.next;
+				(void)setMet(to, (struct scenario_trigger*)tb);
 			}
-			trigger_group = (struct trigger_group*)trigger_group->group_list.next;
 		}
 	}
 }
+
+/** reloadScenario
+ *
+ * Swap in a new definition of the running scenario, read by the preload task after
+ * main.xml was written. Scenes are matched by ID. The current scene carries on with its
+ * elapsed time, and the unchanged triggers of its groups keep their met state. The
+ * scenario init is not applied again. Returns 1 if a group the reload completed has
+ * moved to a new scene, otherwise 0.
+*/
+static int
+reloadScenario(void)
+{
+	std::shared_ptr<const std::vector<unsigned char>> image;
+	std::string message;
+	std::unordered_map<int, struct scenario_scene*> oldScenes;
+	char xmlPath[1400];
+	extern char sessionsPath[];
+	struct arena oldArena;
+	struct scenario_data* oldScenario;
+	struct scenario_scene* scene;
+	struct scenario_scene* match = NULL;
+	struct trigger_group* trig_group;
+	struct snode* snode;
+	int startId = current_scene_id;
+	int bound = 0;
+	int changed = 0;
+	int added = 0;
+	int removed = 0;
+
+	if (!takeScenarioReload(image, message) || !current_scene)
+	{
+		return (0);
+	}
+	if (!image)
+	{
+		snprintf(s_msg, MAX_MSG_SIZE, "Scenario: main.xml has errors and was not reloaded. %s", message.c_str());
+		lockAndComment(s_msg);
+		return (0);
+	}
+
+	// Build the new definition in an arena of its own
+	oldArena = scenarioArena;
+	oldScenario = scenario;
+	memset(&scenarioArena, 0, sizeof(scenarioArena));
+	scenario = (struct scenario_data*)arena_alloc(&scenarioArena, sizeof(struct scenario_data));
+	sprintf_s(xmlPath, sizeof(xmlPath), "%s\\%s\\main.xml", sessionsPath, simmgr_shm->status.scenario.active);
+	if (scenario && bindScenarioImage(*image, xmlPath) == 0)
+	{
+		bound = 1;
+		current_scene_id = startId;
+		if (compileTriggers() == 0)
+		{
+			match = findScene(current_scene->id);
+		}
+	}
+	if (match)
+	{
+		for (snode = oldScenario->scene_list.next; snode; snode = get_next_llist(snode))
+		{
+			oldScenes[((struct scenario_scene*)snode)->id] = (struct scenario_scene*)snode;
+		}
+		for (snode = scenario->scene_list.next; snode; snode = get_next_llist(snode))
+		{
+			scene = (struct scenario_scene*)snode;
+			auto found = oldScenes.find(scene->id);
+			if (found == oldScenes.end())
+			{
+				added++;
+			}
+			else
+			{
+				if (!sameScene(found->second, scene))
+				{
+					changed++;
+				}
+				oldScenes.erase(found);
+			}
+		}
+		removed = (int)oldScenes.size();
+	}
+	if (!match || changed + added + removed == 0)
+	{
+		// Keep running the old definition. A bind that fails means main.xml has been
+		// written again, and the preload task will post that.
+		if (bound && !match)
+		{
+			snprintf(s_msg, MAX_MSG_SIZE, "Scenario: main.xml was not reloaded, as it no longer has scene %d", current_scene->id);
+			lockAndComment(s_msg);
+		}
+		arena_free(&scenarioArena);
+		scenarioArena = oldArena;
+		scenario = oldScenario;
+		current_scene_id = startId;
+		(void)compileTriggers();
+		return (0);
+	}
+
+	carryGroups(current_scene, match);
+	current_scene = match;
+	indexScene(current_scene);
+	sprintf_s(simmgr_shm->status.scenario.scene_name, LONG_STRING_SIZE, "%s", current_scene->name);
+	statusMarkDirty(STATUS_SEC_SCENARIO);
+	arena_free(&oldArena);
+
+	snprintf(s_msg, MAX_MSG_SIZE, "Scenario: Reloaded main.xml, %d scenes changed, %d added, %d removed", changed, added, removed);
+	lockAndComment(s_msg);
+
+	// A group may now need fewer triggers than are already met
+	for (snode = current_scene->group_list.next; snode; snode = get_next_llist(snode))
+	{
+		trig_group = (struct trigger_group*)snode;
+		if (current_scene->groupMet[trig_group->index] > 0 &&
+			current_scene->groupMet[trig_group->index] >= trig_group->group_triggers_needed)
+		{
+			logTriggerGroup(trig_group, 0);
+			startScene(trig_group->next, trig_group->scene);
+			return (1);
+		}
+	}
+	return (0);
+}
@@ -25,9 +25,14 @@
 #ifndef _SCENARIO_H
 #define _SCENARIO_H
 
+#include <string>
+#include <vector>
+#include <memory>
 #include "llist.h"
+#include "arena.h"
 
-#define SCENARIO_LOOP_DELAY	250	// Sleep time (msec) for the Scenario loop
+#define SCENARIO_LOOP_DELAY	250	// Longest wait (msec) between periodic scene checks
+#define SCENARIO_CLOCK_DELAY	1000	// Longest wait (msec) while running, for the runtime display
 #define LONG_STRING_SIZE	128
 #define NORMAL_STRING_SIZE	32
 #define SCENE_TITLE_MAX		32
@@ -70,6 +75,26 @@
 #define PARSE_HEADER_STATE_DATE_OF_CREATION	3
 #define PARSE_HEADER_STATE_DESCRIPTION		4
 
+// Scenario and scene parameters, stored as only the instructor fields they set
+struct param_entry
+{
+	unsigned short field;	// Index in the instructor field table (sim-parse.cpp)
+	unsigned short length;	// Bytes of the value. Strings include the terminator.
+	unsigned int value;		// Offset of the value in param_delta.values
+};
+
+struct param_delta
+{
+	int count;
+	struct param_entry* entries;
+	unsigned char* values;
+};
+
+int buildParamDelta(const struct instructor* params, struct param_delta* delta, struct arena* arena);
+int paramFieldSize(int field);
+const char* paramDeltaString(const struct param_delta* delta, size_t offset);
+unsigned int paramLayoutStamp(void);
+
 // Scenario
 struct scenario_data
 {
@@ -79,10 +104,16 @@ struct scenario_data
 	char description[LONG_STRING_SIZE+2];
 
 	// Initialization Parameters for the scenario
-	struct instructor initParams;
+	struct param_delta initParams;
 
 	struct snode scene_list;
 	struct snode event_list;
+	struct snode* scene_tail;	// For append_llist
+	struct snode* event_tail;
+
+	// Scenes by ID, built by compileTriggers. NULL if the IDs are too sparse for a table.
+	struct scenario_scene** sceneTable;
+	int sceneTableSize;
 };
 
 struct trigger_group
@@ -91,8 +122,12 @@ struct trigger_group
 	int group_id;
 	int scene;	// ID of next scene
 	struct snode group_trigger_list;
+	struct snode* group_trigger_tail;
 	int group_triggers_needed;
-	int group_triggers_met;
+
+	// Set by compileTriggers when the scenario is read
+	int index;	// Position in the scene. The count met is the scene's groupMet[index].
+	struct scenario_scene* next;	// The next scene, or NULL if it does not exist
 };
 struct scenario_scene
 {
@@ -101,7 +136,7 @@ struct scenario_scene
 	char name[LONG_STRING_SIZE+1];		// 
 
 	// Initialization Parameters for the scene
-	struct instructor initParams;
+	struct param_delta initParams;
 
 	// Timeout in Seconds
 	int timeout;
@@ -109,12 +144,22 @@ struct scenario_scene
 
 	// List of simple triggers. Advance to next_scene when met.
 	struct snode trigger_list;
+	struct snode* trigger_tail;
 
 	// List of trigger groups. Advcance to next_scene when the required number of triggers have been met.
 	struct snode group_list;
+	struct snode* group_tail;
 
+	// Set by compileTriggers when the scenario is read
+	struct scenario_scene* timeout_next;	// NULL if the timeout scene does not exist
+	int groupCount;
+	int groupTriggers;
+	int* groupMet;				// Triggers met, by group
+	unsigned int* metBits;		// One bit per group trigger, by scenario_trigger.bit
 };
 
+#define SCENE_MET_WORDS(scene)	(((scene)->groupTriggers + 31) / 32)
+
 
 
 // A trigger is defined as a setting of a parameter, or the setting of a trend. A trend time of 0 indicates immediate.
@@ -141,7 +186,18 @@ struct scenario_trigger
 	int		value2;		// Comparison value (only for Inside/Outside)
 	int 	scene;		// ID of next scene
 	int		group;		// Set to include in group
-	int		met;		// Set when an trigger is met. Used to check for Trigger Group Completions.
+
+	// Set by compileTriggers when the scenario is read
+	size_t	offset;		// Offset of the tested value in struct status
+	int		width;		// Size of the tested value, 0 for events
+	int		low;		// The test is met when low <= value <= high,
+	int		high;		// or when it is not, for an Outside test
+	int		outside;
+	int		seq;		// Position in the scene. Earlier triggers are checked first.
+	int		event;		// Interned event ID, for TRIGGER_TEST_EVENT
+	struct trigger_group* trig_group;	// Owning group, or NULL for a single trigger
+	int		bit;		// Group triggers: the met flag in the scene's metBits
+	struct scenario_scene* next;	// Single triggers: the next scene, or NULL if it does not exist
 };
 
 struct scenario_event
@@ -158,10 +214,85 @@ struct scenario_event
 struct xml_level
 {
 	int num;
-	char name[PARAMETER_NAME_LENGTH];
+	const char* name;	// In the reader's buffer
 };
 
+extern thread_local struct arena scenarioArena;	// Holds scenario and everything hanging from it
+
 int readScenario(const char* name);
+void resetParseState(void);
+int parseScenarioFile(const char* filename);
+int parseScenarioMemory(const char* data, size_t size, const char* name);
+int validateScenes(void);
+
+// Problems found by checkScenario
+#define CHECK_SCENE_ID			0	// Negative scene ID
+#define CHECK_DUPLICATE_SCENE	1
+#define CHECK_DUPLICATE_EVENT	2
+#define CHECK_NO_EXIT			3	// A scene other than the end scene with no trigger or timeout
+#define CHECK_END_EXITS			4	// The end scene has triggers and a timeout
+#define CHECK_NO_START			5	// The starting scene does not exist
+#define CHECK_DANGLING			6	// A timeout, trigger or group goes to a scene that does not exist
+#define CHECK_UNREACHABLE		7	// No path from the starting scene reaches the scene
+#define CHECK_PARSE				8	// Reported by the parser
+
+struct scenario_finding
+{
+	int check;
+	int scene;				// Scene the problem is in, or -1
+	std::string message;
+};
+
+int checkScenario(int startScene, std::vector<struct scenario_finding>& findings);
+int scenarioXmlKey(const char* xmlPath, unsigned long long* size, unsigned long long* time);
+int loadScenarioCache(const char* xmlPath);
+int saveScenarioCache(const char* xmlPath);
+int buildScenarioImage(const char* xmlPath, std::vector<unsigned char>& image);
+int writeScenarioImage(const char* xmlPath, const std::vector<unsigned char>& image);
+int bindScenarioImage(const std::vector<unsigned char>& image, const char* xmlPath);
+
+// Background preloading of the scenario library (scenario_preload.cpp)
+#define PRELOAD_PENDING	0	// Queued or being parsed
+#define PRELOAD_READY	1	// Parsed and validated, image held in memory
+#define PRELOAD_ERROR	2	// Parse or validation errors. Started from the XML as before.
+
+struct preload_status
+{
+	std::string name;
+	int state;
+	int errors;
+	long long usec;			// Time to read and validate
+	std::string message;	// Last error, if any
+};
+
+void scenarioPreloadMain(void);
+int bindPreloadedScenario(const char* name, const char* xmlPath);
+void getPreloadStatus(std::vector<struct preload_status>& list);
+void watchScenarioReload(const char* name);
+int takeScenarioReload(std::shared_ptr<const std::vector<unsigned char>>& image, std::string& message);
+int compileTriggers(void);
+struct scenario_scene* findSceneIn(struct scenario_data* data, int scene_id);
+int findEventId(const char* name);
+int eventIdCount(void);
 struct scenario_scene* showScenes(void);
 
+// Lookahead prefetch of scene media and vocals (scenario_prefetch.cpp)
+struct prefetch_status
+{
+	unsigned long long budget;		// Bytes, from prefetchMB
+	unsigned long long held;		// Bytes mapped now
+	int files;						// Files mapped now
+	unsigned int hits;				// Files a scene started with that were held
+	unsigned int misses;
+	unsigned int loaded;
+	unsigned long long loaded_bytes;
+	unsigned int evicted;			// Dropped to stay within the budget
+	unsigned int failed;			// Missing, empty or over the budget
+};
+
+void scenarioPrefetchMain(void);
+void prefetchAssets(const char* scenarioName, const std::vector<std::string>& used, const std::vector<std::string>& next);
+void prefetchRelease(void);
+void getPrefetchStatus(struct prefetch_status* status);
+
 #endif // _SCENARIO_H
\ No newline at end of file
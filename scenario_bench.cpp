@@ -0,0 +1,1452 @@
+/*
+ * scenario_bench.cpp
+ *
+ * XML parser benchmark and fuzz target
+ *
+ * This file is part of the sim-mgr distribution (https://github.com/OpenVetSim/sim-mgr).
+ *
+ * Copyright (c) 2019-2025 ITown Design
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+ * Usage: WinVetSim --xmlbench [-n passes] [-o report] [-g dir] [-m cycles] [-c] [file ...]
+ *
+ * Times each file through the XML tokenizer alone (XMLRead::getEntry), through the
+ * reader it replaced (legacyGetEntry below) and through the whole scenario parser
+ * (processNode and compileTriggers), reading from memory so that the disk is not
+ * measured, and reports MB/s and heap allocations per parse. With no files, every
+ * html/scenarios main.xml is timed. -g first writes the synthetic corpus,
+ * scenarios of 10 KB to 50 MB and a 10 MB one in which every scene is followed by a
+ * commented-out copy, into dir and adds it to the list. The report (-o,
+ * xmlbench.json by default) has one entry per file:
+ *
+ *		{ "file": "...", "bytes": 1048576, "comment_bytes": 4410, "tokens": 61234, "scenes": 812,
+ *		  "errors": 0, "tokenize_mbs": 910.2, "legacy_mbs": 240.7, "legacy_tokens": 59120,
+ *		  "parse_mbs": 96.4, "tokenize_allocs": 1, "parse_allocs": 9,
+ *		  "arena_blocks": 14, "arena_bytes": 917504, "triggers": 2436,
+ *		  "trigger_nsec": { "name": 402.1, "compiled": 11.5 } }
+ *
+ * Each file is then tokenized and parsed again with each scanning kernel in turn,
+ * selected through xmlScanSelect, and the rates are added as
+ *
+ *		"kernels": { "scalar": { "tokenize_mbs": 512.0, "parse_mbs": 90.1 },
+ *		  "sse2": { ... }, "avx2": { ... } }
+ *
+ * with null for a kernel the CPU lacks. The best kernel is selected again after.
+ *
+ * Allocations are counted with the debug heap, so only in a Debug build; a Release
+ * build reports them as null. Time a Release build. The old reader's time includes
+ * the copy and the comment stripping its open made; it returns white space between
+ * tags differently, so its token count differs.
+ *
+ * The value triggers of every scene are then evaluated against the status, once through
+ * the offsets compileTriggers stores and once by name through getValueFromName with the
+ * test switched on each time, as trigger_check did before the triggers were compiled.
+ * "trigger_nsec" is the time for one pass over a scene's triggers, averaged over the
+ * scenes, as { "name": ..., "compiled": ... }.
+ *
+ * -m parses each file that many times more, freeing the arena after each as a scenario
+ * stop does, and reports the largest arena and the process private bytes after the
+ * first cycle, after the last and at most. The entry gains
+ *
+ *		"memory": { "cycles": 1000, "arena_peak": 917504, "private_first": 5242880,
+ *		  "private_last": 5242880, "private_peak": 5246976 }
+ *
+ * and the run fails if the private bytes grew by more than BENCH_MEMORY_SLACK from the
+ * first cycle to the last.
+ *
+ * -c writes main.cache beside each file that parses without errors, as a start does,
+ * and times loading the scenario from it against the parse. The load is timed as a
+ * start makes it, mapping the cache and hashing the XML to check it is current, and as
+ * the preloader binds an image it holds, without the hash. Both include compileTriggers,
+ * as the parse does. The entry gains
+ *
+ *		"cache": { "bytes": 3145728, "parse_msec": 142.3, "load_msec": 21.6,
+ *		  "bind_msec": 9.8 }
+ *
+ * The Fuzz|x64 configuration builds WinVetSim with the address sanitizer and libFuzzer,
+ * and XML_FUZZ defined, so that LLVMFuzzerTestOneInput below is the program. Each input
+ * goes through the tokenizer and then the scenario parser and checkScenario:
+ *
+ *		WinVetSim.exe -dict=fuzz\xml.dict -close_fd_mask=1 -max_len=65536 work fuzz\corpus
+ *
+ * fuzz\corpus is the seed corpus; new inputs are written to work. -close_fd_mask=1
+ * silences the parser's printing. With VETSIM_FUZZ=http set, the same build fuzzes the
+ * simstatus request parser instead (simstatus_bench.cpp).
+ */
+#include "vetsim.h"
+#include "scenario.h"
+#include "XMLRead.h"
+#include "XMLScan.h"
+#include <string>
+#include <vector>
+#include <chrono>
+#include <io.h>
+#include <fcntl.h>
+#include <psapi.h>
+#ifdef _DEBUG
+#include <crtdbg.h>
+#endif
+
+#pragma comment(lib, "psapi.lib")
+
+extern thread_local struct scenario_data* scenario;
+extern thread_local int current_scene_id;
+extern thread_local int errCount;
+
+#define BENCH_PASSES	10
+#define BENCH_TRIGGER_TESTS	1000000		// At least this many trigger tests each way
+#define BENCH_KERNELS		(XML_SCAN_AVX2 + 1)
+#define BENCH_MEMORY_SLACK	(1024 * 1024)	// Private bytes growth allowed over the -m cycles
+
+struct bench_result
+{
+	std::string path;
+	size_t bytes;
+	size_t commentBytes;	// In <!-- --> comments
+	int tokens;
+	int scenes;
+	int errors;
+	double tokenizeMBs;
+	double legacyMBs;		// The reader before the pull tokenizer
+	int legacyTokens;
+	double parseMBs;
+	double kernelTokenizeMBs[BENCH_KERNELS];	// By XML_SCAN_*, or -1 if the CPU lacks it
+	double kernelParseMBs[BENCH_KERNELS];
+	long tokenizeAllocs;	// Of the last pass, or -1 if not counted
+	long parseAllocs;
+	int arenaBlocks;
+	size_t arenaBytes;
+	int triggers;			// Value triggers in all scenes
+	double triggerNameNsec;	// Per scene pass
+	double triggerCompiledNsec;
+	int cycles;				// -m cycles run, or 0
+	size_t arenaPeak;
+	size_t privateFirst;	// Process private bytes after the first cycle
+	size_t privateLast;
+	size_t privatePeak;
+	size_t cacheBytes;		// -c image size, or 0
+	double parseMsec;		// Per parse
+	double cacheLoadMsec;	// Per load from main.cache
+	double cacheBindMsec;	// Per bind of the image in memory
+};
+
+// Synthetic corpus sizes. The last has each scene commented out again after it.
+static const size_t synthSizes[] = { 10 * 1024, 100 * 1024, 1024 * 1024, 10 * 1024 * 1024, 50 * 1024 * 1024,
+	10 * 1024 * 1024 };
+static const char* synthNames[] = { "synthetic_10k.xml", "synthetic_100k.xml", "synthetic_1m.xml", "synthetic_10m.xml",
+	"synthetic_50m.xml", "synthetic_comments_10m.xml" };
+static const int synthComments[] = { 0, 0, 0, 0, 0, 1 };
+
+static long benchAllocs = -1;
+
+#ifdef _DEBUG
+static int
+benchAllocHook(int type, void* data, size_t size, int block, long request, const unsigned char* file, int line)
+{
+	if (type == _HOOK_ALLOC || type == _HOOK_REALLOC)
+	{
+		benchAllocs++;
+	}
+	return (TRUE);
+}
+#endif
+
+static void
+usage(void)
+{
+	printf("Usage: WinVetSim --xmlbench [-n passes] [-o report] [-g dir] [-m cycles] [-c] [file ...]\n");
+}
+
+// The scenario parser prints as it goes, which would be most of the time measured
+static int
+stdoutOff(void)
+{
+	int saved;
+	int nul;
+
+	fflush(stdout);
+	saved = _dup(_fileno(stdout));
+	nul = _open("NUL", _O_WRONLY);
+	if (nul >= 0)
+	{
+		_dup2(nul, _fileno(stdout));
+		_close(nul);
+	}
+	return (saved);
+}
+
+static void
+stdoutOn(int saved)
+{
+	fflush(stdout);
+	if (saved >= 0)
+	{
+		_dup2(saved, _fileno(stdout));
+		_close(saved);
+	}
+}
+
+static int
+readDocument(const char* path, std::vector<char>& doc)
+{
+	FILE* fp;
+	long size;
+	int sts = -1;
+
+	if (fopen_s(&fp, path, "rb") != 0 || !fp)
+	{
+		return (-1);
+	}
+	if (fseek(fp, 0, SEEK_END) == 0 && (size = ftell(fp)) >= 0 && fseek(fp, 0, SEEK_SET) == 0)
+	{
+		doc.resize((size_t)size);
+		if (fread(doc.data(), 1, doc.size(), fp) == doc.size())
+		{
+			sts = 0;
+		}
+	}
+	fclose(fp);
+	return (sts);
+}
+
+// Free the last scenario and allocate a fresh one, as scenarioStart does
+static int
+benchScenario(void)
+{
+	resetParseState();
+	arena_free(&scenarioArena);
+	scenario = (struct scenario_data*)arena_alloc(&scenarioArena, sizeof(struct scenario_data));
+	return (scenario ? 0 : -1);
+}
+
+/*
+ * benchParse
+ * @data: the text of a main.xml
+ * @size: its length in bytes
+ * @name: what to call it in messages
+ *
+ * Reads the document into a fresh scenario. Returns the parser's status, or -1 with
+ * scenario NULL if the scenario could not be allocated.
+ */
+static int
+benchParse(const char* data, size_t size, const char* name)
+{
+	if (benchScenario() != 0)
+	{
+		return (-1);
+	}
+	return (parseScenarioMemory(data, size, name));
+}
+
+// Free the scenario, as a stop does
+static void
+benchRelease(void)
+{
+	arena_free(&scenarioArena);
+	scenario = NULL;
+}
+
+/*
+ * synthScenario
+ * @out: receives the document
+ * @size: length to reach
+ * @comments: follow each scene with a commented-out copy, as editing leaves them
+ *
+ * A scenario of about size bytes, as the scenario editor writes them: a header and
+ * init, then scenes with init sections, a timeout, triggers, a trigger group and an
+ * event trigger, and the event list. Comments, CDATA and empty elements are mixed in.
+ * The content is the same on every run.
+ */
+static void
+synthScenario(std::string& out, size_t size, int comments)
+{
+	static const char* tests[] = { "GT", "LT", "GTE", "LTE", "EQ" };
+	unsigned int seed = 1;
+	char buf[4096];
+	int scene;
+	int events = 0;
+
+	auto roll = [&seed](int range) {
+		seed = seed * 1103515245 + 12345;
+		return ((int)((seed >> 16) % (unsigned int)range));
+		};
+
+	out.clear();
+	out.reserve(size + sizeof(buf));
+	out += "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+		"<!-- Synthetic scenario for the XML benchmark -->\n"
+		"<scenario>\n"
+		"\t<header>\n"
+		"\t\t<author>VetSim Benchmark</author>\n"
+		"\t\t<date_of_creation>1/1/2025</date_of_creation>\n"
+		"\t\t<description>Synthetic scenario. Each scene leads to the next.</description>\n"
+		"\t\t<scenario>\n"
+		"\t\t\t<name>Synthetic</name>\n"
+		"\t\t</scenario>\n"
+		"\t</header>\n"
+		"\t<profile>\n"
+		"\t\t<avatar>\n"
+		"\t\t\t<type>canine</type>\n"
+		"\t\t</avatar>\n"
+		"\t</profile>\n"
+		"\t<init>\n"
+		"\t\t<cardiac>\n"
+		"\t\t\t<rhythm>sinus</rhythm>\n"
+		"\t\t\t<rate>80</rate>\n"
+		"\t\t\t<nibp_rate>80</nibp_rate>\n"
+		"\t\t\t<bps_sys>120</bps_sys>\n"
+		"\t\t\t<bps_dia>80</bps_dia>\n"
+		"\t\t</cardiac>\n"
+		"\t\t<respiration>\n"
+		"\t\t\t<rate>20</rate>\n"
+		"\t\t\t<spo2>98</spo2>\n"
+		"\t\t\t<etco2>35</etco2>\n"
+		"\t\t</respiration>\n"
+		"\t\t<general>\n"
+		"\t\t\t<temperature>1015</temperature>\n"
+		"\t\t\t<temperature_units>F</temperature_units>\n"
+		"\t\t</general>\n"
+		"\t\t<initial_scene>1</initial_scene>\n"
+		"\t</init>\n";
+
+	// Leave room for the last scene and the event list, which is about 80 bytes an event
+	for (scene = 1; out.size() + 80 * (size_t)(events + 2) + 512 < size; scene++)
+	{
+		if (scene % 10 == 0)
+		{
+			snprintf(buf, sizeof(buf), "\t<!-- Scenes %d to %d: <scene> elements in here are not read -->\n",
+				scene, scene + 9);
+			out += buf;
+		}
+		snprintf(buf, sizeof(buf),
+			"\t<scene>\n"
+			"\t\t<id>%d</id>\n"
+			"\t\t<title>%s</title>\n"
+			"\t\t<init>\n"
+			"\t\t\t<cardiac>\n"
+			"\t\t\t\t<rate>%d</rate>\n"
+			"\t\t\t\t<bps_sys>%d</bps_sys>\n"
+			"\t\t\t\t<bps_dia>%d</bps_dia>\n"
+			"\t\t\t\t<transfer_time>%d</transfer_time>\n"
+			"\t\t\t</cardiac>\n"
+			"\t\t\t<respiration>\n"
+			"\t\t\t\t<rate>%d</rate>\n"
+			"\t\t\t\t<spo2>%d</spo2>\n"
+			"\t\t\t</respiration>\n"
+			"\t\t\t<vocals/>\n"
+			"\t\t</init>\n"
+			"\t\t<timeout>\n"
+			"\t\t\t<timeout_value>%d</timeout_value>\n"
+			"\t\t\t<scene_id>1</scene_id>\n"
+			"\t\t</timeout>\n"
+			"\t\t<triggers>\n"
+			"\t\t\t<trigger>\n"
+			"\t\t\t\t<test>%s</test>\n"
+			"\t\t\t\t<cardiac>\n"
+			"\t\t\t\t\t<rate>%d</rate>\n"
+			"\t\t\t\t</cardiac>\n"
+			"\t\t\t\t<scene_id>%d</scene_id>\n"
+			"\t\t\t</trigger>\n"
+			"\t\t\t<trigger_group>\n"
+			"\t\t\t\t<scene_id>%d</scene_id>\n"
+			"\t\t\t\t<group_id>%d</group_id>\n"
+			"\t\t\t\t<triggers_required>2</triggers_required>\n"
+			"\t\t\t\t<trigger>\n"
+			"\t\t\t\t\t<test>INSIDE</test>\n"
+			"\t\t\t\t\t<respiration>\n"
+			"\t\t\t\t\t\t<spo2>%d-%d</spo2>\n"
+			"\t\t\t\t\t</respiration>\n"
+			"\t\t\t\t</trigger>\n"
+			"\t\t\t\t<trigger>\n"
+			"\t\t\t\t\t<event_id>event_%d</event_id>\n"
+			"\t\t\t\t</trigger>\n"
+			"\t\t\t</trigger_group>\n"
+			"\t\t\t<trigger>\n"
+			"\t\t\t\t<event_id>event_%d</event_id>\n"
+			"\t\t\t\t<scene_id>%d</scene_id>\n"
+			"\t\t\t</trigger>\n"
+			"\t\t</triggers>\n"
+			"\t</scene>\n",
+			scene,
+			(scene % 7 == 0) ? "<![CDATA[Fluids & <pressors>]]>" : "Assessment",
+			40 + roll(160), 60 + roll(120), 30 + roll(80), 5 + roll(60),
+			6 + roll(40), 80 + roll(20),
+			60 + roll(600),
+			tests[roll(5)], 40 + roll(160), scene + 1,
+			scene + 1, scene,
+			85 + roll(5), 95 + roll(5), events,
+			events + 1, scene + 1);
+		out += buf;
+		if (comments)
+		{
+			out += "\t<!-- Earlier version\n";
+			out += buf;
+			out += "\t-->\n";
+		}
+		events += 2;
+	}
+	snprintf(buf, sizeof(buf),
+		"\t<scene>\n"
+		"\t\t<id>%d</id>\n"
+		"\t\t<title>End</title>\n"
+		"\t</scene>\n"
+		"\t<events>\n",
+		scene);
+	out += buf;
+	for (int e = 0; e < events; e++)
+	{
+		if (e % 20 == 0)
+		{
+			snprintf(buf, sizeof(buf), "%s\t\t<category>\n\t\t\t<name>group_%d</name>\n\t\t\t<title>Group %d</title>\n",
+				e ? "\t\t</category>\n" : "", e / 20, e / 20);
+			out += buf;
+		}
+		snprintf(buf, sizeof(buf), "\t\t\t<event>\n\t\t\t\t<title>Event %d</title>\n\t\t\t\t<id>event_%d</id>\n\t\t\t</event>\n",
+			e, e);
+		out += buf;
+	}
+	out += events ? "\t\t</category>\n\t</events>\n</scenario>\n" : "\t</events>\n</scenario>\n";
+}
+
+/*
+ * writeCorpus
+ * @dir: directory to write into
+ * @list: receives the files written
+ */
+static int
+writeCorpus(const char* dir, std::vector<struct bench_result>& list)
+{
+	struct bench_result result = {};
+	std::string doc;
+	char path[1200];
+	FILE* fp;
+
+	if (!CreateDirectoryA(dir, NULL) && GetLastError() != ERROR_ALREADY_EXISTS)
+	{
+		printf("Cannot create %s\n", dir);
+		return (-1);
+	}
+	for (size_t i = 0; i < sizeof(synthSizes) / sizeof(synthSizes[0]); i++)
+	{
+		synthScenario(doc, synthSizes[i], synthComments[i]);
+		sprintf_s(path, sizeof(path), "%s\\%s", dir, synthNames[i]);
+		if (fopen_s(&fp, path, "wb") != 0 || !fp)
+		{
+			printf("Cannot write %s\n", path);
+			return (-1);
+		}
+		fwrite(doc.data(), 1, doc.size(), fp);
+		fclose(fp);
+		printf("Wrote %s, %zu bytes\n", path, doc.size());
+		result.path = path;
+		list.push_back(result);
+	}
+	return (0);
+}
+
+/*
+ * The reader before the pull tokenizer, kept to time against it. open read the whole
+ * file into a zeroed copy and blanked the prolog and every comment before the first
+ * token. getEntry copied each name and text into fixed arrays and looked for "</" at
+ * every character. The end tag cases are shared here, and value[] is bounded; the old
+ * reader overran it.
+ */
+#define LEGACY_MAX_NAME		512
+#define LEGACY_MAX_VALUE	16536
+
+enum class legacyState
+{
+	initial = 0,
+	foundElement = 1,
+	returnedText = 2,
+	closedElement = 3
+};
+
+struct legacy_reader
+{
+	std::vector<char> xml;
+	size_t idx;
+	enum legacyState state;
+	int type;
+	int depth;
+	char name[LEGACY_MAX_NAME];
+	char value[LEGACY_MAX_VALUE];
+};
+
+static void
+legacyName(struct legacy_reader& r, const char* from, int len)
+{
+	if (len < 0 || len >= LEGACY_MAX_NAME)
+	{
+		len = 0;
+	}
+	memcpy(r.name, from, (size_t)len);
+	r.name[len] = 0;
+}
+
+static void
+legacyOpen(struct legacy_reader& r, const std::vector<char>& doc)
+{
+	char* cptr;
+	char* cptr1;
+	char* cptr2;
+
+	r.xml.assign(doc.size() + 32, 0);
+	memcpy(r.xml.data(), doc.data(), doc.size());
+	r.idx = 0;
+	r.state = legacyState::initial;
+	r.type = XML_TYPE_NONE;
+	r.depth = -1;
+	r.name[0] = 0;
+	r.value[0] = 0;
+
+	// Strip out the prolog and all comments, replacing them with spaces
+	cptr = r.xml.data();
+	cptr1 = strstr(cptr, "<?xml");
+	if (!cptr1)
+	{
+		cptr1 = strstr(cptr, "<?XML");
+	}
+	if (cptr1 && (cptr2 = strstr(cptr1, "?>")) != NULL)
+	{
+		memset(cptr1, ' ', (size_t)(cptr2 + 2 - cptr1));
+	}
+	cptr1 = cptr;
+	while ((cptr1 = strstr(cptr1, "<!--")) != NULL && (cptr2 = strstr(cptr1, "-->")) != NULL)
+	{
+		memset(cptr1, ' ', (size_t)(cptr2 + 3 - cptr1));
+	}
+}
+
+// Start tag name after the '<' at cptr
+static void
+legacyElement(struct legacy_reader& r, char* cptr)
+{
+	int i;
+
+	for (i = 0; cptr[i]; i++)
+	{
+		if (cptr[i] == '>' || isspace((unsigned char)cptr[i]))
+		{
+			legacyName(r, cptr, i);
+			r.value[0] = 0;
+			r.type = XML_TYPE_ELEMENT;
+			r.depth++;
+			r.idx = (size_t)(&cptr[i] - r.xml.data() + 1);
+			r.state = legacyState::foundElement;
+			break;
+		}
+	}
+}
+
+// End tag name after the "</" at cptr
+static void
+legacyEndElement(struct legacy_reader& r, char* cptr)
+{
+	int i;
+
+	for (i = 0; cptr[i]; i++)
+	{
+		if (cptr[i] == '>' || isspace((unsigned char)cptr[i]))
+		{
+			break;
+		}
+	}
+	legacyName(r, cptr, i);
+	r.value[0] = 0;
+	r.type = XML_TYPE_END_ELEMENT;
+	if (r.depth > 0)
+	{
+		r.depth--;
+	}
+	r.idx = (size_t)(&cptr[i] - r.xml.data() + 1);
+	r.state = legacyState::closedElement;
+}
+
+static int
+legacyGetEntry(struct legacy_reader& r)
+{
+	char* cptr = r.xml.data() + r.idx;
+	int i;
+
+	r.type = XML_TYPE_FILE_END;
+	if (r.state == legacyState::initial || r.state == legacyState::closedElement)
+	{
+		for (i = 0; cptr[i]; i++)
+		{
+			if (strncmp(&cptr[i], "</", 2) == 0)
+			{
+				legacyEndElement(r, &cptr[i + 2]);
+				break;
+			}
+			else if (cptr[i] == '<')
+			{
+				legacyElement(r, &cptr[i + 1]);
+				break;
+			}
+		}
+	}
+	else
+	{
+		for (i = 0; cptr[i]; i++)
+		{
+			if (!isspace((unsigned char)cptr[i]))
+			{
+				cptr = &cptr[i];
+				break;
+			}
+		}
+		if (strncmp(cptr, "</", 2) == 0)
+		{
+			legacyEndElement(r, &cptr[2]);
+		}
+		else if (cptr[0] == '<')
+		{
+			legacyElement(r, &cptr[1]);
+		}
+		else if (r.state == legacyState::foundElement)
+		{
+			// Content up to the next tag
+			for (i = 0; cptr[i]; i++)
+			{
+				if (cptr[i] == '<')
+				{
+					r.value[i < LEGACY_MAX_VALUE ? i : LEGACY_MAX_VALUE - 1] = 0;
+					r.state = legacyState::returnedText;
+					r.type = XML_TYPE_TEXT;
+					r.idx = (size_t)(&cptr[i] - r.xml.data());
+					break;
+				}
+				else if (i < LEGACY_MAX_VALUE - 1)
+				{
+					r.value[i] = cptr[i];
+				}
+			}
+		}
+		else
+		{
+			r.name[0] = 0;
+			r.value[0] = 0;
+			r.type = XML_TYPE_NONE;
+			r.idx = (size_t)(cptr - r.xml.data() + 1);
+			r.state = legacyState::initial;
+		}
+	}
+	return (r.type == XML_TYPE_FILE_END ? 1 : 0);
+}
+
+// A scene's value triggers, single and grouped
+static void
+sceneTriggers(struct scenario_scene* scene, std::vector<struct scenario_trigger*>& list)
+{
+	struct snode* g_snode;
+	struct snode* t_snode;
+	struct scenario_trigger* trig;
+
+	list.clear();
+	for (t_snode = scene->trigger_list.next; t_snode; t_snode = get_next_llist(t_snode))
+	{
+		trig = (struct scenario_trigger*)t_snode;
+		if (trig->test != TRIGGER_TEST_EVENT)
+		{
+			list.push_back(trig);
+		}
+	}
+	for (g_snode = scene->group_list.next; g_snode; g_snode = get_next_llist(g_snode))
+	{
+		for (t_snode = ((struct trigger_group*)g_snode)->group_trigger_list.next; t_snode; t_snode = get_next_llist(t_snode))
+		{
+			trig = (struct scenario_trigger*)t_snode;
+			if (trig->test != TRIGGER_TEST_EVENT)
+			{
+				list.push_back(trig);
+			}
+		}
+	}
+}
+
+// The test as trigger_check made it before compileTriggers, without its printing
+static int
+nameTest(struct scenario_trigger* trig)
+{
+	int val = getValueFromName(trig->param_class, trig->param_element);
+
+	switch (trig->test)
+	{
+	case TRIGGER_TEST_EQ:
+		return (val == trig->value);
+	case TRIGGER_TEST_LTE:
+		return (val <= trig->value);
+	case TRIGGER_TEST_LT:
+		return (val < trig->value);
+	case TRIGGER_TEST_GTE:
+		return (val >= trig->value);
+	case TRIGGER_TEST_GT:
+		return (val > trig->value);
+	case TRIGGER_TEST_INSIDE:
+		return ((val > trig->value) && (val < trig->value2));
+	case TRIGGER_TEST_OUTSIDE:
+		return ((val < trig->value) || (val > trig->value2));
+	}
+	return (0);
+}
+
+// The test as trigger_check makes it now
+static int
+compiledTest(struct scenario_trigger* trig)
+{
+	int val = getStatusValue(trig->offset, trig->width);
+
+	return (((val >= trig->low) && (val <= trig->high)) != (trig->outside != 0));
+}
+
+/*
+ * benchTriggers
+ * @result: the file to time; receives the results
+ * @doc: its contents
+ * @passes: times to evaluate each scene's triggers each way, raised for small files
+ */
+static int
+benchTriggers(struct bench_result& result, std::vector<char>& doc, int passes)
+{
+	std::vector<std::vector<struct scenario_trigger*>> scenes;
+	std::vector<struct scenario_trigger*> list;
+	struct snode* snode;
+	volatile int sink;
+	int met = 0;
+	int saved;
+	int pass;
+	std::chrono::steady_clock::time_point start;
+
+	saved = stdoutOff();
+	(void)benchParse(doc.data(), doc.size(), result.path.c_str());
+	stdoutOn(saved);
+	if (!scenario)
+	{
+		return (-1);
+	}
+	result.triggers = 0;
+	for (snode = scenario->scene_list.next; snode; snode = get_next_llist(snode))
+	{
+		sceneTriggers((struct scenario_scene*)snode, list);
+		result.triggers += (int)list.size();
+		scenes.push_back(list);
+	}
+
+	if (result.triggers > 0 && (long long)passes * result.triggers < BENCH_TRIGGER_TESTS)
+	{
+		passes = BENCH_TRIGGER_TESTS / result.triggers + 1;
+	}
+	if (!scenes.empty())
+	{
+		start = std::chrono::steady_clock::now();
+		for (pass = 0; pass < passes; pass++)
+		{
+			for (auto& scene : scenes)
+			{
+				for (auto trig : scene)
+				{
+					met += nameTest(trig);
+				}
+			}
+		}
+		result.triggerNameNsec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() *
+			1e9 / passes / scenes.size();
+
+		start = std::chrono::steady_clock::now();
+		for (pass = 0; pass < passes; pass++)
+		{
+			for (auto& scene : scenes)
+			{
+				for (auto trig : scene)
+				{
+					met += compiledTest(trig);
+				}
+			}
+		}
+		result.triggerCompiledNsec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() *
+			1e9 / passes / scenes.size();
+	}
+	sink = met;
+	benchRelease();
+	return (0);
+}
+
+static size_t
+privateBytes(void)
+{
+	PROCESS_MEMORY_COUNTERS_EX pmc;
+
+	if (!GetProcessMemoryInfo(GetCurrentProcess(), (PROCESS_MEMORY_COUNTERS*)&pmc, sizeof(pmc)))
+	{
+		return (0);
+	}
+	return (pmc.PrivateUsage);
+}
+
+/*
+ * benchMemory
+ * @result: the file to check; receives the high-water marks
+ * @cycles: times to parse and free it
+ *
+ * Each cycle loads the scenario as scenarioStart does and frees it as a stop does.
+ * Returns 0, or -1 if the file could not be read or the process grew by more than
+ * BENCH_MEMORY_SLACK from the first cycle to the last.
+ */
+static int
+benchMemory(struct bench_result& result, int cycles)
+{
+	std::vector<char> doc;
+	size_t priv;
+	int saved;
+	int cycle;
+
+	if (readDocument(result.path.c_str(), doc) != 0)
+	{
+		printf("Cannot read %s\n", result.path.c_str());
+		return (-1);
+	}
+	result.arenaPeak = 0;
+	result.privatePeak = 0;
+	saved = stdoutOff();
+	for (cycle = 0; cycle < cycles; cycle++)
+	{
+		(void)benchParse(doc.data(), doc.size(), result.path.c_str());
+		if (!scenario)
+		{
+			break;
+		}
+		if (scenarioArena.reserved > result.arenaPeak)
+		{
+			result.arenaPeak = scenarioArena.reserved;
+		}
+		priv = privateBytes();
+		if (priv > result.privatePeak)
+		{
+			result.privatePeak = priv;
+		}
+		benchRelease();
+
+		priv = privateBytes();
+		if (cycle == 0)
+		{
+			result.privateFirst = priv;
+		}
+		result.privateLast = priv;
+	}
+	stdoutOn(saved);
+	result.cycles = cycle;
+	if (cycle < cycles)
+	{
+		printf("Failed to allocate the scenario\n");
+		return (-1);
+	}
+	if (result.privateLast > result.privateFirst + BENCH_MEMORY_SLACK)
+	{
+		printf("%s: private bytes grew from %zu to %zu over %d cycles\n", result.path.c_str(),
+			result.privateFirst, result.privateLast, cycles);
+		return (-1);
+	}
+	return (0);
+}
+
+/*
+ * benchCache
+ * @result: the file to time; receives the results
+ * @passes: times to load it each way
+ *
+ * Returns 0, 1 if the file does not parse cleanly and so gets no cache, or -1.
+ */
+static int
+benchCache(struct bench_result& result, int passes)
+{
+	std::vector<char> doc;
+	std::vector<unsigned char> image;
+	const char* path = result.path.c_str();
+	int saved;
+	int pass;
+	int sts = 0;
+	std::chrono::steady_clock::time_point start;
+
+	result.cacheBytes = 0;
+	if (readDocument(path, doc) != 0)
+	{
+		printf("Cannot read %s\n", path);
+		return (-1);
+	}
+	saved = stdoutOff();
+	if (benchParse(doc.data(), doc.size(), path) != 0 || errCount != 0)
+	{
+		sts = (scenario ? 1 : -1);
+	}
+	else if (buildScenarioImage(path, image) != 0 || writeScenarioImage(path, image) != 0)
+	{
+		sts = -1;
+	}
+
+	start = std::chrono::steady_clock::now();
+	for (pass = 0; sts == 0 && pass < passes; pass++)
+	{
+		if (benchScenario() != 0 || loadScenarioCache(path) != 0)
+		{
+			sts = -1;
+			break;
+		}
+		(void)compileTriggers();
+	}
+	result.cacheLoadMsec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() *
+		1e3 / passes;
+
+	start = std::chrono::steady_clock::now();
+	for (pass = 0; sts == 0 && pass < passes; pass++)
+	{
+		if (benchScenario() != 0 || bindScenarioImage(image, path) != 0)
+		{
+			sts = -1;
+			break;
+		}
+		(void)compileTriggers();
+	}
+	result.cacheBindMsec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() *
+		1e3 / passes;
+	benchRelease();
+	stdoutOn(saved);
+
+	if (sts < 0)
+	{
+		printf("Cannot write or load the cache of %s\n", path);
+	}
+	else if (sts == 0)
+	{
+		result.cacheBytes = image.size();
+	}
+	return (sts);
+}
+
+static const char* kernelNames[BENCH_KERNELS] = { "scalar", "sse2", "avx2" };
+
+/*
+ * benchKernels
+ * @result: the file to time; receives the rates
+ * @doc: its contents
+ * @passes: times to read it each way with each kernel
+ */
+static int
+benchKernels(struct bench_result& result, std::vector<char>& doc, int passes)
+{
+	XMLRead reader;
+	int level;
+	int saved;
+	int pass;
+	int failed = 0;
+	std::chrono::steady_clock::time_point start;
+
+	for (level = XML_SCAN_SCALAR; level < BENCH_KERNELS; level++)
+	{
+		result.kernelTokenizeMBs[level] = -1;
+		result.kernelParseMBs[level] = -1;
+		if (xmlScanSelect(level) != level)
+		{
+			continue;
+		}
+
+		start = std::chrono::steady_clock::now();
+		for (pass = 0; pass < passes && !failed; pass++)
+		{
+			failed = reader.openMemory(doc.data(), doc.size());
+			while (!failed && reader.getEntry() == 0)
+			{
+			}
+			reader.close();
+		}
+		result.kernelTokenizeMBs[level] = (double)doc.size() * passes / 1e6 /
+			std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		saved = stdoutOff();
+		start = std::chrono::steady_clock::now();
+		for (pass = 0; pass < passes && !failed; pass++)
+		{
+			(void)benchParse(doc.data(), doc.size(), result.path.c_str());
+			if (!scenario)
+			{
+				failed = 1;
+			}
+		}
+		result.kernelParseMBs[level] = (double)doc.size() * passes / 1e6 /
+			std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		benchRelease();
+		stdoutOn(saved);
+	}
+	(void)xmlScanSelect(XML_SCAN_AVX2);
+	return (failed ? -1 : 0);
+}
+
+static size_t
+commentBytes(const std::vector<char>& doc)
+{
+	std::string_view text(doc.data(), doc.size());
+	size_t bytes = 0;
+	size_t open;
+	size_t close;
+
+	for (open = text.find("<!--"); open != std::string_view::npos; open = text.find("<!--", close))
+	{
+		close = text.find("-->", open + 4);
+		if (close == std::string_view::npos)
+		{
+			break;
+		}
+		close += 3;
+		bytes += close - open;
+	}
+	return (bytes);
+}
+
+/*
+ * benchOne
+ * @result: the file to time; receives the results
+ * @passes: times to read it each way
+ */
+static int
+benchOne(struct bench_result& result, int passes)
+{
+	std::vector<char> doc;
+	XMLRead reader;
+	static struct legacy_reader legacy;
+	struct snode* snode;
+	long allocs = -1;
+	int saved;
+	int pass;
+	double sec;
+	std::chrono::steady_clock::time_point start;
+
+	if (readDocument(result.path.c_str(), doc) != 0)
+	{
+		printf("Cannot read %s\n", result.path.c_str());
+		return (-1);
+	}
+	result.bytes = doc.size();
+	result.commentBytes = commentBytes(doc);
+
+	start = std::chrono::steady_clock::now();
+	for (pass = 0; pass < passes; pass++)
+	{
+		allocs = benchAllocs;
+		if (reader.openMemory(doc.data(), doc.size()) != 0)
+		{
+			return (-1);
+		}
+		result.tokens = 0;
+		while (reader.getEntry() == 0)
+		{
+			result.tokens++;
+		}
+		reader.close();
+		allocs = benchAllocs - allocs;
+	}
+	sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	result.tokenizeMBs = (double)result.bytes * passes / 1e6 / sec;
+	result.tokenizeAllocs = (benchAllocs < 0 ? -1 : allocs);
+
+	start = std::chrono::steady_clock::now();
+	for (pass = 0; pass < passes; pass++)
+	{
+		legacyOpen(legacy, doc);
+		result.legacyTokens = 0;
+		while (legacyGetEntry(legacy) == 0)
+		{
+			result.legacyTokens++;
+		}
+	}
+	sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	result.legacyMBs = (double)result.bytes * passes / 1e6 / sec;
+	legacy.xml.clear();
+	legacy.xml.shrink_to_fit();
+
+	saved = stdoutOff();
+	start = std::chrono::steady_clock::now();
+	for (pass = 0; pass < passes; pass++)
+	{
+		allocs = benchAllocs;
+		(void)benchParse(doc.data(), doc.size(), result.path.c_str());
+		if (!scenario)
+		{
+			break;
+		}
+		allocs = benchAllocs - allocs;
+
+		result.errors = errCount;
+		result.arenaBlocks = scenarioArena.blocks;
+		result.arenaBytes = scenarioArena.reserved;
+		result.scenes = 0;
+		for (snode = scenario->scene_list.next; snode; snode = get_next_llist(snode))
+		{
+			result.scenes++;
+		}
+		benchRelease();
+	}
+	sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	stdoutOn(saved);
+	if (pass < passes)
+	{
+		printf("Failed to allocate the scenario\n");
+		return (-1);
+	}
+	result.parseMBs = (double)result.bytes * passes / 1e6 / sec;
+	result.parseMsec = sec * 1e3 / passes;
+	result.parseAllocs = (benchAllocs < 0 ? -1 : allocs);
+	if (benchKernels(result, doc, passes) != 0)
+	{
+		printf("Failed to read %s with each kernel\n", result.path.c_str());
+		return (-1);
+	}
+	return (benchTriggers(result, doc, passes));
+}
+
+static void
+writeCount(FILE* fp, const char* name, long count)
+{
+	if (count < 0)
+	{
+		fprintf(fp, "\"%s\": null", name);
+	}
+	else
+	{
+		fprintf(fp, "\"%s\": %ld", name, count);
+	}
+}
+
+static int
+writeReport(const char* path, std::vector<struct bench_result>& list)
+{
+	FILE* fp;
+	size_t i;
+	std::string file;
+
+	if (fopen_s(&fp, path, "w") != 0 || !fp)
+	{
+		printf("Cannot write %s\n", path);
+		return (-1);
+	}
+	fprintf(fp, "[\n");
+	for (i = 0; i < list.size(); i++)
+	{
+		struct bench_result& r = list[i];
+
+		// Paths are Windows paths
+		file.clear();
+		for (char c : r.path)
+		{
+			if (c == '\\' || c == '"')
+			{
+				file += '\\';
+			}
+			file += c;
+		}
+		fprintf(fp, "\t{ \"file\": \"%s\", \"bytes\": %zu, \"comment_bytes\": %zu, \"tokens\": %d, \"scenes\": %d,\n",
+			file.c_str(), r.bytes, r.commentBytes, r.tokens, r.scenes);
+		fprintf(fp, "\t  \"errors\": %d, \"tokenize_mbs\": %.1f, \"legacy_mbs\": %.1f, \"legacy_tokens\": %d,\n"
+			"\t  \"parse_mbs\": %.1f, ",
+			r.errors, r.tokenizeMBs, r.legacyMBs, r.legacyTokens, r.parseMBs);
+		writeCount(fp, "tokenize_allocs", r.tokenizeAllocs);
+		fprintf(fp, ", ");
+		writeCount(fp, "parse_allocs", r.parseAllocs);
+		fprintf(fp, ",\n\t  \"arena_blocks\": %d, \"arena_bytes\": %zu, \"triggers\": %d,\n",
+			r.arenaBlocks, r.arenaBytes, r.triggers);
+		fprintf(fp, "\t  \"trigger_nsec\": { \"name\": %.1f, \"compiled\": %.1f }",
+			r.triggerNameNsec, r.triggerCompiledNsec);
+		fprintf(fp, ",\n\t  \"kernels\": { ");
+		for (int k = 0; k < BENCH_KERNELS; k++)
+		{
+			if (r.kernelTokenizeMBs[k] < 0)
+			{
+				fprintf(fp, "\"%s\": null", kernelNames[k]);
+			}
+			else
+			{
+				fprintf(fp, "\"%s\": { \"tokenize_mbs\": %.1f, \"parse_mbs\": %.1f }",
+					kernelNames[k], r.kernelTokenizeMBs[k], r.kernelParseMBs[k]);
+			}
+			fprintf(fp, "%s", k + 1 < BENCH_KERNELS ? ",\n\t    " : " }");
+		}
+		if (r.cycles > 0)
+		{
+			fprintf(fp, ",\n\t  \"memory\": { \"cycles\": %d, \"arena_peak\": %zu, \"private_first\": %zu,\n"
+				"\t    \"private_last\": %zu, \"private_peak\": %zu }",
+				r.cycles, r.arenaPeak, r.privateFirst, r.privateLast, r.privatePeak);
+		}
+		if (r.cacheBytes > 0)
+		{
+			fprintf(fp, ",\n\t  \"cache\": { \"bytes\": %zu, \"parse_msec\": %.1f, \"load_msec\": %.1f,\n"
+				"\t    \"bind_msec\": %.1f }",
+				r.cacheBytes, r.parseMsec, r.cacheLoadMsec, r.cacheBindMsec);
+		}
+		fprintf(fp, " }%s\n", i + 1 < list.size() ? "," : "");
+	}
+	fprintf(fp, "]\n");
+	fclose(fp);
+	return (0);
+}
+
+/*
+ * benchMain
+ *
+ * Entry for --xmlbench. Returns 0, or 1 if a file could not be read or the report
+ * could not be written.
+ */
+int
+benchMain(int argc, char* argv[])
+{
+	std::vector<struct bench_result> list;
+	struct bench_result result = {};
+	const char* outFile = "xmlbench.json";
+	const char* corpusDir = NULL;
+	int passes = BENCH_PASSES;
+	int cycles = 0;
+	int cache = 0;
+	int sts = 0;
+	int i;
+	char dir[1100];
+	char xmlPath[1400];
+	WIN32_FIND_DATAA fd;
+	HANDLE find;
+
+	for (i = 0; i < argc; i++)
+	{
+		if (strcmp(argv[i], "-n") == 0 && i + 1 < argc)
+		{
+			passes = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc)
+		{
+			outFile = argv[++i];
+		}
+		else if (strcmp(argv[i], "-g") == 0 && i + 1 < argc)
+		{
+			corpusDir = argv[++i];
+		}
+		else if (strcmp(argv[i], "-m") == 0 && i + 1 < argc)
+		{
+			cycles = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "-c") == 0)
+		{
+			cache = 1;
+		}
+		else if (argv[i][0] == '-')
+		{
+			usage();
+			return (1);
+		}
+		else
+		{
+			result.path = argv[i];
+			list.push_back(result);
+		}
+	}
+	if (passes < 1 || cycles < 0)
+	{
+		usage();
+		return (1);
+	}
+	if (corpusDir && writeCorpus(corpusDir, list) != 0)
+	{
+		return (1);
+	}
+	if (list.empty())
+	{
+		sprintf_s(dir, sizeof(dir), "%s\\scenarios", localConfig.html_path);
+		sprintf_s(xmlPath, sizeof(xmlPath), "%s\\*", dir);
+		find = FindFirstFileA(xmlPath, &fd);
+		if (find != INVALID_HANDLE_VALUE)
+		{
+			do
+			{
+				if ((fd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) && fd.cFileName[0] != '.')
+				{
+					sprintf_s(xmlPath, sizeof(xmlPath), "%s\\%s\\main.xml", dir, fd.cFileName);
+					if (GetFileAttributesA(xmlPath) != INVALID_FILE_ATTRIBUTES)
+					{
+						result.path = xmlPath;
+						list.push_back(result);
+					}
+				}
+			} while (FindNextFileA(find, &fd));
+			FindClose(find);
+		}
+		if (list.empty())
+		{
+			printf("No scenarios found in %s\n", dir);
+			return (1);
+		}
+	}
+
+	// Triggers are evaluated against the status
+	initSHM();
+
+#ifdef _DEBUG
+	benchAllocs = 0;
+	_CrtSetAllocHook(benchAllocHook);
+#endif
+	printf("%-40s %10s %8s %6s %12s %8s %10s %8s %8s %8s %14s\n",
+		"File", "Bytes", "Tokens", "Errors", "Tokenize MB/s", "Old MB/s", "Parse MB/s", "Allocs", "Blocks",
+		"Triggers", "Name/Compiled");
+	for (auto& r : list)
+	{
+		if (benchOne(r, passes) != 0)
+		{
+			sts = 1;
+			continue;
+		}
+		printf("%-40.40s %10zu %8d %6d %12.1f %8.1f %10.1f %8ld %8d %8d %6.0f/%-7.0f\n",
+			r.path.length() > 40 ? r.path.c_str() + r.path.length() - 40 : r.path.c_str(),
+			r.bytes, r.tokens, r.errors, r.tokenizeMBs, r.legacyMBs, r.parseMBs, r.parseAllocs, r.arenaBlocks,
+			r.triggers, r.triggerNameNsec, r.triggerCompiledNsec);
+	}
+#ifdef _DEBUG
+	_CrtSetAllocHook(NULL);
+#endif
+	printf("\n%-40s %22s %22s %22s\n", "File", "Scalar tokenize/parse", "SSE2 tokenize/parse",
+		"AVX2 tokenize/parse");
+	for (auto& r : list)
+	{
+		if (r.bytes == 0)
+		{
+			continue;
+		}
+		printf("%-40.40s", r.path.length() > 40 ? r.path.c_str() + r.path.length() - 40 : r.path.c_str());
+		for (int k = 0; k < BENCH_KERNELS; k++)
+		{
+			if (r.kernelTokenizeMBs[k] < 0)
+			{
+				printf(" %22s", "-");
+			}
+			else
+			{
+				printf(" %13.1f/%-8.1f", r.kernelTokenizeMBs[k], r.kernelParseMBs[k]);
+			}
+		}
+		printf("\n");
+	}
+	if (cycles > 0)
+	{
+		printf("\n%-40s %8s %12s %14s %14s %14s\n",
+			"File", "Cycles", "Arena peak", "Private first", "Private last", "Private peak");
+		for (auto& r : list)
+		{
+			if (benchMemory(r, cycles) != 0)
+			{
+				sts = 1;
+				continue;
+			}
+			printf("%-40.40s %8d %12zu %14zu %14zu %14zu\n",
+				r.path.length() > 40 ? r.path.c_str() + r.path.length() - 40 : r.path.c_str(),
+				r.cycles, r.arenaPeak, r.privateFirst, r.privateLast, r.privatePeak);
+		}
+	}
+	if (cache)
+	{
+		printf("\n%-40s %12s %10s %14s %10s\n", "File", "Cache bytes", "Parse ms", "Cache load ms", "Bind ms");
+		for (auto& r : list)
+		{
+			switch (benchCache(r, passes))
+			{
+			case 0:
+				printf("%-40.40s %12zu %10.2f %14.2f %10.2f\n",
+					r.path.length() > 40 ? r.path.c_str() + r.path.length() - 40 : r.path.c_str(),
+					r.cacheBytes, r.parseMsec, r.cacheLoadMsec, r.cacheBindMsec);
+				break;
+			case 1:
+				printf("%-40.40s %12s\n",
+					r.path.length() > 40 ? r.path.c_str() + r.path.length() - 40 : r.path.c_str(),
+					"errors");
+				break;
+			default:
+				sts = 1;
+				break;
+			}
+		}
+	}
+	if (writeReport(outFile, list) != 0)
+	{
+		sts = 1;
+	}
+	return (sts);
+}
+
+#ifdef XML_FUZZ
+int httpFuzzOne(const uint8_t* data, size_t size);
+
+static int fuzzHttp = 0;
+
+/*
+ * LLVMFuzzerInitialize
+ *
+ * Pick the target from VETSIM_FUZZ: "http" for the request parser, otherwise XML.
+ */
+extern "C" int
+LLVMFuzzerInitialize(int* argc, char*** argv)
+{
+	char target[16];
+	DWORD len;
+
+	len = GetEnvironmentVariableA("VETSIM_FUZZ", target, sizeof(target));
+	fuzzHttp = (len > 0 && len < sizeof(target) && _stricmp(target, "http") == 0);
+	return (0);
+}
+
+/*
+ * LLVMFuzzerTestOneInput
+ *
+ * One input through the tokenizer, with each start tag's attributes looked up, then
+ * through the scenario parser and the scene graph checks. The parser state is the
+ * same thread_local state as a scenario read, reset for each input.
+ */
+extern "C" int
+LLVMFuzzerTestOneInput(const uint8_t* data, size_t size)
+{
+	static XMLRead reader;
+	std::vector<struct scenario_finding> findings;
+	std::string_view val;
+
+	if (fuzzHttp)
+	{
+		return (httpFuzzOne(data, size));
+	}
+	if (reader.openMemory((const char*)data, size) == 0)
+	{
+		while (reader.getEntry() == 0)
+		{
+			if (reader.type == XML_TYPE_ELEMENT)
+			{
+				(void)reader.getAttribute("id", val);
+			}
+		}
+		if (reader.error)
+		{
+			(void)reader.errorLine();
+		}
+		reader.close();
+	}
+
+	if (benchParse((const char*)data, size, "fuzz") == 0)
+	{
+		(void)checkScenario(current_scene_id, findings);
+	}
+	benchRelease();
+	return (0);
+}
+#endif
@@ -0,0 +1,697 @@
+/*
+ * scenario_cache.cpp
+ *
+ * Precompiled scenario images
+ *
+ * This file is part of the sim-mgr distribution (https://github.com/OpenVetSim/sim-mgr).
+ *
+ * Copyright (c) 2019-2025 ITown Design
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+ * After a clean parse, the scenario graph is written next to main.xml as main.cache: a
+ * flat image of the scenes, trigger groups, triggers, events and init parameter deltas.
+ * The image is keyed by the size, last write time and hash of the XML it came from, and
+ * by the layout of the build that wrote it. On a later start the image is mapped and,
+ * if every key still matches, the graph is linked up from it in one pass and the XML
+ * parser is not run. Anything unexpected leaves the scenario empty for the XML parser.
+ * The preloader keeps the same images in memory (scenario_preload.cpp).
+ */
+#include "vetsim.h"
+#include "scenario.h"
+#include <vector>
+
+#define CACHE_MAGIC		0x48435356	// "VSCH"
+#define CACHE_VERSION	1
+#define CACHE_ALIGN		8
+
+extern thread_local struct scenario_data* scenario;
+extern thread_local int current_scene_id;
+
+// An init section: entries [first, first + count) of the image, values from "values"
+struct cache_delta
+{
+	int first;
+	int count;
+	unsigned int values;	// Offset in the value bytes
+	unsigned int bytes;
+};
+
+struct cache_header
+{
+	unsigned int magic;
+	unsigned int version;
+	unsigned int layout;		// cacheLayout() of the build that wrote it
+	unsigned int size;			// Bytes in the image, header included
+	unsigned long long xmlSize;
+	unsigned long long xmlTime;	// Last write time of main.xml
+	unsigned long long xmlHash;
+	int initialScene;
+	int sceneCount;
+	int groupCount;
+	int triggerCount;
+	int eventCount;
+	int entryCount;
+	unsigned int valueBytes;
+	unsigned int sceneOffset;
+	unsigned int groupOffset;
+	unsigned int triggerOffset;
+	unsigned int eventOffset;
+	unsigned int entryOffset;
+	unsigned int valueOffset;
+	struct cache_delta init;
+	char author[LONG_STRING_SIZE + 2];
+	char title[LONG_STRING_SIZE + 2];
+	char date_created[NORMAL_STRING_SIZE + 2];
+	char description[LONG_STRING_SIZE + 2];
+};
+
+// Each scene is followed in the trigger table by its triggers, then by the triggers of each of its groups
+struct cache_scene
+{
+	int id;
+	int timeout;
+	int timeout_scene;
+	int triggerCount;
+	int groupCount;
+	struct cache_delta init;
+	char name[LONG_STRING_SIZE + 1];
+};
+
+struct cache_group
+{
+	int group_id;
+	int scene;
+	int needed;
+	int triggerCount;
+};
+
+struct cache_trigger
+{
+	int test;
+	int value;
+	int value2;
+	int scene;
+	int group;
+	char param_class[TRIGGER_NAME_LENGTH + 2];
+	char param_element[TRIGGER_NAME_LENGTH + 2];
+};
+
+struct cache_event
+{
+	char event_catagory_name[NORMAL_STRING_SIZE + 2];
+	char event_catagory_title[NORMAL_STRING_SIZE + 2];
+	char event_title[NORMAL_STRING_SIZE + 2];
+	char event_id[NORMAL_STRING_SIZE + 2];
+};
+
+struct mapped_file
+{
+	HANDLE file;
+	HANDLE map;
+	const unsigned char* data;
+	unsigned long long size;
+};
+
+static unsigned int
+cacheLayout(void)
+{
+	unsigned int layout = paramLayoutStamp();
+
+	layout = (layout ^ (unsigned int)sizeof(struct cache_header)) * 16777619u;
+	layout = (layout ^ (unsigned int)sizeof(struct cache_scene)) * 16777619u;
+	layout = (layout ^ (unsigned int)sizeof(struct cache_trigger)) * 16777619u;
+	layout = (layout ^ (unsigned int)sizeof(struct cache_event)) * 16777619u;
+	return (layout);
+}
+
+static unsigned long long
+hashBytes(const unsigned char* data, unsigned long long len)
+{
+	unsigned long long hash = 14695981039346656037ULL;
+	unsigned long long i;
+
+	for (i = 0; i < len; i++)
+	{
+		hash = (hash ^ data[i]) * 1099511628211ULL;
+	}
+	return (hash);
+}
+
+static int
+mapFile(const char* path, struct mapped_file* mf)
+{
+	LARGE_INTEGER len;
+
+	mf->map = NULL;
+	mf->data = NULL;
+	mf->size = 0;
+	mf->file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (mf->file == INVALID_HANDLE_VALUE)
+	{
+		return (-1);
+	}
+	if (!GetFileSizeEx(mf->file, &len) || len.QuadPart <= 0)
+	{
+		CloseHandle(mf->file);
+		return (-1);
+	}
+	mf->size = (unsigned long long)len.QuadPart;
+	mf->map = CreateFileMappingA(mf->file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (mf->map)
+	{
+		mf->data = (const unsigned char*)MapViewOfFile(mf->map, FILE_MAP_READ, 0, 0, 0);
+	}
+	if (!mf->data)
+	{
+		if (mf->map)
+		{
+			CloseHandle(mf->map);
+		}
+		CloseHandle(mf->file);
+		return (-1);
+	}
+	return (0);
+}
+
+static void
+unmapFile(struct mapped_file* mf)
+{
+	UnmapViewOfFile(mf->data);
+	CloseHandle(mf->map);
+	CloseHandle(mf->file);
+}
+
+/*
+ * scenarioXmlKey
+ *
+ * Get the size and last write time of the XML file. Returns 0 or -1.
+ */
+int
+scenarioXmlKey(const char* xmlPath, unsigned long long* size, unsigned long long* time)
+{
+	WIN32_FILE_ATTRIBUTE_DATA attr;
+
+	if (!GetFileAttributesExA(xmlPath, GetFileExInfoStandard, &attr))
+	{
+		return (-1);
+	}
+	*size = ((unsigned long long)attr.nFileSizeHigh << 32) | attr.nFileSizeLow;
+	*time = ((unsigned long long)attr.ftLastWriteTime.dwHighDateTime << 32) | attr.ftLastWriteTime.dwLowDateTime;
+	return (0);
+}
+
+static void
+cachePath(const char* xmlPath, char* path, size_t size)
+{
+	const char* sep = strrchr(xmlPath, '\\');
+	int dirLen = (sep ? (int)(sep - xmlPath) + 1 : 0);
+
+	sprintf_s(path, size, "%.*smain.cache", dirLen, xmlPath);
+}
+
+static int
+tableFits(const struct cache_header* hdr, unsigned int offset, int count, size_t recSize)
+{
+	return (count >= 0 && offset <= hdr->size && (unsigned long long)count * recSize <= hdr->size - offset);
+}
+
+static int
+deltaFits(const struct cache_header* hdr, const struct cache_delta* delta)
+{
+	return (delta->first >= 0 && delta->count >= 0 && delta->count <= hdr->entryCount - delta->first &&
+		delta->values <= hdr->valueBytes && delta->bytes <= hdr->valueBytes - delta->values);
+}
+
+static void
+linkDelta(struct param_delta* delta, const struct cache_delta* cd, struct param_entry* entries, unsigned char* values)
+{
+	delta->count = cd->count;
+	delta->entries = (cd->count ? entries + cd->first : NULL);
+	delta->values = (cd->count ? values + cd->values : NULL);
+}
+
+/*
+ * checkImage
+ *
+ * Returns the header if the image is complete, self-consistent and was built by this
+ * build from an XML file of the given size and write time, or NULL.
+ */
+static const struct cache_header*
+checkImage(const unsigned char* data, unsigned long long size, unsigned long long xmlSize, unsigned long long xmlTime)
+{
+	const struct cache_header* hdr = (const struct cache_header*)data;
+	const struct param_entry* pe;
+	int i;
+
+	if (size < sizeof(struct cache_header) || hdr->magic != CACHE_MAGIC || hdr->version != CACHE_VERSION ||
+		hdr->layout != cacheLayout() || hdr->size != size ||
+		hdr->xmlSize != xmlSize || hdr->xmlTime != xmlTime)
+	{
+		return (NULL);
+	}
+	if (!tableFits(hdr, hdr->sceneOffset, hdr->sceneCount, sizeof(struct cache_scene)) ||
+		!tableFits(hdr, hdr->groupOffset, hdr->groupCount, sizeof(struct cache_group)) ||
+		!tableFits(hdr, hdr->triggerOffset, hdr->triggerCount, sizeof(struct cache_trigger)) ||
+		!tableFits(hdr, hdr->eventOffset, hdr->eventCount, sizeof(struct cache_event)) ||
+		!tableFits(hdr, hdr->entryOffset, hdr->entryCount, sizeof(struct param_entry)) ||
+		!tableFits(hdr, hdr->valueOffset, (int)hdr->valueBytes, 1) ||
+		!deltaFits(hdr, &hdr->init))
+	{
+		return (NULL);
+	}
+	pe = (const struct param_entry*)(data + hdr->entryOffset);
+	for (i = 0; i < hdr->entryCount; i++)
+	{
+		if (paramFieldSize(pe[i].field) < (int)pe[i].length)
+		{
+			return (NULL);
+		}
+	}
+	return (hdr);
+}
+
+/*
+ * linkImage
+ *
+ * Build the scenario of this thread from a checked image. The scenario must be freshly
+ * allocated. Returns 0, or -1 with the scenario left empty.
+ */
+static int
+linkImage(const struct cache_header* hdr)
+{
+	const unsigned char* data = (const unsigned char*)hdr;
+	const struct cache_scene* cs;
+	const struct cache_group* cg;
+	const struct cache_trigger* ct;
+	const struct cache_event* ce;
+	struct param_entry* entries = NULL;
+	unsigned char* values = NULL;
+	struct scenario_scene* scene;
+	struct trigger_group* group;
+	struct scenario_trigger* trig;
+	struct scenario_event* event;
+	int nextTrigger = 0;
+	int nextGroup = 0;
+	int i;
+	int j;
+	int k;
+
+	// The deltas are used from one copy of the entry and value tables
+	if (hdr->entryCount)
+	{
+		entries = (struct param_entry*)arena_alloc(&scenarioArena, hdr->entryCount * sizeof(struct param_entry));
+		values = (unsigned char*)arena_alloc(&scenarioArena, hdr->valueBytes);
+		if (!entries || !values)
+		{
+			return (-1);
+		}
+		memcpy(entries, data + hdr->entryOffset, hdr->entryCount * sizeof(struct param_entry));
+		memcpy(values, data + hdr->valueOffset, hdr->valueBytes);
+	}
+
+	memcpy(scenario->author, hdr->author, sizeof(scenario->author));
+	memcpy(scenario->title, hdr->title, sizeof(scenario->title));
+	memcpy(scenario->date_created, hdr->date_created, sizeof(scenario->date_created));
+	memcpy(scenario->description, hdr->description, sizeof(scenario->description));
+	linkDelta(&scenario->initParams, &hdr->init, entries, values);
+
+	cs = (const struct cache_scene*)(data + hdr->sceneOffset);
+	cg = (const struct cache_group*)(data + hdr->groupOffset);
+	ct = (const struct cache_trigger*)(data + hdr->triggerOffset);
+	for (i = 0; i < hdr->sceneCount; i++, cs++)
+	{
+		scene = (struct scenario_scene*)arena_alloc(&scenarioArena, sizeof(struct scenario_scene));
+		if (!scene || !deltaFits(hdr, &cs->init) || cs->triggerCount < 0 || cs->groupCount < 0 ||
+			cs->triggerCount > hdr->triggerCount - nextTrigger || cs->groupCount > hdr->groupCount - nextGroup)
+		{
+			goto bad;
+		}
+		append_llist(&scene->scene_list, &scenario->scene_list, &scenario->scene_tail);
+		scene->id = cs->id;
+		scene->timeout = cs->timeout;
+		scene->timeout_scene = cs->timeout_scene;
+		memcpy(scene->name, cs->name, sizeof(scene->name));
+		linkDelta(&scene->initParams, &cs->init, entries, values);
+
+		for (j = 0; j < cs->triggerCount; j++)
+		{
+			trig = (struct scenario_trigger*)arena_alloc(&scenarioArena, sizeof(struct scenario_trigger));
+			if (!trig)
+			{
+				goto bad;
+			}
+			append_llist(&trig->trigger_list, &scene->trigger_list, &scene->trigger_tail);
+			memcpy(trig->param_class, ct[nextTrigger].param_class, sizeof(trig->param_class));
+			memcpy(trig->param_element, ct[nextTrigger].param_element, sizeof(trig->param_element));
+			trig->test = ct[nextTrigger].test;
+			trig->value = ct[nextTrigger].value;
+			trig->value2 = ct[nextTrigger].value2;
+			trig->scene = ct[nextTrigger].scene;
+			trig->group = ct[nextTrigger].group;
+			nextTrigger++;
+		}
+		for (j = 0; j < cs->groupCount; j++, nextGroup++)
+		{
+			group = (struct trigger_group*)arena_alloc(&scenarioArena, sizeof(struct trigger_group));
+			if (!group || cg[nextGroup].triggerCount < 0 || cg[nextGroup].triggerCount > hdr->triggerCount - nextTrigger)
+			{
+				goto bad;
+			}
+			append_llist(&group->group_list, &scene->group_list, &scene->group_tail);
+			group->group_id = cg[nextGroup].group_id;
+			group->scene = cg[nextGroup].scene;
+			group->group_triggers_needed = cg[nextGroup].needed;
+			for (k = 0; k < cg[nextGroup].triggerCount; k++)
+			{
+				trig = (struct scenario_trigger*)arena_alloc(&scenarioArena, sizeof(struct scenario_trigger));
+				if (!trig)
+				{
+					goto bad;
+				}
+				append_llist(&trig->trigger_list, &group->group_trigger_list, &group->group_trigger_tail);
+				memcpy(trig->param_class, ct[nextTrigger].param_class, sizeof(trig->param_class));
+				memcpy(trig->param_element, ct[nextTrigger].param_element, sizeof(trig->param_element));
+				trig->test = ct[nextTrigger].test;
+				trig->value = ct[nextTrigger].value;
+				trig->value2 = ct[nextTrigger].value2;
+				trig->scene = ct[nextTrigger].scene;
+				trig->group = ct[nextTrigger].group;
+				nextTrigger++;
+			}
+		}
+	}
+	if (nextTrigger != hdr->triggerCount || nextGroup != hdr->groupCount)
+	{
+		goto bad;
+	}
+
+	ce = (const struct cache_event*)(data + hdr->eventOffset);
+	for (i = 0; i < hdr->eventCount; i++, ce++)
+	{
+		event = (struct scenario_event*)arena_alloc(&scenarioArena, sizeof(struct scenario_event));
+		if (!event)
+		{
+			goto bad;
+		}
+		append_llist(&event->event_list, &scenario->event_list, &scenario->event_tail);
+		memcpy(event->event_catagory_name, ce->event_catagory_name, sizeof(event->event_catagory_name));
+		memcpy(event->event_catagory_title, ce->event_catagory_title, sizeof(event->event_catagory_title));
+		memcpy(event->event_title, ce->event_title, sizeof(event->event_title));
+		memcpy(event->event_id, ce->event_id, sizeof(event->event_id));
+	}
+	current_scene_id = hdr->initialScene;
+	return (0);
+
+bad:
+	// What was linked so far is left in the arena, unreachable
+	memset(scenario, 0, sizeof(struct scenario_data));
+	return (-1);
+}
+
+/*
+ * loadScenarioCache
+ * @xmlPath: the main.xml the scenario would be parsed from
+ *
+ * Build the scenario from main.cache, if it is current. The scenario must be freshly
+ * allocated. Returns 0 when the scenario was loaded, or -1 to parse the XML instead.
+ */
+int
+loadScenarioCache(const char* xmlPath)
+{
+	char path[1400];
+	struct mapped_file cache;
+	struct mapped_file xml;
+	const struct cache_header* hdr;
+	unsigned long long xmlSize;
+	unsigned long long xmlTime;
+	unsigned long long hash;
+	int sts;
+
+	if (scenarioXmlKey(xmlPath, &xmlSize, &xmlTime) != 0)
+	{
+		return (-1);
+	}
+	cachePath(xmlPath, path, sizeof(path));
+	if (mapFile(path, &cache) != 0)
+	{
+		return (-1);
+	}
+	hdr = checkImage(cache.data, cache.size, xmlSize, xmlTime);
+	if (!hdr || mapFile(xmlPath, &xml) != 0)
+	{
+		unmapFile(&cache);
+		return (-1);
+	}
+	hash = hashBytes(xml.data, xml.size);
+	unmapFile(&xml);
+	sts = (hash == hdr->xmlHash ? linkImage(hdr) : -1);
+	unmapFile(&cache);
+	return (sts);
+}
+
+/*
+ * bindScenarioImage
+ * @image: built by buildScenarioImage
+ * @xmlPath: the main.xml the image was built from
+ *
+ * As loadScenarioCache, for an image held in memory. The XML is not hashed again, so
+ * the caller must have rebuilt the image if the file has been written since.
+ */
+int
+bindScenarioImage(const std::vector<unsigned char>& image, const char* xmlPath)
+{
+	const struct cache_header* hdr;
+	unsigned long long xmlSize;
+	unsigned long long xmlTime;
+
+	if (image.empty() || scenarioXmlKey(xmlPath, &xmlSize, &xmlTime) != 0)
+	{
+		return (-1);
+	}
+	hdr = checkImage(image.data(), image.size(), xmlSize, xmlTime);
+	return (hdr ? linkImage(hdr) : -1);
+}
+
+static unsigned int
+appendTable(std::vector<unsigned char>& image, const void* data, size_t bytes)
+{
+	size_t offset = (image.size() + CACHE_ALIGN - 1) & ~(size_t)(CACHE_ALIGN - 1);
+
+	image.resize(offset + bytes);
+	if (bytes)
+	{
+		memcpy(&image[offset], data, bytes);
+	}
+	return ((unsigned int)offset);
+}
+
+static void
+saveDelta(const struct param_delta* delta, struct cache_delta* cd, std::vector<struct param_entry>& entries,
+	std::vector<unsigned char>& values)
+{
+	int i;
+
+	cd->first = (int)entries.size();
+	cd->count = delta->count;
+	cd->values = (unsigned int)values.size();
+	cd->bytes = 0;
+	for (i = 0; i < delta->count; i++)
+	{
+		if (delta->entries[i].value + delta->entries[i].length > cd->bytes)
+		{
+			cd->bytes = delta->entries[i].value + delta->entries[i].length;
+		}
+		entries.push_back(delta->entries[i]);
+	}
+	values.insert(values.end(), delta->values, delta->values + cd->bytes);
+}
+
+static void
+saveTrigger(const struct scenario_trigger* trig, std::vector<struct cache_trigger>& triggers)
+{
+	struct cache_trigger ct;
+
+	memset(&ct, 0, sizeof(ct));
+	memcpy(ct.param_class, trig->param_class, sizeof(ct.param_class));
+	memcpy(ct.param_element, trig->param_element, sizeof(ct.param_element));
+	ct.test = trig->test;
+	ct.value = trig->value;
+	ct.value2 = trig->value2;
+	ct.scene = trig->scene;
+	ct.group = trig->group;
+	triggers.push_back(ct);
+}
+
+/*
+ * buildScenarioImage
+ * @xmlPath: the main.xml the scenario was parsed from
+ * @image: receives the image
+ *
+ * Flatten the scenario of this thread. Only call this after a parse without errors.
+ * Returns 0, or -1 if the XML can no longer be read.
+ */
+int
+buildScenarioImage(const char* xmlPath, std::vector<unsigned char>& image)
+{
+	struct mapped_file xml;
+	struct cache_header hdr;
+	struct cache_scene cs;
+	struct cache_group cg;
+	struct cache_event ce;
+	std::vector<struct cache_scene> scenes;
+	std::vector<struct cache_group> groups;
+	std::vector<struct cache_trigger> triggers;
+	std::vector<struct cache_event> events;
+	std::vector<struct param_entry> entries;
+	std::vector<unsigned char> values;
+	struct snode* snode;
+	struct snode* g_snode;
+	struct snode* t_snode;
+	struct scenario_scene* scene;
+	struct trigger_group* group;
+	struct scenario_event* event;
+
+	memset(&hdr, 0, sizeof(hdr));
+	if (scenarioXmlKey(xmlPath, &hdr.xmlSize, &hdr.xmlTime) != 0 || mapFile(xmlPath, &xml) != 0)
+	{
+		return (-1);
+	}
+	hdr.xmlHash = hashBytes(xml.data, xml.size);
+	unmapFile(&xml);
+
+	hdr.magic = CACHE_MAGIC;
+	hdr.version = CACHE_VERSION;
+	hdr.layout = cacheLayout();
+	hdr.initialScene = current_scene_id;
+	memcpy(hdr.author, scenario->author, sizeof(hdr.author));
+	memcpy(hdr.title, scenario->title, sizeof(hdr.title));
+	memcpy(hdr.date_created, scenario->date_created, sizeof(hdr.date_created));
+	memcpy(hdr.description, scenario->description, sizeof(hdr.description));
+	saveDelta(&scenario->initParams, &hdr.init, entries, values);
+
+	for (snode = scenario->scene_list.next; snode; snode = get_next_llist(snode))
+	{
+		scene = (struct scenario_scene*)snode;
+		memset(&cs, 0, sizeof(cs));
+		cs.id = scene->id;
+		cs.timeout = scene->timeout;
+		cs.timeout_scene = scene->timeout_scene;
+		memcpy(cs.name, scene->name, sizeof(cs.name));
+		saveDelta(&scene->initParams, &cs.init, entries, values);
+		for (t_snode = scene->trigger_list.next; t_snode; t_snode = get_next_llist(t_snode))
+		{
+			saveTrigger((struct scenario_trigger*)t_snode, triggers);
+			cs.triggerCount++;
+		}
+		for (g_snode = scene->group_list.next; g_snode; g_snode = get_next_llist(g_snode))
+		{
+			group = (struct trigger_group*)g_snode;
+			memset(&cg, 0, sizeof(cg));
+			cg.group_id = group->group_id;
+			cg.scene = group->scene;
+			cg.needed = group->group_triggers_needed;
+			for (t_snode = group->group_trigger_list.next; t_snode; t_snode = get_next_llist(t_snode))
+			{
+				saveTrigger((struct scenario_trigger*)t_snode, triggers);
+				cg.triggerCount++;
+			}
+			groups.push_back(cg);
+			cs.groupCount++;
+		}
+		scenes.push_back(cs);
+	}
+	for (snode = scenario->event_list.next; snode; snode = get_next_llist(snode))
+	{
+		event = (struct scenario_event*)snode;
+		memset(&ce, 0, sizeof(ce));
+		memcpy(ce.event_catagory_name, event->event_catagory_name, sizeof(ce.event_catagory_name));
+		memcpy(ce.event_catagory_title, event->event_catagory_title, sizeof(ce.event_catagory_title));
+		memcpy(ce.event_title, event->event_title, sizeof(ce.event_title));
+		memcpy(ce.event_id, event->event_id, sizeof(ce.event_id));
+		events.push_back(ce);
+	}
+
+	hdr.sceneCount = (int)scenes.size();
+	hdr.groupCount = (int)groups.size();
+	hdr.triggerCount = (int)triggers.size();
+	hdr.eventCount = (int)events.size();
+	hdr.entryCount = (int)entries.size();
+	hdr.valueBytes = (unsigned int)values.size();
+
+	image.clear();
+	image.resize(sizeof(hdr));
+	hdr.sceneOffset = appendTable(image, scenes.data(), scenes.size() * sizeof(struct cache_scene));
+	hdr.groupOffset = appendTable(image, groups.data(), groups.size() * sizeof(struct cache_group));
+	hdr.triggerOffset = appendTable(image, triggers.data(), triggers.size() * sizeof(struct cache_trigger));
+	hdr.eventOffset = appendTable(image, events.data(), events.size() * sizeof(struct cache_event));
+	hdr.entryOffset = appendTable(image, entries.data(), entries.size() * sizeof(struct param_entry));
+	hdr.valueOffset = appendTable(image, values.data(), values.size());
+	hdr.size = (unsigned int)image.size();
+	memcpy(&image[0], &hdr, sizeof(hdr));
+	return (0);
+}
+
+/*
+ * writeScenarioImage
+ * @xmlPath: the main.xml the image was built from
+ * @image: built by buildScenarioImage
+ *
+ * Store the image as main.cache. Returns 0, or -1 if it could not be written, which
+ * only costs a parse next time.
+ */
+int
+writeScenarioImage(const char* xmlPath, const std::vector<unsigned char>& image)
+{
+	char path[1400];
+	char tmpPath[1400];
+	FILE* fp;
+	size_t written;
+
+	// Write a temporary file and rename it, so a reader never maps a partial image.
+	// The name is per thread, as the preloader and a starting scenario may both write.
+	cachePath(xmlPath, path, sizeof(path));
+	sprintf_s(tmpPath, sizeof(tmpPath), "%s.%lu.tmp", path, (unsigned long)GetCurrentThreadId());
+	if (fopen_s(&fp, tmpPath, "wb") != 0 || fp == NULL)
+	{
+		return (-1);
+	}
+	written = fwrite(&image[0], 1, image.size(), fp);
+	if (fclose(fp) != 0 || written != image.size() ||
+		!MoveFileExA(tmpPath, path, MOVEFILE_REPLACE_EXISTING))
+	{
+		DeleteFileA(tmpPath);
+		return (-1);
+	}
+	return (0);
+}
+
+/*
+ * saveScenarioCache
+ * @xmlPath: the main.xml the scenario was parsed from
+ *
+ * Write the parsed scenario to main.cache. Only call this after a parse without errors.
+ */
+int
+saveScenarioCache(const char* xmlPath)
+{
+	std::vector<unsigned char> image;
+
+	if (buildScenarioImage(xmlPath, image) != 0)
+	{
+		return (-1);
+	}
+	return (writeScenarioImage(xmlPath, image));
+}
@@ -0,0 +1,348 @@
+/*
+ * scenario_prefetch.cpp
+ *
+ * Lookahead prefetch of scene media and vocals
+ *
+ * This file is part of the sim-mgr distribution (https://github.com/OpenVetSim/sim-mgr).
+ *
+ * Copyright (c) 2019-2025 ITown Design
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+ * When a scene starts, the clients fetch its media and vocal files from the PHP server,
+ * which reads them from html/scenarios/<scenario>/media and .../vocals. Read cold, a
+ * large video or clip stalls its first frames. So each time a scene starts, the files
+ * of every scene it can go to next are mapped and touched on a background task. The
+ * pages are those of the system file cache, so the server reads them from memory.
+ *
+ * The views are held, most recently used first, up to prefetchMB (winvetsim.ini,
+ * [Scenario]) and released when the scenario stops. A file the clients are sent is
+ * counted as a hit if it was held at the time. The counts are in the "prefetch" status.
+ */
+#include "vetsim.h"
+#include "scenario.h"
+#include <list>
+#include <deque>
+#include <unordered_map>
+#include <condition_variable>
+
+#define PREFETCH_PAGE		4096
+#define PREFETCH_IDLE		500		// msec between checks of closeFlag while idle
+
+extern int closeFlag;
+
+struct prefetch_entry
+{
+	int state;
+	unsigned long long size;
+	const void* view;						// Held while the state is PREFETCH_HELD
+	std::list<std::string>::iterator lru;	// Valid while held
+};
+
+#define PREFETCH_QUEUED		0
+#define PREFETCH_LOADING	1
+#define PREFETCH_HELD		2
+#define PREFETCH_FAILED		3	// Missing, empty or larger than the budget
+
+static std::mutex prefetchMutex;
+static std::condition_variable prefetchWake;
+static std::unordered_map<std::string, struct prefetch_entry> prefetchTable;	// By path
+static std::list<std::string> prefetchLru;		// Held files, most recently used first
+static std::deque<std::string> prefetchQueue;
+static int prefetchRunning = 0;
+static struct prefetch_status prefetchStats;
+
+/*
+ * assetPath
+ * @scenarioName: scenario directory
+ * @asset: "media\<file>" or "vocals\<file>"
+ * @path: receives the full path
+ *
+ * Returns 0, or -1 if the file name would leave the scenario directory.
+ */
+static int
+assetPath(const char* scenarioName, const std::string& asset, std::string& path)
+{
+	if (asset.find("..") != std::string::npos || asset.find(':') != std::string::npos)
+	{
+		return (-1);
+	}
+	path = localConfig.html_path;
+	path += "\\scenarios\\";
+	path += scenarioName;
+	path += "\\";
+	for (char c : asset)
+	{
+		path += (c == '/' ? '\\' : c);
+	}
+	return (0);
+}
+
+/*
+ * releaseEntry
+ *
+ * Unmap a held file. Called with prefetchMutex held.
+ */
+static void
+releaseEntry(struct prefetch_entry& entry)
+{
+	if (entry.state == PREFETCH_HELD)
+	{
+		UnmapViewOfFile(entry.view);
+		prefetchLru.erase(entry.lru);
+		prefetchStats.held -= entry.size;
+		prefetchStats.files--;
+	}
+	entry.view = NULL;
+}
+
+/*
+ * mapAsset
+ * @path: file to read
+ * @budget: largest file to take
+ * @size: receives its length
+ *
+ * Map the file and touch each page of it. Returns the view, or NULL.
+ */
+static const void*
+mapAsset(const char* path, unsigned long long budget, unsigned long long* size)
+{
+	HANDLE hFile;
+	HANDLE hMap;
+	LARGE_INTEGER filelen;
+	const volatile char* view = NULL;
+	unsigned long long off;
+	char sum = 0;
+
+	hFile = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL,
+		OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (hFile == INVALID_HANDLE_VALUE)
+	{
+		return (NULL);
+	}
+	if (!GetFileSizeEx(hFile, &filelen) || filelen.QuadPart <= 0 || (unsigned long long)filelen.QuadPart > budget)
+	{
+		CloseHandle(hFile);
+		return (NULL);
+	}
+	*size = (unsigned long long)filelen.QuadPart;
+	hMap = CreateFileMappingA(hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (hMap)
+	{
+		view = (const volatile char*)MapViewOfFile(hMap, FILE_MAP_READ, 0, 0, 0);
+		CloseHandle(hMap);
+	}
+	CloseHandle(hFile);
+	if (view)
+	{
+		for (off = 0; off < *size && !closeFlag; off += PREFETCH_PAGE)
+		{
+			sum += view[off];
+		}
+	}
+	(void)sum;
+	return ((const void*)view);
+}
+
+/*
+ * prefetchOne
+ * @path: next file on the queue
+ *
+ * Read the file in, then drop the least recently used files to get back within budget.
+ */
+static void
+prefetchOne(const std::string& path)
+{
+	unsigned long long budget = (unsigned long long)localConfig.prefetch_mb * 1024 * 1024;
+	unsigned long long size = 0;
+	const void* view;
+
+	view = mapAsset(path.c_str(), budget, &size);
+
+	std::lock_guard<std::mutex> lock(prefetchMutex);
+	auto found = prefetchTable.find(path);
+	if (found == prefetchTable.end())
+	{
+		// Released while it was read
+		if (view)
+		{
+			UnmapViewOfFile(view);
+		}
+		return;
+	}
+	if (!view)
+	{
+		found->second.state = PREFETCH_FAILED;
+		prefetchStats.failed++;
+		return;
+	}
+	found->second.state = PREFETCH_HELD;
+	found->second.size = size;
+	found->second.view = view;
+	prefetchLru.push_front(path);
+	found->second.lru = prefetchLru.begin();
+	prefetchStats.held += size;
+	prefetchStats.files++;
+	prefetchStats.loaded++;
+	prefetchStats.loaded_bytes += size;
+
+	while (prefetchStats.held > budget && prefetchLru.size() > 1)
+	{
+		auto victim = prefetchTable.find(prefetchLru.back());
+
+		releaseEntry(victim->second);
+		prefetchTable.erase(victim);
+		prefetchStats.evicted++;
+	}
+}
+
+/*
+ * scenarioPrefetchMain
+ *
+ * Task to read the queued files.
+ */
+void
+scenarioPrefetchMain(void)
+{
+	std::string path;
+
+	if (localConfig.prefetch_mb <= 0)
+	{
+		return;
+	}
+	SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_BELOW_NORMAL);
+	{
+		std::lock_guard<std::mutex> lock(prefetchMutex);
+		prefetchRunning = 1;
+		prefetchStats.budget = (unsigned long long)localConfig.prefetch_mb * 1024 * 1024;
+	}
+	while (!closeFlag)
+	{
+		{
+			std::unique_lock<std::mutex> lock(prefetchMutex);
+			if (prefetchQueue.empty())
+			{
+				prefetchWake.wait_for(lock, std::chrono::milliseconds(PREFETCH_IDLE));
+				continue;
+			}
+			path = prefetchQueue.front();
+			prefetchQueue.pop_front();
+			auto found = prefetchTable.find(path);
+			if (found == prefetchTable.end() || found->second.state != PREFETCH_QUEUED)
+			{
+				continue;
+			}
+			found->second.state = PREFETCH_LOADING;
+		}
+		prefetchOne(path);
+	}
+	std::lock_guard<std::mutex> lock(prefetchMutex);
+	prefetchRunning = 0;
+}
+
+/*
+ * prefetchAssets
+ * @scenarioName: scenario directory
+ * @used: files of the scene just started, as "media\<file>" or "vocals\<file>"
+ * @next: files of the scenes it can go to next
+ *
+ * Count each used file as a hit or a miss, and queue the next files that are not held.
+ * Called by the scenario thread when a scene starts. Returns without waiting.
+ */
+void
+prefetchAssets(const char* scenarioName, const std::vector<std::string>& used, const std::vector<std::string>& next)
+{
+	std::string path;
+	int queued = 0;
+
+	std::lock_guard<std::mutex> lock(prefetchMutex);
+	if (!prefetchRunning)
+	{
+		return;
+	}
+	for (auto& asset : used)
+	{
+		if (assetPath(scenarioName, asset, path) != 0)
+		{
+			continue;
+		}
+		auto found = prefetchTable.find(path);
+		if (found != prefetchTable.end() && found->second.state == PREFETCH_HELD)
+		{
+			prefetchLru.splice(prefetchLru.begin(), prefetchLru, found->second.lru);
+			prefetchStats.hits++;
+		}
+		else
+		{
+			prefetchStats.misses++;
+		}
+	}
+	for (auto& asset : next)
+	{
+		if (assetPath(scenarioName, asset, path) != 0)
+		{
+			continue;
+		}
+		auto found = prefetchTable.find(path);
+		if (found == prefetchTable.end())
+		{
+			struct prefetch_entry& entry = prefetchTable[path];
+
+			entry.state = PREFETCH_QUEUED;
+			entry.size = 0;
+			entry.view = NULL;
+			prefetchQueue.push_back(path);
+			queued++;
+		}
+		else if (found->second.state == PREFETCH_HELD)
+		{
+			// Keep it ahead of the files that are not coming up
+			prefetchLru.splice(prefetchLru.begin(), prefetchLru, found->second.lru);
+		}
+	}
+	if (queued)
+	{
+		prefetchWake.notify_one();
+	}
+}
+
+/*
+ * prefetchRelease
+ *
+ * Drop the queue and unmap every held file, so the files can be replaced. Called when
+ * the scenario stops. The counts are kept.
+ */
+void
+prefetchRelease(void)
+{
+	std::lock_guard<std::mutex> lock(prefetchMutex);
+	prefetchQueue.clear();
+	for (auto& entry : prefetchTable)
+	{
+		releaseEntry(entry.second);
+	}
+	prefetchTable.clear();
+}
+
+/*
+ * getPrefetchStatus
+ * @status: receives the counts
+ */
+void
+getPrefetchStatus(struct prefetch_status* status)
+{
+	std::lock_guard<std::mutex> lock(prefetchMutex);
+	*status = prefetchStats;
+}
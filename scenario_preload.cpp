@@ -0,0 +1,428 @@
+/*
+ * scenario_preload.cpp
+ *
+ * Background preloading of the scenario library
+ *
+ * This file is part of the sim-mgr distribution (https://github.com/OpenVetSim/sim-mgr).
+ *
+ * Copyright (c) 2019-2025 ITown Design
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+ * At boot, and whenever something under html/scenarios changes, each scenario directory
+ * whose main.xml is new or has been written since it was last read is parsed and
+ * validated on a small pool of threads. A clean scenario is kept in memory as an
+ * immutable image (see scenario_cache.cpp), which readScenario binds instead of reading
+ * the file, so parse errors are known before start is pressed and the parse is off the
+ * start path. The parser state is thread_local, so this runs alongside a scenario.
+ *
+ * The running scenario's directory is watched too: when its main.xml has been read
+ * again, the result is posted to the scenario thread, which swaps the new definition
+ * in at its next scene_check (see reloadScenario in scenario.cpp).
+ */
+#include "vetsim.h"
+#include "scenario.h"
+#include <map>
+#include <memory>
+#include <atomic>
+#include <algorithm>
+
+#define PRELOAD_MAX_THREADS	4
+#define PRELOAD_SETTLE		500	// msec without further changes before the library is rescanned
+
+extern thread_local struct scenario_data* scenario;
+extern thread_local int current_scene_id;
+extern thread_local int errCount;
+extern thread_local char parseError[];
+extern int closeFlag;
+
+struct preload_entry
+{
+	int state;
+	int errors;
+	long long usec;
+	unsigned long long xmlSize;	// Key of the main.xml the entry was read from
+	unsigned long long xmlTime;
+	std::string message;
+	std::shared_ptr<const std::vector<unsigned char>> image;
+};
+
+static char preloadPath[1088];
+static std::mutex preloadMutex;
+static std::map<std::string, struct preload_entry> preloadTable;	// By scenario directory
+
+// Reload of the running scenario, under preloadMutex
+static std::string reloadName;		// Directory of the running scenario, or empty
+static std::shared_ptr<const std::vector<unsigned char>> reloadImage;	// NULL if it has errors
+static std::string reloadMessage;
+static std::atomic<int> reloadPending(0);
+
+// The message is reported in JSON without escaping
+static std::string
+cleanMessage(const char* msg)
+{
+	std::string clean;
+
+	for (; *msg; msg++)
+	{
+		if (*msg == '"' || *msg == '\\')
+		{
+			clean += '\'';
+		}
+		else if ((unsigned char)*msg >= ' ')
+		{
+			clean += *msg;
+		}
+	}
+	return (clean);
+}
+
+/*
+ * preloadOne
+ * @name: scenario directory
+ *
+ * Read and validate one scenario on this thread and record the result.
+ */
+static void
+preloadOne(const std::string& name)
+{
+	char xmlPath[1400];
+	struct preload_entry entry;
+	std::vector<unsigned char> image;
+	unsigned long long xmlSize;
+	unsigned long long xmlTime;
+	struct snode* snode;
+	int fromXml = 0;
+	int found = 0;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	sprintf_s(xmlPath, sizeof(xmlPath), "%s\\%s\\main.xml", preloadPath, name.c_str());
+	entry.state = PRELOAD_ERROR;
+	entry.errors = 0;
+	entry.xmlSize = 0;
+	entry.xmlTime = 0;
+	(void)scenarioXmlKey(xmlPath, &entry.xmlSize, &entry.xmlTime);
+
+	resetParseState();
+	arena_free(&scenarioArena);
+	scenario = (struct scenario_data*)arena_alloc(&scenarioArena, sizeof(struct scenario_data));
+	if (!scenario)
+	{
+		snprintf(parseError, STR_SIZE, "Failed to allocate the scenario\n");
+		errCount++;
+	}
+	else if (loadScenarioCache(xmlPath) == 0)
+	{
+		(void)compileTriggers();
+	}
+	else if (parseScenarioFile(xmlPath) != 0)
+	{
+		errCount++;
+	}
+	else
+	{
+		fromXml = 1;
+	}
+
+	if (errCount == 0)
+	{
+		if (validateScenes() != 0)
+		{
+			errCount++;
+		}
+		for (snode = scenario->scene_list.next; snode; snode = get_next_llist(snode))
+		{
+			if (((struct scenario_scene*)snode)->id == current_scene_id)
+			{
+				found = 1;
+			}
+		}
+		if (!found)
+		{
+			snprintf(parseError, STR_SIZE, "Starting scene not found in XML file\n");
+			errCount++;
+		}
+	}
+	if (errCount == 0 && buildScenarioImage(xmlPath, image) == 0)
+	{
+		if (scenarioXmlKey(xmlPath, &xmlSize, &xmlTime) != 0 || xmlSize != entry.xmlSize || xmlTime != entry.xmlTime)
+		{
+			// Written while it was read. The change notification will queue it again.
+			entry.state = PRELOAD_PENDING;
+		}
+		else
+		{
+			if (fromXml)
+			{
+				(void)writeScenarioImage(xmlPath, image);
+			}
+			entry.image = std::make_shared<const std::vector<unsigned char>>(std::move(image));
+			entry.state = PRELOAD_READY;
+		}
+	}
+	entry.errors = errCount;
+	entry.message = cleanMessage(parseError);
+	arena_free(&scenarioArena);
+	scenario = NULL;
+	entry.usec = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+
+	std::lock_guard<std::mutex> lock(preloadMutex);
+	preloadTable[name] = entry;
+	if (entry.state != PRELOAD_PENDING && name == reloadName)
+	{
+		reloadImage = entry.image;
+		reloadMessage = entry.message;
+		reloadPending = 1;
+		scenarioNotify();
+	}
+}
+
+/*
+ * preloadScan
+ *
+ * Queue every scenario that is new or changed, drop the ones that are gone, and read
+ * the queue on a pool of threads.
+ */
+static void
+preloadScan(void)
+{
+	WIN32_FIND_DATAA fd;
+	HANDLE find;
+	char pattern[1100];
+	char xmlPath[1400];
+	unsigned long long xmlSize;
+	unsigned long long xmlTime;
+	std::vector<std::string> present;
+	std::vector<std::string> work;
+	std::vector<std::thread> pool;
+	std::atomic<size_t> next(0);
+	size_t threads;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	sprintf_s(pattern, sizeof(pattern), "%s\\*", preloadPath);
+	find = FindFirstFileA(pattern, &fd);
+	if (find == INVALID_HANDLE_VALUE)
+	{
+		return;
+	}
+	do
+	{
+		if (!(fd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) || fd.cFileName[0] == '.')
+		{
+			continue;
+		}
+		sprintf_s(xmlPath, sizeof(xmlPath), "%s\\%s\\main.xml", preloadPath, fd.cFileName);
+		if (scenarioXmlKey(xmlPath, &xmlSize, &xmlTime) != 0)
+		{
+			continue;
+		}
+		present.push_back(fd.cFileName);
+
+		std::lock_guard<std::mutex> lock(preloadMutex);
+		auto found = preloadTable.find(fd.cFileName);
+		if (found == preloadTable.end() || found->second.xmlSize != xmlSize || found->second.xmlTime != xmlTime)
+		{
+			struct preload_entry& entry = preloadTable[fd.cFileName];
+
+			entry.state = PRELOAD_PENDING;
+			entry.errors = 0;
+			entry.usec = 0;
+			entry.xmlSize = xmlSize;
+			entry.xmlTime = xmlTime;
+			entry.message.clear();
+			entry.image.reset();
+			work.push_back(fd.cFileName);
+		}
+	} while (FindNextFileA(find, &fd));
+	FindClose(find);
+
+	{
+		std::lock_guard<std::mutex> lock(preloadMutex);
+		for (auto it = preloadTable.begin(); it != preloadTable.end(); )
+		{
+			if (std::find(present.begin(), present.end(), it->first) == present.end())
+			{
+				it = preloadTable.erase(it);
+			}
+			else
+			{
+				++it;
+			}
+		}
+	}
+	if (work.empty())
+	{
+		return;
+	}
+
+	threads = std::thread::hardware_concurrency();
+	threads = std::max<size_t>(1, std::min<size_t>({ threads, (size_t)PRELOAD_MAX_THREADS, work.size() }));
+	for (size_t t = 0; t < threads; t++)
+	{
+		pool.push_back(std::thread([&work, &next]() {
+			size_t i;
+
+			// Stay out of the way of the simulation threads
+			SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_BELOW_NORMAL);
+			while ((i = next++) < work.size())
+			{
+				preloadOne(work[i]);
+			}
+			}));
+	}
+	for (auto& t : pool)
+	{
+		t.join();
+	}
+	printf("Scenario preload: %zu read on %zu threads in %lld msec\n", work.size(), threads,
+		(long long)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count());
+}
+
+/*
+ * scenarioPreloadMain
+ *
+ * Task to preload the library at boot and again after each change under html/scenarios.
+ */
+void
+scenarioPreloadMain(void)
+{
+	HANDLE change;
+	char buf[1200];
+
+	sprintf_s(preloadPath, sizeof(preloadPath), "%s\\scenarios", localConfig.html_path);
+	preloadScan();
+
+	change = FindFirstChangeNotificationA(preloadPath, TRUE,
+		FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_DIR_NAME | FILE_NOTIFY_CHANGE_LAST_WRITE);
+	if (change == INVALID_HANDLE_VALUE)
+	{
+		sprintf_s(buf, sizeof(buf), "Scenario preload: cannot watch %s. Changes will be read at start.", preloadPath);
+		log_message("", buf);
+		return;
+	}
+	while (!closeFlag)
+	{
+		if (WaitForSingleObject(change, PRELOAD_SETTLE) != WAIT_OBJECT_0)
+		{
+			continue;
+		}
+		// Let a copy or an editor's save finish before reading. Writing main.cache
+		// signals the handle too, but the rescan finds nothing changed.
+		do
+		{
+			if (!FindNextChangeNotification(change))
+			{
+				FindCloseChangeNotification(change);
+				return;
+			}
+		} while (WaitForSingleObject(change, PRELOAD_SETTLE) == WAIT_OBJECT_0);
+		preloadScan();
+	}
+	FindCloseChangeNotification(change);
+}
+
+/*
+ * bindPreloadedScenario
+ * @name: scenario directory
+ * @xmlPath: its main.xml
+ *
+ * Build this thread's scenario from the preloaded image. Returns 0, or -1 if the
+ * scenario is not ready or main.xml has changed since it was read, so the caller
+ * reads it itself. The change notification may not have been handled yet.
+ */
+int
+bindPreloadedScenario(const char* name, const char* xmlPath)
+{
+	std::shared_ptr<const std::vector<unsigned char>> image;
+	unsigned long long xmlSize;
+	unsigned long long xmlTime;
+
+	if (scenarioXmlKey(xmlPath, &xmlSize, &xmlTime) != 0)
+	{
+		return (-1);
+	}
+	{
+		std::lock_guard<std::mutex> lock(preloadMutex);
+		auto found = preloadTable.find(name);
+		if (found == preloadTable.end() || found->second.state != PRELOAD_READY ||
+			found->second.xmlSize != xmlSize || found->second.xmlTime != xmlTime)
+		{
+			return (-1);
+		}
+		image = found->second.image;
+	}
+	return (bindScenarioImage(*image, xmlPath));
+}
+
+/*
+ * watchScenarioReload
+ * @name: directory of the scenario now running, or NULL when it stops
+ *
+ * Post each later read of the scenario to takeScenarioReload.
+ */
+void
+watchScenarioReload(const char* name)
+{
+	std::lock_guard<std::mutex> lock(preloadMutex);
+	reloadName = (name ? name : "");
+	reloadImage.reset();
+	reloadMessage.clear();
+	reloadPending = 0;
+}
+
+/*
+ * takeScenarioReload
+ * @image: receives the new image, or NULL if main.xml now has errors
+ * @message: receives the error
+ *
+ * Returns 1 if the running scenario has been read again since the last call, otherwise 0.
+ * Cheap enough to call on every scene_check.
+ */
+int
+takeScenarioReload(std::shared_ptr<const std::vector<unsigned char>>& image, std::string& message)
+{
+	if (!reloadPending)
+	{
+		return (0);
+	}
+	std::lock_guard<std::mutex> lock(preloadMutex);
+	image = reloadImage;
+	message = reloadMessage;
+	reloadImage.reset();
+	reloadPending = 0;
+	return (1);
+}
+
+/*
+ * getPreloadStatus
+ * @list: receives one entry per scenario, by name
+ */
+void
+getPreloadStatus(std::vector<struct preload_status>& list)
+{
+	struct preload_status status;
+
+	std::lock_guard<std::mutex> lock(preloadMutex);
+	list.clear();
+	for (auto& entry : preloadTable)
+	{
+		status.name = entry.first;
+		status.state = entry.second.state;
+		status.errors = entry.second.errors;
+		status.usec = entry.second.usec;
+		status.message = entry.second.message;
+		list.push_back(status);
+	}
+}
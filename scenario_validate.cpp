@@ -0,0 +1,420 @@
+/*
+ * scenario_validate.cpp
+ *
+ * Batch scenario validator
+ *
+ * This file is part of the sim-mgr distribution (https://github.com/OpenVetSim/sim-mgr).
+ *
+ * Copyright (c) 2019-2025 ITown Design
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+ * Usage: WinVetSim --validate [-j threads] [-o report] [scenario ...]
+ *
+ * Reads and checks each scenario from its main.xml, without starting the simulation.
+ * A scenario is a directory under html/scenarios, or a path to a scenario directory;
+ * with none given, every directory under html/scenarios that has a main.xml is read.
+ * The scenarios are read on a pool of threads (-j, one per processor by default), as
+ * the parser state is thread_local.
+ *
+ * Besides the parse errors, each scenario's scene graph is checked by checkScenario:
+ * invalid and duplicate scene and event IDs, a missing starting scene, scenes with no
+ * way out, timeouts, triggers and trigger groups that go to a scene that does not exist,
+ * and scenes that cannot be reached from the starting scene. The last is a warning; the
+ * rest are errors.
+ *
+ * The report (-o, validate.json by default) is JSON:
+ *
+ *		{ "threads": 8, "msec": 412, "count": 300, "failed": 2, "scenarios": [
+ *			{ "name": "Canine Anaphylaxis", "path": "...\\main.xml", "result": "error",
+ *			  "errors": 1, "warnings": 0, "scenes": 7, "events": 12, "usec": 5120,
+ *			  "findings": [ { "level": "error", "check": "dangling", "scene": 3,
+ *			  "message": "Scene 3: a trigger goes to scene 9, which does not exist" } ] },
+ *			... ] }
+ *
+ * "result" is ok, warning or error. The scenarios are listed in the order given, or by
+ * name. The exit status is 0 if no scenario has an error, 2 if one does, and 1 if the
+ * validator could not run.
+ */
+#include "vetsim.h"
+#include "scenario.h"
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include <chrono>
+
+extern thread_local struct scenario_data* scenario;
+extern thread_local int current_scene_id;
+extern thread_local int errCount;
+extern thread_local char parseError[];
+extern thread_local std::wstring parseLog;
+
+static const char* checkNames[] =
+{
+	"scene_id", "duplicate_scene", "duplicate_event", "no_exit", "end_exits", "no_start",
+	"dangling", "unreachable", "parse"
+};
+
+struct validate_result
+{
+	std::string name;
+	std::string path;
+	int errors;
+	int warnings;
+	int scenes;
+	int events;
+	long long usec;
+	std::vector<struct scenario_finding> findings;
+};
+
+static void
+usage(void)
+{
+	printf("Usage: WinVetSim --validate [-j threads] [-o report] [scenario ...]\n");
+}
+
+/*
+ * parseFindings
+ *
+ * The parser's messages for this thread's scenario, one finding per line of the parse log.
+ * parseError has the last message, which is not always in the log.
+ */
+static void
+parseFindings(std::vector<struct scenario_finding>& findings)
+{
+	struct scenario_finding finding;
+	std::string text;
+	std::string last(parseError);
+	size_t start = 0;
+	size_t end;
+	int length;
+	int found = 0;
+
+	length = WideCharToMultiByte(CP_UTF8, 0, parseLog.c_str(), (int)parseLog.length(), NULL, 0, NULL, NULL);
+	if (length > 0)
+	{
+		text.resize(length);
+		WideCharToMultiByte(CP_UTF8, 0, parseLog.c_str(), (int)parseLog.length(), &text[0], length, NULL, NULL);
+	}
+	// appendToParseLog leaves padding after each message
+	text.erase(std::remove(text.begin(), text.end(), '\0'), text.end());
+	while (!last.empty() && (last.back() == '\n' || last.back() == '\r'))
+	{
+		last.pop_back();
+	}
+
+	finding.check = CHECK_PARSE;
+	finding.scene = -1;
+	while (start < text.length())
+	{
+		end = text.find('\n', start);
+		if (end == std::string::npos)
+		{
+			end = text.length();
+		}
+		finding.message = text.substr(start, end - start);
+		if (!finding.message.empty())
+		{
+			found |= (finding.message == last);
+			findings.push_back(finding);
+		}
+		start = end + 1;
+	}
+	if (!last.empty() && !found)
+	{
+		finding.message = last;
+		findings.push_back(finding);
+	}
+}
+
+/*
+ * validateOne
+ * @result: name and path of the scenario; receives the findings
+ *
+ * Read and check one scenario on this thread.
+ */
+static void
+validateOne(struct validate_result& result)
+{
+	struct scenario_finding finding;
+	struct snode* snode;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	resetParseState();
+	arena_free(&scenarioArena);
+	scenario = (struct scenario_data*)arena_alloc(&scenarioArena, sizeof(struct scenario_data));
+	if (!scenario)
+	{
+		finding.check = CHECK_PARSE;
+		finding.scene = -1;
+		finding.message = "Failed to allocate the scenario";
+		result.findings.push_back(finding);
+	}
+	else
+	{
+		if (parseScenarioFile(result.path.c_str()) != 0)
+		{
+			parseFindings(result.findings);
+		}
+		else
+		{
+			if (errCount > 0)
+			{
+				parseFindings(result.findings);
+			}
+			(void)checkScenario(current_scene_id, result.findings);
+		}
+		for (snode = scenario->scene_list.next; snode; snode = get_next_llist(snode))
+		{
+			result.scenes++;
+		}
+		for (snode = scenario->event_list.next; snode; snode = get_next_llist(snode))
+		{
+			result.events++;
+		}
+	}
+	arena_free(&scenarioArena);
+	scenario = NULL;
+
+	for (auto& f : result.findings)
+	{
+		if (f.check == CHECK_UNREACHABLE)
+		{
+			result.warnings++;
+		}
+		else
+		{
+			result.errors++;
+		}
+	}
+	result.usec = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+/*
+ * findScenarios
+ * @dir: the scenarios directory
+ *
+ * Every subdirectory that has a main.xml, by name
+ */
+static int
+findScenarios(const char* dir, std::vector<struct validate_result>& list)
+{
+	WIN32_FIND_DATAA fd;
+	HANDLE find;
+	char pattern[1100];
+	char xmlPath[1400];
+	struct validate_result result = {};
+
+	sprintf_s(pattern, sizeof(pattern), "%s\\*", dir);
+	find = FindFirstFileA(pattern, &fd);
+	if (find == INVALID_HANDLE_VALUE)
+	{
+		printf("Cannot read %s\n", dir);
+		return (-1);
+	}
+	do
+	{
+		if (!(fd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) || fd.cFileName[0] == '.')
+		{
+			continue;
+		}
+		sprintf_s(xmlPath, sizeof(xmlPath), "%s\\%s\\main.xml", dir, fd.cFileName);
+		if (GetFileAttributesA(xmlPath) == INVALID_FILE_ATTRIBUTES)
+		{
+			continue;
+		}
+		result.name = fd.cFileName;
+		result.path = xmlPath;
+		list.push_back(result);
+	} while (FindNextFileA(find, &fd));
+	FindClose(find);
+
+	std::sort(list.begin(), list.end(),
+		[](const struct validate_result& a, const struct validate_result& b) { return (a.name < b.name); });
+	return (0);
+}
+
+// JSON string, with the quotes
+static void
+writeString(FILE* fp, const std::string& str)
+{
+	fputc('"', fp);
+	for (unsigned char c : str)
+	{
+		if (c == '"' || c == '\\')
+		{
+			fprintf(fp, "\\%c", c);
+		}
+		else if (c < ' ')
+		{
+			fprintf(fp, "\\u%04x", c);
+		}
+		else
+		{
+			fputc(c, fp);
+		}
+	}
+	fputc('"', fp);
+}
+
+static void
+writeReport(FILE* fp, const std::vector<struct validate_result>& list, size_t threads, long long msec, int failed)
+{
+	size_t i;
+	size_t f;
+
+	fprintf(fp, "{ \"threads\": %zu, \"msec\": %lld, \"count\": %zu, \"failed\": %d, \"scenarios\": [\n",
+		threads, msec, list.size(), failed);
+	for (i = 0; i < list.size(); i++)
+	{
+		const struct validate_result& result = list[i];
+
+		fprintf(fp, "\t{ \"name\": ");
+		writeString(fp, result.name);
+		fprintf(fp, ", \"path\": ");
+		writeString(fp, result.path);
+		fprintf(fp, ", \"result\": \"%s\", \"errors\": %d, \"warnings\": %d, \"scenes\": %d, \"events\": %d, \"usec\": %lld,\n\t  \"findings\": [",
+			result.errors ? "error" : result.warnings ? "warning" : "ok",
+			result.errors, result.warnings, result.scenes, result.events, result.usec);
+		for (f = 0; f < result.findings.size(); f++)
+		{
+			const struct scenario_finding& finding = result.findings[f];
+
+			fprintf(fp, "%s\n\t\t{ \"level\": \"%s\", \"check\": \"%s\", \"scene\": %d, \"message\": ",
+				f ? "," : "", finding.check == CHECK_UNREACHABLE ? "warning" : "error",
+				checkNames[finding.check], finding.scene);
+			writeString(fp, finding.message);
+			fprintf(fp, " }");
+		}
+		fprintf(fp, "%s] }%s\n", result.findings.empty() ? "" : "\n\t  ", i + 1 < list.size() ? "," : "");
+	}
+	fprintf(fp, "] }\n");
+}
+
+/*
+ * validateMain
+ * @argc, @argv: the arguments after --validate
+ *
+ * Returns 0 if every scenario is clean, 2 if any has an error, or 1 if the validator
+ * could not run.
+ */
+int
+validateMain(int argc, char* argv[])
+{
+	std::vector<struct validate_result> list;
+	std::vector<std::thread> pool;
+	std::atomic<size_t> next(0);
+	struct validate_result result = {};
+	char reportPath[256] = "validate.json";
+	char scenariosPath[1088];
+	char xmlPath[1400];
+	size_t threads = std::thread::hardware_concurrency();
+	FILE* fp;
+	int failed = 0;
+	int i;
+	std::chrono::steady_clock::time_point start;
+	long long msec;
+
+	sprintf_s(scenariosPath, sizeof(scenariosPath), "%s\\scenarios", localConfig.html_path);
+	for (i = 0; i < argc; i++)
+	{
+		if (argv[i][0] == '-')
+		{
+			if (i + 1 >= argc)
+			{
+				usage();
+				return (1);
+			}
+			switch (argv[i][1])
+			{
+			case 'j':
+				threads = (size_t)strtoul(argv[++i], NULL, 10);
+				break;
+			case 'o':
+				sprintf_s(reportPath, sizeof(reportPath), "%s", argv[++i]);
+				break;
+			default:
+				usage();
+				return (1);
+			}
+		}
+		else
+		{
+			// A name under html/scenarios, or a path to a scenario directory
+			if (strpbrk(argv[i], "\\/:"))
+			{
+				sprintf_s(xmlPath, sizeof(xmlPath), "%s\\main.xml", argv[i]);
+			}
+			else
+			{
+				sprintf_s(xmlPath, sizeof(xmlPath), "%s\\%s\\main.xml", scenariosPath, argv[i]);
+			}
+			result.name = argv[i];
+			result.path = xmlPath;
+			list.push_back(result);
+		}
+	}
+	if (list.empty() && findScenarios(scenariosPath, list) != 0)
+	{
+		return (1);
+	}
+	if (list.empty())
+	{
+		printf("No scenarios found in %s\n", scenariosPath);
+		return (1);
+	}
+
+	start = std::chrono::steady_clock::now();
+	threads = std::max<size_t>(1, std::min<size_t>(threads, list.size()));
+	for (size_t t = 0; t < threads; t++)
+	{
+		pool.push_back(std::thread([&list, &next]() {
+			size_t n;
+
+			while ((n = next++) < list.size())
+			{
+				validateOne(list[n]);
+			}
+			}));
+	}
+	for (auto& t : pool)
+	{
+		t.join();
+	}
+	msec = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+
+	for (auto& r : list)
+	{
+		if (r.errors)
+		{
+			failed++;
+			auto first = std::find_if(r.findings.begin(), r.findings.end(),
+				[](const struct scenario_finding& f) { return (f.check != CHECK_UNREACHABLE); });
+			printf("%s: %d errors, %d warnings. %s\n", r.name.c_str(), r.errors, r.warnings, first->message.c_str());
+		}
+	}
+	if (fopen_s(&fp, reportPath, "w") != 0 || fp == NULL)
+	{
+		printf("Cannot write %s\n", reportPath);
+		return (1);
+	}
+	writeReport(fp, list, threads, msec, failed);
+	fclose(fp);
+	printf("Validated %zu scenarios on %zu threads in %lld msec: %d failed. Report in %s\n",
+		list.size(), threads, msec, failed, reportPath);
+	return (failed ? 2 : 0);
+}
@@ -31,24 +31,35 @@
 #include "scenario.h"
 #include "llist.h"
 #include "XMLRead.h"
+#include <climits>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <string_view>
+#include <cstdarg>
+#include <algorithm>
 
-XMLRead xmlr;
+#define SCENE_TABLE_SLACK	256	// The scene table is used while the largest ID < 4 * scenes + this
 
-extern int current_scene_id;
-struct xml_level xmlLevels[10];
-extern int xml_current_level;
+// The parse state is per thread, so the library can be preloaded while a scenario runs
+thread_local XMLRead xmlr;
 
-extern const char* xml_filename;
-extern int line_number;
+extern thread_local int current_scene_id;
+thread_local struct xml_level xmlLevels[XML_MAX_DEPTH];
+extern thread_local int xml_current_level;
+
+extern thread_local const char* xml_filename;
+extern thread_local int line_number;
 extern int verbose;
 extern int checkOnly;
-extern int errCount;
+extern thread_local int errCount;
 
-extern std::wstring parseLog;
-extern int parse_state;
-extern int parse_init_state;
-extern int parse_scene_state;
-extern int parse_header_state;
+extern thread_local std::wstring parseLog;
+extern thread_local int parse_state;
+extern thread_local int parse_init_state;
+extern thread_local int parse_scene_state;
+extern thread_local int parse_header_state;
+thread_local char parseError[STR_SIZE];	// Last parse error. Copied to the status by readScenario.
 
 const char* parse_states[] =
 {
@@ -85,15 +96,15 @@ const char* trigger_tests_sym[] =
 	"==", "<=", "<", ">=", ">", "", "", ""
 };
 
-char current_event_catagory[NORMAL_STRING_SIZE + 2];
-char current_event_title[NORMAL_STRING_SIZE + 2];
+thread_local char current_event_catagory[NORMAL_STRING_SIZE + 2];
+thread_local char current_event_title[NORMAL_STRING_SIZE + 2];
 
 extern struct scenario_scene* current_scene;
-extern struct scenario_data* scenario;
-struct scenario_scene* new_scene;
-struct scenario_trigger* new_trigger;
-struct trigger_group* new_trigger_group;
-struct scenario_event* new_event;
+extern thread_local struct scenario_data* scenario;
+thread_local struct scenario_scene* new_scene;
+thread_local struct scenario_trigger* new_trigger;
+thread_local struct trigger_group* new_trigger_group;
+thread_local struct scenario_event* new_event;
 
 /**
  *  appendToParseLog
@@ -105,106 +116,205 @@ void
 appendToParseLog(char* str)
 {
 	::std::wstring wideStr;
-	int convertResult = MultiByteToWideChar(CP_UTF8, 0, simmgr_shm->status.scenario.error_message, (int)strlen(simmgr_shm->status.scenario.error_message), NULL, 0);
+	int convertResult = MultiByteToWideChar(CP_UTF8, 0, parseError, (int)strlen(parseError), NULL, 0);
 	if (convertResult > 0)
 	{
 		wideStr.resize(convertResult + 10);
-		convertResult = MultiByteToWideChar(CP_UTF8, 0, simmgr_shm->status.scenario.error_message, (int)strlen(simmgr_shm->status.scenario.error_message), &wideStr[0], (int)wideStr.size());
+		convertResult = MultiByteToWideChar(CP_UTF8, 0, parseError, (int)strlen(parseError), &wideStr[0], (int)wideStr.size());
 		parseLog.append(wideStr);
 	}
 }
 
+// Init sections are parsed into parseParams, then kept as a delta by the scenario or scene
+static thread_local struct instructor parseParams;
+static thread_local struct param_delta* parseParamsOwner = NULL;
+
 /**
- *  scanForDuplicateScene
- * @scene_id
+ *  endParams
  *
- * Returns the number of matches found.
+ * Store the parameters parsed so far with their scenario or scene
 */
-//std::wstring_convert<std::codecvt_utf8_utf16<wchar_t>> converter;
-
-int
-scanForDuplicateScene(int sceneId)
+static void
+endParams(void)
 {
-	struct snode* snode;
-	struct scenario_scene* scene;
-	int match = 0;
-
-	snode = scenario->scene_list.next;
-
-	while (snode)
+	if (parseParamsOwner)
 	{
-		scene = (struct scenario_scene*)snode;
-		if (scene->id == sceneId)
+		if (buildParamDelta(&parseParams, parseParamsOwner, &scenarioArena) < 0)
 		{
-			printf("sfds: %d %d\n", scene->id, sceneId);
-			match++;
+			snprintf(parseError, STR_SIZE, "ERROR: Out of memory for init parameters\n");
+			appendToParseLog(parseError);
+			errCount++;
 		}
-		snode = get_next_llist(snode);
+		parseParamsOwner = NULL;
 	}
-	if (match < 1)
-	{
-		printf("ERROR: Scene ID %d not found\n", sceneId);
-		snprintf(simmgr_shm->status.scenario.error_message, STR_SIZE, "ERROR: Scene ID %d not found\n", sceneId);
-		appendToParseLog(simmgr_shm->status.scenario.error_message);
+}
 
-		errCount++;
-	}
-	else if (match > 1)
-	{
-		printf("ERROR: duplicate check, Scene ID %d found %d times\n", sceneId, match);
-		snprintf(simmgr_shm->status.scenario.error_message, STR_SIZE, "ERROR: DUPLICATE Scene ID %d found %d times\n", sceneId, match);
-		appendToParseLog(simmgr_shm->status.scenario.error_message);
-		errCount++;
-	}
-	return (match);
+/**
+ *  beginParams
+ * @owner: delta of the scenario or scene whose init section follows
+ *
+*/
+static void
+beginParams(struct param_delta* owner)
+{
+	endParams();
+	initializeParameterStruct(&parseParams);
+	parseParamsOwner = owner;
 }
+
 /**
- *  scanForDuplicateEvent
- * @scene_id
+ *  addFinding
  *
- * Returns the number of matches found.
+ * Format a message and add it to the findings
 */
+static void
+addFinding(std::vector<struct scenario_finding>& findings, int check, int sceneId, const char* format, ...)
+{
+	struct scenario_finding finding;
+	char msg[COMMENT_SIZE];
+	va_list args;
+
+	va_start(args, format);
+	vsnprintf(msg, sizeof(msg), format, args);
+	va_end(args);
+	finding.check = check;
+	finding.scene = sceneId;
+	finding.message = msg;
+	findings.push_back(finding);
+}
 
+/**
+ *  checkScenario
+ * @startScene: ID of the starting scene
+ * @findings: receives the problems found
+ *
+ * Check the scene graph of this thread's scenario. The scenes and events are indexed
+ * once, so duplicates are found as they are indexed. Each scene's timeout, triggers and
+ * trigger groups are then walked once, out from the starting scene, which finds the
+ * targets that do not exist and, by the scenes it did not reach, the unreachable ones.
+ * Returns the number of findings.
+*/
 int
-scanForDuplicateEvent(char* eventId)
+checkScenario(int startScene, std::vector<struct scenario_finding>& findings)
 {
+	std::unordered_map<int, std::pair<struct scenario_scene*, int>> scenes;	// By ID, with a count
+	std::unordered_map<std::string_view, int> events;
+	std::unordered_set<int> reached;
+	std::vector<struct scenario_scene*> work;
+	std::unordered_map<int, std::pair<struct scenario_scene*, int>>::iterator start;
+	struct scenario_scene* scene;
 	struct snode* snode;
-	struct scenario_event* event;
-	int match = 0;
-
-	snode = scenario->event_list.next;
+	size_t first = findings.size();
 
-	while (snode)
+	for (snode = scenario->scene_list.next; snode; snode = get_next_llist(snode))
+	{
+		scene = (struct scenario_scene*)snode;
+		if (scene->id < 0)
+		{
+			addFinding(findings, CHECK_SCENE_ID, scene->id, "Scene ID %d is invalid", scene->id);
+		}
+		auto& entry = scenes[scene->id];
+		if (entry.second++ == 0)
+		{
+			entry.first = scene;
+		}
+		else if (entry.second == 2)
+		{
+			addFinding(findings, CHECK_DUPLICATE_SCENE, scene->id, "Scene ID %d has duplicates in XML file", scene->id);
+		}
+	}
+	for (snode = scenario->event_list.next; snode; snode = get_next_llist(snode))
 	{
-		event = (struct scenario_event*)snode;
-		if (strcmp(event->event_id, eventId) == 0)
+		const char* id = ((struct scenario_event*)snode)->event_id;
+
+		if (++events[id] == 2)
 		{
-			match++;
+			addFinding(findings, CHECK_DUPLICATE_EVENT, -1, "Event ID %s has duplicates in XML file", id);
 		}
-		snode = get_next_llist(snode);
 	}
-	if (match < 1)
+
+	// Each scene is walked once: from the starting scene, following every way out of
+	// the scenes reached, then the rest in the order of the file
+	auto target = [&](struct scenario_scene* from, int to, const char* how, int follow) {
+		auto found = scenes.find(to);
+
+		if (found == scenes.end())
+		{
+			addFinding(findings, CHECK_DANGLING, from->id, "Scene %d: %s goes to scene %d, which does not exist",
+				from->id, how, to);
+		}
+		else if (follow && reached.insert(to).second)
+		{
+			work.push_back(found->second.first);
+		}
+		};
+	auto walk = [&](struct scenario_scene* from, int follow) {
+		int exits = 0;
+		int timeout = 0;
+
+		if (from->timeout > 0)
+		{
+			timeout++;
+			target(from, from->timeout_scene, "the timeout", follow);
+		}
+		for (struct snode* t_snode = from->trigger_list.next; t_snode; t_snode = get_next_llist(t_snode))
+		{
+			exits++;
+			target(from, ((struct scenario_trigger*)t_snode)->scene, "a trigger", follow);
+		}
+		for (struct snode* g_snode = from->group_list.next; g_snode; g_snode = get_next_llist(g_snode))
+		{
+			exits++;
+			target(from, ((struct trigger_group*)g_snode)->scene, "a trigger group", follow);
+		}
+		if ((from->id != 0) && (exits == 0) && (timeout == 0))
+		{
+			addFinding(findings, CHECK_NO_EXIT, from->id, "Scene ID %d has no trigger/timeout events", from->id);
+		}
+		if ((from->id == 0) && (exits != 0) && (timeout != 0))
+		{
+			addFinding(findings, CHECK_END_EXITS, from->id, "End Scene ID %d has %d triggers %d timeouts. Should be none.",
+				from->id, exits, timeout);
+		}
+		};
+
+	start = scenes.find(startScene);
+	if (start == scenes.end())
 	{
-		printf("ERROR: Event ID %s not found\n", eventId);
-		snprintf(simmgr_shm->status.scenario.error_message, STR_SIZE, "ERROR: Event ID %s not found\n", eventId);
-		appendToParseLog(simmgr_shm->status.scenario.error_message);
-		errCount++;
+		addFinding(findings, CHECK_NO_START, startScene, "Starting scene %d not found in XML file", startScene);
 	}
-	else if (match > 1)
+	else
 	{
-		printf("ERROR: duplicate check, Event ID %s found %d times\n", eventId, match);
-		snprintf(simmgr_shm->status.scenario.error_message, STR_SIZE, "ERROR: duplicate check, Event ID %s found %d times\n", eventId, match);
-		appendToParseLog(simmgr_shm->status.scenario.error_message);
-		errCount++;
+		reached.insert(startScene);
+		work.push_back(start->second.first);
 	}
-	return (match);
+	while (!work.empty())
+	{
+		scene = work.back();
+		work.pop_back();
+		walk(scene, 1);
+	}
+	for (snode = scenario->scene_list.next; snode; snode = get_next_llist(snode))
+	{
+		scene = (struct scenario_scene*)snode;
+		if (reached.find(scene->id) != reached.end())
+		{
+			continue;
+		}
+		if (start != scenes.end())
+		{
+			addFinding(findings, CHECK_UNREACHABLE, scene->id, "Scene %d is not reachable from scene %d",
+				scene->id, startScene);
+		}
+		walk(scene, 0);
+	}
+	return ((int)(findings.size() - first));
 }
 
-
 /**
  *  showScenes
- * @scene_id
  *
+ * Print the scenes and events, and count the duplicate IDs as errors
 */
 struct scenario_scene*
 showScenes()
@@ -216,9 +326,7 @@ showScenes()
 	struct snode* t_snode;
 	struct snode* e_snode;
 	struct snode* g_snode;
-	int duplicates;
-	int tcount;
-	int timeout = 0;
+	std::vector<struct scenario_finding> findings;
 
 	snode = scenario->scene_list.next;
 
@@ -226,31 +334,9 @@ showScenes()
 	{
 		scene = (struct scenario_scene*)snode;
 		printf("Scene %d: %s\n", scene->id, scene->name);
-		//if (scene->id < 0)
-		//{
-		//	printf("ERROR: Scene ID %d is invalid\n",
-		//		scene->id);
-		//	snprintf(simmgr_shm->status.scenario.error_message, STR_SIZE, "ERROR: Scene ID %d is invalid\n",
-		//		scene->id);
-		//	appendToParseLog(simmgr_shm->status.scenario.error_message);
-		//	errCount++;
-		//}
-		duplicates = scanForDuplicateScene(scene->id);
-		if (duplicates != 1)
-		{
-			printf("ERROR: Scene ID %d has %d duplicate entries\n",
-				scene->id, duplicates);
-			snprintf(simmgr_shm->status.scenario.error_message, STR_SIZE, "ERROR: Scene ID %d has %d entries\n",
-				scene->id, duplicates);
-			appendToParseLog(simmgr_shm->status.scenario.error_message);
-			errCount++;
-		}
-		tcount = 0;
-		timeout = 0;
 		if (scene->timeout > 0)
 		{
 			printf("\tTimeout: %d Scene %d\n", scene->timeout, scene->timeout_scene);
-			timeout++;
 		}
 		printf("\tGroup Triggers:\n");
 		g_snode = scene->group_list.next;
@@ -288,7 +374,6 @@ showScenes()
 		t_snode = scene->trigger_list.next;
 		while (t_snode)
 		{
-			tcount++;
 			trig = (struct scenario_trigger*)t_snode;
 			if (trig->test == TRIGGER_TEST_EVENT)
 			{
@@ -301,26 +386,6 @@ showScenes()
 			}
 			t_snode = get_next_llist(t_snode);
 		}
-		/*
-		if ((scene->id != 0) && (tcount == 0) && (timeout == 0))
-		{
-			printf("ERROR: Scene ID %d has no trigger/timeout events\n",
-				scene->id);
-			snprintf(simmgr_shm->status.scenario.error_message, STR_SIZE, "ERROR: Scene ID %d has no trigger/timeout events\n",
-				scene->id );
-			appendToParseLog(simmgr_shm->status.scenario.error_message);
-			errCount++;
-		}
-		if ((scene->id == 0) && (tcount != 0) && (timeout != 0))
-		{
-			printf("ERROR: End Scene ID %d has %d triggers %d timeouts. Should be none.\n",
-				scene->id, tcount, timeout);
-			snprintf(simmgr_shm->status.scenario.error_message, STR_SIZE, "ERROR: End Scene ID %d has %d triggers %d timeouts. Should be none.\n",
-				scene->id, tcount, timeout);
-			appendToParseLog(simmgr_shm->status.scenario.error_message);
-			errCount++;
-		}
-		*/
 		snode = get_next_llist(snode);
 	}
 	printf("Events:\n");
@@ -330,118 +395,328 @@ showScenes()
 		event = (struct scenario_event*)e_snode;
 		printf("\t'%s'\t'%s'\t'%s'\t'%s'\n",
 			event->event_catagory_name, event->event_catagory_title, event->event_title, event->event_id);
-		duplicates = scanForDuplicateEvent(event->event_id);
-		if (duplicates != 1)
+		e_snode = get_next_llist(e_snode);
+	}
+	(void)checkScenario(current_scene_id, findings);
+	for (auto& finding : findings)
+	{
+		if (finding.check == CHECK_DUPLICATE_SCENE || finding.check == CHECK_DUPLICATE_EVENT)
 		{
-			printf("ERROR: Event ID %s has %d entries\n",
-				event->event_id, duplicates);
-			snprintf(simmgr_shm->status.scenario.error_message, STR_SIZE, "ERROR: Event ID %s has %d entries\n",
-				event->event_id, duplicates);
-			appendToParseLog(simmgr_shm->status.scenario.error_message);
+			printf("ERROR: %s\n", finding.message.c_str());
+			snprintf(parseError, STR_SIZE, "ERROR: %s\n", finding.message.c_str());
+			appendToParseLog(parseError);
 			errCount++;
 		}
-		e_snode = get_next_llist(e_snode);
 	}
 	return (NULL);
 }
 
 /**
  *  validateScenes
- * @scene_id
  *
+ * Check the scenario before it is used. An invalid or duplicate ID fails it; a scene
+ * with no way out, or with a way out to a scene that does not exist, is counted as
+ * a parse error. Returns 0 or -1.
 */
 int
 validateScenes()
+{
+	std::vector<struct scenario_finding> findings;
+
+	(void)checkScenario(current_scene_id, findings);
+	for (auto& finding : findings)
+	{
+		switch (finding.check)
+		{
+		case CHECK_SCENE_ID:
+		case CHECK_DUPLICATE_SCENE:
+		case CHECK_DUPLICATE_EVENT:
+			snprintf(parseError, STR_SIZE, "Scenario ERROR: %s\n", finding.message.c_str());
+			return (-1);
+
+		case CHECK_NO_EXIT:
+		case CHECK_END_EXITS:
+		case CHECK_DANGLING:
+			printf("ERROR: %s\n", finding.message.c_str());
+			snprintf(parseError, STR_SIZE, "ERROR: %s\n", finding.message.c_str());
+			appendToParseLog(parseError);
+			errCount++;
+			break;
+
+		default:
+			// Reported by the validator (WinVetSim --validate). The starting scene is
+			// checked by the caller.
+			if (verbose)
+			{
+				printf("%s\n", finding.message.c_str());
+			}
+			break;
+		}
+	}
+	return (0);
+}
+
+// Event IDs of the loaded scenario, interned to 0..n-1
+static thread_local std::unordered_map<std::string, int> eventIds;
+
+static int
+internEventId(const char* name)
+{
+	auto found = eventIds.find(name);
+
+	if (found != eventIds.end())
+	{
+		return (found->second);
+	}
+	return (eventIds[name] = (int)eventIds.size());
+}
+
+/**
+ *  findEventId
+ * @name: posted event name
+ *
+ * Returns the interned ID, or -1 if no event trigger in the scenario uses the name.
+*/
+int
+findEventId(const char* name)
+{
+	auto found = eventIds.find(name);
+
+	return (found == eventIds.end() ? -1 : found->second);
+}
+
+int
+eventIdCount(void)
+{
+	return ((int)eventIds.size());
+}
+
+/**
+ *  compileTrigger
+ * @trig
+ * @sceneId: for error messages
+ *
+ * Resolve the tested value and turn the test into a range, so the scene check
+ * does no name lookups. Returns 0, or -1 if the target is not a testable value.
+*/
+static int
+compileTrigger(struct scenario_trigger* trig, int sceneId)
+{
+	long long low = INT_MIN;
+	long long high = INT_MAX;
+
+	trig->outside = 0;
+	trig->event = -1;
+	if (trig->test == TRIGGER_TEST_EVENT)
+	{
+		trig->width = 0;
+		trig->event = internEventId(trig->param_element);
+		return (0);
+	}
+	if (findStatusValue(trig->param_class, trig->param_element, &trig->offset, &trig->width) != 0)
+	{
+		snprintf(parseError, STR_SIZE, "ERROR: In Scene %d, trigger %s:%s is not a value that can be tested\n",
+			sceneId, trig->param_class, trig->param_element);
+		appendToParseLog(parseError);
+		errCount++;
+		trig->width = 0;
+		return (-1);
+	}
+	switch (trig->test)
+	{
+	case TRIGGER_TEST_EQ:
+		low = trig->value;
+		high = trig->value;
+		break;
+	case TRIGGER_TEST_LTE:
+		high = trig->value;
+		break;
+	case TRIGGER_TEST_LT:
+		high = (long long)trig->value - 1;
+		break;
+	case TRIGGER_TEST_GTE:
+		low = trig->value;
+		break;
+	case TRIGGER_TEST_GT:
+		low = (long long)trig->value + 1;
+		break;
+	case TRIGGER_TEST_INSIDE:
+		low = (long long)trig->value + 1;
+		high = (long long)trig->value2 - 1;
+		break;
+	case TRIGGER_TEST_OUTSIDE:
+		low = trig->value;
+		high = trig->value2;
+		trig->outside = 1;
+		break;
+	}
+	if (low > INT_MAX || high < INT_MIN)
+	{
+		// Can never be met
+		low = 1;
+		high = 0;
+	}
+	trig->low = (int)low;
+	trig->high = (int)high;
+	return (0);
+}
+
+/**
+ *  indexScenes
+ *
+ * Build the table of scenes by ID, unless the IDs are negative or too sparse for one.
+ * A duplicate ID finds the first scene with it, as the list walk did.
+*/
+static void
+indexScenes(void)
 {
 	struct snode* snode;
 	struct scenario_scene* scene;
-	struct scenario_trigger* trig;
-	struct scenario_event* event;
-	struct snode* t_snode;
-	struct snode* e_snode;
-	int duplicates;
-	int tcount;
-	int timeout = 0;
+	int count = 0;
+	int maxId = -1;
 
-	snode = scenario->scene_list.next;
-
-	while (snode)
+	for (snode = scenario->scene_list.next; snode; snode = get_next_llist(snode))
 	{
 		scene = (struct scenario_scene*)snode;
 		if (scene->id < 0)
 		{
-			snprintf(simmgr_shm->status.scenario.error_message, STR_SIZE, "Scenario ERROR: Scene ID % d is invalid\n",
-				scene->id);
-			return (-1);
+			return;
 		}
-		duplicates = scanForDuplicateScene(scene->id);
-		if (duplicates != 1)
+		maxId = std::max(maxId, scene->id);
+		count++;
+	}
+	if (maxId < 0 || maxId >= count * 4 + SCENE_TABLE_SLACK)
+	{
+		return;
+	}
+	scenario->sceneTable = (struct scenario_scene**)arena_alloc(&scenarioArena, (maxId + 1) * sizeof(struct scenario_scene*));
+	if (!scenario->sceneTable)
+	{
+		return;
+	}
+	scenario->sceneTableSize = maxId + 1;
+	for (snode = scenario->scene_list.next; snode; snode = get_next_llist(snode))
+	{
+		scene = (struct scenario_scene*)snode;
+		if (!scenario->sceneTable[scene->id])
 		{
-			snprintf(simmgr_shm->status.scenario.error_message, STR_SIZE, "Scenario ERROR: Scene ID %d has duplicates in XML file\n",
-				scene->id);
-			return (-1);
+			scenario->sceneTable[scene->id] = scene;
 		}
-		tcount = 0;
-		timeout = 0;
-		if (scene->timeout > 0)
+	}
+}
+
+/**
+ *  findSceneIn
+ * @data: scenario to search
+ * @scene_id
+ *
+ * Returns the scene, or NULL if there is none with the ID.
+*/
+struct scenario_scene*
+findSceneIn(struct scenario_data* data, int scene_id)
+{
+	struct snode* snode;
+
+	if (data->sceneTable)
+	{
+		return ((scene_id >= 0 && scene_id < data->sceneTableSize) ? data->sceneTable[scene_id] : NULL);
+	}
+	for (snode = data->scene_list.next; snode; snode = get_next_llist(snode))
+	{
+		if (((struct scenario_scene*)snode)->id == scene_id)
 		{
-			printf("\tTimeout: %d Scene %d\n", scene->timeout, scene->timeout_scene);
-			timeout++;
+			return ((struct scenario_scene*)snode);
 		}
-		printf("\tTriggers:\n");
-		t_snode = scene->trigger_list.next;
-		while (t_snode)
+	}
+	return (NULL);
+}
+
+/**
+ *  compileTriggers
+ *
+ * Compile every trigger and group trigger in the scenario, and bind each timeout,
+ * trigger and group to the scene it goes to, so a scene change does no lookups. A
+ * target that does not exist is left NULL and is reported by validateScenes. Each scene
+ * with trigger groups gets the flags and counts they are met by, cleared in one go
+ * when the scene starts. May be run again on the same scenario; the flags are kept.
+ * Returns the number of triggers that could not be compiled.
+*/
+int
+compileTriggers(void)
+{
+	struct snode* snode;
+	struct snode* g_snode;
+	struct snode* t_snode;
+	struct scenario_scene* scene;
+	struct trigger_group* trig_group;
+	struct scenario_trigger* trig;
+	int errors = 0;
+	int seq;
+	int groups;
+	int bits;
+
+	// Events the scenario declares first, then any other names the triggers wait for
+	eventIds.clear();
+	for (snode = scenario->event_list.next; snode; snode = get_next_llist(snode))
+	{
+		(void)internEventId(((struct scenario_event*)snode)->event_id);
+	}
+	if (!scenario->sceneTable)
+	{
+		indexScenes();
+	}
+	for (snode = scenario->scene_list.next; snode; snode = get_next_llist(snode))
+	{
+		scene = (struct scenario_scene*)snode;
+		scene->timeout_next = findSceneIn(scenario, scene->timeout_scene);
+		seq = 0;
+		for (t_snode = scene->trigger_list.next; t_snode; t_snode = get_next_llist(t_snode))
 		{
-			tcount++;
 			trig = (struct scenario_trigger*)t_snode;
-			if (trig->test == TRIGGER_TEST_EVENT)
+			trig->seq = seq++;
+			trig->trig_group = NULL;
+			trig->next = findSceneIn(scenario, trig->scene);
+			if (compileTrigger(trig, scene->id) != 0)
 			{
-				printf("\t\tEvent : %s\n", trig->param_element);
-			}
-			else
-			{
-				printf("\t\t%s:%s, %s, %d, %d - Scene %d\n",
-					trig->param_class, trig->param_element, trigger_tests[trig->test], trig->value, trig->value2, trig->scene);
+				errors++;
 			}
-			t_snode = get_next_llist(t_snode);
-		}
-		if ((scene->id != 0) && (tcount == 0) && (timeout == 0))
-		{
-			printf("ERROR: Scene ID %d has no trigger/timeout events\n",
-				scene->id);
-			snprintf(simmgr_shm->status.scenario.error_message, STR_SIZE, "ERROR: Event ID %d has no trigger/timeout events\n",
-				scene->id);
-			appendToParseLog(simmgr_shm->status.scenario.error_message);
-			errCount++;
 		}
-		if ((scene->id == 0) && (tcount != 0) && (timeout != 0))
+		groups = 0;
+		bits = 0;
+		for (g_snode = scene->group_list.next; g_snode; g_snode = get_next_llist(g_snode))
 		{
-			printf("ERROR: End Scene ID %d has %d triggers %d timeouts. Should be none.\n",
-				scene->id, tcount, timeout);
-			snprintf(simmgr_shm->status.scenario.error_message, STR_SIZE, "ERROR: End Scene ID %d has %d triggers %d timeouts. Should be none.\n",
-				scene->id, tcount, timeout);
-			appendToParseLog(simmgr_shm->status.scenario.error_message);
-			errCount++;
+			trig_group = (struct trigger_group*)g_snode;
+			trig_group->index = groups++;
+			trig_group->next = findSceneIn(scenario, trig_group->scene);
+			for (t_snode = trig_group->group_trigger_list.next; t_snode; t_snode = get_next_llist(t_snode))
+			{
+				trig = (struct scenario_trigger*)t_snode;
+				trig->seq = seq++;
+				trig->trig_group = trig_group;
+				trig->next = NULL;
+				trig->bit = bits++;
+				if (compileTrigger(trig, scene->id) != 0)
+				{
+					errors++;
+				}
+			}
 		}
-		snode = get_next_llist(snode);
-	}
-	printf("Events:\n");
-	e_snode = scenario->event_list.next;
-	while (e_snode)
-	{
-		event = (struct scenario_event*)e_snode;
-		printf("\t'%s'\t'%s'\t'%s'\t'%s'\n",
-			event->event_catagory_name, event->event_catagory_title, event->event_title, event->event_id);
-		duplicates = scanForDuplicateEvent(event->event_id);
-		if (duplicates != 1)
+		scene->groupCount = groups;
+		scene->groupTriggers = bits;
+		if (groups && !scene->groupMet)
 		{
-			printf("ERROR: Event ID %s has %d entries\n",
-				event->event_id, duplicates);
-			return (-1);
+			scene->groupMet = (int*)arena_alloc(&scenarioArena, groups * sizeof(int));
+			scene->metBits = (unsigned int*)arena_alloc(&scenarioArena, SCENE_MET_WORDS(scene) * sizeof(unsigned int));
+			if (!scene->groupMet || !scene->metBits)
+			{
+				snprintf(parseError, STR_SIZE, "ERROR: In Scene %d, no memory for the trigger groups\n", scene->id);
+				appendToParseLog(parseError);
+				errCount++;
+				errors++;
+			}
 		}
-		e_snode = get_next_llist(e_snode);
 	}
-	return (NULL);
+	return (errors);
 }
 
 /**
@@ -456,9 +731,10 @@ validateScenes()
 static void
 saveData(const char* xmlName, const char* xmlValue)
 {
-	char* name = (char*)xmlName;
+	const char* name = xmlName;
 	char* value = (char*)xmlValue;
 	int sts = 0;
+	int initSts = 0;	// From the *_parse functions, for an init element
 	int i;
 	char* value2;
 	char complex[1024];
@@ -487,56 +763,55 @@ saveData(const char* xmlName, const char* xmlValue)
 		case PARSE_INIT_STATE_CARDIAC:
 			if (xml_current_level == 3)
 			{
-				sts = cardiac_parse(xmlLevels[xml_current_level].name, value, &scenario->initParams.cardiac);
+				sts = initSts = cardiac_parse(xmlLevels[xml_current_level].name, value, &parseParams.cardiac);
 			}
 			break;
 		case PARSE_INIT_STATE_RESPIRATION:
 			if (xml_current_level == 3)
 			{
-				sts = respiration_parse(xmlLevels[xml_current_level].name, value, &scenario->initParams.respiration);
+				sts = initSts = respiration_parse(xmlLevels[xml_current_level].name, value, &parseParams.respiration);
 			}
 			break;
 		case PARSE_INIT_STATE_GENERAL:
 			if (xml_current_level == 3)
 			{
-				sts = general_parse(xmlLevels[xml_current_level].name, value, &scenario->initParams.general);
+				sts = initSts = general_parse(xmlLevels[xml_current_level].name, value, &parseParams.general);
 			}
 			break;
 		case PARSE_INIT_STATE_TELESIM:
 			if (xml_current_level == 3)
 			{
-				sts = telesim_parse(xmlLevels[xml_current_level].name, value, &scenario->initParams.telesim);
+				sts = initSts = telesim_parse(xmlLevels[xml_current_level].name, value, &parseParams.telesim);
 			}
 			else if (xml_current_level == 4)
 			{
-				sprintf_s(complex, 1024, "%s:%s", xmlLevels[3].name, value);
-				sts = telesim_parse(xmlLevels[xml_current_level].name, complex, &scenario->initParams.telesim);
+				snprintf(complex, 1024, "%s:%s", xmlLevels[3].name, value);
+				sts = initSts = telesim_parse(xmlLevels[xml_current_level].name, complex, &parseParams.telesim);
 			}
 			break;
 		case PARSE_INIT_STATE_VOCALS:
 			if (xml_current_level == 3)
 			{
-				sts = vocals_parse(xmlLevels[xml_current_level].name, value, &scenario->initParams.vocals);
+				sts = initSts = vocals_parse(xmlLevels[xml_current_level].name, value, &parseParams.vocals);
 			}
 			break;
 		case PARSE_INIT_STATE_MEDIA:
 			if (xml_current_level == 3)
 			{
-				sts = media_parse(xmlLevels[xml_current_level].name, value, &scenario->initParams.media);
+				sts = initSts = media_parse(xmlLevels[xml_current_level].name, value, &parseParams.media);
 			}
 			break;
 		case PARSE_INIT_STATE_CPR:
 			if (xml_current_level == 3)
 			{
-				sts = cpr_parse(xmlLevels[xml_current_level].name, value, &scenario->initParams.cpr);
+				sts = initSts = cpr_parse(xmlLevels[xml_current_level].name, value, &parseParams.cpr);
 			}
 			break;
 		case PARSE_INIT_STATE_SCENE:
 			if ((xml_current_level == 2) &&
 				(strcmp(xmlLevels[xml_current_level].name, "initial_scene") == 0))
 			{
-				simmgr_shm->status.scenario.scene_id = atoi(value);
-				current_scene_id = simmgr_shm->status.scenario.scene_id;
+				current_scene_id = atoi(value);
 				if (verbose)
 				{
 					printf("Set Initial Scene to ID %d\n", current_scene_id);
@@ -546,8 +821,7 @@ saveData(const char* xmlName, const char* xmlValue)
 			else if ((xml_current_level == 2) &&
 				(strcmp(xmlLevels[xml_current_level].name, "scene") == 0))
 			{
-				simmgr_shm->status.scenario.scene_id = atoi(value);
-				current_scene_id = simmgr_shm->status.scenario.scene_id;
+				current_scene_id = atoi(value);
 				if (verbose)
 				{
 					printf("Set Scene to ID %d\n", current_scene_id);
@@ -583,9 +857,9 @@ saveData(const char* xmlName, const char* xmlValue)
 				}
 				else if (strcmp(xmlLevels[2].name, "triggers_needed") == 0)
 				{
-					snprintf(simmgr_shm->status.scenario.error_message, STR_SIZE, "ERROR: In Scene %d, 'triggers_needed' found.\n",
+					snprintf(parseError, STR_SIZE, "ERROR: In Scene %d, 'triggers_needed' found.\n",
 						new_scene->id);
-					appendToParseLog(simmgr_shm->status.scenario.error_message);
+					appendToParseLog(parseError);
 					appendToParseLog((char*)"See 'https://vetsim.net/groupTriggers.php'\n");
 					errCount++;
 					printf("Error Triggers Needed found.");
@@ -627,55 +901,56 @@ saveData(const char* xmlName, const char* xmlValue)
 		case PARSE_SCENE_STATE_INIT_CARDIAC:
 			if (xml_current_level == 4)
 			{
-				sts = cardiac_parse(xmlLevels[4].name, value, &new_scene->initParams.cardiac);
+				sts = initSts = cardiac_parse(xmlLevels[4].name, value, &parseParams.cardiac);
 			}
 			break;
 		case PARSE_SCENE_STATE_INIT_RESPIRATION:
 			if (xml_current_level == 4)
 			{
-				sts = respiration_parse(xmlLevels[4].name, value, &new_scene->initParams.respiration);
+				sts = initSts = respiration_parse(xmlLevels[4].name, value, &parseParams.respiration);
 			}
 			break;
 		case PARSE_SCENE_STATE_INIT_GENERAL:
 			if (xml_current_level == 4)
 			{
-				sts = general_parse(xmlLevels[4].name, value, &new_scene->initParams.general);
+				sts = initSts = general_parse(xmlLevels[4].name, value, &parseParams.general);
 			}
 			break;
 		case PARSE_SCENE_STATE_INIT_TELESIM:
 			if (xml_current_level == 5)
 			{
-				sprintf_s(complex, 1024, "%s:%s", xmlLevels[4].name, value);
-				sts = telesim_parse(xmlLevels[xml_current_level].name, complex, &new_scene->initParams.telesim);
+				snprintf(complex, 1024, "%s:%s", xmlLevels[4].name, value);
+				sts = initSts = telesim_parse(xmlLevels[xml_current_level].name, complex, &parseParams.telesim);
 			}
 			else if (xml_current_level == 4)
 			{
-				sprintf_s(complex, 1024, "%s:%s", xmlLevels[3].name, value);
-				sts = telesim_parse(xmlLevels[xml_current_level].name, complex, &new_scene->initParams.telesim);
+				snprintf(complex, 1024, "%s:%s", xmlLevels[3].name, value);
+				sts = initSts = telesim_parse(xmlLevels[xml_current_level].name, complex, &parseParams.telesim);
 			}
 			break;
 		case PARSE_SCENE_STATE_INIT_VOCALS:
 			if (xml_current_level == 4)
 			{
-				sts = vocals_parse(xmlLevels[4].name, value, &new_scene->initParams.vocals);
+				sts = initSts = vocals_parse(xmlLevels[4].name, value, &parseParams.vocals);
 			}
 			break;
 		case PARSE_SCENE_STATE_INIT_MEDIA:
 			if (xml_current_level == 4)
 			{
-				sts = media_parse(xmlLevels[4].name, value, &new_scene->initParams.media);
+				sts = initSts = media_parse(xmlLevels[4].name, value, &parseParams.media);
 			}
 			break;
 		case PARSE_SCENE_STATE_INIT_CPR:
 			if (xml_current_level == 4)
 			{
-				sts = cpr_parse(xmlLevels[4].name, value, &new_scene->initParams.cpr);
+				sts = initSts = cpr_parse(xmlLevels[4].name, value, &parseParams.cpr);
 			}
 			break;
 		case PARSE_SCENE_STATE_TRIGS:
 			break;
 		case PARSE_SCENE_STATE_TRIG_GROUP:
-			if (xml_current_level == 4)
+			// A trigger_group directly under the scene sets the state without a group
+			if (xml_current_level == 4 && new_trigger_group)
 			{
 				if (strcmp(xmlLevels[4].name, "scene_id") == 0)
 				{
@@ -711,7 +986,7 @@ saveData(const char* xmlName, const char* xmlValue)
 				}
 				else if (strcmp(xmlLevels[4].name, "event_id") == 0)
 				{
-					sprintf_s(new_trigger->param_element, 32, "%s", value);
+					snprintf(new_trigger->param_element, 32, "%s", value);
 					new_trigger->test = TRIGGER_TEST_EVENT;
 				}
 				//else if (strcmp(xmlLevels[4].name, "group") == 0)
@@ -725,8 +1000,8 @@ saveData(const char* xmlName, const char* xmlValue)
 			}
 			else if (xml_current_level == 5)
 			{
-				sprintf_s(new_trigger->param_class, 32, "%s", xmlLevels[4].name);
-				sprintf_s(new_trigger->param_element, 32, "%s", xmlLevels[5].name);
+				snprintf(new_trigger->param_class, 32, "%s", xmlLevels[4].name);
+				snprintf(new_trigger->param_element, 32, "%s", xmlLevels[5].name);
 				new_trigger->value = atoi(value);
 
 				// For range, the two values are shown as "2-4". No spaces allowed.
@@ -769,7 +1044,7 @@ saveData(const char* xmlName, const char* xmlValue)
 				}
 				else if (strcmp(xmlLevels[5].name, "event_id") == 0)
 				{
-					sprintf_s(new_trigger->param_element, 32, "%s", value);
+					snprintf(new_trigger->param_element, 32, "%s", value);
 					new_trigger->test = TRIGGER_TEST_EVENT;
 				}
 				else if (strcmp(xmlLevels[5].name, "group_id") == 0)
@@ -783,8 +1058,8 @@ saveData(const char* xmlName, const char* xmlValue)
 			}
 			else if (xml_current_level == 6)
 			{
-				sprintf_s(new_trigger->param_class, 32, "%s", xmlLevels[5].name);
-				sprintf_s(new_trigger->param_element, 32, "%s", xmlLevels[6].name);
+				snprintf(new_trigger->param_class, 32, "%s", xmlLevels[5].name);
+				snprintf(new_trigger->param_element, 32, "%s", xmlLevels[6].name);
 				new_trigger->value = atoi(value);
 
 				// For range, the two values are shown as "2-4". No spaces allowed.
@@ -825,23 +1100,23 @@ saveData(const char* xmlName, const char* xmlValue)
 			if (strcmp(xmlLevels[3].name, "name") == 0)
 			{
 				// Set the current Category Name
-				sprintf_s(current_event_catagory, NORMAL_STRING_SIZE, "%s", value);
+				snprintf(current_event_catagory, NORMAL_STRING_SIZE, "%s", value);
 			}
 			else if (strcmp(xmlLevels[3].name, "title") == 0)
 			{
 				// Set the current Category Name
-				sprintf_s(current_event_title, NORMAL_STRING_SIZE, "%s", value);
+				snprintf(current_event_title, NORMAL_STRING_SIZE, "%s", value);
 			}
 		}
-		else if (xml_current_level == 4)
+		else if (xml_current_level == 4 && new_event)
 		{
 			if (strcmp(xmlLevels[4].name, "title") == 0)
 			{
-				sprintf_s(new_event->event_title, 32, "%s", value);
+				snprintf(new_event->event_title, 32, "%s", value);
 			}
 			else if (strcmp(xmlLevels[4].name, "id") == 0)
 			{
-				sprintf_s(new_event->event_id, 32, "%s", value);
+				snprintf(new_event->event_id, 32, "%s", value);
 			}
 		}
 		break;
@@ -877,7 +1152,7 @@ saveData(const char* xmlName, const char* xmlValue)
 				name = xmlLevels[2].name;
 				if (strcmp(name, "author") == 0)
 				{
-					sprintf_s(scenario->author, 128, "%s", value);
+					snprintf(scenario->author, 128, "%s", value);
 					if (verbose)
 					{
 						printf("Author: %s\n", scenario->author);
@@ -929,7 +1204,26 @@ saveData(const char* xmlName, const char* xmlValue)
 		}
 		break;
 	}
-	if (sts && verbose)
+	if (initSts != 0)
+	{
+		// An init value that is not used would otherwise be dropped without a word
+		if (parse_state == PARSE_STATE_SCENE && new_scene)
+		{
+			snprintf(parseError, STR_SIZE, "ERROR: In Scene %d, init %s/%s \"%s\" %s\n", new_scene->id,
+				xmlLevels[xml_current_level - 1].name, xmlLevels[xml_current_level].name, value,
+				initSts == 1 ? "is not a known element" : "is not a valid value");
+		}
+		else
+		{
+			snprintf(parseError, STR_SIZE, "ERROR: In the scenario init, %s/%s \"%s\" %s\n",
+				xmlLevels[xml_current_level - 1].name, xmlLevels[xml_current_level].name, value,
+				initSts == 1 ? "is not a known element" : "is not a valid value");
+		}
+		printf("%s", parseError);
+		appendToParseLog(parseError);
+		errCount++;
+	}
+	else if (sts && verbose)
 	{
 		printf("saveData STS %d: Lvl %d: %s, Value  %s, \n", sts, xml_current_level, xmlLevels[xml_current_level].name, value);
 	}
@@ -944,7 +1238,7 @@ saveData(const char* xmlName, const char* xmlValue)
 */
 
 static void
-startParseState(int lvl, char* name)
+startParseState(int lvl, const char* name)
 {
 	if (!name)
 	{
@@ -979,16 +1273,17 @@ startParseState(int lvl, char* name)
 	case 1:	// profile, media, events have no action
 		if (strcmp(name, "init") == 0)
 		{
+			beginParams(&scenario->initParams);
 			parse_state = PARSE_STATE_INIT;
 		}
 		else if ((strcmp(name, "scene") == 0) || (strcmp(name, "initial_scene") == 0))
 		{
 			// Allocate a scene
-			new_scene = (struct scenario_scene*)calloc(1, sizeof(struct scenario_scene));
+			new_scene = (struct scenario_scene*)arena_alloc(&scenarioArena, sizeof(struct scenario_scene));
 			if (new_scene)
 			{
-				initializeParameterStruct(&new_scene->initParams);
-				insert_llist(&new_scene->scene_list, &scenario->scene_list);
+				beginParams(&new_scene->initParams);
+				append_llist(&new_scene->scene_list, &scenario->scene_list, &scenario->scene_tail);
 				parse_state = PARSE_STATE_SCENE;
 				if (verbose)
 				{
@@ -1152,10 +1447,10 @@ startParseState(int lvl, char* name)
 				if (strcmp(name, "trigger_group") == 0)
 				{
 					printf("PARSE_SCENE_STATE_TRIG_GROUP\n");
-					new_trigger_group = (struct trigger_group*)calloc(1, sizeof(struct trigger_group));
+					new_trigger_group = (struct trigger_group*)arena_alloc(&scenarioArena, sizeof(struct trigger_group));
 					if (new_trigger_group)
 					{
-						insert_llist(&new_trigger_group->group_list, &new_scene->group_list);
+						append_llist(&new_trigger_group->group_list, &new_scene->group_list, &new_scene->group_tail);
 						if (verbose)
 						{
 							printf("\n***** New Trigger Group started ******\n");
@@ -1165,10 +1460,10 @@ startParseState(int lvl, char* name)
 				}
 				else if (strcmp(name, "trigger") == 0)
 				{
-					new_trigger = (struct scenario_trigger*)calloc(1, sizeof(struct scenario_trigger));
+					new_trigger = (struct scenario_trigger*)arena_alloc(&scenarioArena, sizeof(struct scenario_trigger));
 					if (new_trigger)
 					{
-						insert_llist(&new_trigger->trigger_list, &new_scene->trigger_list);
+						append_llist(&new_trigger->trigger_list, &new_scene->trigger_list, &new_scene->trigger_tail);
 
 						parse_scene_state = PARSE_SCENE_STATE_TRIG;
 						if (verbose)
@@ -1191,10 +1486,10 @@ startParseState(int lvl, char* name)
 				{
 					printf("New Event %s : %s\n", current_event_catagory, current_event_title);
 				}
-				new_event = (struct scenario_event*)calloc(1, sizeof(struct scenario_event));
+				new_event = (struct scenario_event*)arena_alloc(&scenarioArena, sizeof(struct scenario_event));
 				if (new_event)
 				{
-					insert_llist(&new_event->event_list, &scenario->event_list);
+					append_llist(&new_event->event_list, &scenario->event_list, &scenario->event_tail);
 
 					sprintf_s(new_event->event_catagory_name, NORMAL_STRING_SIZE, "%s", current_event_catagory);
 					sprintf_s(new_event->event_catagory_title, NORMAL_STRING_SIZE, "%s", current_event_title);
@@ -1222,14 +1517,14 @@ startParseState(int lvl, char* name)
 		switch (parse_state)
 		{
 			case PARSE_STATE_SCENE:
-				if (parse_scene_state == PARSE_SCENE_STATE_TRIG_GROUP)
+				if (parse_scene_state == PARSE_SCENE_STATE_TRIG_GROUP && new_trigger_group)
 				{
 					if (strcmp(name, "trigger") == 0)
 					{
-						new_trigger = (struct scenario_trigger*)calloc(1, sizeof(struct scenario_trigger));
+						new_trigger = (struct scenario_trigger*)arena_alloc(&scenarioArena, sizeof(struct scenario_trigger));
 						if (new_trigger)
 						{
-							insert_llist(&new_trigger->trigger_list, &new_trigger_group->group_trigger_list);
+							append_llist(&new_trigger->trigger_list, &new_trigger_group->group_trigger_list, &new_trigger_group->group_trigger_tail);
 
 							parse_scene_state = PARSE_SCENE_STATE_TRIG_GROUP_TRIG;
 							if (verbose)
@@ -1346,28 +1641,29 @@ void
 processNode(void)
 {
 	int lvl;
-	char* name;
+	const char* name;
 	char* value;
 
-	name = &xmlr.name[0];
-	value = &xmlr.value[0];
+	// The reader terminates both in place, in its own buffer
+	name = xmlr.name.data() ? xmlr.name.data() : "";
+	value = xmlr.value.data() ? (char*)xmlr.value.data() : NULL;
 
 	switch (xmlr.type)
 	{
 	case XML_TYPE_ELEMENT:
 		xml_current_level = xmlr.depth;
 		xmlLevels[xml_current_level].num = xml_current_level;
-		if (strlen(name) >= PARAMETER_NAME_LENGTH)
+		if (xmlr.name.size() >= PARAMETER_NAME_LENGTH)
 		{
 			fprintf(stderr, "XML Parse Error: %s: Name %s exceeds Max Length of %d\n",
 				xml_filename, name, PARAMETER_NAME_LENGTH - 1);
 		}
 		else
 		{
-			sprintf_s(xmlLevels[xml_current_level].name, 128, "%s", name);
+			xmlLevels[xml_current_level].name = name;
 		}
 		// printf("Start %d %s\n", xml_current_level, name );
-		startParseState(xml_current_level, (char*)name);
+		startParseState(xml_current_level, name);
 		break;
 
 	case XML_TYPE_TEXT:
@@ -1418,33 +1714,167 @@ processNode(void)
 	}
 }
 
+/**
+ * resetParseState:
+ *
+ * Start this thread's parser afresh
+ */
+void
+resetParseState(void)
+{
+	int lvl;
+
+	for (lvl = 0; lvl < XML_MAX_DEPTH; lvl++)
+	{
+		xmlLevels[lvl].num = lvl;
+		xmlLevels[lvl].name = "";
+	}
+	xml_current_level = 0;
+	current_scene_id = -1;
+	line_number = 0;
+
+	parse_state = PARSE_STATE_NONE;
+	parse_init_state = PARSE_INIT_STATE_NONE;
+	parse_scene_state = PARSE_SCENE_STATE_NONE;
+	parse_header_state = PARSE_HEADER_STATE_NONE;
+
+	// These point into the last scenario's arena
+	new_scene = NULL;
+	new_trigger = NULL;
+	new_trigger_group = NULL;
+	new_event = NULL;
+
+	parseParamsOwner = NULL;
+	parseError[0] = 0;
+	errCount = 0;
+	parseLog.clear();
+}
+
+/**
+ * parseDocument:
+ * @filename: the document open in xmlr
+ *
+ * Process every node of the document, then close it.
+ */
+static int
+parseDocument(const char* filename)
+{
+	int sts;
+
+	xml_filename = filename;
+	parseParamsOwner = NULL;
+	while ((sts = xmlr.getEntry()) == 0)
+	{
+		processNode();
+	}
+	if (sts < 0)
+	{
+		printf("XML error in \"%s\" at line %d: %s\n", filename, xmlr.errorLine(), xmlr.error);
+		snprintf(parseError, STR_SIZE, "XML error at line %d: %s\n", xmlr.errorLine(), xmlr.error);
+		errCount++;
+	}
+	// Let go of main.xml now, so it can be edited while the scenario runs
+	xmlr.close();
+	xml_filename = NULL;
+	endParams();
+	(void)compileTriggers();
+	return (0);
+}
+
+/**
+ * parseScenarioFile:
+ * @filename: the main.xml to parse
+ *
+ * Run the XML parser into this thread's scenario. Errors in the content are counted
+ * in errCount. Returns 0, or -1 if the file could not be read.
+ */
+int
+parseScenarioFile(const char* filename)
+{
+	if (xmlr.open(filename))
+	{
+		printf("Failure on read of XML File \"%s\"\n", filename);
+		snprintf(parseError, STR_SIZE, "Failure on read of XML File \"%s\"\n", filename);
+		return (-1);
+	}
+	return (parseDocument(filename));
+}
+
+/**
+ * parseScenarioMemory:
+ * @data: the text of a main.xml
+ * @size: its length in bytes
+ * @name: what to call it in messages
+ *
+ * As parseScenarioFile, for a document already in memory: the fuzzer and the benchmark.
+ */
+int
+parseScenarioMemory(const char* data, size_t size, const char* name)
+{
+	if (xmlr.openMemory(data, size))
+	{
+		snprintf(parseError, STR_SIZE, "Failure on read of XML document \"%s\"\n", name);
+		return (-1);
+	}
+	return (parseDocument(name));
+}
+
 /**
  * readScenario:
  * @filename: the file name to parse
  *
- * Parse the scenario
+ * Read the scenario. A preloaded image or a current main.cache is used in preference
+ * to parsing the XML.
  */
 
 int
 readScenario(const char* name)
 {
-	int sts;
+	int sts = 0;
 	char filename[1400];
 	extern char sessionsPath[];
+	int startErrors = errCount;
+	const char* from;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
 
 	sprintf_s(sessionsPath, 1088, "%s\\scenarios", localConfig.html_path);
 	sprintf_s(filename, 1400, "%s\\%s\\main.xml", sessionsPath, name);
-	sts = xmlr.open(filename);
-	if (sts)
+	if (!checkOnly && bindPreloadedScenario(name, filename) == 0)
 	{
-		printf("Failure on read of XML File \"%s\"\n", filename);
-		snprintf(simmgr_shm->status.scenario.error_message, STR_SIZE, "Failure on read of XML File \"%s\"\n", filename);
-		return (-1);
+		from = "preload";
+		(void)compileTriggers();
 	}
-	while (xmlr.getEntry() == 0)
+	else if (!checkOnly && loadScenarioCache(filename) == 0)
 	{
-		processNode();
+		from = "main.cache";
+		(void)compileTriggers();
 	}
+	else
+	{
+		from = "main.xml";
+		sts = parseScenarioFile(filename);
+		if (parseError[0])
+		{
+			sprintf_s(simmgr_shm->status.scenario.error_message, STR_SIZE, "%s", parseError);
+			statusMarkDirty(STATUS_SEC_SCENARIO);
+		}
+		if (sts)
+		{
+			return (-1);
+		}
 
+		// Only a clean parse is kept, so a cached scenario never skips an error report
+		if (!checkOnly && errCount == startErrors)
+		{
+			(void)saveScenarioCache(filename);
+		}
+	}
+	if (current_scene_id != -1)
+	{
+		simmgr_shm->status.scenario.scene_id = current_scene_id;
+		statusMarkDirty(STATUS_SEC_SCENARIO);
+	}
+	printf("Scenario read from %s in %lld usec\n", from,
+		(long long)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count());
 	return (0);
-}
\ No newline at end of file
+}
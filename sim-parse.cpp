@@ -23,554 +23,514 @@
 #include "vetsim.h"
 
 #include "scenario.h"
+#include <string_view>
+#include <charconv>
+#include <climits>
 
-int
-cardiac_parse(const char* elem, const char* value, struct cardiac* card)
+using namespace std;
+
+/*
+ * Instructor fields set by name, from a scenario init section or a set: command.
+ *
+ * Each element a class accepts is one entry in setFields. The entries are found through
+ * a perfect hash that buildSetHash computes from the table when this file is compiled,
+ * so a lookup is one hash, one probe and one compare, whatever the element. Numbers are
+ * parsed with from_chars and checked against the range in the table; -1 is always
+ * accepted, as it is the "not set" value simmgr skips.
+ */
+#define SET_CARDIAC		0
+#define SET_RESPIRATION	1
+#define SET_GENERAL		2
+#define SET_TELESIM		3
+#define SET_VOCALS		4
+#define SET_MEDIA		5
+#define SET_CPR			6
+
+static constexpr struct setClass
 {
-	int sts = 0;
+	string_view name;
+	size_t offset;		// Of the class in struct instructor
+} setClasses[] =
+{
+	{ "cardiac", offsetof(struct instructor, cardiac) },
+	{ "respiration", offsetof(struct instructor, respiration) },
+	{ "general", offsetof(struct instructor, general) },
+	{ "telesim", offsetof(struct instructor, telesim) },
+	{ "vocals", offsetof(struct instructor, vocals) },
+	{ "media", offsetof(struct instructor, media) },
+	{ "cpr", offsetof(struct instructor, cpr) },
+};
 
-	if ((!elem) || (!value) || (!card))
-	{
-		return (-11);
-	}
-	if (strcmp(elem, ("rhythm")) == 0)
-	{
-		sprintf_s(card->rhythm, STR_SIZE, "%s", value);
-	}
-	else if (strcmp(elem, ("vpc")) == 0)
-	{
-		sprintf_s(card->vpc, STR_SIZE, "%s", value);
-	}
-	else if (strcmp(elem, ("pea")) == 0)
-	{
-		card->pea = atoi(value);
-	}
-	else if (strcmp(elem, ("vpc_freq")) == 0)
-	{
-		card->vpc_freq = atoi(value);
-	}
-	else if (strcmp(elem, ("vpc_delay")) == 0)
-	{
-		card->vpc_delay = atoi(value);
-	}
-	else if (strcmp(elem, ("vfib_amplitude")) == 0)
-	{
-		sprintf_s(card->vfib_amplitude, STR_SIZE, "%s", value);
-	}
-	else if (strcmp(elem, ("pwave")) == 0)
-	{
-		sprintf_s(card->pwave, STR_SIZE, "%s", value);
-	}
-	else if (strcmp(elem, ("rate")) == 0)
-	{
-		card->rate = atoi(value);
-	}
-	else if (strcmp(elem, ("transfer_time")) == 0)
-	{
-		card->transfer_time = atoi(value);
-	}
-	else if (strcmp(elem, ("pr_interval")) == 0)
-	{
-		card->pr_interval = atoi(value);
-	}
-	else if (strcmp(elem, ("qrs_interval")) == 0)
-	{
-		card->qrs_interval = atoi(value);
-	}
-	else if (strcmp(elem, ("bps_sys")) == 0)
-	{
-		card->bps_sys = atoi(value);
-	}
-	else if (strcmp(elem, ("bps_dia")) == 0)
-	{
-		card->bps_dia = atoi(value);
-	}
-	else if (strcmp(elem, ("nibp_rate")) == 0)
-	{
-		card->nibp_rate = atoi(value);
-	}
-	else if (strcmp(elem, "nibp_read") == 0)
+#define SET_INT			0	// Integer, min to max
+#define SET_STRING		1	// Text, truncated to the field
+#define SET_PULSE		2	// none, weak, medium or strong, stored as 0 to 3
+#define SET_UNITS		3	// F or C, from the first letter. Anything else is ignored.
+#define SET_VID_STRING	4	// Telesim window fields. The value is "vidN:arg" or "N:arg".
+#define SET_VID_INT		5
+#define SET_VID_DOUBLE	6
+
+#define SET_LOG			1	// Log each set
+
+#define SET_FIELD(cls, name, type, member, kind, min, max) \
+	{ cls, name, offsetof(struct type, member), sizeof(((struct type*)0)->member), kind, 0, min, max }
+
+static constexpr struct setField
+{
+	int cls;
+	string_view name;
+	size_t offset;		// In the class, or for SET_VID_* in struct telesimVideo
+	size_t size;
+	int kind;
+	int flags;
+	int min;
+	int max;
+} setFields[] =
+{
+	SET_FIELD(SET_CARDIAC, "rhythm", cardiac, rhythm, SET_STRING, 0, 0),
+	SET_FIELD(SET_CARDIAC, "vpc", cardiac, vpc, SET_STRING, 0, 0),
+	SET_FIELD(SET_CARDIAC, "pea", cardiac, pea, SET_INT, 0, 1),
+	SET_FIELD(SET_CARDIAC, "vpc_freq", cardiac, vpc_freq, SET_INT, 0, 100),
+	SET_FIELD(SET_CARDIAC, "vpc_delay", cardiac, vpc_delay, SET_INT, 0, INT_MAX),
+	SET_FIELD(SET_CARDIAC, "vfib_amplitude", cardiac, vfib_amplitude, SET_STRING, 0, 0),
+	SET_FIELD(SET_CARDIAC, "pwave", cardiac, pwave, SET_STRING, 0, 0),
+	SET_FIELD(SET_CARDIAC, "rate", cardiac, rate, SET_INT, 0, 999),
+	SET_FIELD(SET_CARDIAC, "transfer_time", cardiac, transfer_time, SET_INT, 0, INT_MAX),
+	SET_FIELD(SET_CARDIAC, "pr_interval", cardiac, pr_interval, SET_INT, 0, 9999),
+	SET_FIELD(SET_CARDIAC, "qrs_interval", cardiac, qrs_interval, SET_INT, 0, 9999),
+	SET_FIELD(SET_CARDIAC, "bps_sys", cardiac, bps_sys, SET_INT, 0, 500),
+	SET_FIELD(SET_CARDIAC, "bps_dia", cardiac, bps_dia, SET_INT, 0, 500),
+	SET_FIELD(SET_CARDIAC, "nibp_rate", cardiac, nibp_rate, SET_INT, 0, 999),
+	SET_FIELD(SET_CARDIAC, "nibp_read", cardiac, nibp_read, SET_INT, 0, 1),
+	SET_FIELD(SET_CARDIAC, "nibp_linked_hr", cardiac, nibp_linked_hr, SET_INT, 0, 1),
+	SET_FIELD(SET_CARDIAC, "nibp_freq", cardiac, nibp_freq, SET_INT, 0, 1440),
+	SET_FIELD(SET_CARDIAC, "ecg_indicator", cardiac, ecg_indicator, SET_INT, 0, 1),
+	SET_FIELD(SET_CARDIAC, "bp_cuff", cardiac, bp_cuff, SET_INT, 0, 1),
+	SET_FIELD(SET_CARDIAC, "heart_sound", cardiac, heart_sound, SET_STRING, 0, 0),
+	SET_FIELD(SET_CARDIAC, "heart_sound_volume", cardiac, heart_sound_volume, SET_INT, 0, 100),
+	SET_FIELD(SET_CARDIAC, "heart_sound_mute", cardiac, heart_sound_mute, SET_INT, 0, 1),
+	SET_FIELD(SET_CARDIAC, "right_dorsal_pulse_strength", cardiac, right_dorsal_pulse_strength, SET_PULSE, 0, 3),
+	SET_FIELD(SET_CARDIAC, "left_dorsal_pulse_strength", cardiac, left_dorsal_pulse_strength, SET_PULSE, 0, 3),
+	SET_FIELD(SET_CARDIAC, "right_femoral_pulse_strength", cardiac, right_femoral_pulse_strength, SET_PULSE, 0, 3),
+	SET_FIELD(SET_CARDIAC, "left_femoral_pulse_strength", cardiac, left_femoral_pulse_strength, SET_PULSE, 0, 3),
+	SET_FIELD(SET_CARDIAC, "arrest", cardiac, arrest, SET_INT, 0, 1),
+
+	// inhalation_duration and exhalation_duration are set by simmgr, not the instructor
+	SET_FIELD(SET_RESPIRATION, "left_lung_sound", respiration, left_lung_sound, SET_STRING, 0, 0),
+	SET_FIELD(SET_RESPIRATION, "right_lung_sound", respiration, right_lung_sound, SET_STRING, 0, 0),
+	SET_FIELD(SET_RESPIRATION, "left_lung_sound_volume", respiration, left_lung_sound_volume, SET_INT, 0, 100),
+	SET_FIELD(SET_RESPIRATION, "left_lung_sound_mute", respiration, left_lung_sound_mute, SET_INT, 0, 1),
+	SET_FIELD(SET_RESPIRATION, "right_lung_sound_volume", respiration, right_lung_sound_volume, SET_INT, 0, 100),
+	SET_FIELD(SET_RESPIRATION, "right_lung_sound_mute", respiration, right_lung_sound_mute, SET_INT, 0, 1),
+	SET_FIELD(SET_RESPIRATION, "rate", respiration, rate, SET_INT, 0, 999),
+	SET_FIELD(SET_RESPIRATION, "spo2", respiration, spo2, SET_INT, 0, 100),
+	SET_FIELD(SET_RESPIRATION, "etco2", respiration, etco2, SET_INT, 0, 999),
+	SET_FIELD(SET_RESPIRATION, "transfer_time", respiration, transfer_time, SET_INT, 0, INT_MAX),
+	SET_FIELD(SET_RESPIRATION, "etco2_indicator", respiration, etco2_indicator, SET_INT, 0, 1),
+	SET_FIELD(SET_RESPIRATION, "spo2_indicator", respiration, spo2_indicator, SET_INT, 0, 1),
+	SET_FIELD(SET_RESPIRATION, "chest_movement", respiration, chest_movement, SET_INT, 0, 1),
+	SET_FIELD(SET_RESPIRATION, "manual_count", respiration, manual_count, SET_INT, 0, INT_MAX),
+	{ SET_RESPIRATION, "manual_breath", offsetof(struct respiration, manual_breath),
+		sizeof(((struct respiration*)0)->manual_breath), SET_INT, SET_LOG, 0, INT_MAX },
+
+	SET_FIELD(SET_GENERAL, "temperature_enable", general, temperature_enable, SET_INT, 0, 1),
+	SET_FIELD(SET_GENERAL, "temperature_units", general, temperature_units, SET_UNITS, 0, 0),
+	SET_FIELD(SET_GENERAL, "temperature", general, temperature, SET_INT, 0, 2000),	// degrees * 10
+	SET_FIELD(SET_GENERAL, "transfer_time", general, transfer_time, SET_INT, 0, INT_MAX),
+	SET_FIELD(SET_GENERAL, "clock_start", general, clockStart, SET_STRING, 0, 0),
+
+	SET_FIELD(SET_TELESIM, "enable", telesim, enable, SET_INT, 0, 1),
+	SET_FIELD(SET_TELESIM, "name", telesimVideo, name, SET_VID_STRING, 0, 0),
+	SET_FIELD(SET_TELESIM, "command", telesimVideo, command, SET_VID_INT, INT_MIN, INT_MAX),
+	SET_FIELD(SET_TELESIM, "param", telesimVideo, param, SET_VID_DOUBLE, 0, 0),
+	SET_FIELD(SET_TELESIM, "next", telesimVideo, next, SET_VID_INT, INT_MIN, INT_MAX),
+
+	SET_FIELD(SET_VOCALS, "filename", vocals, filename, SET_STRING, 0, 0),
+	SET_FIELD(SET_VOCALS, "repeat", vocals, repeat, SET_INT, 0, INT_MAX),
+	SET_FIELD(SET_VOCALS, "volume", vocals, volume, SET_INT, 0, 100),
+	SET_FIELD(SET_VOCALS, "play", vocals, play, SET_INT, 0, 1),
+	SET_FIELD(SET_VOCALS, "mute", vocals, mute, SET_INT, 0, 1),
+
+	SET_FIELD(SET_MEDIA, "filename", media, filename, SET_STRING, 0, 0),
+	SET_FIELD(SET_MEDIA, "play", media, play, SET_INT, 0, 1),
+
+	SET_FIELD(SET_CPR, "duration", cpr, duration, SET_INT, 0, INT_MAX),
+	SET_FIELD(SET_CPR, "compression", cpr, compression, SET_INT, 0, 100),
+};
+
+#define SET_FIELD_COUNT		(sizeof(setFields) / sizeof(setFields[0]))
+#define SET_HASH_BITS		9
+#define SET_HASH_SIZE		(1 << SET_HASH_BITS)
+#define SET_HASH_SEEDS		100000	// Give up, and fail the build, after this many tries
+
+static_assert(SET_FIELD_COUNT < 255, "setHash slots hold a field index in a byte");
+
+/*
+ * setKey
+ *
+ * The class, the length of the element and its first, middle and last characters.
+ * That is enough to tell the elements in the table apart without reading all of the
+ * name; buildSetHash fails the build if two come to share a key, and findSetField
+ * compares the whole name.
+ */
+static constexpr unsigned long long
+setKey(int cls, string_view elem)
+{
+	size_t length = elem.length();
+
+	if (length == 0)
 	{
-		card->nibp_read = atoi(value);
+		return (0);
 	}
-	else if (strcmp(elem, "nibp_linked_hr") == 0)
+	return (((unsigned long long)cls << 32) | ((unsigned long long)(length & 0xff) << 24) |
+		((unsigned long long)(unsigned char)elem[0] << 16) |
+		((unsigned long long)(unsigned char)elem[length / 2] << 8) |
+		(unsigned long long)(unsigned char)elem[length - 1]);
+}
+
+static constexpr unsigned int
+setSlot(unsigned long long key, unsigned long long seed)
+{
+	return ((unsigned int)(((key ^ (seed * 0x9E3779B97F4A7C15ull)) * 0x9E3779B97F4A7C15ull) >> (64 - SET_HASH_BITS)));
+}
+
+struct setHashTable
+{
+	unsigned int seed;					// 0 if none was found
+	unsigned char slot[SET_HASH_SIZE];	// Index in setFields + 1, or 0 for no field
+};
+
+/*
+ * buildSetHash
+ *
+ * Find a seed that puts every field in a slot of its own. This runs in the compiler;
+ * with the table about an eighth full, a few dozen seeds are usually tried.
+ */
+static constexpr struct setHashTable
+buildSetHash(void)
+{
+	struct setHashTable table = {};
+	unsigned long long keys[SET_FIELD_COUNT] = {};
+	unsigned int used[SET_HASH_SIZE] = {};	// Seed that last used the slot
+	unsigned int seed = 0;
+	size_t i = 0;
+
+	for (i = 0; i < SET_FIELD_COUNT; i++)
 	{
-		card->nibp_linked_hr = atoi(value);
+		keys[i] = setKey(setFields[i].cls, setFields[i].name);
 	}
-	else if (strcmp(elem, "nibp_freq") == 0)
+	for (seed = 1; seed < SET_HASH_SEEDS; seed++)
 	{
-		card->nibp_freq = atoi(value);
+		for (i = 0; i < SET_FIELD_COUNT; i++)
+		{
+			if (used[setSlot(keys[i], seed)] == seed)
+			{
+				break;
+			}
+			used[setSlot(keys[i], seed)] = seed;
+		}
+		if (i == SET_FIELD_COUNT)
+		{
+			table.seed = seed;
+			for (i = 0; i < SET_FIELD_COUNT; i++)
+			{
+				table.slot[setSlot(keys[i], seed)] = (unsigned char)(i + 1);
+			}
+			break;
+		}
 	}
-	else if (strcmp(elem, ("ecg_indicator")) == 0)
+	return (table);
+}
+
+static constexpr struct setHashTable setHash = buildSetHash();
+static_assert(setHash.seed != 0, "No perfect hash for setFields: two elements of a class share a setKey, or SET_HASH_BITS is too small");
+
+/*
+ * findSetField
+ *
+ * Returns the entry for the class and element, or NULL if there is none.
+ */
+static const struct setField*
+findSetField(int cls, string_view elem)
+{
+	int slot = setHash.slot[setSlot(setKey(cls, elem), setHash.seed)];
+	const struct setField* field;
+
+	if (slot == 0)
 	{
-		card->ecg_indicator = atoi(value);
+		return (NULL);
 	}
-	else if (strcmp(elem, ("bp_cuff")) == 0)
+	field = &setFields[slot - 1];
+	if (field->cls != cls || field->name != elem)
 	{
-		card->bp_cuff = atoi(value);
+		return (NULL);
 	}
-	else if (strcmp(elem, ("heart_sound")) == 0)
+	return (field);
+}
+
+/*
+ * setNumber
+ *
+ * Parse a whole value as an integer, allowing surrounding blanks and a leading '+'.
+ * Returns 0, or -1 if it is not a number or does not fit an int.
+ */
+static int
+setNumber(string_view value, int* num)
+{
+	const char* ptr = value.data();
+	const char* end = ptr + value.length();
+	from_chars_result res;
+
+	while (ptr < end && (*ptr == ' ' || *ptr == '\t'))
 	{
-		sprintf_s(card->heart_sound, STR_SIZE, "%s", value);
+		ptr++;
 	}
-	else if (strcmp(elem, ("heart_sound_volume")) == 0)
+	if (ptr < end && *ptr == '+')
 	{
-		card->heart_sound_volume = atoi(value);
+		ptr++;
 	}
-	else if (strcmp(elem, ("heart_sound_mute")) == 0)
+	res = from_chars(ptr, end, *num);
+	if (res.ec != errc() || res.ptr == ptr)
 	{
-		card->heart_sound_mute = atoi(value);
+		return (-1);
 	}
-	else if (strcmp(elem, ("right_dorsal_pulse_strength")) == 0)
+	for (ptr = res.ptr; ptr < end; ptr++)
 	{
-		if ((strcmp(value, "none")) == 0)
-		{
-			card->right_dorsal_pulse_strength = 0;
-		}
-		else if ((strcmp(value, "weak")) == 0)
-		{
-			card->right_dorsal_pulse_strength = 1;
-		}
-		else if ((strcmp(value, "medium")) == 0)
+		if (*ptr != ' ' && *ptr != '\t' && *ptr != '\r' && *ptr != '\n')
 		{
-			card->right_dorsal_pulse_strength = 2;
-		}
-		else if ((strcmp(value, "strong")) == 0)
-		{
-			card->right_dorsal_pulse_strength = 3;
-		}
-		else
-		{
-			sts = 3;
+			return (-1);
 		}
 	}
-	else if (strcmp(elem, ("left_dorsal_pulse_strength")) == 0)
+	return (0);
+}
+
+static void
+setString(char* dst, size_t size, string_view value)
+{
+	size_t length = value.length() < size - 1 ? value.length() : size - 1;
+
+	memcpy(dst, value.data(), length);
+	dst[length] = 0;
+}
+
+/*
+ * applySetField
+ * @field: entry from setFields
+ * @value: text of the value
+ * @base: the class structure in a struct instructor
+ *
+ * Returns 0, or 3 if the value is not valid for the field.
+ */
+static int
+applySetField(const struct setField* field, string_view value, char* base)
+{
+	static constexpr string_view strengths[] = { "none", "weak", "medium", "strong" };
+	char* ptr = base + field->offset;
+	char buf[STR_SIZE * 2];
+	size_t colon;
+	double dbl;
+	long long wide;
+	int index;
+	int num;
+
+	if (field->kind >= SET_VID_STRING)
 	{
-		if ((strcmp(value, "none")) == 0)
-		{
-			card->left_dorsal_pulse_strength = 0;
-		}
-		else if ((strcmp(value, "weak")) == 0)
+		// The window is named in the value, as "vidN:arg" or "N:arg"
+		if (value.substr(0, 3) == "vid")
 		{
-			card->left_dorsal_pulse_strength = 1;
+			value.remove_prefix(3);
 		}
-		else if ((strcmp(value, "medium")) == 0)
+		colon = value.find(':');
+		if (colon == string_view::npos || setNumber(value.substr(0, colon), &index) != 0 ||
+			index < 0 || index >= TSIM_WINDOWS)
 		{
-			card->left_dorsal_pulse_strength = 2;
-		}
-		else if ((strcmp(value, "strong")) == 0)
-		{
-			card->left_dorsal_pulse_strength = 3;
-		}
-		else
-		{
-			sts = 3;
+			return (3);
 		}
+		value.remove_prefix(colon + 1);
+		ptr = (char*)&((struct telesim*)base)->vid[index] + field->offset;
 	}
-	else if (strcmp(elem, ("right_femoral_pulse_strength")) == 0)
+
+	switch (field->kind)
 	{
-		if ((strcmp(value, "none")) == 0)
-		{
-			card->right_femoral_pulse_strength = 0;
-		}
-		else if ((strcmp(value, "weak")) == 0)
-		{
-			card->right_femoral_pulse_strength = 1;
-		}
-		else if ((strcmp(value, "medium")) == 0)
+	case SET_STRING:
+	case SET_VID_STRING:
+		setString(ptr, field->size, value);
+		return (0);
+
+	case SET_PULSE:
+		for (num = 0; num < (int)(sizeof(strengths) / sizeof(strengths[0])); num++)
 		{
-			card->right_femoral_pulse_strength = 2;
+			if (value == strengths[num])
+			{
+				*(int*)ptr = num;
+				return (0);
+			}
 		}
-		else if ((strcmp(value, "strong")) == 0)
+		return (3);
+
+	case SET_UNITS:
+		if (!value.empty() && (value[0] == 'F' || value[0] == 'f' || value[0] == 'C' || value[0] == 'c'))
 		{
-			card->right_femoral_pulse_strength = 3;
+			ptr[0] = (char)toupper((unsigned char)value[0]);
+			ptr[1] = 0;
 		}
-		else
+		return (0);
+
+	case SET_VID_DOUBLE:
+		while (!value.empty() && (value.front() == ' ' || value.front() == '+'))
 		{
-			sts = 3;
+			value.remove_prefix(1);
 		}
-	}
-	else if (strcmp(elem, ("left_femoral_pulse_strength")) == 0)
-	{
-		if ((strcmp(value, "none")) == 0)
+		if (from_chars(value.data(), value.data() + value.length(), dbl).ec != errc())
 		{
-			card->left_femoral_pulse_strength = 0;
+			return (3);
 		}
-		else if ((strcmp(value, "weak")) == 0)
+		*(double*)ptr = dbl;
+		return (0);
+
+	case SET_INT:
+	case SET_VID_INT:
+		if (setNumber(value, &num) != 0 || (num != -1 && (num < field->min || num > field->max)))
 		{
-			card->left_femoral_pulse_strength = 1;
+			return (3);
 		}
-		else if ((strcmp(value, "medium")) == 0)
+		if (field->flags & SET_LOG)
 		{
-			card->left_femoral_pulse_strength = 2;
+			sprintf_s(buf, sizeof(buf), "%.*s %d", (int)field->name.length(), field->name.data(), num);
+			log_message("", buf);
 		}
-		else if ((strcmp(value, "strong")) == 0)
+		// pr_interval and qrs_interval are long, which is wider than int outside Windows
+		if (field->size == sizeof(long long))
 		{
-			card->left_femoral_pulse_strength = 3;
+			wide = num;
+			memcpy(ptr, &wide, sizeof(wide));
 		}
 		else
 		{
-			sts = 3;
+			memcpy(ptr, &num, sizeof(num));
 		}
+		return (0);
 	}
-	else if (strcmp(elem, ("arrest")) == 0)
-	{
-		card->arrest = atoi(value);
-	}
-	else
-	{
-		sts = 1;
-	}
-	return (sts);
+	return (3);
 }
 
+/*
+ * paramSet
+ * @cls: class name, as cardiac
+ * @elem: element name, as rate
+ * @value: text of the value
+ * @inst: instructor area to set
+ *
+ * Used for set: commands and, through the *_parse functions, for init sections.
+ * Returns 0, 1 for an unknown element, 2 for an unknown class, or 3 for an invalid value.
+ */
 int
-respiration_parse(const char* elem, const char* value, struct respiration* resp)
+paramSet(string_view cls, string_view elem, string_view value, struct instructor* inst)
 {
-	int sts = 0;
+	const struct setField* field;
+	int i;
 
-	if ((!elem) || (!value) || (!resp))
-	{
-		return (-12);
-	}
-	if (strcmp(elem, "left_lung_sound") == 0)
-	{
-		sprintf_s(resp->left_lung_sound, STR_SIZE, "%s", value);
-	}
-	else if (strcmp(elem, "right_lung_sound") == 0)
-	{
-		sprintf_s(resp->right_lung_sound, STR_SIZE, "%s", value);
-	}
-	/* These are set by sim-mgr, not instructor
-	else if ( strcmp(elem, "inhalation_duration" ) == 0 )
-	{
-		resp->inhalation_duration = atoi(value );
-	}
-	else if ( strcmp(elem, "exhalation_duration" ) == 0 )
-	{
-		resp->exhalation_duration = atoi(value );
-	}
-	*/
-	else if (strcmp(elem, "left_lung_sound_volume") == 0)
+	for (i = 0; i < (int)(sizeof(setClasses) / sizeof(setClasses[0])); i++)
 	{
-		resp->left_lung_sound_volume = atoi(value);
-	}
-	else if (strcmp(elem, "left_lung_sound_mute") == 0)
-	{
-		resp->left_lung_sound_mute = atoi(value);
-	}
-	else if (strcmp(elem, "right_lung_sound_volume") == 0)
-	{
-		resp->right_lung_sound_volume = atoi(value);
-	}
-	else if (strcmp(elem, "right_lung_sound_volume") == 0)
-	{
-		resp->right_lung_sound_volume = atoi(value);
-	}
-	else if (strcmp(elem, "right_lung_sound_mute") == 0)
-	{
-		resp->right_lung_sound_mute = atoi(value);
-	}
-	else if (strcmp(elem, "rate") == 0)
-	{
-		resp->rate = atoi(value);
-	}
-	else if (strcmp(elem, "spo2") == 0)
-	{
-		resp->spo2 = atoi(value);
-	}
-	else if (strcmp(elem, "etco2") == 0)
-	{
-		resp->etco2 = atoi(value);
-	}
-	else if (strcmp(elem, "transfer_time") == 0)
-	{
-		resp->transfer_time = atoi(value);
-	}
-	else if (strcmp(elem, "etco2_indicator") == 0)
-	{
-		resp->etco2_indicator = atoi(value);
-	}
-	else if (strcmp(elem, "spo2_indicator") == 0)
-	{
-		resp->spo2_indicator = atoi(value);
-	}
-	else if (strcmp(elem, "chest_movement") == 0)
-	{
-		resp->chest_movement = atoi(value);
-	}
-	else if (strcmp(elem, "manual_count") == 0)
-	{
-		resp->manual_count = atoi(value);
-	}
-	else if (strcmp(elem, "manual_breath") == 0)
-	{
-		char buf[512];
-		sprintf_s(buf, 512, "%s %s %s", "manual_breath", elem, value);
-		log_message("", buf);
-		resp->manual_breath = atoi(value);
+		if (setClasses[i].name == cls)
+		{
+			field = findSetField(i, elem);
+			if (!field)
+			{
+				return (1);
+			}
+			return (applySetField(field, value, (char*)inst + setClasses[i].offset));
+		}
 	}
-	else
+	return (2);
+}
+
+/*
+ * classParse
+ *
+ * Common part of the *_parse functions, which set one class structure.
+ */
+static int
+classParse(int cls, const char* elem, const char* value, void* base)
+{
+	const struct setField* field = findSetField(cls, elem);
+
+	if (!field)
 	{
-		sts = 1;
+		return (1);
 	}
-	return (sts);
+	return (applySetField(field, value, (char*)base));
 }
+
 int
-getVidIndex(const char* value)
+cardiac_parse(const char* elem, const char* value, struct cardiac* card)
 {
-	if (isdigit((int)value[0]))
+	if ((!elem) || (!value) || (!card))
 	{
-		return (atoi(value));
+		return (-11);
 	}
-	else if (strncmp("vid", value, 3) == 0)
+	return (classParse(SET_CARDIAC, elem, value, card));
+}
+
+int
+respiration_parse(const char* elem, const char* value, struct respiration* resp)
+{
+	if ((!elem) || (!value) || (!resp))
 	{
-		return (atoi(&value[3]));
+		return (-12);
 	}
-	return (-1);
+	return (classParse(SET_RESPIRATION, elem, value, resp));
 }
 
 int
 telesim_parse(const char* elem, const char* value, struct telesim* ts)
 {
-	int sts = 0;
-	int index;
-	const char* ptr;
-	const char* arg;
-
-	//char buf[512];
-	//sprintf_s(buf, 512, "%s %s %s", "telesim", elem, value);
-	//log_message("", buf);
-
 	if ((!elem) || (!value) || (!ts))
 	{
 		return (-13);
 	}
-
-	if (strncmp(elem, "enable", 6) == 0)
-	{
-		ts->enable = atoi(value);
-	}
-	else if (strncmp(elem, "name", 4) == 0)
-	{
-		index = getVidIndex(value);
-		ptr = strchr(value, ':');
-		if (index < 0)
-		{
-			sts = 1;
-		}
-		else if (index > TSIM_WINDOWS)
-		{
-			sts = 1;
-		}
-		else if (ptr[0] != ':')
-		{
-			sts = 1;
-		}
-		else
-		{
-			arg = &ptr[1];
-			snprintf(ts->vid[index].name, STR_SIZE, "%s", arg);
-		}
-	}
-	else if (strncmp(elem, "command", 7) == 0)
-	{
-		index = getVidIndex(value);
-		ptr = strchr(value, ':');
-		if (index < 0)
-		{
-			sts = 1;
-		}
-		else if (index > TSIM_WINDOWS)
-		{
-			sts = 1;
-		}
-		else if (ptr[0] != ':')
-		{
-			sts = 1;
-		}
-		else
-		{
-			arg = &ptr[1];
-			ts->vid[index].command = atoi(arg);
-			//ts->vid[index].next = rand();
-		}
-	}
-	else if (strncmp(elem, "param", 5) == 0)
-	{
-		index = getVidIndex(value);
-		ptr = strchr(value, ':');
-		if (index < 0)
-		{
-			sts = 1;
-		}
-		else if (index > TSIM_WINDOWS)
-		{
-			sts = 1;
-		}
-		else if (ptr[0] != ':')
-		{
-			sts = 1;
-		}
-		else
-		{
-			arg = &ptr[1];
-			ts->vid[index].param = atof(arg);
-		}
-	}
-	else if (strncmp(elem, "next", 4) == 0)
-	{
-		index = getVidIndex(value);
-		ptr = strchr(value, ':');
-		if (index < 0)
-		{
-			sts = 1;
-		}
-		else if (index > TSIM_WINDOWS)
-		{
-			sts = 1;
-		}
-		else if (ptr[0] != ':')
-		{
-			sts = 1;
-		}
-		else
-		{
-			arg = &ptr[1];
-			ts->vid[index].next = atoi(arg);
-		}
-	}
-	else
-	{
-	}
-	return (sts);
+	return (classParse(SET_TELESIM, elem, value, ts));
 }
+
 int
 general_parse(const char* elem, const char* value, struct general* gen)
 {
-	int sts = 0;
-
 	if ((!elem) || (!value) || (!gen))
 	{
 		return (-13);
 	}
-	if (strcmp(elem, "temperature_enable") == 0)
-	{
-		gen->temperature_enable = atoi(value);
-	}
-	else if (strcmp(elem, "temperature_units") == 0)
-	{
-		if (value[0] == 'F' || value[0] == 'f')
-		{
-			gen->temperature_units[0] = 'F';
-			gen->temperature_units[1] = 0;
-		}
-		else if ( value[0] == 'C' || value[0] == 'c')
-		{
-			gen->temperature_units[0] = 'C';
-			gen->temperature_units[1] = 0;
-		}
- 	}
-	else if (strcmp(elem, "temperature") == 0)
-	{
-		gen->temperature = atoi(value);
-	}
-	else if (strcmp(elem, "transfer_time") == 0)
-	{
-		gen->transfer_time = atoi(value);
-	}
-	else if (strcmp(elem, "clock_start") == 0)
-	{
-		sprintf_s(gen->clockStart, 64, "%s", value);
-	}
-	else
-	{
-		sts = 1;
-	}
-	return (sts);
+	return (classParse(SET_GENERAL, elem, value, gen));
 }
 
 int
 vocals_parse(const char* elem, const char* value, struct vocals* voc)
 {
-	int sts = 0;
-
 	if ((!elem) || (!value) || (!voc))
 	{
 		return (-14);
 	}
-	if (strcmp(elem, "filename") == 0)
-	{
-		sprintf_s(voc->filename, FILENAME_SIZE, "%s", value);
-	}
-	else if (strcmp(elem, "repeat") == 0)
-	{
-		voc->repeat = atoi(value);
-	}
-	else if (strcmp(elem, "volume") == 0)
-	{
-		voc->volume = atoi(value);
-	}
-	else if (strcmp(elem, "play") == 0)
-	{
-		voc->play = atoi(value);
-	}
-	else if (strcmp(elem, "mute") == 0)
-	{
-		voc->mute = atoi(value);
-	}
-	else
-	{
-		sts = 1;
-	}
-	return (sts);
+	return (classParse(SET_VOCALS, elem, value, voc));
 }
+
 int
 media_parse(const char* elem, const char* value, struct media* med)
 {
-	int sts = 0;
-
 	if ((!elem) || (!value) || (!med))
 	{
 		return (-14);
 	}
-	if (strcmp(elem, "filename") == 0)
-	{
-		sprintf_s(med->filename, FILENAME_SIZE, "%s", value);
-	}
-	else if (strcmp(elem, "play") == 0)
-	{
-		med->play = atoi(value);
-	}
-	else
-	{
-		sts = 1;
-	}
-	return (sts);
+	return (classParse(SET_MEDIA, elem, value, med));
 }
+
 int
 cpr_parse(const char* elem, const char* value, struct cpr* cpr)
 {
-	int sts = 0;
-
 	if ((!elem) || (!value) || (!cpr))
 	{
 		return (-15);
 	}
-	if (strcmp(elem, "duration") == 0)
-	{
-		cpr->duration = atoi(value);
-	}
-	else if (strcmp(elem, "compression") == 0)
-	{
-		cpr->compression = atoi(value);
-	}
-	else
-	{
-		sts = 1;
-	}
-	return (sts);
+	return (classParse(SET_CPR, elem, value, cpr));
 }
+
 /**
 * initializeParameterStruct
 * @initParams: Pointer to a "struct instructor"
@@ -652,45 +612,405 @@ initializeParameterStruct(struct instructor* initParams)
 	initParams->telesim.vid[1].next = -1;
 }
 
+/*
+ * The instructor fields a scenario or scene can set. A parsed init section is kept as
+ * the list of fields that differ from initializeParameterStruct, so only those are
+ * written to the instructor area when the scene starts.
+ */
+#define PARAM_VALUE		0
+#define PARAM_STRING	1
+
+#define PARAM_FIELD(member, type) \
+	{ offsetof(struct instructor, member), sizeof(((struct instructor*)0)->member), type }
+
+static const struct paramField
+{
+	size_t offset;
+	size_t size;
+	int type;
+} paramFields[] =
+{
+	PARAM_FIELD(cardiac.rhythm, PARAM_STRING),
+	PARAM_FIELD(cardiac.vpc, PARAM_STRING),
+	PARAM_FIELD(cardiac.vpc_freq, PARAM_VALUE),
+	PARAM_FIELD(cardiac.vpc_delay, PARAM_VALUE),
+	PARAM_FIELD(cardiac.vpc_count, PARAM_VALUE),
+	PARAM_FIELD(cardiac.vpc_type, PARAM_VALUE),
+	PARAM_FIELD(cardiac.vfib_amplitude, PARAM_STRING),
+	PARAM_FIELD(cardiac.pea, PARAM_VALUE),
+	PARAM_FIELD(cardiac.rate, PARAM_VALUE),
+	PARAM_FIELD(cardiac.avg_rate, PARAM_VALUE),
+	PARAM_FIELD(cardiac.nibp_rate, PARAM_VALUE),
+	PARAM_FIELD(cardiac.nibp_read, PARAM_VALUE),
+	PARAM_FIELD(cardiac.nibp_linked_hr, PARAM_VALUE),
+	PARAM_FIELD(cardiac.nibp_freq, PARAM_VALUE),
+	PARAM_FIELD(cardiac.transfer_time, PARAM_VALUE),
+	PARAM_FIELD(cardiac.pwave, PARAM_STRING),
+	PARAM_FIELD(cardiac.pr_interval, PARAM_VALUE),
+	PARAM_FIELD(cardiac.qrs_interval, PARAM_VALUE),
+	PARAM_FIELD(cardiac.bps_sys, PARAM_VALUE),
+	PARAM_FIELD(cardiac.bps_dia, PARAM_VALUE),
+	PARAM_FIELD(cardiac.right_dorsal_pulse_strength, PARAM_VALUE),
+	PARAM_FIELD(cardiac.right_femoral_pulse_strength, PARAM_VALUE),
+	PARAM_FIELD(cardiac.left_dorsal_pulse_strength, PARAM_VALUE),
+	PARAM_FIELD(cardiac.left_femoral_pulse_strength, PARAM_VALUE),
+	PARAM_FIELD(cardiac.pulseCount, PARAM_VALUE),
+	PARAM_FIELD(cardiac.pulseCountVpc, PARAM_VALUE),
+	PARAM_FIELD(cardiac.heart_sound, PARAM_STRING),
+	PARAM_FIELD(cardiac.heart_sound_volume, PARAM_VALUE),
+	PARAM_FIELD(cardiac.heart_sound_mute, PARAM_VALUE),
+	PARAM_FIELD(cardiac.ecg_indicator, PARAM_VALUE),
+	PARAM_FIELD(cardiac.bp_cuff, PARAM_VALUE),
+	PARAM_FIELD(cardiac.arrest, PARAM_VALUE),
+	PARAM_FIELD(respiration.left_lung_sound, PARAM_STRING),
+	PARAM_FIELD(respiration.left_sound_in, PARAM_STRING),
+	PARAM_FIELD(respiration.left_sound_out, PARAM_STRING),
+	PARAM_FIELD(respiration.left_sound_back, PARAM_STRING),
+	PARAM_FIELD(respiration.left_lung_sound_volume, PARAM_VALUE),
+	PARAM_FIELD(respiration.left_lung_sound_mute, PARAM_VALUE),
+	PARAM_FIELD(respiration.right_lung_sound, PARAM_STRING),
+	PARAM_FIELD(respiration.right_sound_in, PARAM_STRING),
+	PARAM_FIELD(respiration.right_sound_out, PARAM_STRING),
+	PARAM_FIELD(respiration.right_sound_back, PARAM_STRING),
+	PARAM_FIELD(respiration.right_lung_sound_volume, PARAM_VALUE),
+	PARAM_FIELD(respiration.right_lung_sound_mute, PARAM_VALUE),
+	PARAM_FIELD(respiration.inhalation_duration, PARAM_VALUE),
+	PARAM_FIELD(respiration.exhalation_duration, PARAM_VALUE),
+	PARAM_FIELD(respiration.spo2, PARAM_VALUE),
+	PARAM_FIELD(respiration.rate, PARAM_VALUE),
+	PARAM_FIELD(respiration.awRR, PARAM_VALUE),
+	PARAM_FIELD(respiration.etco2, PARAM_VALUE),
+	PARAM_FIELD(respiration.transfer_time, PARAM_VALUE),
+	PARAM_FIELD(respiration.etco2_indicator, PARAM_VALUE),
+	PARAM_FIELD(respiration.spo2_indicator, PARAM_VALUE),
+	PARAM_FIELD(respiration.chest_movement, PARAM_VALUE),
+	PARAM_FIELD(respiration.manual_breath, PARAM_VALUE),
+	PARAM_FIELD(respiration.manual_count, PARAM_VALUE),
+	PARAM_FIELD(respiration.breathCount, PARAM_VALUE),
+	PARAM_FIELD(general.temperature, PARAM_VALUE),
+	PARAM_FIELD(general.transfer_time, PARAM_VALUE),
+	PARAM_FIELD(general.temperature_enable, PARAM_VALUE),
+	PARAM_FIELD(general.temperature_units, PARAM_STRING),
+	PARAM_FIELD(general.clockStart, PARAM_STRING),
+	PARAM_FIELD(general.clockStartSec, PARAM_VALUE),
+	PARAM_FIELD(vocals.filename, PARAM_STRING),
+	PARAM_FIELD(vocals.repeat, PARAM_VALUE),
+	PARAM_FIELD(vocals.volume, PARAM_VALUE),
+	PARAM_FIELD(vocals.play, PARAM_VALUE),
+	PARAM_FIELD(vocals.mute, PARAM_VALUE),
+	PARAM_FIELD(media.filename, PARAM_STRING),
+	PARAM_FIELD(media.play, PARAM_VALUE),
+	PARAM_FIELD(cpr.last, PARAM_VALUE),
+	PARAM_FIELD(cpr.compression, PARAM_VALUE),
+	PARAM_FIELD(cpr.release, PARAM_VALUE),
+	PARAM_FIELD(cpr.duration, PARAM_VALUE),
+	PARAM_FIELD(cpr.running, PARAM_VALUE),
+	PARAM_FIELD(telesim.enable, PARAM_VALUE),
+	PARAM_FIELD(telesim.vid[0].name, PARAM_STRING),
+	PARAM_FIELD(telesim.vid[0].command, PARAM_VALUE),
+	PARAM_FIELD(telesim.vid[0].param, PARAM_VALUE),
+	PARAM_FIELD(telesim.vid[0].next, PARAM_VALUE),
+	PARAM_FIELD(telesim.vid[1].name, PARAM_STRING),
+	PARAM_FIELD(telesim.vid[1].command, PARAM_VALUE),
+	PARAM_FIELD(telesim.vid[1].param, PARAM_VALUE),
+	PARAM_FIELD(telesim.vid[1].next, PARAM_VALUE),
+};
+
+/**
+* buildParamDelta
+* @params: Parsed parameters, starting from initializeParameterStruct
+* @delta: Receives the fields that were set
+* @arena: Storage for the delta
+*
+* Returns the number of fields set, or -1 if the arena is exhausted.
+*/
+int
+buildParamDelta(const struct instructor* params, struct param_delta* delta, struct arena* arena)
+{
+	static struct instructor unset;
+	static std::once_flag unsetOnce;	// The preloader parses on several threads
+	const char* src = (const char*)params;
+	size_t bytes = 0;
+	size_t length;
+	int count = 0;
+	int i;
+
+	std::call_once(unsetOnce, []() { initializeParameterStruct(&unset); });
+	for (i = 0; i < (int)(sizeof(paramFields) / sizeof(paramFields[0])); i++)
+	{
+		if (memcmp(src + paramFields[i].offset, (const char*)&unset + paramFields[i].offset, paramFields[i].size) != 0)
+		{
+			count++;
+			bytes += paramFields[i].size;
+		}
+	}
+	delta->count = 0;
+	delta->entries = NULL;
+	delta->values = NULL;
+	if (count == 0)
+	{
+		return (0);
+	}
+	delta->entries = (struct param_entry*)arena_alloc(arena, count * sizeof(struct param_entry));
+	delta->values = (unsigned char*)arena_alloc(arena, bytes);
+	if (!delta->entries || !delta->values)
+	{
+		return (-1);
+	}
+	bytes = 0;
+	for (i = 0; i < (int)(sizeof(paramFields) / sizeof(paramFields[0])); i++)
+	{
+		if (memcmp(src + paramFields[i].offset, (const char*)&unset + paramFields[i].offset, paramFields[i].size) != 0)
+		{
+			length = paramFields[i].size;
+			if (paramFields[i].type == PARAM_STRING)
+			{
+				length = strnlen(src + paramFields[i].offset, paramFields[i].size - 1) + 1;
+			}
+			memcpy(delta->values + bytes, src + paramFields[i].offset, length);
+			delta->entries[delta->count].field = (unsigned short)i;
+			delta->entries[delta->count].length = (unsigned short)length;
+			delta->entries[delta->count].value = (unsigned int)bytes;
+			delta->count++;
+			bytes += length;
+		}
+	}
+	return (delta->count);
+}
+
+/*
+ * paramFieldSize
+ * @field: index in the field table
+ *
+ * Returns the size of the instructor field, or -1 if there is no such field.
+ */
+int
+paramFieldSize(int field)
+{
+	if (field < 0 || field >= (int)(sizeof(paramFields) / sizeof(paramFields[0])))
+	{
+		return (-1);
+	}
+	return ((int)paramFields[field].size);
+}
+
+/*
+ * paramDeltaString
+ * @delta: the fields set by an init section
+ * @offset: offset of a string field in struct instructor
+ *
+ * Returns the value the init sets the field to, or NULL if it does not set it.
+ */
+const char*
+paramDeltaString(const struct param_delta* delta, size_t offset)
+{
+	int i;
+
+	for (i = 0; i < delta->count; i++)
+	{
+		if (paramFields[delta->entries[i].field].offset == offset && paramFields[delta->entries[i].field].type == PARAM_STRING)
+		{
+			return ((const char*)delta->values + delta->entries[i].value);
+		}
+	}
+	return (NULL);
+}
+
+/*
+ * paramLayoutStamp
+ *
+ * A hash of the field table and the instructor layout. A stored param_delta is only
+ * meaningful to a build with the same stamp.
+ */
+unsigned int
+paramLayoutStamp(void)
+{
+	unsigned int stamp = 2166136261u;
+	unsigned int word;
+	int i;
+
+	for (i = 0; i < (int)(sizeof(paramFields) / sizeof(paramFields[0])); i++)
+	{
+		word = (unsigned int)(paramFields[i].offset << 12) ^ (unsigned int)(paramFields[i].size << 1) ^ paramFields[i].type;
+		stamp = (stamp ^ word) * 16777619u;
+	}
+	return ((stamp ^ (unsigned int)sizeof(struct instructor)) * 16777619u);
+}
+
+// Time from submitting an init section to scan_commands applying it, in usec
+unsigned int initApplyCount = 0;
+unsigned int initApplyTimeouts = 0;
+long long initApplyLastUsec = 0;
+long long initApplyMaxUsec = 0;
+
 /**
 * processInit
-* @initParams: Pointer to a "struct instructor"
+* @initParams: The fields set by a scenario or scene init section
 *
 * Transfer the instructions from the initParams to the instructor portion of
-* the shared data space, to activate all the controls.
+* the shared data space, to activate all the controls, and wait until simmgr
+* has applied them.
 */
 void
-processInit(struct instructor* initParams)
+processInit(const struct param_delta* initParams)
 {
+	const struct paramField* field;
+	size_t vid;
+	int touched[TSIM_WINDOWS] = { 0 };
+	int i;
+	int w;
+	LONG token;
+	std::chrono::steady_clock::time_point start;
+	long long usec;
+	char buf[256];
+
 	takeInstructorLock();
 
-	// Copy initParams to shared instructor interface (not the sema or scenario sections)
+	for (i = 0; i < initParams->count; i++)
+	{
+		field = &paramFields[initParams->entries[i].field];
+		memcpy((char*)&simmgr_shm->instructor + field->offset, initParams->values + initParams->entries[i].value,
+			initParams->entries[i].length);
 
-	memcpy(&simmgr_shm->instructor.cardiac, &initParams->cardiac, sizeof(struct cardiac));
-	memcpy(&simmgr_shm->instructor.respiration, &initParams->respiration, sizeof(struct respiration));
-	memcpy(&simmgr_shm->instructor.general, &initParams->general, sizeof(struct general));
-	memcpy(&simmgr_shm->instructor.vocals, &initParams->vocals, sizeof(struct vocals));
-	memcpy(&simmgr_shm->instructor.media, &initParams->media, sizeof(struct media));
-	memcpy(&simmgr_shm->instructor.cpr, &initParams->cpr, sizeof(struct cpr));
+		// A window with a new name, command or param gets a new sequence number
+		for (w = 0; w < TSIM_WINDOWS; w++)
+		{
+			vid = offsetof(struct instructor, telesim.vid) + w * sizeof(struct telesimVideo);
+			if (field->offset >= vid && field->offset < vid + offsetof(struct telesimVideo, next))
+			{
+				touched[w] = 1;
+			}
+		}
+	}
+	for (w = 0; w < TSIM_WINDOWS; w++)
+	{
+		if (touched[w])
+		{
+			simmgr_shm->instructor.telesim.vid[w].next = rand();
+		}
+	}
+	token = initSubmit();
+	releaseInstructorLock();
 
-	if (strlen(initParams->telesim.vid[0].name) > 0 ||
-		initParams->telesim.vid[0].command != -1 ||
-		initParams->telesim.vid[0].param != -1)
+	// The headless runner has no simmgr loop running beside the scenario
+	if (simClockIsVirtual())
 	{
-		initParams->telesim.vid[0].next = rand();
+		(void)scan_commands();
 	}
-	if (strlen(initParams->telesim.vid[1].name) > 0 ||
-		initParams->telesim.vid[1].command != -1 ||
-		initParams->telesim.vid[1].param != -1)
+
+	// Wait for scan_commands to pick up the changes
+	start = std::chrono::steady_clock::now();
+	if (initWait(token, INIT_APPLY_TIMEOUT) != 0)
 	{
-		initParams->telesim.vid[1].next = rand();
+		initApplyTimeouts++;
+		sprintf_s(buf, sizeof(buf), "processInit: init not applied after %d msec", INIT_APPLY_TIMEOUT);
+		log_message("", buf);
+		return;
 	}
-	memcpy(&simmgr_shm->instructor.telesim, &initParams->telesim, sizeof(struct telesim));
-	releaseInstructorLock();
+	usec = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+	initApplyCount++;
+	initApplyLastUsec = usec;
+	if (usec > initApplyMaxUsec)
+	{
+		initApplyMaxUsec = usec;
+	}
+}
+
+/*
+ * Status values a scenario trigger can test, by class and element.
+ * Triggers are resolved against this table once, when the scenario is read, so the
+ * scene check reads the value directly instead of matching the names every pass.
+ */
+#define TRIGGER_FIELD(cls, elem, member) \
+	{ cls, elem, offsetof(struct status, member), sizeof(((struct status*)0)->member) }
+
+static const struct triggerField
+{
+	const char* param_class;
+	const char* param_element;
+	size_t offset;
+	int width;
+} triggerFields[] =
+{
+	TRIGGER_FIELD("cardiac", "vpc_freq", cardiac.vpc_freq),
+	TRIGGER_FIELD("cardiac", "vpc_delay", cardiac.vpc_delay),
+	TRIGGER_FIELD("cardiac", "pea", cardiac.pea),
+	TRIGGER_FIELD("cardiac", "rate", cardiac.rate),
+	TRIGGER_FIELD("cardiac", "avg_rate", cardiac.avg_rate),
+	TRIGGER_FIELD("cardiac", "nibp_rate", cardiac.nibp_rate),
+	TRIGGER_FIELD("cardiac", "nibp_read", cardiac.nibp_read),
+	TRIGGER_FIELD("cardiac", "nibp_linked_hr", cardiac.nibp_linked_hr),
+	TRIGGER_FIELD("cardiac", "nibp_freq", cardiac.nibp_freq),
+	TRIGGER_FIELD("cardiac", "pr_interval", cardiac.pr_interval),
+	TRIGGER_FIELD("cardiac", "qrs_interval", cardiac.qrs_interval),
+	TRIGGER_FIELD("cardiac", "bps_sys", cardiac.bps_sys),
+	TRIGGER_FIELD("cardiac", "bps_dia", cardiac.bps_dia),
+	TRIGGER_FIELD("cardiac", "ecg_indicator", cardiac.ecg_indicator),
+	TRIGGER_FIELD("cardiac", "bp_cuff", cardiac.bp_cuff),
+	TRIGGER_FIELD("cardiac", "cpr_time", cardiac.bp_cuff),	// As it has always read
+	TRIGGER_FIELD("cardiac", "arrest", cardiac.arrest),
+	TRIGGER_FIELD("respiration", "spo2", respiration.spo2),
+	TRIGGER_FIELD("respiration", "awRR", respiration.awRR),
+	TRIGGER_FIELD("respiration", "awrr", respiration.awRR),
+	TRIGGER_FIELD("respiration", "rate", respiration.rate),
+	TRIGGER_FIELD("respiration", "etco2_indicator", respiration.etco2_indicator),
+	TRIGGER_FIELD("respiration", "spo2_indicator", respiration.spo2_indicator),
+	TRIGGER_FIELD("respiration", "chest_movement", respiration.chest_movement),
+	TRIGGER_FIELD("respiration", "manual_count", respiration.manual_count),
+	TRIGGER_FIELD("respiration", "etco2", respiration.etco2),
+	TRIGGER_FIELD("general", "temperature_enable", general.temperature_enable),
+	TRIGGER_FIELD("general", "temperature", general.temperature),
+	TRIGGER_FIELD("telesim", "enable", telesim.enable),
+	TRIGGER_FIELD("cpr", "duration", cpr.duration),
+	TRIGGER_FIELD("pulse", "left_femoral", pulse.left_femoral),
+	TRIGGER_FIELD("pulse", "right_femoral", pulse.right_femoral),
+	TRIGGER_FIELD("pulse", "duration", pulse.duration),
+	TRIGGER_FIELD("pulse", "active", pulse.active),
+};
 
-	// Delay to allow simmgr to pick up the changes
-	Sleep(500);
+/*
+ * findStatusValue
+ *
+ * Look up a trigger target. Sets the offset into struct status and the width of the value.
+ * Returns 0 on success, -1 if the class and element do not name a testable value.
+ */
+int
+findStatusValue(const char* param_class, const char* param_element, size_t* offset, int* width)
+{
+	for (auto& field : triggerFields)
+	{
+		if (strcmp(param_class, field.param_class) == 0 && strcmp(param_element, field.param_element) == 0)
+		{
+			*offset = field.offset;
+			*width = field.width;
+			return (0);
+		}
+	}
+	return (-1);
+}
 
+/*
+ * getStatusValue
+ *
+ * Read a value found by findStatusValue from the live status
+ */
+int
+getStatusValue(size_t offset, int width)
+{
+	const char* ptr = (const char*)&simmgr_shm->status + offset;
+
+	switch (width)
+	{
+	case sizeof(char):
+		return (*(const char*)ptr);
+	case sizeof(short):
+		return (*(const short*)ptr);
+	case sizeof(int):
+		return (*(const int*)ptr);
+	case sizeof(long long):
+		return ((int)*(const long long*)ptr);
+	}
+	return (-1);
 }
 
 /*
@@ -699,91 +1019,12 @@ processInit(struct instructor* initParams)
 int
 getValueFromName(char* param_class, char* param_element)
 {
-	int rval = -1;
-
-	if (strcmp(param_class, "cardiac") == 0)
-	{
-		if (strcmp(param_element, "vpc_freq") == 0)
-			rval = simmgr_shm->status.cardiac.vpc_freq;
-		else if (strcmp(param_element, "vpc_delay") == 0)
-			rval = simmgr_shm->status.cardiac.vpc_delay;
-		else if (strcmp(param_element, "pea") == 0)
-			rval = simmgr_shm->status.cardiac.pea;
-		else if (strcmp(param_element, "rate") == 0)
-			rval = simmgr_shm->status.cardiac.rate;
-		else if (strcmp(param_element, "avg_rate") == 0)
-			rval = simmgr_shm->status.cardiac.avg_rate;
-		else if (strcmp(param_element, "nibp_rate") == 0)
-			rval = simmgr_shm->status.cardiac.nibp_rate;
-		else if (strcmp(param_element, "nibp_read") == 0)
-			rval = simmgr_shm->status.cardiac.nibp_read;
-		else if (strcmp(param_element, "nibp_linked_hr") == 0)
-			rval = simmgr_shm->status.cardiac.nibp_linked_hr;
-		else if (strcmp(param_element, "nibp_freq") == 0)
-			rval = simmgr_shm->status.cardiac.nibp_freq;
-		else if (strcmp(param_element, "pr_interval") == 0)
-			rval = simmgr_shm->status.cardiac.pr_interval;
-		else if (strcmp(param_element, "qrs_interval") == 0)
-			rval = simmgr_shm->status.cardiac.qrs_interval;
-		else if (strcmp(param_element, "bps_sys") == 0)
-			rval = simmgr_shm->status.cardiac.bps_sys;
-		else if (strcmp(param_element, "bps_dia") == 0)
-			rval = simmgr_shm->status.cardiac.bps_dia;
-		else if (strcmp(param_element, "ecg_indicator") == 0)
-			rval = simmgr_shm->status.cardiac.ecg_indicator;
-		else if (strcmp(param_element, "bp_cuff") == 0)
-			rval = simmgr_shm->status.cardiac.bp_cuff;
-		else if (strcmp(param_element, "cpr_time") == 0)
-			rval = simmgr_shm->status.cardiac.bp_cuff;
-		else if (strcmp(param_element, "arrest") == 0)
-			rval = simmgr_shm->status.cardiac.arrest;
-	}
-	else if (strcmp(param_class, "respiration") == 0)
-	{
-		if (strcmp(param_element, "spo2") == 0)
-			rval = simmgr_shm->status.respiration.spo2;
-		else if ( (strcmp(param_element, "awRR") == 0) || (strcmp(param_element, "awrr") == 0) )
-			rval = simmgr_shm->status.respiration.awRR;
-		else if (strcmp(param_element, "rate") == 0)
-			rval = simmgr_shm->status.respiration.rate;
-		else if (strcmp(param_element, "etco2_indicator") == 0)
-			rval = simmgr_shm->status.respiration.etco2_indicator;
-		else if (strcmp(param_element, "spo2_indicator") == 0)
-			rval = simmgr_shm->status.respiration.spo2_indicator;
-		else if (strcmp(param_element, "chest_movement") == 0)
-			rval = simmgr_shm->status.respiration.chest_movement;
-		else if (strcmp(param_element, "manual_count") == 0)
-			rval = simmgr_shm->status.respiration.manual_count;
-		else if (strcmp(param_element, "etco2") == 0)
-			rval = simmgr_shm->status.respiration.etco2;
-	}
-	else if (strcmp(param_class, "general") == 0)
-	{
-		if (strcmp(param_element, "temperature_enable") == 0)
-			rval = simmgr_shm->status.general.temperature_enable;
-		else if (strcmp(param_element, "temperature") == 0)
-			rval = simmgr_shm->status.general.temperature;
-	}
-	else if (strcmp(param_class, "telesim") == 0)
-	{
-		if (strcmp(param_element, "enable") == 0)
-			rval = simmgr_shm->status.telesim.enable;
-	}
-	else if (strcmp(param_class, "cpr") == 0)
-	{
-		if (strcmp(param_element, "duration") == 0)
-			rval = simmgr_shm->status.cpr.duration;
-	}
-	else if (strcmp(param_class, "pulse") == 0)
-	{
-		if (strcmp(param_element, "left_femoral") == 0)
-			rval = simmgr_shm->status.pulse.left_femoral;
-		if (strcmp(param_element, "right_femoral") == 0)
-			rval = simmgr_shm->status.pulse.right_femoral;
-		if (strcmp(param_element, "duration") == 0)
-			rval = simmgr_shm->status.pulse.duration;
-		if (strcmp(param_element, "active") == 0)
-			rval = simmgr_shm->status.pulse.active;
-	}
-	return (rval);
+	size_t offset;
+	int width;
+
+	if (findStatusValue(param_class, param_element, &offset, &width) != 0)
+	{
+		return (-1);
+	}
+	return (getStatusValue(offset, width));
 }
@@ -92,6 +92,7 @@ simlog_create()
 		simmgr_shm->logfile.lines_written = 0;
 		rval = -1;
 	}
+	statusMarkDirty(STATUS_SEC_LOGFILE);
 	return (rval);
 }
 
@@ -233,6 +234,7 @@ simlog_write(char* msg)
 		
 	simlog_line++;
 	simmgr_shm->logfile.lines_written = simlog_line;
+	statusMarkDirty(STATUS_SEC_LOGFILE);
 	return (simlog_line);
 }
 
@@ -310,4 +312,5 @@ simlog_end()
 		}
 	}
 	simmgr_shm->logfile.active = 0;
+	statusMarkDirty(STATUS_SEC_LOGFILE);
 }
@@ -21,21 +21,37 @@
 */
 
 #include "vetsim.h"
+#include "scenario.h"
 #include "cgiClass.h"
+#include "httpRequest.h"
 #include <map>
 #include <unordered_map>
 #include <utility>
+#include <string_view>
+#include <charconv>
 
 using namespace std;
 
 void sendStatus(void);
 void sendQuickStatus(void);
 void sendSimctrData(void);
-void replaceAll(char* args, size_t len, const char* needle, const char replace);
+void refreshStatusLog(void);
+void sendStatusDelta(int report, unsigned int since);
+int statusDeltaUsable(unsigned int since);
 
 string htmlReply;
 int closeFlag = 0;
 
+// Replies that can be sent as a delta with since=<version>
+#define STATUS_RPT_STATUS	1
+#define STATUS_RPT_QSTAT	2
+#define STATUS_RPT_SIMCTRL	4
+
+// Clients further behind than this get a full snapshot instead of a delta
+#define STATUS_DELTA_WINDOW	1000
+
+extern unsigned int statusVersion;
+
 void makejson(string key, string content)
 {
 	htmlReply += "\"" + key + "\":\"" + content + "\"";
@@ -50,47 +66,24 @@ void makejson(string key, int content)
 
 	htmlReply += "\"" + key + "\":\"" + buf + "\"";
 }
-std::vector<std::string> explode(std::string const& s, char delim)
-{
-	std::vector<std::string> result;
-	std::istringstream iss(s);
-
-	for (std::string token; std::getline(iss, token, delim); )
-	{
-		result.push_back(token);
-	}
-
-	return result;
-}
-
-void
-releaseLock(int taken)
-{
-	if (taken)
-	{
-		releaseInstructorLock();
-	}
-}
 
 int debug = 0;
 
 #define BUF_SIZE	2048
 char smbuf[BUF_SIZE];		// Used for logging messages
 
-#define DEFAULT_BUFLEN 4096
+#define STATUS_RECV_TIMEOUT	2000	// msec
 
-char recvbuf[DEFAULT_BUFLEN];
-char firstLine[DEFAULT_BUFLEN];
-int simstatusHandleCommand(char *args);
-void sendNotFound(char* path);
+char recvbuf[HTTP_MAX_REQUEST];
+int simstatusHandleCommand(vector<struct httpArg>& args);
+void sendNotFound(string_view path);
+void sendBadRequest(void);
 
 void
 simstatusMain(void)
 {
 	int portno = PORT_STATUS;
-	int i;
 	int error;
-	char* sesid = NULL;
 	SOCKET sfd;
 	SOCKET cfd;
 	struct sockaddr client_addr;
@@ -102,7 +95,12 @@ simstatusMain(void)
 	SOCKADDR_IN addr;                     // The address structure for a TCP socket
 
 	int iResult, iSendResult;
-	int recvbuflen = DEFAULT_BUFLEN;
+	int sts;
+	size_t received;
+	size_t offset;
+	string connReply;
+	httpRequest request;
+	DWORD recvTimeout = STATUS_RECV_TIMEOUT;
 
 	error = WSAStartup(0x0202, &w);  // Fill in WSA info
 	if (error)
@@ -145,152 +143,68 @@ simstatusMain(void)
 		cfd = accept(sfd, (struct sockaddr*)&client_addr, &socklen);
 		if (cfd >= 0)
 		{
-			htmlReply.clear();
+			// Don't let a stalled client hold up the port
+			setsockopt(cfd, SOL_SOCKET, SO_RCVTIMEO, (const char*)&recvTimeout, sizeof(recvTimeout));
+
+			connReply.clear();
+			received = 0;
+			offset = 0;
+			sts = HTTP_PARSE_INCOMPLETE;
 
-			// Receive HTTP Header
-			ZeroMemory(recvbuf, recvbuflen);
-			iResult = recv(cfd, recvbuf, recvbuflen, 0);
-			if (iResult > 0) 
+			// Receive until at least one request is complete, then answer every complete
+			// request in the buffer (pipelined) before closing.
+			while (sts == HTTP_PARSE_INCOMPLETE)
 			{
-				//printf("Bytes received: %d\n", iResult);
-				//cout << "START-------\n" << recvbuf << "\n---------END\n" << endl;
-				// Copy the first line by looking for first newline
-				for (i = 0; recvbuf[i]; i++)
+				iResult = recv(cfd, recvbuf + received, (int)(sizeof(recvbuf) - received), 0);
+				if (iResult <= 0)
 				{
-					if (i < sizeof(recvbuf))
+					if (iResult < 0)
 					{
-						if (recvbuf[i] == '\n' || recvbuf[i] == '\r')
-							break;
-						firstLine[i] = recvbuf[i];
-					}
-					else
-					{
-						break;
+						printf("recv failed: %d\n", WSAGetLastError());
 					}
+					break;
 				}
-				firstLine[i] = 0;
+				received += iResult;
 
-				//if (firstLine) cout << "FirstLine: " << firstLine << endl;
-				int method = 0;
-				// Determine Method
-				if (strncmp(firstLine, "GET", 3) == 0)
-				{
-					//cout << "Method:    GET" << endl;
-					method = 1;
-				}
-				else if (strncmp(firstLine, "POST", 4) == 0)
-				{
-					//cout << "Method:    POST" << endl;
-					method = 2;
-				}
-				else
-				{
-					//cout << "Method:    unknown" << endl;
-					method = 0;
-				}
-				char* cptr = NULL;
-				char* path = NULL;
-				char* args = NULL;
-				if (method == 1)
+				while (offset < received)
 				{
-					cptr = strchr(firstLine, '?');
-					if (cptr != NULL)
+					sts = request.parse(recvbuf + offset, received - offset);
+					if (sts != HTTP_PARSE_OK)
 					{
-						args = cptr + 1;
-						*cptr = 0;
-					}
-				}
-				else if (method == 2)
-				{
-					// Args are in the last line of the Request header
-					
-					for ( i = iResult ; i >= 0 ; i-- )
-					{
-						if (i < sizeof(recvbuf))
-						{
-							if (recvbuf[i] == '\n' || recvbuf[i] == '\r')
-							{
-								args = &recvbuf[i + 1];
-								break;
-							}
-						}
-						else
-						{
-							break;
-						}
-					}
-				}
-				if (args)
-				{
-					replaceAll(args, strlen(args), "%3A", ':');
-					replaceAll(args, strlen(args), "+", ' ');
-					replaceAll(args, strlen(args), "%20", ' ');
-					replaceAll(args, strlen(args), "%2B", '+');
-					cptr = strstr(args, " HTTP/");
-					if (cptr)
-					{
-						cptr[0] = 0;
-					}
-				}
-				cptr = strchr(firstLine, '/');
-				if (cptr == NULL)
-				{
-					path = NULL;
-				}
-				else
-				{
-					path = cptr + 1;
-					*cptr = 0;
-					cptr = strchr(path, ' ');
-					if (cptr)
-					{
-						*cptr = 0;
+						break;
 					}
-				}
-				
-				if (path)
-				{
-					//cout << "Path:      " << path << endl;
-				}
-				if (args)
-				{
+					offset += request.length;
 
-					//cout << "Args:      " << args << endl;
-				}
-				//cout << "------------" << endl;
-				if (path)
-				{
-					if (strcmp(path, "simstatus.cgi") == 0)
+					htmlReply.clear();
+					if (request.path.compare("simstatus.cgi") == 0 ||
+						request.path.compare("cgi-bin/simstatus.cgi") == 0)
 					{
-						simstatusHandleCommand(args );
-					}
-					else if (strcmp(path, "cgi-bin/simstatus.cgi") == 0)
-					{
-						simstatusHandleCommand(args );
+						simstatusHandleCommand(request.args);
 					}
 					else
 					{
-						sendNotFound(path);
+						sendNotFound(request.path);
 					}
+					connReply += htmlReply;
 				}
-				// Send reply
-				//cout << "Returning\n------------\n" << htmlReply << "\n------------\n" << endl;
-				iSendResult = send(cfd,  htmlReply.c_str(), (int)htmlReply.length(),  0);
-				if (iSendResult == SOCKET_ERROR) {
-					printf("send failed: %d\n", WSAGetLastError());
+				if (offset > 0 && sts == HTTP_PARSE_INCOMPLETE)
+				{
+					// Answered what we have; a trailing partial request is dropped with the connection
+					break;
 				}
-				else
+				if (sts == HTTP_PARSE_ERROR)
 				{
-					//printf("Bytes sent: %d\n", iSendResult);
+					htmlReply.clear();
+					sendBadRequest();
+					connReply += htmlReply;
 				}
 			}
-			else if (iResult == 0)
+			if (connReply.length() > 0)
 			{
-				//printf("Connection closing...\n");
-			}
-			else 
-			{
-				printf("recv failed: %d\n", WSAGetLastError());
+				iSendResult = send(cfd, connReply.c_str(), (int)connReply.length(), 0);
+				if (iSendResult == SOCKET_ERROR) {
+					printf("send failed: %d\n", WSAGetLastError());
+				}
 			}
 			closesocket(cfd);
 		}
@@ -331,7 +245,16 @@ Cookie: userID = 6; PHPSESSID = jtha8dsa284hes9ehtlvj3bpnh
 
 */
 void
-sendNotFound(char *path)
+sendBadRequest(void)
+{
+	htmlReply += "HTTP/1.1 400 Bad Request\r\n";
+	htmlReply += "Access-Control-Allow-Origin: *\r\n";
+	htmlReply += "Server:vetsim / 1.0\r\n";
+	htmlReply += "Content-Type:  text\r\n";
+	htmlReply += "Connection: close\r\n\r\n";
+}
+void
+sendNotFound(string_view path)
 {
 	string str(path);
 
@@ -348,16 +271,434 @@ sendNotFound(char *path)
 	htmlReply += "< / style>\n";
 	htmlReply += "< / head><body><h1>Not Found< / h1><p>The requested resource <code class = 'url'> / " + str + "< / code> was not found on this server.< / p>< / body> < / html>\n";
 }
-struct argument
+/*
+ * set: command routing
+ *
+ * "set:class:param" is routed by switching on a hash of the class name and, for the
+ * classes handled here, of the parameter name. nameHash() is constexpr, so the case
+ * labels are computed at build time and a collision inside a switch is a duplicate
+ * case compile error. Each case still confirms the name, so an unknown name that
+ * happens to share a hash is rejected.
+ */
+constexpr unsigned int
+nameHash(string_view name)
 {
-	string key;
-	string value;
+	unsigned int hash = 2166136261u;	// FNV-1a
+
+	for (char c : name)
+	{
+		hash ^= (unsigned char)c;
+		hash *= 16777619u;
+	}
+	return (hash);
+}
+
+static int
+svAtoi(string_view str)
+{
+	int val = 0;
+
+	while (!str.empty() && (str.front() == ' ' || str.front() == '\t'))
+	{
+		str.remove_prefix(1);
+	}
+	if (!str.empty() && str.front() == '+')
+	{
+		str.remove_prefix(1);
+	}
+	from_chars(str.data(), str.data() + str.length(), val);
+	return (val);
+}
+
+static int
+setScenario(string_view param, const char* value, struct instructor* inst)
+{
+	switch (nameHash(param))
+	{
+	case nameHash("active"):
+		if (param != "active") break;
+		sprintf_s(inst->scenario.active, STR_SIZE, "%s", value);
+		return (0);
+	case nameHash("state"):
+		if (param != "state") break;
+		sprintf_s(inst->scenario.state, STR_SIZE, "%s", value);
+		return (0);
+	case nameHash("record"):
+		if (param != "record") break;
+		inst->scenario.record = atoi(value);
+		return (0);
+	}
+	return (1);
+}
+
+static int
+setEvent(string_view param, const char* value, int apply)
+{
+	switch (nameHash(param))
+	{
+	case nameHash("event_id"):
+		if (param != "event_id") break;
+		if (strlen(value) == 0)
+		{
+			return (4);
+		}
+		if (apply)
+		{
+			addEvent((char*)value);
+		}
+		return (0);
+	case nameHash("comment"):
+		if (param != "comment") break;
+		if (strlen(value) == 0)
+		{
+			return (4);
+		}
+		if (apply)
+		{
+			sprintf_s(smbuf, sizeof(smbuf), "Comment: %s", value);
+			addComment(smbuf);
+		}
+		if (strcmp(simmgr_shm->status.scenario.state, "Running") == 0 ||
+			strcmp(simmgr_shm->status.scenario.state, "Paused") == 0)
+		{
+			return (0);
+		}
+		return (5);
+	}
+	return (2);
+}
+
+static int
+setCpr(string_view param, const char* value, struct instructor* inst)
+{
+	switch (nameHash(param))
+	{
+	case nameHash("compression"):
+		if (param != "compression") break;
+		inst->cpr.compression = atoi(value);
+		return (0);
+	case nameHash("release"):
+		if (param != "release") break;
+		inst->cpr.release = atoi(value);
+		return (0);
+	}
+	return (2);
+}
+
+static int
+setPulse(string_view param, const char* value, struct status* stat)
+{
+	switch (nameHash(param))
+	{
+	case nameHash("right_dorsal"):
+		if (param != "right_dorsal") break;
+		stat->pulse.right_dorsal = atoi(value);
+		return (0);
+	case nameHash("left_dorsal"):
+		if (param != "left_dorsal") break;
+		stat->pulse.left_dorsal = atoi(value);
+		return (0);
+	case nameHash("right_femoral"):
+		if (param != "right_femoral") break;
+		stat->pulse.right_femoral = atoi(value);
+		return (0);
+	case nameHash("left_femoral"):
+		if (param != "left_femoral") break;
+		stat->pulse.left_femoral = atoi(value);
+		return (0);
+	}
+	return (2);
+}
+
+static int
+setAuscultation(string_view param, const char* value, struct status* stat)
+{
+	switch (nameHash(param))
+	{
+	case nameHash("side"):
+		if (param != "side") break;
+		stat->auscultation.side = atoi(value);
+		return (0);
+	case nameHash("row"):
+		if (param != "row") break;
+		stat->auscultation.row = atoi(value);
+		return (0);
+	case nameHash("col"):
+		if (param != "col") break;
+		stat->auscultation.col = atoi(value);
+		return (0);
+	}
+	return (2);
+}
+
+/*
+ * setCommand
+ *
+ * Parse one set:class:param=value into inst/stat. With apply set, events and comments
+ * are also posted; the caller then holds the instructor lock and passes the SHM blocks.
+ * Returns the status codes reported in the reply (0 ok, 1 invalid param,
+ * 2 invalid class, 3 invalid parameter, 4 null string, 5 scenario not running).
+ */
+static int
+setCommand(string_view cls, string_view param, string_view value,
+	struct instructor* inst, struct status* stat, int apply)
+{
+	char val[MSG_LENGTH];
+
+	// The classes not in the paramSet table work on C strings; copy to the stack rather than allocate
+	if (value.length() >= sizeof(val))
+	{
+		return (3);
+	}
+	memcpy(val, value.data(), value.length());
+	val[value.length()] = 0;
+
+	switch (nameHash(cls))
+	{
+	case nameHash("cardiac"):
+	case nameHash("respiration"):
+	case nameHash("general"):
+	case nameHash("telesim"):
+	case nameHash("vocals"):
+	case nameHash("media"):
+		// paramSet confirms the class name
+		return (paramSet(cls, param, value, inst));
+	case nameHash("scenario"):
+		if (cls != "scenario") break;
+		return (setScenario(param, val, inst));
+	case nameHash("event"):
+		if (cls != "event") break;
+		return (setEvent(param, val, apply));
+	case nameHash("cpr"):
+		if (cls != "cpr") break;
+		return (setCpr(param, val, inst));
+	case nameHash("pulse"):
+		if (cls != "pulse") break;
+		return (setPulse(param, val, stat));
+	case nameHash("auscultation"):
+		if (cls != "auscultation") break;
+		return (setAuscultation(param, val, stat));
+	}
+	return (2);
+}
+
+/*
+ * Batched set
+ *
+ * All set: arguments of a request are first validated against scratch copies, without
+ * the lock. The valid ones are then applied together in one short critical section,
+ * so the simmgr loop and scenario thread never see half a batch, and the reply is
+ * rendered after the lock is released.
+ */
+struct setEntry
+{
+	string_view cls;
+	string_view param;
+	string_view value;
+	int sts;
 };
 
-char defaultArgs[] = "status=1";
+// Instructor lock hold time for set batches, in usec
+unsigned int setLockCount = 0;
+long long setLockLastUsec = 0;
+long long setLockMaxUsec = 0;
+long long setLockTotalUsec = 0;
+
+static int
+stageSet(string_view key, string_view value, struct setEntry* entry)
+{
+	static struct instructor scratchInstructor;
+	static struct status scratchStatus;
+	size_t sep;
+
+	// key is "set:class:param"
+	entry->cls = key.substr(4);
+	entry->param = string_view();
+	entry->value = value;
+	sep = entry->cls.find(':');
+	if (sep == string_view::npos)
+	{
+		entry->sts = 1;
+	}
+	else
+	{
+		entry->param = entry->cls.substr(sep + 1);
+		entry->cls = entry->cls.substr(0, sep);
+		entry->sts = setCommand(entry->cls, entry->param, value, &scratchInstructor, &scratchStatus, 0);
+	}
+	return (entry->sts);
+}
+
+static int
+commitSets(vector<struct setEntry>& batch)
+{
+	chrono::steady_clock::time_point start;
+	long long usec;
+
+	if (takeInstructorLock() != 0)
+	{
+		return (-1);
+	}
+	start = chrono::steady_clock::now();
+	for (auto& entry : batch)
+	{
+		if (entry.sts == 0 || entry.sts == 5)
+		{
+			setCommand(entry.cls, entry.param, entry.value, &simmgr_shm->instructor, &simmgr_shm->status, 1);
+		}
+	}
+	usec = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - start).count();
+	releaseInstructorLock();
+	statusMarkDirty(STATUS_SEC_PULSE | STATUS_SEC_AUSCULTATION);	// Written directly by setPulse and setAuscultation
+	scenarioNotify();	// cpr: and pulse: sets write the status directly
+
+	setLockCount++;
+	setLockLastUsec = usec;
+	setLockTotalUsec += usec;
+	if (usec > setLockMaxUsec)
+	{
+		setLockMaxUsec = usec;
+	}
+	return (0);
+}
+
+/*
+ * applySetCommand
+ * @key: "class:param", as in a set: argument
+ * @value: the value
+ * @apply: 0 to only validate it
+ *
+ * Stage and commit one set command from outside a request, as the headless runner
+ * does. Returns the status code a set: reply would carry, or -1 if the lock failed.
+ */
+int
+applySetCommand(const char* key, const char* value, int apply)
+{
+	string setKey = string("set:") + key;
+	struct setEntry entry;
+	vector<struct setEntry> batch;
+
+	stageSet(setKey, value, &entry);
+	if (!apply || (entry.sts != 0 && entry.sts != 5))
+	{
+		return (entry.sts);
+	}
+	batch.push_back(entry);
+	if (commitSets(batch) != 0)
+	{
+		return (-1);
+	}
+	return (entry.sts);
+}
 
+/*
+ * checkSetCommand
+ * @key: "set:class:param"
+ * @value: the value
+ *
+ * Route and validate one set: argument against the scratch copies, as a request does
+ * before taking the lock. Returns the status code a set: reply would carry. Used by
+ * --httpbench.
+ */
 int
-simstatusHandleCommand(char *args)
+checkSetCommand(string_view key, string_view value)
+{
+	struct setEntry entry;
+
+	return (stageSet(key, value, &entry));
+}
+
+static void
+sendMetrics(void)
+{
+	htmlReply += " \"metrics\" : {\n";
+	makejson("set_batches", to_string(setLockCount));
+	htmlReply += ",\n";
+	makejson("set_lock_usec_last", to_string(setLockLastUsec));
+	htmlReply += ",\n";
+	makejson("set_lock_usec_max", to_string(setLockMaxUsec));
+	htmlReply += ",\n";
+	makejson("set_lock_usec_avg", to_string(setLockCount ? setLockTotalUsec / setLockCount : 0));
+	htmlReply += ",\n";
+	makejson("init_batches", to_string(initApplyCount));
+	htmlReply += ",\n";
+	makejson("init_apply_usec_last", to_string(initApplyLastUsec));
+	htmlReply += ",\n";
+	makejson("init_apply_usec_max", to_string(initApplyMaxUsec));
+	htmlReply += ",\n";
+	makejson("init_apply_timeouts", to_string(initApplyTimeouts));
+	htmlReply += "\n}";
+}
+
+/*
+ * sendPreloadStatus
+ *
+ * The result of the background read of each scenario in the library
+ */
+static void
+sendPreloadStatus(void)
+{
+	static const char* stateNames[] = { "pending", "ready", "error" };
+	vector<struct preload_status> list;
+	size_t i;
+
+	getPreloadStatus(list);
+	htmlReply += " \"scenarios\" : {\n";
+	for (i = 0; i < list.size(); i++)
+	{
+		htmlReply += "  \"" + list[i].name + "\" : { ";
+		makejson("state", stateNames[list[i].state]);
+		htmlReply += ", ";
+		makejson("errors", list[i].errors);
+		htmlReply += ", ";
+		makejson("usec", to_string(list[i].usec));
+		htmlReply += ", ";
+		makejson("message", list[i].message);
+		htmlReply += (i + 1 < list.size() ? " },\n" : " }\n");
+	}
+	htmlReply += "}";
+}
+
+/*
+ * sendPrefetchStatus
+ *
+ * How well the media and vocals of the next scenes were read ahead
+ */
+static void
+sendPrefetchStatus(void)
+{
+	struct prefetch_status status;
+	unsigned int uses;
+
+	getPrefetchStatus(&status);
+	uses = status.hits + status.misses;
+	htmlReply += " \"prefetch\" : {\n";
+	makejson("budget_bytes", to_string(status.budget));
+	htmlReply += ",\n";
+	makejson("held_bytes", to_string(status.held));
+	htmlReply += ",\n";
+	makejson("held_files", to_string(status.files));
+	htmlReply += ",\n";
+	makejson("hits", to_string(status.hits));
+	htmlReply += ",\n";
+	makejson("misses", to_string(status.misses));
+	htmlReply += ",\n";
+	makejson("hit_rate", to_string(uses ? (status.hits * 100) / uses : 0));
+	htmlReply += ",\n";
+	makejson("loaded", to_string(status.loaded));
+	htmlReply += ",\n";
+	makejson("loaded_bytes", to_string(status.loaded_bytes));
+	htmlReply += ",\n";
+	makejson("evicted", to_string(status.evicted));
+	htmlReply += ",\n";
+	makejson("failed", to_string(status.failed));
+	htmlReply += "\n}";
+}
+
+static struct httpArg defaultArgs[] = { { "status", "1" } };
+
+int
+simstatusHandleCommand(vector<struct httpArg>& args)
 {
 	char buffer[MSG_LENGTH];
 	char cmd[32];
@@ -366,47 +707,20 @@ simstatusHandleCommand(char *args)
 	int sts;
 	char sesid[512] = { 0, };
 	int userid = -1;
-	argument arg;
-	int ss_iiLockTaken = 0;
+	int deltaRequested = 0;
+	int useDelta = 0;
+	unsigned int since = 0;
 
-	std::string key;
-	std::string value;
-	std::string command;
+	string_view key;
+	string_view value;
 	std::string theTime;
-	std::vector<std::string> v;
+	vector<struct setEntry> batch;
+	struct setEntry entry;
+	int applyCount = 0;
 
-	map<int, argument> argList;
-	if (strlen(args) == 0)
+	if (args.empty())
 	{
-		args = defaultArgs;
-	}
-	char* keyP = &args[0];
-	char* valP = strchr(args, '=');
-	char* nextP = strchr(args, '&');
-	i = 0;
-	while (valP)
-	{
-		valP[0] = 0;
-		valP += 1;
-		if (nextP)
-		{
-			nextP[0] = 0;
-			nextP += 1;
-		}
-		arg.key = keyP;
-		arg.value = valP;
-		argList.insert(pair<int,argument>(i, arg));
-		if (nextP != NULL)
-		{
-			keyP = nextP;
-			valP = strchr(nextP, '=');
-			nextP = strchr(nextP, '&');
-		}
-		else
-		{
-			valP = NULL;
-		}
-		i++;
+		args.assign(defaultArgs, defaultArgs + 1);
 	}
 	htmlReply += "HTTP/1.1 200 OK\r\n";
 	htmlReply += "Server:vetsim / 1.0\r\n";
@@ -415,7 +729,6 @@ simstatusHandleCommand(char *args)
 	htmlReply += "Connection: close\r\n\r\n";
 
 	htmlReply += "{\n";
-	map<int, argument>::iterator itr;
 	//cout << "\tKey\tValue\n";
 
 	//for (itr = argList.begin(); itr != argList.end(); ++itr) {
@@ -431,37 +744,37 @@ simstatusHandleCommand(char *args)
 	//makejson("date", buffer);
 	//htmlReply += ",\n    ";
 
-	for (itr = argList.begin(); itr != argList.end(); ++itr) 
+	for (auto& arg : args)
 	{
-		arg = itr->second;
 		key = arg.key;
 		value = arg.value;
 		if (key.compare("PHPSESSID") == 0)
 		{
-			sprintf_s(sesid, sizeof(sesid), "%s", value.c_str());
-			makejson(key, value);
+			sprintf_s(sesid, sizeof(sesid), "%.*s", (int)value.length(), value.data());
+			makejson(string(key), string(value));
 			htmlReply += ",\n";
 		}
 		else if (key.compare("simIIUserID") == 0)
 		{
-			userid = atoi(value.c_str());
-			makejson(key, value);
+			userid = svAtoi(value);
+			makejson(string(key), string(value));
 			htmlReply += ",\n";
 		}
 		else if (key.compare("userID") == 0)
 		{
-			userid = atoi(value.c_str());
-			makejson(key, value);
+			userid = svAtoi(value);
+			makejson(string(key), string(value));
 			htmlReply += ",\n";
 		}
 		else if (key.compare("close") == 0)
 		{
-			i = atoi(value.c_str());
+			i = svAtoi(value);
 			if (i == 565)
 			{
-				makejson(key, value);
+				makejson(string(key), string(value));
 				htmlReply += ",\n";
 				closeFlag = 1;
+				scenarioNotify();
 			}
 			else
 			{
@@ -469,37 +782,47 @@ simstatusHandleCommand(char *args)
 				htmlReply += ",\n";
 			}
 		}
+		else if (key.compare("since") == 0)
+		{
+			from_chars(value.data(), value.data() + value.length(), since);
+			deltaRequested = 1;
+		}
+	}
+	if (deltaRequested)
+	{
+		// Bring the change log up to date once, so every report in this reply
+		// is relative to the same version.
+		refreshStatusLog();
+		useDelta = statusDeltaUsable(since);
 	}
 
 	sprintf_s(cmd, sizeof(cmd), "none");
-	// If any "set" commands are in the GET/POST list, then take the Instructor Interface lock
-	for (itr = argList.begin(); itr != argList.end(); ++itr)
+	// Stage and validate the "set" commands, then apply the valid ones under one lock
+	for (auto& arg : args)
 	{
-		arg = itr->second;
-		key = arg.key;
-		value = arg.value;
-
-		if (key.compare(0, 4, "set:") == 0)
+		if (arg.key.compare(0, 4, "set:") == 0)
 		{
-			if (takeInstructorLock() != 0)
+			sts = stageSet(arg.key, arg.value, &entry);
+			if (sts == 0 || sts == 5)
 			{
-				makejson("status", "Fail");
-				htmlReply += ",\n    ";
-				makejson("error", "Could not get Instructor Mutex");
-				htmlReply += "\n}\n";
-				return (0);
+				applyCount++;
 			}
-
-			ss_iiLockTaken = 1;
-			break;
+			batch.push_back(entry);
 		}
 	}
+	if (applyCount > 0 && commitSets(batch) != 0)
+	{
+		makejson("status", "Fail");
+		htmlReply += ",\n    ";
+		makejson("error", "Could not get Instructor Mutex");
+		htmlReply += "\n}\n";
+		return (0);
+	}
 
 	i = 0;
 	// Parse the submitted GET/POST elements
-	for (itr = argList.begin(); itr != argList.end(); ++itr)
+	for (auto& arg : args)
 	{
-		arg = itr->second;
 		key = arg.key;
 		value = arg.value;
 		//printf("Key \"%s\" Value \"%s\"\n", key.c_str(), value.c_str());
@@ -511,7 +834,14 @@ simstatusHandleCommand(char *args)
 		if (key.compare("qstat") == 0)
 		{
 			// The Quick Status
-			sendQuickStatus();
+			if (useDelta)
+			{
+				sendStatusDelta(STATUS_RPT_QSTAT, since);
+			}
+			else
+			{
+				sendQuickStatus();
+			}
 		}
 		else if (key.compare("check") == 0)
 		{
@@ -560,204 +890,79 @@ simstatusHandleCommand(char *args)
 			//makejson("date_t", simmgr_shm->server.server_time );
 		}
 		
-		else if (key.compare("ip") == 0)
-		{
-			makejson("ip_addr", simmgr_shm->server.ip_addr);
-		}
-		else if (key.compare("host") == 0)
-		{
-			makejson("hostname", simmgr_shm->server.name);
-		}
-		else if (key.compare("time") == 0)
-		{
-			theTime = std::string(simmgr_shm->server.server_time);
-
-			if (!theTime.empty() && theTime[theTime.length() - 1] == '\n')
-			{
-				theTime.erase(theTime.length() - 1);
-			}
-			makejson("time", theTime.c_str());
-		}
-		else if (key.compare("status") == 0)
-		{
-			// The meat of the task - Return the content of the SHM
-			sendStatus();
-		}
-		else if (key.compare("simctrldata") == 0)
-		{
-			// Return abbreviated status for sim controller
-			sendSimctrData();
-		}
-		else if (key.compare(0, 4, "set:") == 0)
-		{
-			set_count++;
-			// set command: Split to segments to construct the reference
-			v = explode(key, ':');
-			sprintf_s(buffer, MSG_LENGTH, " \"set_%d\" : {\n    ", set_count);
-			htmlReply += buffer;
-			makejson("class", v[1]);
-			htmlReply += ",\n    ";
-			makejson("param", v[2]);
-			htmlReply += ",\n    ";
-			makejson("value", value);
-			htmlReply += ",\n    ";
-			sts = 0;
-
-			if (v[1].compare("cardiac") == 0)
-			{
-				printf("Calling Cardiac Parse, \"%s\", \"%s\"\n", v[2].c_str(), value.c_str());
-				sts = cardiac_parse(v[2].c_str(), value.c_str(), &simmgr_shm->instructor.cardiac);
-			}
-			else if (v[1].compare("scenario") == 0)
-			{
-				if (v[2].compare("active") == 0)
-				{
-					sprintf_s(simmgr_shm->instructor.scenario.active, STR_SIZE, "%s", value.c_str());
-				}
-				else if (v[2].compare("state") == 0)
-				{
-					sprintf_s(simmgr_shm->instructor.scenario.state, STR_SIZE, "%s", value.c_str());
-				}
-				else if (v[2].compare("record") == 0)
-				{
-					simmgr_shm->instructor.scenario.record = atoi(value.c_str());
-				}
-				else
-				{
-					sts = 1;
-				}
-			}
-			else if (v[1].compare("respiration") == 0)
-			{
-				sts = respiration_parse(v[2].c_str(), value.c_str(), &simmgr_shm->instructor.respiration);
-			}
-			else if (v[1].compare("general") == 0)
-			{
-				sts = general_parse(v[2].c_str(), value.c_str(), &simmgr_shm->instructor.general);
-			}
-			else if (v[1].compare("telesim") == 0)
-			{
-				sts = telesim_parse(v[2].c_str(), value.c_str(), &simmgr_shm->instructor.telesim);
-			}
-			else if (v[1].compare("vocals") == 0)
-			{
-				sts = vocals_parse(v[2].c_str(), value.c_str(), &simmgr_shm->instructor.vocals);
-			}
-			else if (v[1].compare("media") == 0)
-			{
-				sts = media_parse(v[2].c_str(), value.c_str(), &simmgr_shm->instructor.media);
-			}
-			else if (v[1].compare("event") == 0)
-			{
-				if (v[2].compare("event_id") == 0)
-				{
-					if (value.length() != 0)
-					{
-						addEvent((char*)value.c_str());
-						sts = 0;
-					}
-					else
-					{
-						sts = 4;
-					}
-				}
-				else if (v[2].compare("comment") == 0)
-				{
-					if (value.length() != 0)
-					{
-						sprintf_s(smbuf, sizeof(smbuf), "Comment: %s", (char*)value.c_str());
-						if (strcmp(simmgr_shm->status.scenario.state, "Running") == 0 ||
-							strcmp(simmgr_shm->status.scenario.state, "Paused") == 0)
-						{
-							addComment(smbuf);
-							sts = 0;
-						}
-						else
-						{
-							addComment(smbuf);
-							sts = 5;
-						}
-					}
-					else
-					{
-						sts = 4;
-					}
-				}
-				else
-				{
-					sts = 2;
-				}
+		else if (key.compare("ip") == 0)
+		{
+			makejson("ip_addr", simmgr_shm->server.ip_addr);
+		}
+		else if (key.compare("host") == 0)
+		{
+			makejson("hostname", simmgr_shm->server.name);
+		}
+		else if (key.compare("time") == 0)
+		{
+			theTime = std::string(simmgr_shm->server.server_time);
+
+			if (!theTime.empty() && theTime[theTime.length() - 1] == '\n')
+			{
+				theTime.erase(theTime.length() - 1);
 			}
-			else if (v[1].compare("cpr") == 0)
+			makejson("time", theTime.c_str());
+		}
+		else if (key.compare("status") == 0)
+		{
+			// The meat of the task - Return the content of the SHM
+			if (useDelta)
 			{
-				if (v[2].compare("compression") == 0)
-				{
-					simmgr_shm->instructor.cpr.compression = atoi(value.c_str());
-					sts = 0;
-				}
-				else if (v[2].compare("release") == 0)
-				{
-					simmgr_shm->instructor.cpr.release = atoi(value.c_str());
-					sts = 0;
-				}
-				else
-				{
-					sts = 2;
-				}
+				sendStatusDelta(STATUS_RPT_STATUS, since);
 			}
-			else if (v[1].compare("pulse") == 0)
+			else
 			{
-				if (v[2].compare("right_dorsal") == 0)
-				{
-					simmgr_shm->status.pulse.right_dorsal = atoi(value.c_str());
-					sts = 0;
-				}
-				else if (v[2].compare("left_dorsal") == 0)
-				{
-					simmgr_shm->status.pulse.left_dorsal = atoi(value.c_str());
-					sts = 0;
-				}
-				else if (v[2].compare("right_femoral") == 0)
-				{
-					simmgr_shm->status.pulse.right_femoral = atoi(value.c_str());
-					sts = 0;
-				}
-				else if (v[2].compare("left_femoral") == 0)
-				{
-					simmgr_shm->status.pulse.left_femoral = atoi(value.c_str());
-					sts = 0;
-				}
-				else
-				{
-					sts = 2;
-				}
+				sendStatus();
 			}
-			else if (v[1].compare("auscultation") == 0)
+		}
+		else if (key.compare("simctrldata") == 0)
+		{
+			// Return abbreviated status for sim controller
+			if (useDelta)
 			{
-				if (v[2].compare("side") == 0)
-				{
-					simmgr_shm->status.auscultation.side = atoi(value.c_str());
-					sts = 0;
-				}
-				else if (v[2].compare("row") == 0)
-				{
-					simmgr_shm->status.auscultation.row = atoi(value.c_str());
-					sts = 0;
-				}
-				else if (v[2].compare("col") == 0)
-				{
-					simmgr_shm->status.auscultation.col = atoi(value.c_str());
-					sts = 0;
-				}
-				else
-				{
-					sts = 2;
-				}
+				sendStatusDelta(STATUS_RPT_SIMCTRL, since);
 			}
 			else
 			{
-				sts = 2;
+				sendSimctrData();
 			}
+		}
+		else if (key.compare("metrics") == 0)
+		{
+			sendMetrics();
+		}
+		else if (key.compare("scenarios") == 0)
+		{
+			sendPreloadStatus();
+		}
+		else if (key.compare("prefetch") == 0)
+		{
+			sendPrefetchStatus();
+		}
+		else if (key.compare("since") == 0)
+		{
+			// Version the client should send as "since" on its next poll
+			makejson("version", to_string(statusVersion));
+		}
+		else if (key.compare(0, 4, "set:") == 0)
+		{
+			// Report the result staged above
+			entry = batch[set_count];
+			set_count++;
+			sprintf_s(buffer, MSG_LENGTH, " \"set_%d\" : {\n    ", set_count);
+			htmlReply += buffer;
+			makejson("class", string(entry.cls));
+			htmlReply += ",\n    ";
+			makejson("param", string(entry.param));
+			htmlReply += ",\n    ";
+			makejson("value", string(entry.value));
+			htmlReply += ",\n    ";
+			sts = entry.sts;
 			if (sts == 1)
 			{
 				makejson("status", "invalid param");
@@ -791,12 +996,6 @@ simstatusHandleCommand(char *args)
 	}
 
 	htmlReply += "\n}\n";
-	if (ss_iiLockTaken)
-	{
-		releaseLock(ss_iiLockTaken);
-	}
-	
-	ss_iiLockTaken = 0;
 	return (0);
 }
 
@@ -1001,6 +1200,465 @@ sendSimctrData(void)
 
 extern char WVSversion[];
 
+/*
+ * Delta status
+ *
+ * A client that passes since=<version> gets back only the fields that changed after
+ * that version, plus the current "version" to send on its next poll. Each reported
+ * field keeps the version at which its value last changed. The log is brought up to
+ * date when a delta client polls, by comparing the SHM contents of the sections the
+ * writers marked with statusMarkDirty since the last poll.
+ *
+ * Fields are always collected in the same order (all telesim windows and all controller
+ * slots are included), so the log is indexed by position. Each section starts at a fixed
+ * index, so a clean section is skipped without losing the place of the ones after it.
+ */
+struct statusField
+{
+	const char* section;
+	int sub;				// Telesim window, or -1 for a plain field
+	string key;
+	int reports;			// Mask of STATUS_RPT_* replies that carry this field
+	string value;
+	unsigned int version;	// statusVersion at which value last changed
+};
+vector<struct statusField> statusLog;
+unsigned int statusVersion = 0;
+size_t statusLogNext;
+int statusLogChanged;
+static volatile LONG statusDirty = STATUS_SEC_ALL;
+static vector<size_t> statusSectionStart;	// Log index of the first field of each section
+static size_t statusSectionNext;
+
+/*
+ * statusMarkDirty
+ *
+ * Called by the writers of the status block with the STATUS_SEC_* sections they changed.
+ */
+void
+statusMarkDirty(LONG sections)
+{
+	InterlockedOr(&statusDirty, sections);
+}
+
+/*
+ * statusSectionBegin
+ *
+ * Position the log at the start of the next section. Returns nonzero if the section
+ * must be compared; that is, it is marked in dirty or the log is being built.
+ */
+static int
+statusSectionBegin(LONG section, LONG dirty)
+{
+	size_t n = statusSectionNext++;
+
+	if (n >= statusSectionStart.size())
+	{
+		statusSectionStart.push_back(statusLogNext);
+		return (1);
+	}
+	statusLogNext = statusSectionStart[n];
+	return ((dirty & section) != 0);
+}
+
+static void
+statusTrack(const char* section, int sub, const char* key, int reports, const char* value)
+{
+	size_t idx = statusLogNext++;
+
+	if (idx >= statusLog.size())
+	{
+		struct statusField field;
+
+		field.section = section;
+		field.sub = sub;
+		field.key = key;
+		field.reports = reports;
+		field.value = value;
+		field.version = statusVersion + 1;
+		statusLog.push_back(field);
+		statusLogChanged = 1;
+	}
+	else if (statusLog[idx].value.compare(value) != 0)
+	{
+		statusLog[idx].value = value;
+		statusLog[idx].version = statusVersion + 1;
+		statusLogChanged = 1;
+	}
+}
+static void
+statusTrack(const char* section, int sub, const char* key, int reports, long long value)
+{
+	char buffer[32];
+
+	_i64toa_s(value, buffer, sizeof(buffer), 10);
+	statusTrack(section, sub, key, reports, buffer);
+}
+static const char*
+pulseStrengthName(int strength, char* buffer, size_t len)
+{
+	switch (strength)
+	{
+	case 0:
+		return ("none");
+	case 1:
+		return ("weak");
+	case 2:
+		return ("medium");
+	case 3:
+		return ("strong");
+	default:	// Should never happen
+		_itoa_s(strength, buffer, len, 10);
+		return (buffer);
+	}
+}
+
+#define SR	STATUS_RPT_STATUS
+#define QR	STATUS_RPT_QSTAT
+#define CR	STATUS_RPT_SIMCTRL
+
+/*
+ * refreshStatusLog
+ *
+ * Compare the dirty sections of the current status against the change log and stamp
+ * every field that differs with a new version. The version only advances when something
+ * changed. The debug section holds the server clock, so it is always compared.
+ */
+void
+refreshStatusLog(void)
+{
+	char buffer[256];
+	char ctrlKey[16];
+	string reply;
+	int i;
+	extern ULONGLONG breathInterval;
+	LONG dirty = InterlockedExchange(&statusDirty, 0) | STATUS_SEC_DEBUG;
+
+	statusLogNext = 0;
+	statusLogChanged = 0;
+	statusSectionNext = 0;
+
+	if (statusSectionBegin(STATUS_SEC_SCENARIO, dirty))
+	{
+		statusTrack("scenario", -1, "active", SR, simmgr_shm->status.scenario.active);
+		statusTrack("scenario", -1, "start", SR, simmgr_shm->status.scenario.start);
+		statusTrack("scenario", -1, "runtime", SR, simmgr_shm->status.scenario.runtimeAbsolute);
+		statusTrack("scenario", -1, "runtimeScenario", SR, simmgr_shm->status.scenario.runtimeScenario);
+		statusTrack("scenario", -1, "runtimeScene", SR, simmgr_shm->status.scenario.runtimeScene);
+		statusTrack("scenario", -1, "clockDisplay", SR, simmgr_shm->status.scenario.clockDisplay);
+		statusTrack("scenario", -1, "scene_name", SR, simmgr_shm->status.scenario.scene_name);
+		statusTrack("scenario", -1, "scene_id", SR, simmgr_shm->status.scenario.scene_id);
+		statusTrack("scenario", -1, "record", SR, simmgr_shm->status.scenario.record);
+		statusTrack("scenario", -1, "error_message", SR, simmgr_shm->status.scenario.error_message);
+		statusTrack("scenario", -1, "state", SR, simmgr_shm->status.scenario.state);
+	}
+
+	if (statusSectionBegin(STATUS_SEC_LOGFILE, dirty))
+	{
+		statusTrack("logfile", -1, "active", SR, simmgr_shm->logfile.active);
+		statusTrack("logfile", -1, "filename", SR, simmgr_shm->logfile.filename);
+		statusTrack("logfile", -1, "lines_written", SR, simmgr_shm->logfile.lines_written);
+	}
+
+	if (statusSectionBegin(STATUS_SEC_CARDIAC, dirty))
+	{
+		statusTrack("cardiac", -1, "rhythm", SR | CR, simmgr_shm->status.cardiac.rhythm);
+		statusTrack("cardiac", -1, "vpc", SR | CR, simmgr_shm->status.cardiac.vpc);
+		statusTrack("cardiac", -1, "pea", SR | CR, simmgr_shm->status.cardiac.pea);
+		statusTrack("cardiac", -1, "vpc_freq", SR | CR, simmgr_shm->status.cardiac.vpc_freq);
+		statusTrack("cardiac", -1, "vpc_delay", SR | CR, simmgr_shm->status.cardiac.vpc_delay);
+		statusTrack("cardiac", -1, "vfib_amplitude", SR, simmgr_shm->status.cardiac.vfib_amplitude);
+		statusTrack("cardiac", -1, "rate", SR | QR | CR, simmgr_shm->status.cardiac.rate);
+		statusTrack("cardiac", -1, "avg_rate", SR | QR | CR, simmgr_shm->status.cardiac.avg_rate);
+		statusTrack("cardiac", -1, "nibp_rate", SR | CR, simmgr_shm->status.cardiac.nibp_rate);
+		statusTrack("cardiac", -1, "nibp_read", SR | CR, simmgr_shm->status.cardiac.nibp_read);
+		statusTrack("cardiac", -1, "nibp_linked_hr", SR | CR, simmgr_shm->status.cardiac.nibp_linked_hr);
+		statusTrack("cardiac", -1, "nibp_freq", SR | CR, simmgr_shm->status.cardiac.nibp_freq);
+		statusTrack("cardiac", -1, "pulseCount", SR | QR | CR, simmgr_shm->status.cardiac.pulseCount);
+		statusTrack("cardiac", -1, "pulseCountVpc", SR | QR | CR, simmgr_shm->status.cardiac.pulseCountVpc);
+		statusTrack("cardiac", -1, "pwave", SR | CR, simmgr_shm->status.cardiac.pwave);
+		statusTrack("cardiac", -1, "pr_interval", SR | CR, simmgr_shm->status.cardiac.pr_interval);
+		statusTrack("cardiac", -1, "qrs_interval", SR | CR, simmgr_shm->status.cardiac.qrs_interval);
+		statusTrack("cardiac", -1, "bps_sys", SR | CR, simmgr_shm->status.cardiac.bps_sys);
+		statusTrack("cardiac", -1, "bps_dia", SR | CR, simmgr_shm->status.cardiac.bps_dia);
+		statusTrack("cardiac", -1, "right_dorsal_pulse_strength", SR | CR,
+			pulseStrengthName(simmgr_shm->status.cardiac.right_dorsal_pulse_strength, buffer, sizeof(buffer)));
+		statusTrack("cardiac", -1, "left_dorsal_pulse_strength", SR | CR,
+			pulseStrengthName(simmgr_shm->status.cardiac.left_dorsal_pulse_strength, buffer, sizeof(buffer)));
+		statusTrack("cardiac", -1, "right_femoral_pulse_strength", SR | CR,
+			pulseStrengthName(simmgr_shm->status.cardiac.right_femoral_pulse_strength, buffer, sizeof(buffer)));
+		statusTrack("cardiac", -1, "left_femoral_pulse_strength", SR | CR,
+			pulseStrengthName(simmgr_shm->status.cardiac.left_femoral_pulse_strength, buffer, sizeof(buffer)));
+		statusTrack("cardiac", -1, "heart_sound_volume", SR | CR, simmgr_shm->status.cardiac.heart_sound_volume);
+		statusTrack("cardiac", -1, "heart_sound_mute", SR | CR, simmgr_shm->status.cardiac.heart_sound_mute);
+		statusTrack("cardiac", -1, "heart_sound", SR | CR, simmgr_shm->status.cardiac.heart_sound);
+		statusTrack("cardiac", -1, "ecg_indicator", SR, simmgr_shm->status.cardiac.ecg_indicator);
+		statusTrack("cardiac", -1, "bp_cuff", SR, simmgr_shm->status.cardiac.bp_cuff);
+		statusTrack("cardiac", -1, "arrest", SR | CR, simmgr_shm->status.cardiac.arrest);
+	}
+
+	if (statusSectionBegin(STATUS_SEC_RESPIRATION, dirty))
+	{
+		statusTrack("respiration", -1, "left_lung_sound", SR | CR, simmgr_shm->status.respiration.left_lung_sound);
+		statusTrack("respiration", -1, "left_lung_sound_volume", SR | CR, simmgr_shm->status.respiration.left_lung_sound_volume);
+		statusTrack("respiration", -1, "left_lung_sound_mute", SR | CR, simmgr_shm->status.respiration.left_lung_sound_mute);
+		statusTrack("respiration", -1, "right_lung_sound", SR | CR, simmgr_shm->status.respiration.right_lung_sound);
+		statusTrack("respiration", -1, "right_lung_sound_volume", SR | CR, simmgr_shm->status.respiration.right_lung_sound_volume);
+		statusTrack("respiration", -1, "right_lung_sound_mute", SR | CR, simmgr_shm->status.respiration.right_lung_sound_mute);
+		statusTrack("respiration", -1, "inhalation_duration", SR | QR | CR, simmgr_shm->status.respiration.inhalation_duration);
+		statusTrack("respiration", -1, "exhalation_duration", SR | QR | CR, simmgr_shm->status.respiration.exhalation_duration);
+		statusTrack("respiration", -1, "breathCount", SR | QR, simmgr_shm->status.respiration.breathCount);
+		statusTrack("respiration", -1, "spo2", SR, simmgr_shm->status.respiration.spo2);
+		statusTrack("respiration", -1, "etco2", SR, simmgr_shm->status.respiration.etco2);
+		statusTrack("respiration", -1, "rate", SR | QR | CR, simmgr_shm->status.respiration.rate);
+		statusTrack("respiration", -1, "awRR", SR | QR | CR, simmgr_shm->status.respiration.awRR);
+		statusTrack("respiration", -1, "etco2_indicator", SR, simmgr_shm->status.respiration.etco2_indicator);
+		statusTrack("respiration", -1, "spo2_indicator", SR, simmgr_shm->status.respiration.spo2_indicator);
+		statusTrack("respiration", -1, "chest_movement", SR | CR, simmgr_shm->status.respiration.chest_movement);
+		statusTrack("respiration", -1, "manual_count", SR | QR | CR, simmgr_shm->status.respiration.manual_count);
+	}
+
+	if (statusSectionBegin(STATUS_SEC_AUSCULTATION, dirty))
+	{
+		statusTrack("auscultation", -1, "side", SR, simmgr_shm->status.auscultation.side);
+		statusTrack("auscultation", -1, "row", SR, simmgr_shm->status.auscultation.row);
+		statusTrack("auscultation", -1, "col", SR, simmgr_shm->status.auscultation.col);
+	}
+
+	if (statusSectionBegin(STATUS_SEC_GENERAL, dirty))
+	{
+		statusTrack("general", -1, "wvs_version", SR, WVSversion);
+		statusTrack("general", -1, "temperature", SR, simmgr_shm->status.general.temperature);
+		statusTrack("general", -1, "temperature_units", SR, simmgr_shm->status.general.temperature_units);
+		statusTrack("general", -1, "temperature_enable", SR, simmgr_shm->status.general.temperature_enable);
+	}
+
+	if (statusSectionBegin(STATUS_SEC_VOCALS, dirty))
+	{
+		statusTrack("vocals", -1, "filename", SR, simmgr_shm->status.vocals.filename);
+		statusTrack("vocals", -1, "repeat", SR, simmgr_shm->status.vocals.repeat);
+		statusTrack("vocals", -1, "volume", SR, simmgr_shm->status.vocals.volume);
+		statusTrack("vocals", -1, "play", SR, simmgr_shm->status.vocals.play);
+		statusTrack("vocals", -1, "mute", SR, simmgr_shm->status.vocals.mute);
+	}
+
+	if (statusSectionBegin(STATUS_SEC_PULSE, dirty))
+	{
+		statusTrack("pulse", -1, "right_dorsal", SR, simmgr_shm->status.pulse.right_dorsal);
+		statusTrack("pulse", -1, "left_dorsal", SR, simmgr_shm->status.pulse.left_dorsal);
+		statusTrack("pulse", -1, "right_femoral", SR, simmgr_shm->status.pulse.right_femoral);
+		statusTrack("pulse", -1, "left_femoral", SR, simmgr_shm->status.pulse.left_femoral);
+		statusTrack("pulse", -1, "duration", SR, simmgr_shm->status.pulse.duration);
+		statusTrack("pulse", -1, "active", SR, simmgr_shm->status.pulse.active);
+	}
+
+	if (statusSectionBegin(STATUS_SEC_MEDIA, dirty))
+	{
+		statusTrack("media", -1, "filename", SR, simmgr_shm->status.media.filename);
+		statusTrack("media", -1, "play", SR, simmgr_shm->status.media.play);
+	}
+
+	if (statusSectionBegin(STATUS_SEC_TELESIM, dirty))
+	{
+		statusTrack("telesim", -1, "enable", SR, simmgr_shm->status.telesim.enable);
+		for (i = 0; i < TSIM_WINDOWS; i++)
+		{
+			statusTrack("telesim", i, "name", SR, simmgr_shm->status.telesim.vid[i].name);
+			statusTrack("telesim", i, "command", SR, simmgr_shm->status.telesim.vid[i].command);
+			_gcvt_s(buffer, sizeof(buffer), simmgr_shm->status.telesim.vid[i].param, 8);
+			statusTrack("telesim", i, "param", SR, buffer);
+			statusTrack("telesim", i, "next", SR, simmgr_shm->status.telesim.vid[i].next);
+		}
+	}
+
+	if (statusSectionBegin(STATUS_SEC_CPR, dirty))
+	{
+		statusTrack("cpr", -1, "last", SR, simmgr_shm->status.cpr.last);
+		statusTrack("cpr", -1, "running", SR | QR | CR, simmgr_shm->status.cpr.running);
+		statusTrack("cpr", -1, "compression", SR, simmgr_shm->status.cpr.compression);
+		statusTrack("cpr", -1, "release", SR, simmgr_shm->status.cpr.release);
+	}
+
+	if (statusSectionBegin(STATUS_SEC_DEFIBRILLATION, dirty))
+	{
+		statusTrack("defibrillation", -1, "last", SR, simmgr_shm->status.defibrillation.last);
+		statusTrack("defibrillation", -1, "shock", SR | QR | CR, simmgr_shm->status.defibrillation.shock);
+		statusTrack("defibrillation", -1, "energy", SR, simmgr_shm->status.defibrillation.energy);
+	}
+
+	if (statusSectionBegin(STATUS_SEC_DEBUG, dirty))
+	{
+		statusTrack("debug", -1, "msec", SR | QR, simmgr_shm->server.msec_time);
+		statusTrack("debug", -1, "avg_rate", SR | QR, simmgr_shm->status.cardiac.avg_rate);
+		statusTrack("debug", -1, "breathInterval", SR, breathInterval);
+		statusTrack("debug", -1, "debug1", QR, simmgr_shm->server.dbg1);
+		statusTrack("debug", -1, "debug2", SR | QR, simmgr_shm->server.dbg2);
+		statusTrack("debug", -1, "debug3", SR | QR, simmgr_shm->server.dbg3);
+	}
+
+	if (statusSectionBegin(STATUS_SEC_CONTROLLERS, dirty))
+	{
+		// Unallocated controller slots report an empty string, so a delta can show a removal
+		for (i = 0; i < MAX_CONTROLLERS; i++)
+		{
+			sprintf_s(ctrlKey, sizeof(ctrlKey), "%d", i + 1);
+			reply.clear();
+			if (simmgr_shm->simControllers[i].allocated)
+			{
+				reply = simmgr_shm->simControllers[i].ipAddr;
+				if (strlen(simmgr_shm->simControllers[i].version))
+				{
+					reply.append(" Version ");
+					reply.append(simmgr_shm->simControllers[i].version);
+				}
+			}
+			statusTrack("controllers", -1, ctrlKey, SR, reply.c_str());
+		}
+		for (i = 0; i < MAX_CONTROLLERS; i++)
+		{
+			sprintf_s(ctrlKey, sizeof(ctrlKey), "%d", i + 1);
+			statusTrack("controllerVersions", -1, ctrlKey, SR,
+				simmgr_shm->simControllers[i].allocated ? simmgr_shm->simControllers[i].version : "");
+		}
+	}
+
+	(void)statusSectionBegin(0, dirty);	// The end of the log
+
+	if (statusLogNext != statusLog.size())
+	{
+		// Should never happen; the field list is fixed. Start the log over.
+		statusLog.clear();
+		statusSectionStart.clear();
+		statusLogNext = 0;
+		refreshStatusLog();
+		return;
+	}
+	if (statusLogChanged)
+	{
+		statusVersion++;
+	}
+}
+#undef SR
+#undef QR
+#undef CR
+
+/*
+ * statusDeltaUsable
+ *
+ * A delta is sent unless the client has no base (since=0), holds a version from before
+ * a restart, or is so far behind that the delta would be about the size of the snapshot.
+ */
+int
+statusDeltaUsable(unsigned int since)
+{
+	if (since == 0 || since > statusVersion)
+	{
+		return (0);
+	}
+	if (statusVersion - since > STATUS_DELTA_WINDOW)
+	{
+		return (0);
+	}
+	return (1);
+}
+
+/*
+ * sendStatusDelta
+ *
+ * Send the fields of the given report that changed after "since". The reply is
+ * marked with "delta" so the client knows to merge rather than replace.
+ */
+void
+sendStatusDelta(int report, unsigned int since)
+{
+	char buffer[32];
+	const char* section = NULL;
+	int sub = -1;
+	int first = 1;
+	size_t idx;
+
+	switch (report)
+	{
+	case STATUS_RPT_QSTAT:
+		makejson("delta", "qstat");
+		break;
+	case STATUS_RPT_SIMCTRL:
+		makejson("delta", "simctrldata");
+		break;
+	default:
+		makejson("delta", "status");
+		break;
+	}
+
+	for (idx = 0; idx < statusLog.size(); idx++)
+	{
+		struct statusField* field = &statusLog[idx];
+
+		if ((field->reports & report) == 0 || field->version <= since)
+		{
+			continue;
+		}
+		if (section == NULL || strcmp(section, field->section) != 0)
+		{
+			if (sub >= 0)
+			{
+				htmlReply += "\n  }";
+			}
+			if (section)
+			{
+				htmlReply += "\n}";
+			}
+			htmlReply += ",\n \"";
+			htmlReply += field->section;
+			htmlReply += "\" : {\n";
+			section = field->section;
+			sub = -1;
+			first = 1;
+		}
+		if (field->sub != sub)
+		{
+			if (sub >= 0)
+			{
+				htmlReply += "\n  }";
+				first = 0;
+			}
+			sub = field->sub;
+			if (sub >= 0)
+			{
+				if (!first)
+				{
+					htmlReply += ",\n";
+				}
+				sprintf_s(buffer, sizeof(buffer), "\"%d\" : {\n", sub);
+				htmlReply += buffer;
+				first = 1;
+			}
+		}
+		if (!first)
+		{
+			htmlReply += ",\n";
+		}
+		first = 0;
+		makejson(field->key, field->value);
+
+		// Same one-shot behaviour as sendStatus
+		if (strcmp(field->section, "scenario") == 0 && field->key.compare("error_message") == 0 &&
+			report == STATUS_RPT_STATUS)
+		{
+			simmgr_shm->status.scenario.error_message[0] = 0;
+			statusMarkDirty(STATUS_SEC_SCENARIO);
+		}
+	}
+	if (sub >= 0)
+	{
+		htmlReply += "\n  }";
+	}
+	if (section)
+	{
+		htmlReply += "\n}";
+	}
+}
+
 void
 sendStatus(void)
 {
@@ -1033,6 +1691,7 @@ sendStatus(void)
 		makejson("error_message", simmgr_shm->status.scenario.error_message);
 		htmlReply += ",\n";
 		simmgr_shm->status.scenario.error_message[0] = 0;
+		statusMarkDirty(STATUS_SEC_SCENARIO);
 	}
 	makejson("state", simmgr_shm->status.scenario.state);
 	htmlReply += "\n},\n";
@@ -1525,57 +2184,3 @@ sendQuickStatus(void)
 	makejson("debug3", buffer);
 	htmlReply += "\n}\n";
 }
-void replaceAll(char* args, size_t len, const char* needle, const char replace)
-{
-	char* src;
-	char* next;
-	string lbuf;
-	int sts;
-	int count = 0;
-
-	if (strlen(needle) == 1)
-	{
-		size_t i;
-		for (i = 0; i < len; i++)
-		{
-			if ( args[i] == needle[0] )
-			{
-				args[i] = replace;
-			}
-		}
-	}
-	else
-	{
-		src = args;
-		while (src)
-		{
-			next = strstr(src, needle);
-			if (next)
-			{
-				next[0] = replace;
-				next[1] = 0;
-				lbuf += src;
-				src = next + strlen(needle);
-				count++;
-			}
-			else
-			{
-				lbuf += src;
-				src = NULL;
-			}
-		}
-		if (count > 0)
-		{
-			if (args &&
-				strlen(args) > 0 &&
-				len > 0 &&
-				lbuf.length() > 0)
-			{
-				sts = sprintf_s(args,
-					len,
-					"%s",
-					lbuf.c_str());
-			}
-		}
-	}
-}
@@ -0,0 +1,448 @@
+/*
+ * simstatus_bench.cpp
+ *
+ * simstatus request benchmark and fuzz target
+ *
+ * This file is part of the sim-mgr distribution (https://github.com/OpenVetSim/sim-mgr).
+ *
+ * Copyright (c) 2019-2025 ITown Design
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+ * Usage: WinVetSim --httpbench [-n requests]
+ *
+ * Times httpRequest::parse on the requests the simstatus port sees: an Instructor
+ * Interface qstat poll with browser headers, a GET carrying escaped set: arguments,
+ * a form POST, eight pipelined polls in one buffer and the set: GET arriving in three
+ * segments. Each pass copies the request into a receive buffer, as recv would, and
+ * parses it to the end, so the in-place decoding is measured on fresh bytes.
+ *
+ * It then times the routing of single set: arguments, as simstatusHandleCommand
+ * validates them, against the routing that the hashed switches replaced: the
+ * arguments copied into a map<int, argument>, the key split by explode(), the class
+ * found down the compare() chain and the parameter down the *_parse strcmp ladder.
+ * That older path is reproduced below, without its printing, since it is no longer
+ * in the tree. Each argument is routed n times each way.
+ *
+ * The Fuzz|x64 configuration (see scenario_bench.cpp) runs httpFuzzOne below in place
+ * of the XML target when VETSIM_FUZZ=http is set:
+ *
+ *		set VETSIM_FUZZ=http
+ *		WinVetSim.exe -dict=fuzz\http.dict -max_len=70000 work fuzz\http
+ */
+#include "vetsim.h"
+#include "httpRequest.h"
+#include <string>
+#include <vector>
+#include <map>
+#include <sstream>
+#include <chrono>
+
+#define HTTP_BENCH_REQUESTS	1000000
+
+int checkSetCommand(std::string_view key, std::string_view value);
+
+struct http_bench_case
+{
+	const char* name;
+	const char* request;
+	int segments;		// Parts the request is received in
+};
+
+static const struct http_bench_case httpCases[] =
+{
+	{ "qstat",
+		"GET /cgi-bin/simstatus.cgi?qstat=1 HTTP/1.1\r\n"
+		"Host: 192.168.1.10:40844\r\n"
+		"Connection: keep-alive\r\n"
+		"User-Agent: Mozilla/5.0 (Windows NT 10.0; Win64; x64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/120.0.0.0 Safari/537.36\r\n"
+		"Accept: application/json, text/javascript, */*; q=0.01\r\n"
+		"Referer: http://192.168.1.10/sim-ii/ii.php\r\n"
+		"Accept-Encoding: gzip, deflate\r\n"
+		"Accept-Language: en-US,en;q=0.9\r\n"
+		"Cookie: PHPSESSID=8f0e6d3b2c1a4f5e9d8c7b6a5f4e3d2c\r\n"
+		"\r\n", 1 },
+	{ "set",
+		"GET /cgi-bin/simstatus.cgi?set%3Acardiac%3Arate=120&set%3Acardiac%3Arhythm=afib"
+		"&set%3Arespiration%3Aspo2=91&set%3Aevent%3Acomment=Fluids+given%2C+500+mL+%2B+KCl"
+		"&set%3Ageneral%3Atemperature=1032&userID=instructor HTTP/1.1\r\n"
+		"Host: 192.168.1.10:40844\r\n"
+		"Connection: close\r\n"
+		"\r\n", 1 },
+	{ "post",
+		"POST /cgi-bin/simstatus.cgi HTTP/1.1\r\n"
+		"Host: 192.168.1.10:40844\r\n"
+		"Content-Type: application/x-www-form-urlencoded\r\n"
+		"Content-Length: 101\r\n"
+		"\r\n"
+		"set%3Acardiac%3Abps_sys=90&set%3Acardiac%3Abps_dia=50&set%3Aevent%3Aevent_id=epinephrine&status=1&x=1", 1 },
+	{ "pipelined x8",
+		"GET /simstatus.cgi?qstat=1 HTTP/1.1\r\nHost: localhost\r\n\r\n"
+		"GET /simstatus.cgi?qstat=1 HTTP/1.1\r\nHost: localhost\r\n\r\n"
+		"GET /simstatus.cgi?simctrldata=1 HTTP/1.1\r\nHost: localhost\r\n\r\n"
+		"GET /simstatus.cgi?qstat=1 HTTP/1.1\r\nHost: localhost\r\n\r\n"
+		"GET /simstatus.cgi?status=1 HTTP/1.1\r\nHost: localhost\r\n\r\n"
+		"GET /simstatus.cgi?qstat=1 HTTP/1.1\r\nHost: localhost\r\n\r\n"
+		"GET /simstatus.cgi?since=1234 HTTP/1.1\r\nHost: localhost\r\n\r\n"
+		"GET /simstatus.cgi?qstat=1 HTTP/1.1\r\nHost: localhost\r\n\r\n", 1 },
+	{ "set, 3 segments",
+		"GET /cgi-bin/simstatus.cgi?set%3Acardiac%3Arate=120&set%3Acardiac%3Arhythm=afib"
+		"&set%3Arespiration%3Aspo2=91&set%3Aevent%3Acomment=Fluids+given%2C+500+mL+%2B+KCl"
+		"&set%3Ageneral%3Atemperature=1032&userID=instructor HTTP/1.1\r\n"
+		"Host: 192.168.1.10:40844\r\n"
+		"Connection: close\r\n"
+		"\r\n", 3 },
+};
+
+// set: arguments for the routing benchmark; the last one is not a parameter
+static const char* setCases[][2] =
+{
+	{ "set:cardiac:rate", "120" },
+	{ "set:cardiac:rhythm", "afib" },
+	{ "set:cardiac:left_femoral_pulse_strength", "2" },
+	{ "set:respiration:spo2", "91" },
+	{ "set:general:temperature", "1032" },
+	{ "set:event:event_id", "epinephrine" },
+	{ "set:cpr:compression", "1" },
+	{ "set:pulse:left_femoral", "1" },
+	{ "set:auscultation:col", "2" },
+	{ "set:cardiac:no_such_param", "1" },
+};
+
+// Class and parameter order of the compare() chain and the *_parse ladders
+static const char* legacyClasses[] =
+{
+	"cardiac", "scenario", "respiration", "general", "telesim", "vocals", "media",
+	"event", "cpr", "pulse", "auscultation", NULL
+};
+static const char* legacyCardiac[] =
+{
+	"rhythm", "vpc", "pea", "vpc_freq", "vpc_delay", "vfib_amplitude", "pwave", "rate",
+	"transfer_time", "pr_interval", "qrs_interval", "bps_sys", "bps_dia", "nibp_rate",
+	"nibp_read", "nibp_linked_hr", "nibp_freq", "ecg_indicator", "bp_cuff", "heart_sound",
+	"heart_sound_volume", "heart_sound_mute", "right_dorsal_pulse_strength",
+	"left_dorsal_pulse_strength", "right_femoral_pulse_strength",
+	"left_femoral_pulse_strength", "arrest", NULL
+};
+static const char* legacyRespiration[] =
+{
+	"left_lung_sound", "right_lung_sound", "inhalation_duration", "exhalation_duration",
+	"left_lung_sound_volume", "left_lung_sound_mute", "right_lung_sound_volume",
+	"right_lung_sound_volume", "right_lung_sound_mute", "rate", "spo2", "etco2",
+	"transfer_time", "etco2_indicator", "spo2_indicator", "chest_movement", "manual_count",
+	"manual_breath", NULL
+};
+static const char* legacyGeneral[] =
+{
+	"temperature_enable", "temperature_units", "temperature", "transfer_time", "clock_start", NULL
+};
+static const char* legacyScenario[] = { "active", "state", "record", NULL };
+static const char* legacyEvent[] = { "event_id", "comment", NULL };
+static const char* legacyCpr[] = { "compression", "release", NULL };
+static const char* legacyPulse[] = { "right_dorsal", "left_dorsal", "right_femoral", "left_femoral", NULL };
+static const char* legacyAuscultation[] = { "side", "row", "col", NULL };
+
+struct legacy_argument
+{
+	std::string key;
+	std::string value;
+};
+
+static std::vector<std::string>
+legacyExplode(std::string const& s, char delim)
+{
+	std::vector<std::string> result;
+	std::istringstream iss(s);
+
+	for (std::string token; std::getline(iss, token, delim); )
+	{
+		result.push_back(token);
+	}
+	return (result);
+}
+
+/*
+ * legacyRoute
+ *
+ * The set: routing before the hashed switches. The value is converted with atoi, as
+ * most of the old ladder's branches did. Returns 0, 1 for an unknown parameter or
+ * 2 for an unknown class.
+ */
+static int
+legacyRoute(const char* key, const char* value, int* sink)
+{
+	static const char** params[] =
+	{
+		legacyCardiac, legacyScenario, legacyRespiration, legacyGeneral, NULL, NULL, NULL,
+		legacyEvent, legacyCpr, legacyPulse, legacyAuscultation
+	};
+	std::map<int, struct legacy_argument> argList;
+	std::vector<std::string> v;
+	int cls;
+	int i;
+
+	argList[0] = { key, value };
+	for (auto& arg : argList)
+	{
+		if (arg.second.key.compare(0, 4, "set:") != 0)
+		{
+			continue;
+		}
+		v = legacyExplode(arg.second.key, ':');
+		if (v.size() < 3)
+		{
+			return (1);
+		}
+		for (cls = 0; legacyClasses[cls] && v[1].compare(legacyClasses[cls]) != 0; cls++)
+			;
+		if (!legacyClasses[cls] || !params[cls])
+		{
+			return (2);
+		}
+		for (i = 0; params[cls][i] && strcmp(v[2].c_str(), params[cls][i]) != 0; i++)
+			;
+		if (!params[cls][i])
+		{
+			return (1);
+		}
+		*sink += atoi(arg.second.value.c_str());
+	}
+	return (0);
+}
+
+/*
+ * setBenchOne
+ * @key: set: argument
+ * @value: its value
+ * @passes: times to route it each way
+ * @before: receives nsec per argument through legacyRoute
+ * @after: receives nsec per argument through checkSetCommand
+ */
+static void
+setBenchOne(const char* key, const char* value, int passes, double* before, double* after)
+{
+	std::string_view keyView(key);
+	std::string_view valueView(value);
+	std::chrono::steady_clock::time_point start;
+	volatile int sink = 0;
+	int parsed = 0;
+	int acc = 0;
+	int pass;
+
+	start = std::chrono::steady_clock::now();
+	for (pass = 0; pass < passes; pass++)
+	{
+		acc += legacyRoute(key, value, &parsed);
+	}
+	*before = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() * 1e9 / passes;
+
+	start = std::chrono::steady_clock::now();
+	for (pass = 0; pass < passes; pass++)
+	{
+		if (keyView.compare(0, 4, "set:") == 0)
+		{
+			acc += checkSetCommand(keyView, valueView);
+		}
+	}
+	*after = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() * 1e9 / passes;
+	sink = acc + parsed;
+}
+
+static void
+usage(void)
+{
+	printf("Usage: WinVetSim --httpbench [-n requests]\n");
+}
+
+/*
+ * httpBenchOne
+ * @test: request to time
+ * @requests: how many to parse
+ * @nsec: receives nsec per request
+ * @mbs: receives MB/s of request bytes
+ * @args: receives the arguments found in one pass
+ *
+ * Returns 0, or -1 if the request does not parse.
+ */
+static int
+httpBenchOne(const struct http_bench_case* test, int requests, double* nsec, double* mbs, int* args)
+{
+	std::vector<char> buf;
+	httpRequest request;
+	size_t len = strlen(test->request);
+	size_t offset;
+	size_t received;
+	int perPass = 0;
+	int done = 0;
+	int sts;
+	double sec;
+	std::chrono::steady_clock::time_point start;
+
+	buf.resize(len);
+	*args = 0;
+	start = std::chrono::steady_clock::now();
+	while (done < requests)
+	{
+		memcpy(buf.data(), test->request, len);
+		perPass = 0;
+		offset = 0;
+		received = (test->segments > 1 ? len / test->segments : len);
+		while (offset < len)
+		{
+			sts = request.parse(buf.data() + offset, received - offset);
+			if (sts == HTTP_PARSE_INCOMPLETE && received < len)
+			{
+				received = (received + len / test->segments < len ? received + len / test->segments : len);
+				continue;
+			}
+			if (sts != HTTP_PARSE_OK)
+			{
+				return (-1);
+			}
+			offset += request.length;
+			*args += (int)request.args.size();
+			perPass++;
+		}
+		done += perPass;
+	}
+	sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	*nsec = sec * 1e9 / done;
+	*mbs = (double)len * (done / perPass) / 1e6 / sec;
+	*args /= (done / perPass);
+	return (0);
+}
+
+/*
+ * httpBenchMain
+ *
+ * Entry for --httpbench. Returns 0, or 1 if a request did not parse.
+ */
+int
+httpBenchMain(int argc, char* argv[])
+{
+	int requests = HTTP_BENCH_REQUESTS;
+	int sts = 0;
+	int args;
+	int i;
+	double nsec;
+	double mbs;
+	double before;
+	double after;
+	double beforeSum = 0;
+	double afterSum = 0;
+	int count;
+
+	for (i = 0; i < argc; i++)
+	{
+		if (strcmp(argv[i], "-n") == 0 && i + 1 < argc)
+		{
+			requests = atoi(argv[++i]);
+		}
+		else
+		{
+			usage();
+			return (1);
+		}
+	}
+	if (requests < 1)
+	{
+		usage();
+		return (1);
+	}
+
+	printf("%-20s %8s %6s %12s %10s\n", "Request", "Bytes", "Args", "nsec/req", "MB/s");
+	for (auto& test : httpCases)
+	{
+		if (httpBenchOne(&test, requests, &nsec, &mbs, &args) != 0)
+		{
+			printf("%-20s failed to parse\n", test.name);
+			sts = 1;
+			continue;
+		}
+		printf("%-20s %8zu %6d %12.1f %10.1f\n", test.name, strlen(test.request), args, nsec, mbs);
+	}
+
+	printf("\n%-44s %14s %14s\n", "set: argument", "Before nsec", "Hashed nsec");
+	for (auto& set : setCases)
+	{
+		setBenchOne(set[0], set[1], requests, &before, &after);
+		printf("%-44s %14.1f %14.1f\n", set[0], before, after);
+		beforeSum += before;
+		afterSum += after;
+	}
+	count = sizeof(setCases) / sizeof(setCases[0]);
+	printf("%-44s %14.1f %14.1f\n", "Mean", beforeSum / count, afterSum / count);
+	return (sts);
+}
+
+#ifdef XML_FUZZ
+/*
+ * httpFuzzOne
+ *
+ * Parse the input as a receive buffer: first as the server would see its first half
+ * arrive, then whole, pipelined to the end. Checks that an incomplete request leaves
+ * the buffer untouched and that every view lies inside the request it came from.
+ */
+int
+httpFuzzOne(const uint8_t* data, size_t size)
+{
+	std::vector<char> buf(data, data + size);	// Exact size, so ASAN sees overruns
+	httpRequest request;
+	size_t offset = 0;
+	int sts;
+
+	auto inside = [&](std::string_view view) {
+		return (view.empty() || (view.data() >= buf.data() + offset &&
+			view.data() + view.length() <= buf.data() + offset + request.length));
+		};
+
+	if (size == 0)
+	{
+		return (0);
+	}
+	if (request.parse(buf.data(), size / 2) == HTTP_PARSE_INCOMPLETE)
+	{
+		if (memcmp(buf.data(), data, size) != 0)
+		{
+			abort();
+		}
+	}
+	else
+	{
+		memcpy(buf.data(), data, size);
+	}
+	while (offset < size)
+	{
+		sts = request.parse(buf.data() + offset, size - offset);
+		if (sts != HTTP_PARSE_OK)
+		{
+			break;
+		}
+		if (request.length == 0 || request.length > size - offset || !inside(request.path))
+		{
+			abort();
+		}
+		for (auto& arg : request.args)
+		{
+			if (!inside(arg.key) || !inside(arg.value))
+			{
+				abort();
+			}
+		}
+		offset += request.length;
+	}
+	return (0);
+}
+#endif
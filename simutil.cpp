@@ -22,6 +22,8 @@
 */
 
 #include "vetsim.h"
+#include "scenario.h"
+#include "XMLScan.h"
 
 using namespace std;
 
@@ -30,6 +32,16 @@ using namespace std;
 extern char msg_buf[];
 
 struct simmgr_shm* simmgr_shm;	// Data structure of the shared memory
+HANDLE scenarioWakeEvent = NULL;	// Signalled by scenarioNotify
+HANDLE initAppliedEvent = NULL;		// Signalled by initApplied
+static volatile LONG initSubmitted = 0;	// Last init batch token handed out
+static volatile LONG initDone = 0;		// Last init batch token scan_commands has applied
+
+// Simulation clock. See simClockMsec.
+static int clockVirtual = 0;
+static ULONGLONG clockVirtualMsec = 0;
+static time_t clockVirtualEpoch = 0;
+static thread_local unsigned int randState = 1;
 
 /*
  * FUNCTION: initSHM
@@ -49,6 +61,17 @@ initSHM(void )
 	extern struct simmgr_shm shmSpace;
 	simmgr_shm = &shmSpace;
 
+	scenarioWakeEvent = CreateEvent(
+		NULL,              // default security attributes
+		FALSE,             // auto-reset, so one wait consumes one wake
+		FALSE,             // initially clear
+		NULL);             // unnamed event
+	initAppliedEvent = CreateEvent(
+		NULL,              // default security attributes
+		FALSE,             // auto-reset
+		FALSE,             // initially clear
+		NULL);             // unnamed event
+
 	return (0);
 }
 /*
@@ -393,43 +416,37 @@ getWIFI_IP()
  *
  * remove leading and trailing spaces. Reduce internal spaces to single. Remove tabs, newlines, CRs.
 */
-#define WHERE_START		0
-#define WHERE_TEXT		1
-#define WHERE_SPACE		2
-
 void
 cleanString(char* strIn)
 {
-	char* in;
-	char* out;
-	int where = WHERE_START;
-
-	in = (char*)strIn;
-	out = (char*)strIn;
-	while (*in)
+	const char* end = strIn + strlen(strIn);
+	const char* in;
+	const char* word;
+	char* out = strIn;
+
+	// Most values are one word. Find the first space with the vector scan, and only
+	// collapse from there on.
+	in = xmlSkip(XML_CLASS_C_SPACE, strIn, end);
+	word = xmlFind(XML_CLASS_C_SPACE, in, end);
+	memmove(out, in, (size_t)(word - in));
+	out += word - in;
+	for (in = word; in < end; in++)
 	{
-		if (isspace(*in))
+		if (isspace((unsigned char)*in))
 		{
-			switch (where)
+			if (out[-1] != ' ')
 			{
-			case WHERE_START:
-			case WHERE_SPACE:
-				break;
-
-			case WHERE_TEXT:
-				*out = ' ';
-				out++;
-				where = WHERE_SPACE;
-				break;
+				*out++ = ' ';
 			}
 		}
 		else
 		{
-			where = WHERE_TEXT;
-			*out = *in;
-			out++;
+			*out++ = *in;
 		}
-		in++;
+	}
+	if (out > strIn && out[-1] == ' ')
+	{
+		out--;
 	}
 	*out = 0;
 }
@@ -474,6 +491,102 @@ releaseInstructorLock()
 	ReleaseMutex(simmgr_shm->instructor.sema );
 }
 
+/*
+ * scenarioNotify
+ *
+ * Wake the scenario thread so scene_check runs now, rather than at its next deadline.
+ * Called when an event is posted, when scan_commands changes the status and when
+ * the scenario state changes. May be called with or without the Instructor lock.
+ */
+void
+scenarioNotify(void)
+{
+	if (scenarioWakeEvent)
+	{
+		SetEvent(scenarioWakeEvent);
+	}
+}
+
+/*
+ * scenarioWait
+ * @msec - longest time to wait, or INFINITE
+ *
+ * Block the scenario thread until scenarioNotify is called or msec passes.
+ * Returns 1 if notified, 0 on timeout.
+ */
+int
+scenarioWait(DWORD msec)
+{
+	if (!scenarioWakeEvent)
+	{
+		Sleep(msec == INFINITE ? SCENARIO_LOOP_DELAY : msec);
+		return (0);
+	}
+	return (WaitForSingleObject(scenarioWakeEvent, msec) == WAIT_OBJECT_0 ? 1 : 0);
+}
+
+/*
+ * initSubmit
+ *
+ * Called by processInit, with the Instructor lock held, after it has written an init
+ * batch to the instructor area. Returns the token to pass to initWait.
+ */
+LONG
+initSubmit(void)
+{
+	return (InterlockedIncrement(&initSubmitted));
+}
+
+/*
+ * initApplied
+ *
+ * Called by scan_commands, with the Instructor lock held, after it has consumed the
+ * instructor area. Every batch submitted before the lock was taken is now applied.
+ */
+void
+initApplied(void)
+{
+	LONG token = InterlockedCompareExchange(&initSubmitted, 0, 0);
+
+	if (InterlockedExchange(&initDone, token) != token && initAppliedEvent)
+	{
+		SetEvent(initAppliedEvent);
+	}
+}
+
+/*
+ * initWait
+ * @token - returned by initSubmit
+ * @msec - longest time to wait
+ *
+ * Block until scan_commands has applied the batch, or msec passes.
+ * Returns 0 when applied, -1 on timeout.
+ */
+int
+initWait(LONG token, DWORD msec)
+{
+	ULONGLONG end = GetTickCount64() + msec;
+	ULONGLONG now;
+
+	while ((LONG)(InterlockedCompareExchange(&initDone, 0, 0) - token) < 0)
+	{
+		now = GetTickCount64();
+		if (now >= end)
+		{
+			return (-1);
+		}
+		if (!initAppliedEvent)
+		{
+			Sleep(10);
+		}
+		else
+		{
+			WaitForSingleObject(initAppliedEvent, (DWORD)(end - now));
+		}
+	}
+	return (0);
+}
+
 /*
  * addEvent
  * @str - pointer to event to add
@@ -503,6 +616,7 @@ addEvent(char* str)
 	{
 		simmgr_shm->instructor.defibrillation.shock = 1;
 	}
+	scenarioNotify();
 }
 
 /*
@@ -671,6 +785,12 @@ clock_gettime(int X, struct timeval* tv)
 	static int              initialized = 0;
 	static BOOL             usePerformanceCounter = 0;
 
+	if (clockVirtual)
+	{
+		tv->tv_sec = (long)(clockVirtualMsec / 1000);
+		tv->tv_usec = (long)(clockVirtualMsec % 1000) * 1000;
+		return (0);
+	}
 	if (!initialized) {
 		LARGE_INTEGER performanceFrequency;
 		initialized = 1;
@@ -699,6 +819,92 @@ clock_gettime(int X, struct timeval* tv)
 	tv->tv_usec = (long)(t.QuadPart % 1000000);
 	return (0);
 }
+
+/*
+ * Simulation clock
+ *
+ * The pulse and breath timers, the trends, the heart and breath rate calculations and
+ * the scenario's scene timing all read the time through simClockMsec, simClockTime and
+ * clock_gettime. Normally these are the tick count and the wall clock. The headless
+ * runner switches to a virtual clock, which only moves when it calls simClockAdvance,
+ * so a run does not depend on how fast or how busy the machine is.
+ */
+
+/*
+ * simClockSetVirtual
+ * @epoch - wall clock time at tick count 0
+ * @msec - tick count at the start of the run
+ */
+void
+simClockSetVirtual(time_t epoch, ULONGLONG msec)
+{
+	clockVirtualEpoch = epoch;
+	clockVirtualMsec = msec;
+	clockVirtual = 1;
+}
+
+int
+simClockIsVirtual(void)
+{
+	return (clockVirtual);
+}
+
+void
+simClockAdvance(ULONGLONG msec)
+{
+	clockVirtualMsec += msec;
+}
+
+/*
+ * simClockMsec
+ *
+ * Returns: msec tick count
+ */
+ULONGLONG
+simClockMsec(void)
+{
+	if (clockVirtual)
+	{
+		return (clockVirtualMsec);
+	}
+	return (GetTickCount64());
+}
+
+/*
+ * simClockTime
+ *
+ * Returns: wall clock time, in seconds
+ */
+time_t
+simClockTime(void)
+{
+	if (clockVirtual)
+	{
+		return (clockVirtualEpoch + (time_t)(clockVirtualMsec / 1000));
+	}
+	return (time(nullptr));
+}
+
+/*
+ * simRand
+ *
+ * rand() for the simulation. Like the CRT, each thread has its own sequence, starting
+ * from seed 1, so a seeded single threaded run repeats exactly on any build.
+ *
+ * Returns: 0 to 0x7fff
+ */
+int
+simRand(void)
+{
+	randState = randState * 214013 + 2531011;
+	return ((int)((randState >> 16) & 0x7fff));
+}
+
+void
+simSrand(unsigned int seed)
+{
+	randState = seed;
+}
 /*
  * getDcode
  *
@@ -0,0 +1,337 @@
+/*
+ * statusLoad.cpp
+ *
+ * Load generator for the simstatus port. Runs a number of polling clients against
+ * a running WinVetSim and reports throughput, latency percentiles and errors.
+ *
+ * This file is part of the sim-mgr distribution (https://github.com/OpenVetSim/sim-mgr).
+ *
+ * Copyright (c) 2019-2025 ITown Design
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+ * Usage: statusLoad [-h host] [-p port] [-c clients] [-d seconds] [-s sets] [-o file.json]
+ *
+ * Each client replays the mix seen from the Instructor Interface and SimControllers:
+ *		qstat		5 Hz
+ *		simctrldata	2 Hz
+ *		status		1 Hz
+ *		set:		with -s, a burst of that many every SET_BURST_PERIOD msec
+ * Every request is a new connection, as the server closes after each reply.
+ * The set: burst is off by default. It writes cardiac:vpc_delay=0 on the running
+ * simulation, which is sent to the SimControllers and can fire a scenario trigger,
+ * so only use -s against a simulation that is not in use.
+ */
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <chrono>
+#include <algorithm>
+
+#pragma comment(lib, "Ws2_32.lib")
+
+#include "../vetsimDefs.h"
+
+using namespace std;
+
+#define REQ_QSTAT		0
+#define REQ_SIMCTRL		1
+#define REQ_STATUS		2
+#define REQ_SET			3
+#define REQ_TYPES		4
+
+#define SET_BURST_PERIOD	10000	// msec
+
+const char* reqNames[REQ_TYPES] = { "qstat", "simctrldata", "status", "set" };
+const char* reqArgs[REQ_TYPES] = { "qstat=1", "simctrldata=1", "status=1", "set:cardiac:vpc_delay=0" };
+int reqPeriod[REQ_TYPES] = { 200, 500, 1000, SET_BURST_PERIOD };	// msec
+
+struct reqStats
+{
+	vector<long long> usec;		// Latency of each successful request
+	unsigned int errors = 0;
+	unsigned long long bytes = 0;
+};
+
+char host[256] = "127.0.0.1";
+int port = DEFAULT_PORT_STATUS;
+int clients = 10;
+int duration = 30;
+int setBurst = 0;		// set: requests per burst; 0 for none
+char outFile[256] = "statusLoad.json";
+
+mutex statsMutex;
+struct reqStats totals[REQ_TYPES];
+
+/*
+ * doRequest
+ *
+ * Send one GET and read the reply until the server closes.
+ * Returns the number of bytes received, or -1 on any failure or a non-200 reply.
+ */
+static int
+doRequest(struct sockaddr_in* addr, const char* args)
+{
+	SOCKET sfd;
+	char req[512];
+	char buf[16384];
+	int len;
+	int total = 0;
+	int ok = 0;
+
+	sfd = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+	if (sfd == INVALID_SOCKET)
+	{
+		return (-1);
+	}
+	if (connect(sfd, (struct sockaddr*)addr, sizeof(*addr)) == SOCKET_ERROR)
+	{
+		closesocket(sfd);
+		return (-1);
+	}
+	len = sprintf_s(req, sizeof(req), "GET /simstatus.cgi?%s HTTP/1.1\r\nHost: %s\r\nConnection: close\r\n\r\n", args, host);
+	if (send(sfd, req, len, 0) != len)
+	{
+		closesocket(sfd);
+		return (-1);
+	}
+	while ((len = recv(sfd, buf, sizeof(buf), 0)) > 0)
+	{
+		if (total == 0 && len >= 12 && strncmp(buf, "HTTP/1.1 200", 12) == 0)
+		{
+			ok = 1;
+		}
+		total += len;
+	}
+	closesocket(sfd);
+	if (len < 0 || !ok)
+	{
+		return (-1);
+	}
+	return (total);
+}
+
+static void
+clientMain(int id, chrono::steady_clock::time_point end)
+{
+	struct sockaddr_in addr;
+	struct reqStats stats[REQ_TYPES];
+	chrono::steady_clock::time_point next[REQ_TYPES];
+	chrono::steady_clock::time_point now;
+	chrono::steady_clock::time_point start;
+	int type;
+	int due;
+	int count;
+	int sts;
+	int i;
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(port);
+	inet_pton(AF_INET, host, &addr.sin_addr);
+
+	// Stagger the clients so they don't all poll in step
+	now = chrono::steady_clock::now();
+	for (type = 0; type < REQ_TYPES; type++)
+	{
+		next[type] = now + chrono::milliseconds((id * 37 + type * 11) % reqPeriod[type]);
+	}
+	if (setBurst == 0)
+	{
+		next[REQ_SET] = chrono::steady_clock::time_point::max();
+	}
+
+	while (1)
+	{
+		now = chrono::steady_clock::now();
+		if (now >= end)
+		{
+			break;
+		}
+		due = 0;
+		for (type = 1; type < REQ_TYPES; type++)
+		{
+			if (next[type] < next[due])
+			{
+				due = type;
+			}
+		}
+		if (next[due] > now)
+		{
+			this_thread::sleep_until(min(next[due], end));
+			continue;
+		}
+		next[due] += chrono::milliseconds(reqPeriod[due]);
+
+		count = (due == REQ_SET ? setBurst : 1);
+		for (i = 0; i < count; i++)
+		{
+			start = chrono::steady_clock::now();
+			sts = doRequest(&addr, reqArgs[due]);
+			if (sts < 0)
+			{
+				stats[due].errors++;
+			}
+			else
+			{
+				stats[due].usec.push_back(chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - start).count());
+				stats[due].bytes += sts;
+			}
+		}
+	}
+
+	lock_guard<mutex> lock(statsMutex);
+	for (type = 0; type < REQ_TYPES; type++)
+	{
+		totals[type].usec.insert(totals[type].usec.end(), stats[type].usec.begin(), stats[type].usec.end());
+		totals[type].errors += stats[type].errors;
+		totals[type].bytes += stats[type].bytes;
+	}
+}
+
+static long long
+percentile(vector<long long>& sorted, double pct)
+{
+	size_t idx;
+
+	if (sorted.empty())
+	{
+		return (0);
+	}
+	idx = (size_t)(pct / 100.0 * (double)(sorted.size() - 1) + 0.5);
+	return (sorted[idx]);
+}
+
+static void
+writeStats(FILE* fp, const char* name, struct reqStats* stats, int last)
+{
+	sort(stats->usec.begin(), stats->usec.end());
+	fprintf(fp, "  \"%s\" : {\n", name);
+	fprintf(fp, "   \"requests\" : %zu,\n", stats->usec.size());
+	fprintf(fp, "   \"errors\" : %u,\n", stats->errors);
+	fprintf(fp, "   \"per_sec\" : %.1f,\n", (double)stats->usec.size() / duration);
+	fprintf(fp, "   \"avg_bytes\" : %llu,\n", stats->usec.empty() ? 0ULL : stats->bytes / stats->usec.size());
+	fprintf(fp, "   \"p50_usec\" : %lld,\n", percentile(stats->usec, 50.0));
+	fprintf(fp, "   \"p99_usec\" : %lld,\n", percentile(stats->usec, 99.0));
+	fprintf(fp, "   \"p999_usec\" : %lld,\n", percentile(stats->usec, 99.9));
+	fprintf(fp, "   \"max_usec\" : %lld\n", stats->usec.empty() ? 0LL : stats->usec.back());
+	fprintf(fp, "  }%s\n", last ? "" : ",");
+}
+
+static void
+usage(const char* name)
+{
+	printf("Usage: %s [-h host] [-p port] [-c clients] [-d seconds] [-s sets] [-o file.json]\n", name);
+	printf("  -s sets: send a burst of set:cardiac:vpc_delay=0 every %d seconds. This changes the\n", SET_BURST_PERIOD / 1000);
+	printf("           running simulation, so it is off by default.\n");
+	exit(1);
+}
+
+int main(int argc, char* argv[])
+{
+	WSADATA w;
+	vector<thread> threads;
+	chrono::steady_clock::time_point end;
+	struct reqStats all;
+	FILE* fp;
+	int type;
+	int i;
+
+	for (i = 1; i < argc; i++)
+	{
+		if (i + 1 >= argc || argv[i][0] != '-')
+		{
+			usage(argv[0]);
+		}
+		switch (argv[i][1])
+		{
+		case 'h':
+			sprintf_s(host, sizeof(host), "%s", argv[++i]);
+			break;
+		case 'p':
+			port = atoi(argv[++i]);
+			break;
+		case 'c':
+			clients = atoi(argv[++i]);
+			break;
+		case 'd':
+			duration = atoi(argv[++i]);
+			break;
+		case 's':
+			setBurst = atoi(argv[++i]);
+			break;
+		case 'o':
+			sprintf_s(outFile, sizeof(outFile), "%s", argv[++i]);
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+	if (clients < 1 || duration < 1 || setBurst < 0)
+	{
+		usage(argv[0]);
+	}
+	if (WSAStartup(0x0202, &w))
+	{
+		printf("WSAStartup fails\n");
+		return (1);
+	}
+
+	printf("%d clients against %s:%d for %d seconds\n", clients, host, port, duration);
+	end = chrono::steady_clock::now() + chrono::seconds(duration);
+	for (i = 0; i < clients; i++)
+	{
+		threads.push_back(thread(clientMain, i, end));
+	}
+	for (auto& t : threads)
+	{
+		t.join();
+	}
+	WSACleanup();
+
+	for (type = 0; type < REQ_TYPES; type++)
+	{
+		all.usec.insert(all.usec.end(), totals[type].usec.begin(), totals[type].usec.end());
+		all.errors += totals[type].errors;
+		all.bytes += totals[type].bytes;
+	}
+
+	if (fopen_s(&fp, outFile, "w") != 0 || fp == NULL)
+	{
+		printf("Cannot write %s\n", outFile);
+		return (1);
+	}
+	fprintf(fp, "{\n \"host\" : \"%s\",\n \"port\" : %d,\n \"clients\" : %d,\n \"seconds\" : %d,\n \"set_burst\" : %d,\n \"results\" : {\n",
+		host, port, clients, duration, setBurst);
+	for (type = 0; type < REQ_TYPES; type++)
+	{
+		writeStats(fp, reqNames[type], &totals[type], 0);
+	}
+	writeStats(fp, "total", &all, 1);
+	fprintf(fp, " }\n}\n");
+	fclose(fp);
+
+	printf("%zu requests, %.1f/sec, %u errors, p50 %lld usec, p99 %lld usec, p999 %lld usec\n",
+		all.usec.size(), (double)all.usec.size() / duration, all.errors,
+		percentile(all.usec, 50.0), percentile(all.usec, 99.0), percentile(all.usec, 99.9));
+	printf("Results written to %s\n", outFile);
+	return (all.errors ? 2 : 0);
+}
@@ -52,6 +52,7 @@
 #include <functional>
 #include <mutex>
 #include <vector>
+#include <string_view>
 #include <locale>
 #include <sstream>
 #include <codecvt>
@@ -78,6 +79,9 @@
 // Terminate a running scenario after the limit is reached
 #define MAX_SCENARIO_RUNTIME (1*60*60)	// 1 Hour, time in seconds
 
+// Longest wait (msec) for scan_commands to apply a scenario or scene init section
+#define INIT_APPLY_TIMEOUT	1000
+
 // When initSHM is called, only the simmgr daemon should set OPEN_WITH_CREATE
 // All other open with _OPEN_ACCESS
 #define	OPEN_WITH_CREATE		1
@@ -470,11 +474,42 @@ void releaseInstructorLock();
 void addEvent(char* str);
 void addComment(char* str);
 void lockAndComment(char* str);
+void scenarioNotify(void);
+int scenarioWait(DWORD msec);
+LONG initSubmit(void);
+void initApplied(void);
+int initWait(LONG token, DWORD msec);
 void forceInstructorLock(void);
 void awrr_restart(void);
 ULONGLONG msec_time_update(void);
+void simClockSetVirtual(time_t epoch, ULONGLONG msec);
+int simClockIsVirtual(void);
+void simClockAdvance(ULONGLONG msec);
+ULONGLONG simClockMsec(void);
+time_t simClockTime(void);
+int simRand(void);
+void simSrand(unsigned int seed);
 std::string GetLastErrorAsString(void);
 void initializeConfiguration(void);
+
+// Sections of the status, as reported by simstatus. Code that writes to the status
+// marks the sections it changed with statusMarkDirty, so a delta poll only compares those.
+#define STATUS_SEC_SCENARIO			0x0001
+#define STATUS_SEC_LOGFILE			0x0002
+#define STATUS_SEC_CARDIAC			0x0004
+#define STATUS_SEC_RESPIRATION		0x0008
+#define STATUS_SEC_AUSCULTATION		0x0010
+#define STATUS_SEC_GENERAL			0x0020
+#define STATUS_SEC_VOCALS			0x0040
+#define STATUS_SEC_PULSE			0x0080
+#define STATUS_SEC_MEDIA			0x0100
+#define STATUS_SEC_TELESIM			0x0200
+#define STATUS_SEC_CPR				0x0400
+#define STATUS_SEC_DEFIBRILLATION	0x0800
+#define STATUS_SEC_DEBUG			0x1000
+#define STATUS_SEC_CONTROLLERS		0x2000
+#define STATUS_SEC_ALL				0x3fff
+void statusMarkDirty(LONG sections);
 int getKeys(void);
 __int64 getDcode(void);
 
@@ -486,9 +521,18 @@ int telesim_parse(const char* elem, const char* value, struct telesim* ts);
 int vocals_parse(const char* elem, const char* value, struct vocals* voc);
 int media_parse(const char* elem, const char* value, struct media* med);
 int cpr_parse(const char* elem, const char* value, struct cpr* cpr);
+int paramSet(std::string_view cls, std::string_view elem, std::string_view value, struct instructor* inst);
+int applySetCommand(const char* key, const char* value, int apply);
 void initializeParameterStruct(struct instructor* initParams);
-void processInit(struct instructor* initParams);
+struct param_delta;
+void processInit(const struct param_delta* initParams);
+extern unsigned int initApplyCount;
+extern unsigned int initApplyTimeouts;
+extern long long initApplyLastUsec;
+extern long long initApplyMaxUsec;
 int getValueFromName(char* param_class, char* param_element);
+int findStatusValue(const char* param_class, const char* param_element, size_t* offset, int* width);
+int getStatusValue(size_t offset, int width);
 // Global Data
 //
 #ifndef SIMUTIL
@@ -502,10 +546,20 @@ extern char* program_invocation_short_name;
 
 void pulseProcessChild(void);
 int pulseTask(void);
+void pulseTimerInit(void);
+void pulseTimerCheck(void);
+void pulseRateCheck(void);
+void pulseBroadcastCheck(void);
 void resetVpc(void);
 int bcastReply(void);
 
 int scenario_main(void);
+int scenarioStart(void);
+int scenarioStep(void);
+int headlessMain(int argc, char* argv[]);
+int validateMain(int argc, char* argv[]);
+int benchMain(int argc, char* argv[]);
+int httpBenchMain(int argc, char* argv[]);
 
 int clock_gettime(int X, struct timeval* tv);
 #define CLOCK_REALTIME	1
@@ -533,6 +587,7 @@ int scan_commands(void);
 void comm_check(void);
 void time_update(void);
 void awrr_check(void);
+void hrcheck_handler(void);
 void cpr_check(void);
 void shock_check(void);
 int start_scenario(void);
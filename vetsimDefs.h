@@ -14,6 +14,7 @@
 #define DEFAULT_PHP_SERVER_ADDRESS	"127.0.0.1"
 #define DEFAULT_LOG_NAME			"simlogs/vetsim.log"
 #define DEFAULT_HTML_PATH			"WinVetSim\\html"
+#define DEFAULT_PREFETCH_MB			256		// Scene media and vocals held ahead of use. 0 to disable.
 
 struct localConfiguration
 {
@@ -23,6 +24,7 @@ struct localConfiguration
 	char php_server_addr[STR_SIZE];
 	char log_name[FILENAME_SIZE];
 	char html_path[FILENAME_SIZE];
+	int prefetch_mb;
 };
 
 